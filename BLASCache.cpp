@@ -0,0 +1,639 @@
+#include "BLASCache.h"
+#include "DXRHelper.h"
+#include"Validation.h"
+#include<algorithm>
+#include<random>
+
+//fnv-1a over raw bytes, continues from hash
+static UINT64 HashBytes(const void* data, size_t size, UINT64 hash)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+D3D12BLASBuildBackend::D3D12BLASBuildBackend(ComPtr<ID3D12Device5> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	this->device = device;
+	this->commandList = commandList;
+	compactedSizeSlots = 0;
+}
+
+void D3D12BLASBuildBackend::AddGeometry(nv_helpers_dx12::BottomLevelASGenerator& bottomLevelAS, Mesh* mesh)
+{
+	auto vertexBuffer = mesh->GetVertexBufferResourceAndCount();
+	auto& indexBuffer = mesh->GetIndexBufferResource();
+
+	if (indexBuffer == nullptr || mesh->GetIndexCount() == 0)
+	{
+		bottomLevelAS.AddVertexBuffer(vertexBuffer.first.Get(), 0, vertexBuffer.second, sizeof(Vertex), 0, 0);
+		return;
+	}
+
+	bottomLevelAS.AddVertexBuffer(vertexBuffer.first.Get(), 0, vertexBuffer.second, sizeof(Vertex),
+		indexBuffer.Get(), 0, mesh->GetIndexCount(), nullptr, 0);
+}
+
+void D3D12BLASBuildBackend::GetBuildSizes(Mesh* mesh, UINT64* scratchSize, UINT64* resultSize)
+{
+	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
+	AddGeometry(bottomLevelAS, mesh);
+	bottomLevelAS.ComputeASBufferSizes(device.Get(), false, true, scratchSize, resultSize);
+}
+
+ComPtr<ID3D12Resource> D3D12BLASBuildBackend::CreateScratchBuffer(UINT64 size)
+{
+	return nv_helpers_dx12::CreateBuffer(device.Get(), size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
+}
+
+ComPtr<ID3D12Resource> D3D12BLASBuildBackend::CreateResultBuffer(UINT64 size)
+{
+	return nv_helpers_dx12::CreateBuffer(device.Get(), size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps);
+}
+
+void D3D12BLASBuildBackend::Build(Mesh* mesh, ID3D12Resource* scratch, ID3D12Resource* result, bool waitForScratch, UINT compactedSizeSlot)
+{
+	if (waitForScratch)
+	{
+		auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(scratch);
+		commandList->ResourceBarrier(1, &barrier);
+	}
+
+	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
+	AddGeometry(bottomLevelAS, mesh);
+
+	//the generator needs the sizes computed before it can build
+	UINT64 scratchSize = 0;
+	UINT64 resultSize = 0;
+	bottomLevelAS.ComputeASBufferSizes(device.Get(), false, true, &scratchSize, &resultSize);
+	bottomLevelAS.Generate(commandList.Get(), scratch, result, false, nullptr,
+		compactedSizeBuffer->GetGPUVirtualAddress() + compactedSizeSlot * sizeof(UINT64));
+}
+
+void D3D12BLASBuildBackend::ReserveCompactedSizeSlots(UINT count)
+{
+	if (count <= compactedSizeSlots)
+		return;
+
+	//only grown between frames, after the previous readback was consumed
+	compactedSizeSlots = count;
+	compactedSizeBuffer = nv_helpers_dx12::CreateBuffer(device.Get(), count * sizeof(UINT64), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nv_helpers_dx12::kDefaultHeapProps);
+
+	auto readbackHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+	compactedSizeReadback = nv_helpers_dx12::CreateBuffer(device.Get(), count * sizeof(UINT64), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, readbackHeapProps);
+}
+
+void D3D12BLASBuildBackend::ReadbackCompactedSizes(UINT count)
+{
+	auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(compactedSizeBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_COPY_SOURCE);
+	commandList->ResourceBarrier(1, &toCopy);
+
+	commandList->CopyBufferRegion(compactedSizeReadback.Get(), 0, compactedSizeBuffer.Get(), 0, count * sizeof(UINT64));
+
+	auto toUAV = CD3DX12_RESOURCE_BARRIER::Transition(compactedSizeBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	commandList->ResourceBarrier(1, &toUAV);
+}
+
+void D3D12BLASBuildBackend::GetCompactedSizes(UINT count, UINT64* sizes)
+{
+	UINT64* mapped = nullptr;
+	D3D12_RANGE readRange = { 0, count * sizeof(UINT64) };
+	ThrowIfFailed(compactedSizeReadback->Map(0, &readRange, reinterpret_cast<void**>(&mapped)));
+	memcpy(sizes, mapped, count * sizeof(UINT64));
+
+	D3D12_RANGE writeRange = { 0, 0 };
+	compactedSizeReadback->Unmap(0, &writeRange);
+}
+
+void D3D12BLASBuildBackend::Compact(ID3D12Resource* source, ID3D12Resource* compacted)
+{
+	nv_helpers_dx12::BottomLevelASGenerator::Compact(commandList.Get(), source, compacted);
+}
+
+BLASCache::BLASCache(std::shared_ptr<BLASBuildBackend> backend)
+{
+	this->backend = backend;
+	scratchPoolSize = 0;
+	ZeroMemory(&stats, sizeof(BLASCacheStats));
+}
+
+BLASCache::~BLASCache()
+{
+}
+
+BLASKey BLASCache::CreateKey(Mesh* mesh)
+{
+	BLASKey key = {};
+	key.vertexCount = mesh->GetVertexCount();
+	key.indexCount = mesh->GetIndexCount();
+
+	//only the positions and the triangles matter to the structure
+	UINT64 hash = 14695981039346656037ull;
+	auto& vertices = mesh->GetVerts();
+
+	//without cpu side data there is nothing to compare, so the mesh is only equal to itself
+	if (vertices.empty())
+	{
+		UINT64 meshID = mesh->GetMeshID();
+		key.contentHash = HashBytes(&meshID, sizeof(meshID), hash);
+		return key;
+	}
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		hash = HashBytes(&vertices[i].Position, sizeof(vertices[i].Position), hash);
+	}
+
+	auto& indices = mesh->GetIndices();
+	if (!indices.empty())
+		hash = HashBytes(indices.data(), indices.size() * sizeof(unsigned int), hash);
+
+	key.contentHash = hash;
+	return key;
+}
+
+UINT BLASCache::Acquire(std::shared_ptr<Mesh> mesh)
+{
+	stats.acquireCount++;
+
+	//same mesh object, no need to hash it again
+	auto meshEntry = meshToEntry.find(mesh->GetMeshID());
+	if (meshEntry != meshToEntry.end())
+	{
+		entries[meshEntry->second].refCount++;
+		stats.cacheHits++;
+		return meshEntry->second;
+	}
+
+	BLASKey key = CreateKey(mesh.get());
+
+	auto keyEntry = keyToEntry.find(key);
+	if (keyEntry != keyToEntry.end())
+	{
+		entries[keyEntry->second].refCount++;
+		meshToEntry[mesh->GetMeshID()] = keyEntry->second;
+		stats.cacheHits++;
+		return keyEntry->second;
+	}
+
+	BLASEntry entry = {};
+	entry.key = key;
+	entry.mesh = mesh;
+	entry.refCount = 1;
+	entry.built = false;
+	entry.compacted = false;
+	backend->GetBuildSizes(mesh.get(), &entry.scratchSize, &entry.resultSize);
+
+	UINT handle;
+	if (!freeEntries.empty())
+	{
+		handle = freeEntries.back();
+		freeEntries.pop_back();
+		entries[handle] = entry;
+	}
+
+	else
+	{
+		handle = (UINT)entries.size();
+		entries.emplace_back(entry);
+	}
+
+	keyToEntry[key] = handle;
+	meshToEntry[mesh->GetMeshID()] = handle;
+	pendingBuilds.emplace_back(handle);
+	stats.entryCount++;
+
+	return handle;
+}
+
+void BLASCache::Release(UINT handle)
+{
+	BLASEntry& entry = entries[handle];
+	if (entry.refCount == 0)
+		return;
+
+	entry.refCount--;
+	if (entry.refCount > 0)
+		return;
+
+	keyToEntry.erase(entry.key);
+	for (auto mesh = meshToEntry.begin(); mesh != meshToEntry.end();)
+	{
+		if (mesh->second == handle)
+			mesh = meshToEntry.erase(mesh);
+		else
+			++mesh;
+	}
+
+	pendingBuilds.erase(std::remove(pendingBuilds.begin(), pendingBuilds.end(), handle), pendingBuilds.end());
+
+	if (entry.built)
+		stats.resultMemory -= entry.resultSize;
+
+	entry.result = nullptr;
+	entry.mesh = nullptr;
+	entry.built = false;
+	freeEntries.emplace_back(handle);
+	stats.entryCount--;
+}
+
+UINT64 BLASCache::PlanScratchPool()
+{
+	UINT64 requiredSize = 0;
+	for (size_t i = 0; i < pendingBuilds.size(); i++)
+	{
+		requiredSize = std::max(requiredSize, entries[pendingBuilds[i]].scratchSize);
+	}
+
+	return std::max(requiredSize, scratchPoolSize);
+}
+
+void BLASCache::BuildPending()
+{
+	if (pendingBuilds.empty())
+		return;
+
+	UINT64 requiredSize = PlanScratchPool();
+	if (requiredSize > scratchPoolSize)
+	{
+		//builds recorded by the last call may still be reading the old pool
+		retiredScratchPool = scratchPool;
+		scratchPool = backend->CreateScratchBuffer(requiredSize);
+		scratchPoolSize = requiredSize;
+		stats.scratchPoolSize = scratchPoolSize;
+	}
+
+	//builds that were never compacted have nothing left to read back
+	pendingCompactions.clear();
+	backend->ReserveCompactedSizeSlots((UINT)pendingBuilds.size());
+
+	for (size_t i = 0; i < pendingBuilds.size(); i++)
+	{
+		BLASEntry& entry = entries[pendingBuilds[i]];
+
+		entry.result = backend->CreateResultBuffer(entry.resultSize);
+		backend->Build(entry.mesh.get(), scratchPool.Get(), entry.result.Get(), stats.buildCount > 0, (UINT)i);
+		entry.built = true;
+
+		stats.buildCount++;
+		stats.resultMemory += entry.resultSize;
+		stats.unpooledScratchMemory += entry.scratchSize;
+	}
+
+	backend->ReadbackCompactedSizes((UINT)pendingBuilds.size());
+	pendingCompactions = pendingBuilds;
+	pendingBuilds.clear();
+}
+
+void BLASCache::CompactPending()
+{
+	if (pendingCompactions.empty())
+		return;
+
+	std::vector<UINT64> compactedSizes(pendingCompactions.size());
+	backend->GetCompactedSizes((UINT)compactedSizes.size(), compactedSizes.data());
+
+	for (size_t i = 0; i < pendingCompactions.size(); i++)
+	{
+		BLASEntry& entry = entries[pendingCompactions[i]];
+
+		//released, or released and reused by a newer acquire, since the build
+		if (!entry.built || entry.compacted)
+			continue;
+
+		UINT64 compactedSize = compactedSizes[i];
+		if (compactedSize == 0 || compactedSize >= entry.resultSize)
+			continue;
+
+		ComPtr<ID3D12Resource> compacted = backend->CreateResultBuffer(compactedSize);
+		backend->Compact(entry.result.Get(), compacted.Get());
+
+		retiredResults.emplace_back(entry.result);
+		entry.result = compacted;
+
+		stats.compactedCount++;
+		stats.compactionSavings += entry.resultSize - compactedSize;
+		stats.resultMemory -= entry.resultSize - compactedSize;
+
+		entry.compactedSize = compactedSize;
+		entry.resultSize = compactedSize;
+		entry.compacted = true;
+	}
+
+	pendingCompactions.clear();
+}
+
+void BLASCache::ReleaseRetired()
+{
+	retiredResults.clear();
+	retiredScratchPool = nullptr;
+}
+
+ID3D12Resource* BLASCache::GetResult(UINT handle)
+{
+	return entries[handle].result.Get();
+}
+
+UINT64 BLASCache::GetResultSize(UINT handle)
+{
+	return entries[handle].resultSize;
+}
+
+bool BLASCache::IsCompacted(UINT handle)
+{
+	return entries[handle].compacted;
+}
+
+UINT BLASCache::GetRefCount(UINT handle)
+{
+	return entries[handle].refCount;
+}
+
+const BLASCacheStats& BLASCache::GetStats()
+{
+	return stats;
+}
+
+//reports sizes from the vertex count and records what the cache asks of it, nothing touches the device
+class FakeBLASBuildBackend : public BLASBuildBackend
+{
+public:
+	std::vector<UINT64> scratchBuffers;
+	std::vector<UINT64> resultBuffers;
+	std::vector<UINT64> slotCompactedSizes;
+	UINT buildCount = 0;
+	UINT waitCount = 0;
+	UINT compactCount = 0;
+
+	void GetBuildSizes(Mesh* mesh, UINT64* scratchSize, UINT64* resultSize) override
+	{
+		*scratchSize = mesh->GetVertexCount() * 64ull;
+		*resultSize = mesh->GetVertexCount() * 256ull;
+	}
+
+	ComPtr<ID3D12Resource> CreateScratchBuffer(UINT64 size) override
+	{
+		scratchBuffers.emplace_back(size);
+		return nullptr;
+	}
+
+	ComPtr<ID3D12Resource> CreateResultBuffer(UINT64 size) override
+	{
+		resultBuffers.emplace_back(size);
+		return nullptr;
+	}
+
+	void Build(Mesh* mesh, ID3D12Resource* scratch, ID3D12Resource* result, bool waitForScratch, UINT compactedSizeSlot) override
+	{
+		buildCount++;
+		waitCount += waitForScratch ? 1 : 0;
+
+		//compaction gives back half of the structure, except for odd vertex counts where it gives nothing back
+		UINT vertexCount = mesh->GetVertexCount();
+		slotCompactedSizes[compactedSizeSlot] = vertexCount * (vertexCount % 2 == 0 ? 128ull : 256ull);
+	}
+
+	void ReserveCompactedSizeSlots(UINT count) override
+	{
+		slotCompactedSizes.resize(std::max((size_t)count, slotCompactedSizes.size()));
+	}
+
+	void ReadbackCompactedSizes(UINT count) override
+	{
+	}
+
+	void GetCompactedSizes(UINT count, UINT64* sizes) override
+	{
+		memcpy(sizes, slotCompactedSizes.data(), count * sizeof(UINT64));
+	}
+
+	void Compact(ID3D12Resource* source, ID3D12Resource* compacted) override
+	{
+		compactCount++;
+	}
+};
+
+//a triangle strip of vertexCount vertices, offset moves the positions so the content differs
+static std::shared_ptr<Mesh> CreateValidationMesh(UINT vertexCount, float offset)
+{
+	std::vector<Vertex> vertices(vertexCount);
+	for (UINT i = 0; i < vertexCount; i++)
+	{
+		vertices[i] = {};
+		vertices[i].Position = Vector3((float)(i / 2) + offset, (float)(i % 2), 0.0f);
+	}
+
+	std::vector<UINT> indices;
+	for (UINT i = 0; i + 2 < vertexCount; i++)
+	{
+		indices.insert(indices.end(), { i, i + 1, i + 2 });
+	}
+
+	return std::make_shared<Mesh>(vertices, vertexCount, indices, (int)indices.size());
+}
+
+void ValidateBLASCache()
+{
+	printf("BLAS cache\n");
+	bool passed = true;
+
+	auto backend = std::make_shared<FakeBLASBuildBackend>();
+	BLASCache cache(backend);
+
+	auto meshA = CreateValidationMesh(30, 0.0f);
+	auto meshB = CreateValidationMesh(30, 0.0f);
+	auto meshC = CreateValidationMesh(60, 5.0f);
+
+	UINT handleA = cache.Acquire(meshA);
+	UINT handleAAgain = cache.Acquire(meshA);
+	UINT handleB = cache.Acquire(meshB);
+	UINT handleC = cache.Acquire(meshC);
+
+	Check(passed, "same mesh hits", handleAAgain == handleA);
+	Check(passed, "same content in another mesh hits", handleB == handleA && cache.GetRefCount(handleA) == 3);
+	Check(passed, "other content misses", handleC != handleA && cache.GetStats().entryCount == 2);
+	Check(passed, "hits and acquires counted", cache.GetStats().acquireCount == 4 && cache.GetStats().cacheHits == 2);
+	Check(passed, "scratch planned for the largest build", cache.PlanScratchPool() == 60 * 64ull);
+
+	cache.BuildPending();
+	Check(passed, "one build per entry", backend->buildCount == 2 && cache.GetStats().buildCount == 2);
+	Check(passed, "builds share one scratch buffer", backend->scratchBuffers.size() == 1 && backend->scratchBuffers[0] == 60 * 64ull);
+	Check(passed, "builds after the first wait on the scratch", backend->waitCount == 1);
+	Check(passed, "result memory before compaction", cache.GetStats().resultMemory == 90 * 256ull);
+	Check(passed, "separate scratch accounted", cache.GetStats().unpooledScratchMemory == 90 * 64ull);
+
+	cache.CompactPending();
+	cache.ReleaseRetired();
+	Check(passed, "both entries compacted", backend->compactCount == 2 && cache.IsCompacted(handleA) && cache.IsCompacted(handleC));
+	Check(passed, "compacted sizes", cache.GetResultSize(handleA) == 30 * 128ull && cache.GetResultSize(handleC) == 60 * 128ull);
+	Check(passed, "compaction savings", cache.GetStats().compactionSavings == 90 * 128ull && cache.GetStats().resultMemory == 90 * 128ull);
+
+	//a hit after the build doesn't build again
+	cache.Acquire(meshC);
+	cache.BuildPending();
+	Check(passed, "hit after the build doesn't rebuild", backend->buildCount == 2);
+
+	//the entry is evicted with its last reference
+	cache.Release(handleC);
+	cache.Release(handleC);
+	Check(passed, "last release evicts", cache.GetStats().entryCount == 1 && cache.GetStats().resultMemory == 30 * 128ull);
+
+	UINT handleCAgain = cache.Acquire(meshC);
+	cache.BuildPending();
+	Check(passed, "evicted mesh misses and rebuilds", backend->buildCount == 3 && cache.GetRefCount(handleCAgain) == 1);
+
+	//meshB's id stays mapped to the shared entry until the entry goes, so a new mesh that lands on meshB's freed address
+	//has to miss. Allocating right after the free usually gets the same address back
+	Mesh* freedAddress = meshB.get();
+	cache.Release(handleB);
+	meshB = nullptr;
+	auto meshD = CreateValidationMesh(30, 9.0f);
+	UINT handleD = cache.Acquire(meshD);
+	printf("    new mesh %s the freed mesh's address\n", meshD.get() == freedAddress ? "reuses" : "doesn't reuse");
+	Check(passed, "new mesh with other content misses", handleD != handleA && cache.GetRefCount(handleA) == 2);
+
+	PrintValidationResult(passed);
+}
+
+//what the memory accounting validation expects of one cache entry
+struct ExpectedBLASEntry
+{
+	std::shared_ptr<Mesh> mesh;
+	UINT handle;
+	UINT refCount;
+	UINT64 resultSize;
+	bool built;
+	bool compactionPending;
+};
+
+void ValidateBLASMemoryAccounting()
+{
+	printf("BLAS memory accounting\n");
+	bool passed = true;
+
+	auto backend = std::make_shared<FakeBLASBuildBackend>();
+	BLASCache cache(backend);
+
+	std::mt19937 generator(5);
+	std::uniform_int_distribution<UINT> vertexCounts(3, 200);
+
+	//the totals the cache should report, kept without asking the cache
+	std::vector<ExpectedBLASEntry> expected;
+	UINT64 expectedScratchPool = 0;
+	UINT64 expectedUnpooledScratch = 0;
+	UINT64 expectedSavings = 0;
+	UINT expectedBuilds = 0;
+	UINT meshCount = 0;
+
+	//drops one reference of a random entry, the entry is gone with the last one
+	auto releaseRandom = [&]()
+	{
+		size_t index = std::uniform_int_distribution<size_t>(0, expected.size() - 1)(generator);
+		cache.Release(expected[index].handle);
+		if (--expected[index].refCount == 0)
+			expected.erase(expected.begin() + index);
+	};
+
+	bool handlesMatch = true;
+	bool totalsMatch = true;
+	for (int round = 0; round < 6; round++)
+	{
+		//every mesh gets its own content, so each one is a new entry
+		for (int i = 0; i < 8; i++)
+		{
+			UINT vertexCount = vertexCounts(generator);
+			ExpectedBLASEntry entry = {};
+			entry.mesh = CreateValidationMesh(vertexCount, 1000.0f * meshCount++);
+			entry.handle = cache.Acquire(entry.mesh);
+			entry.refCount = 1;
+			entry.resultSize = vertexCount * 256ull;
+			expected.emplace_back(entry);
+		}
+
+		//more instances of existing geometry only add references
+		for (int i = 0; i < 3; i++)
+		{
+			size_t index = std::uniform_int_distribution<size_t>(0, expected.size() - 1)(generator);
+			handlesMatch = handlesMatch && cache.Acquire(expected[index].mesh) == expected[index].handle;
+			expected[index].refCount++;
+		}
+
+		//some entries go before they are built, their handles are reused by the next round
+		for (int i = 0; i < 3; i++)
+		{
+			releaseRandom();
+		}
+
+		//the builds suballocate one pool, sized to the largest pending build and never shrunk
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			if (expected[i].built)
+				continue;
+
+			UINT64 scratchSize = expected[i].mesh->GetVertexCount() * 64ull;
+			expectedScratchPool = std::max(expectedScratchPool, scratchSize);
+			expectedUnpooledScratch += scratchSize;
+			expectedBuilds++;
+			expected[i].built = true;
+			expected[i].compactionPending = true;
+		}
+
+		cache.BuildPending();
+
+		//one entry goes between the build and the compaction, so its copy is never made
+		releaseRandom();
+
+		cache.CompactPending();
+		cache.ReleaseRetired();
+
+		UINT64 expectedResultMemory = 0;
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			ExpectedBLASEntry& entry = expected[i];
+			UINT vertexCount = entry.mesh->GetVertexCount();
+
+			//the fake backend only gives memory back for even vertex counts
+			if (entry.compactionPending && vertexCount % 2 == 0)
+			{
+				entry.resultSize = vertexCount * 128ull;
+				expectedSavings += vertexCount * 128ull;
+			}
+
+			entry.compactionPending = false;
+			expectedResultMemory += entry.resultSize;
+			handlesMatch = handlesMatch && cache.GetRefCount(entry.handle) == entry.refCount && cache.GetResultSize(entry.handle) == entry.resultSize;
+		}
+
+		const BLASCacheStats& stats = cache.GetStats();
+		printf("    round %d: %u entries, %llu bytes of results, %llu saved, %llu byte scratch pool\n", round, stats.entryCount,
+			stats.resultMemory, stats.compactionSavings, stats.scratchPoolSize);
+
+		totalsMatch = totalsMatch && stats.entryCount == expected.size() && stats.resultMemory == expectedResultMemory
+			&& stats.compactionSavings == expectedSavings && stats.scratchPoolSize == expectedScratchPool
+			&& stats.unpooledScratchMemory == expectedUnpooledScratch && stats.buildCount == expectedBuilds;
+	}
+
+	Check(passed, "refcounts and sizes of every entry", handlesMatch);
+	Check(passed, "totals after every round", totalsMatch);
+
+	while (!expected.empty())
+	{
+		releaseRandom();
+	}
+
+	const BLASCacheStats& stats = cache.GetStats();
+	Check(passed, "no result memory after the last release", stats.entryCount == 0 && stats.resultMemory == 0);
+	Check(passed, "pool smaller than a scratch buffer per build", stats.scratchPoolSize < stats.unpooledScratchMemory);
+
+	PrintValidationResult(passed);
+}
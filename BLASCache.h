@@ -0,0 +1,174 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include"Mesh.h"
+#include"BottomLevelASGenerator.h"
+#include<unordered_map>
+#include<memory>
+#include<vector>
+
+//geometry a bottom level structure is built from, meshes with the same key share one structure
+struct BLASKey
+{
+	UINT64 contentHash;
+	UINT vertexCount;
+	UINT indexCount;
+
+	bool operator==(const BLASKey& other) const
+	{
+		return contentHash == other.contentHash && vertexCount == other.vertexCount && indexCount == other.indexCount;
+	}
+};
+
+struct BLASKeyHasher
+{
+	size_t operator()(const BLASKey& key) const
+	{
+		return (size_t)(key.contentHash ^ ((UINT64)key.vertexCount << 32) ^ key.indexCount);
+	}
+};
+
+struct BLASEntry
+{
+	BLASKey key;
+	std::shared_ptr<Mesh> mesh;
+	ComPtr<ID3D12Resource> result;
+	UINT64 scratchSize;
+	UINT64 resultSize;
+	UINT refCount;
+	bool built;
+
+	//filled in by CompactPending, until then resultSize is the size reported before the build
+	UINT64 compactedSize;
+	bool compacted;
+};
+
+struct BLASCacheStats
+{
+	UINT entryCount;
+	UINT acquireCount;
+	UINT cacheHits;
+	UINT buildCount;
+	UINT64 resultMemory;
+	UINT64 scratchPoolSize;
+
+	UINT compactedCount;
+	//result memory given back by compaction
+	UINT64 compactionSavings;
+
+	//scratch that a separate buffer per build would have needed
+	UINT64 unpooledScratchMemory;
+};
+
+//everything that touches the device goes through here, so the keying, refcounting and
+//scratch planning of the cache can run against a backend that only reports sizes
+class BLASBuildBackend
+{
+public:
+	virtual ~BLASBuildBackend() {}
+
+	virtual void GetBuildSizes(Mesh* mesh, UINT64* scratchSize, UINT64* resultSize) = 0;
+	virtual ComPtr<ID3D12Resource> CreateScratchBuffer(UINT64 size) = 0;
+	virtual ComPtr<ID3D12Resource> CreateResultBuffer(UINT64 size) = 0;
+
+	//builds that share a scratch buffer are recorded one after the other, waitForScratch asks for a barrier in between
+	//the compacted size of the build is written to compactedSizeSlot of the query buffer
+	virtual void Build(Mesh* mesh, ID3D12Resource* scratch, ID3D12Resource* result, bool waitForScratch, UINT compactedSizeSlot) = 0;
+
+	//query buffer has to hold a slot for every build recorded before the readback
+	virtual void ReserveCompactedSizeSlots(UINT count) = 0;
+	virtual void ReadbackCompactedSizes(UINT count) = 0;
+	//only valid once the readback has executed
+	virtual void GetCompactedSizes(UINT count, UINT64* sizes) = 0;
+
+	virtual void Compact(ID3D12Resource* source, ID3D12Resource* compacted) = 0;
+};
+
+//records the builds with BottomLevelASGenerator on the given command list
+class D3D12BLASBuildBackend : public BLASBuildBackend
+{
+	ComPtr<ID3D12Device5> device;
+	ComPtr<ID3D12GraphicsCommandList4> commandList;
+
+	//compacted sizes written by the builds, copied to the readback buffer for the cpu
+	ComPtr<ID3D12Resource> compactedSizeBuffer;
+	ComPtr<ID3D12Resource> compactedSizeReadback;
+	UINT compactedSizeSlots;
+
+	void AddGeometry(nv_helpers_dx12::BottomLevelASGenerator& bottomLevelAS, Mesh* mesh);
+
+public:
+	D3D12BLASBuildBackend(ComPtr<ID3D12Device5> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+
+	void GetBuildSizes(Mesh* mesh, UINT64* scratchSize, UINT64* resultSize) override;
+	ComPtr<ID3D12Resource> CreateScratchBuffer(UINT64 size) override;
+	ComPtr<ID3D12Resource> CreateResultBuffer(UINT64 size) override;
+	void Build(Mesh* mesh, ID3D12Resource* scratch, ID3D12Resource* result, bool waitForScratch, UINT compactedSizeSlot) override;
+	void ReserveCompactedSizeSlots(UINT count) override;
+	void ReadbackCompactedSizes(UINT count) override;
+	void GetCompactedSizes(UINT count, UINT64* sizes) override;
+	void Compact(ID3D12Resource* source, ID3D12Resource* compacted) override;
+};
+
+//bottom level structures keyed by mesh identity and content, built once and shared by every instance that uses them
+class BLASCache
+{
+	std::shared_ptr<BLASBuildBackend> backend;
+
+	std::vector<BLASEntry> entries;
+	std::vector<UINT> freeEntries;
+	std::unordered_map<BLASKey, UINT, BLASKeyHasher> keyToEntry;
+	//keyed by Mesh::GetMeshID, a freed mesh's address can be reused by a mesh with other geometry
+	std::unordered_map<UINT64, UINT> meshToEntry;
+	std::vector<UINT> pendingBuilds;
+	std::vector<UINT> pendingCompactions;
+
+	//uncompacted results, still referenced by the copies until the gpu is done with them
+	std::vector<ComPtr<ID3D12Resource>> retiredResults;
+
+	//one scratch buffer for all the builds, grown to the largest pending build
+	ComPtr<ID3D12Resource> scratchPool;
+	ComPtr<ID3D12Resource> retiredScratchPool;
+	UINT64 scratchPoolSize;
+
+	BLASCacheStats stats;
+
+public:
+	BLASCache(std::shared_ptr<BLASBuildBackend> backend);
+	~BLASCache();
+
+	static BLASKey CreateKey(Mesh* mesh);
+
+	//returns the handle of the structure for this mesh, a new one is queued for the next BuildPending
+	UINT Acquire(std::shared_ptr<Mesh> mesh);
+
+	//the result is released with the last reference, so only release once the gpu is done with the tlas using it
+	void Release(UINT handle);
+
+	//size the scratch pool has to be for the pending builds
+	UINT64 PlanScratchPool();
+
+	//records every pending build on the backend, the builds of the previous call have to be finished on the gpu
+	void BuildPending();
+
+	//the builds of BuildPending have to be finished on the gpu, records the copies into buffers of the compacted size
+	//and swaps the results, so the tlas has to be built after this
+	void CompactPending();
+
+	//once the gpu is done with the copies
+	void ReleaseRetired();
+
+	ID3D12Resource* GetResult(UINT handle);
+	UINT64 GetResultSize(UINT handle);
+	bool IsCompacted(UINT handle);
+	UINT GetRefCount(UINT handle);
+	const BLASCacheStats& GetStats();
+};
+
+//hits, misses, sharing by content, scratch planning, eviction and compaction against a backend that only reports
+//sizes. The meshes still create their vertex buffers, so this needs the device
+void ValidateBLASCache();
+
+//rounds of acquires, shared references, releases before and after the build, builds suballocating the scratch pool and
+//compactions, with the reported totals checked against ones kept separately after every round
+void ValidateBLASMemoryAccounting();
@@ -0,0 +1,470 @@
+#include "BlueNoisePermutations.h"
+#include"Validation.h"
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<random>
+#include<thread>
+
+static const UINT TableMagic = 0x54504E42;
+static const UINT TableVersion = 2;
+static const UINT BlockPixels = BLUE_NOISE_BLOCK * BLUE_NOISE_BLOCK;
+//keeps the benchmark loops from being optimized out
+static volatile UINT benchmarkSink;
+
+static UINT64 HashNoise(const UINT8* noise, size_t size)
+{
+	UINT64 hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ noise[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+//the block's pixels from the lowest value up, ties in pixel order like the shader's bubble sort left them
+static UINT64 SortWindow(const float* values)
+{
+	UINT order[BlockPixels];
+	for (UINT i = 0; i < BlockPixels; i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order, order + BlockPixels, [values](UINT a, UINT b) { return values[a] < values[b]; });
+
+	UINT64 packed = 0;
+	for (UINT rank = 0; rank < BlockPixels; rank++)
+	{
+		packed |= (UINT64)order[rank] << (rank * 4);
+	}
+	return packed;
+}
+
+BlueNoisePermutationTable::BlueNoisePermutationTable()
+	: noiseWidth(0), noiseHeight(0), noiseHash(0), buildTime(0.0)
+{
+}
+
+BlueNoisePermutationTable::~BlueNoisePermutationTable()
+{
+}
+
+void BlueNoisePermutationTable::Build(const UINT8* noise, UINT width, UINT height, UINT workerCount)
+{
+	if (width < BLUE_NOISE_BLOCK || height < BLUE_NOISE_BLOCK)
+		throw std::logic_error("Blue noise permutations need a texture of at least a block");
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	noiseWidth = width;
+	noiseHeight = height;
+	noiseHash = HashNoise(noise, (size_t)width * height);
+
+	blockOrders.resize((size_t)width * height);
+
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	workerCount = std::min(workerCount, height);
+
+	auto work = [this, noise](UINT firstRow, UINT lastRow)
+	{
+		float values[BlockPixels];
+		for (UINT y = firstRow; y < lastRow; y++)
+		{
+			for (UINT x = 0; x < noiseWidth; x++)
+			{
+				for (UINT i = 0; i < BlockPixels; i++)
+				{
+					UINT noiseX = (x + i % BLUE_NOISE_BLOCK) % noiseWidth;
+					UINT noiseY = (y + i / BLUE_NOISE_BLOCK) % noiseHeight;
+					values[i] = noise[noiseY * noiseWidth + noiseX];
+				}
+				blockOrders[y * noiseWidth + x] = SortWindow(values);
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	UINT rowsPerWorker = (height + workerCount - 1) / workerCount;
+	for (UINT w = 1; w < workerCount; w++)
+	{
+		workers.emplace_back(work, std::min(w * rowsPerWorker, height), std::min((w + 1) * rowsPerWorker, height));
+	}
+	work(0, std::min(rowsPerWorker, height));
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool BlueNoisePermutationTable::Load(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	UINT64 remaining = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[6] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != TableMagic || header[1] != TableVersion)
+		return false;
+	remaining -= sizeof(header);
+
+	//a corrupt header is a miss, the orders are only sized once the dimensions match what is left of the file
+	if (header[2] == 0 || header[3] == 0 || (UINT64)header[2] * header[3] * sizeof(UINT64) != remaining)
+		return false;
+
+	noiseWidth = header[2];
+	noiseHeight = header[3];
+	noiseHash = (UINT64)header[4] | ((UINT64)header[5] << 32);
+	blockOrders.resize((size_t)noiseWidth * noiseHeight);
+	file.read(reinterpret_cast<char*>(blockOrders.data()), blockOrders.size() * sizeof(UINT64));
+	buildTime = 0.0;
+	return file.good();
+}
+
+bool BlueNoisePermutationTable::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[6] = { TableMagic, TableVersion, noiseWidth, noiseHeight, (UINT)noiseHash, (UINT)(noiseHash >> 32) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(blockOrders.data()), blockOrders.size() * sizeof(UINT64));
+	return file.good();
+}
+
+void BlueNoisePermutationTable::LoadOrBuild(const std::filesystem::path& tableFile, const std::filesystem::path& noiseFile)
+{
+	std::vector<UINT8> noise;
+	UINT width, height;
+	if (!LoadBlueNoiseBMP(noiseFile, noise, width, height))
+		throw std::logic_error("Couldn't read the blue noise texture");
+
+	if (Load(tableFile) && noiseWidth == width && noiseHeight == height && noiseHash == HashNoise(noise.data(), noise.size()))
+		return;
+
+	Build(noise.data(), width, height);
+	Save(tableFile);
+}
+
+BlueNoiseFrameOffset BlueNoisePermutationTable::GetFrameOffset(UINT frame)
+{
+	//GenerateR2Sequence from the shaders. Their floats lost the fraction as the frame count grew, a double keeps it to
+	//well under a texel for every frame a UINT counts
+	double g = 1.32471795724474602596;
+	double a1 = 1.0 / g;
+	double a2 = 1.0 / (g * g);
+
+	BlueNoiseFrameOffset offset;
+	offset.x = (UINT16)(fmod(a1 * frame, 1.0) * (noiseWidth - 1));
+	offset.y = (UINT16)(fmod(a2 * frame, 1.0) * (noiseHeight - 1));
+	return offset;
+}
+
+UINT64 BlueNoisePermutationTable::GetBlockOrder(UINT x, UINT y)
+{
+	return blockOrders[(y % noiseHeight) * noiseWidth + x % noiseWidth];
+}
+
+UINT BlueNoisePermutationTable::GetNoiseWidth()
+{
+	return noiseWidth;
+}
+
+UINT BlueNoisePermutationTable::GetNoiseHeight()
+{
+	return noiseHeight;
+}
+
+const std::vector<UINT64>& BlueNoisePermutationTable::GetBlockOrders()
+{
+	return blockOrders;
+}
+
+size_t BlueNoisePermutationTable::GetSizeInBytes()
+{
+	return sizeof(UINT) * 6 + blockOrders.size() * sizeof(UINT64);
+}
+
+double BlueNoisePermutationTable::GetBuildTime()
+{
+	return buildTime;
+}
+
+bool LoadBlueNoiseBMP(const std::filesystem::path& fileName, std::vector<UINT8>& red, UINT& width, UINT& height)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	//the file header and the BITMAPINFOHEADER, read by offset so nothing depends on struct packing
+	UINT8 header[54];
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != 'B' || header[1] != 'M')
+		return false;
+
+	auto read32 = [&header](UINT offset) { return (UINT)header[offset] | (header[offset + 1] << 8) | (header[offset + 2] << 16) | ((UINT)header[offset + 3] << 24); };
+	UINT dataOffset = read32(10);
+	int bmpWidth = (int)read32(18);
+	int bmpHeight = (int)read32(22);
+	UINT bitCount = header[28] | (header[29] << 8);
+	UINT compression = read32(30);
+	if (bmpWidth <= 0 || bmpHeight == 0 || (bitCount != 24 && bitCount != 32) || (compression != 0 && compression != 3))
+		return false;
+
+	width = (UINT)bmpWidth;
+	height = (UINT)std::abs(bmpHeight);
+	UINT pixelBytes = bitCount / 8;
+	UINT rowBytes = (width * pixelBytes + 3) & ~3u;
+	std::vector<UINT8> row(rowBytes);
+	red.resize((size_t)width * height);
+
+	file.seekg(dataOffset);
+	for (UINT r = 0; r < height; r++)
+	{
+		file.read(reinterpret_cast<char*>(row.data()), rowBytes);
+		//bottom up unless the height is negative, blue green red in each pixel
+		UINT y = bmpHeight > 0 ? height - 1 - r : r;
+		for (UINT x = 0; x < width; x++)
+		{
+			red[(size_t)y * width + x] = row[x * pixelBytes + 2];
+		}
+	}
+	return file.good();
+}
+
+//what ComputeBlueNoisePermutedSequencesCS did per block before the table, both sorts on one thread. Returns where
+//the seed of each pixel of the block went
+static void BubbleSortPermutation(const float* intensities, const float* noise, UINT* destinations)
+{
+	float sortedIntensities[BlockPixels];
+	float sortedNoise[BlockPixels];
+	UINT intensityPixels[BlockPixels];
+	UINT noisePixels[BlockPixels];
+	for (UINT i = 0; i < BlockPixels; i++)
+	{
+		sortedIntensities[i] = intensities[i];
+		sortedNoise[i] = noise[i];
+		intensityPixels[i] = i;
+		noisePixels[i] = i;
+	}
+
+	for (UINT i = 0; i < BlockPixels - 1; i++)
+	{
+		for (UINT j = 0; j < BlockPixels - i - 1; j++)
+		{
+			if (sortedIntensities[j] > sortedIntensities[j + 1])
+			{
+				std::swap(sortedIntensities[j], sortedIntensities[j + 1]);
+				std::swap(intensityPixels[j], intensityPixels[j + 1]);
+			}
+			if (sortedNoise[j] > sortedNoise[j + 1])
+			{
+				std::swap(sortedNoise[j], sortedNoise[j + 1]);
+				std::swap(noisePixels[j], noisePixels[j + 1]);
+			}
+		}
+	}
+
+	for (UINT rank = 0; rank < BlockPixels; rank++)
+	{
+		destinations[intensityPixels[rank]] = noisePixels[rank];
+	}
+}
+
+//what the shader does now, each thread counts the intensities below its own and looks its rank up in the order
+static void TablePermutation(const float* intensities, UINT64 order, UINT* destinations)
+{
+	for (UINT i = 0; i < BlockPixels; i++)
+	{
+		UINT rank = 0;
+		for (UINT j = 0; j < BlockPixels; j++)
+		{
+			rank += intensities[j] < intensities[i] || (intensities[j] == intensities[i] && j < i);
+		}
+		destinations[i] = (UINT)(order >> (rank * 4)) & 0xF;
+	}
+}
+
+void ValidateBlueNoisePermutations()
+{
+	printf("Blue noise permutations\n");
+	bool passed = true;
+
+	//a small texture with few distinct values so windows have ties
+	const UINT noiseWidth = 64;
+	const UINT noiseHeight = 48;
+	std::mt19937 generator(11);
+	std::vector<UINT8> noise(noiseWidth * noiseHeight);
+	for (UINT8& value : noise)
+	{
+		value = (UINT8)(generator() % 24);
+	}
+
+	BlueNoisePermutationTable table;
+	table.Build(noise.data(), noiseWidth, noiseHeight, 5);
+	BlueNoisePermutationTable serialTable;
+	serialTable.Build(noise.data(), noiseWidth, noiseHeight, 1);
+	Check(passed, "threads build the same table", table.GetBlockOrders() == serialTable.GetBlockOrders());
+
+	//a 200x120 frame over the texture for a few frames, intensities quantized so they tie as well
+	const UINT frameWidth = 200;
+	const UINT frameHeight = 120;
+	bool samePermutation = true;
+	for (UINT frame = 1; frame < 40; frame += 7)
+	{
+		BlueNoiseFrameOffset offset = table.GetFrameOffset(frame);
+		for (UINT blockY = 0; blockY < frameHeight / BLUE_NOISE_BLOCK; blockY++)
+		{
+			for (UINT blockX = 0; blockX < frameWidth / BLUE_NOISE_BLOCK; blockX++)
+			{
+				float intensities[BlockPixels];
+				float blockNoise[BlockPixels];
+				for (UINT i = 0; i < BlockPixels; i++)
+				{
+					UINT x = blockX * BLUE_NOISE_BLOCK + i % BLUE_NOISE_BLOCK;
+					UINT y = blockY * BLUE_NOISE_BLOCK + i / BLUE_NOISE_BLOCK;
+					intensities[i] = (float)(generator() % 6) * 0.25f;
+					blockNoise[i] = noise[((y + offset.y) % noiseHeight) * noiseWidth + (x + offset.x) % noiseWidth];
+				}
+
+				UINT expected[BlockPixels];
+				UINT destinations[BlockPixels];
+				BubbleSortPermutation(intensities, blockNoise, expected);
+				TablePermutation(intensities, table.GetBlockOrder(blockX * BLUE_NOISE_BLOCK + offset.x, blockY * BLUE_NOISE_BLOCK + offset.y), destinations);
+				samePermutation = samePermutation && std::equal(expected, expected + BlockPixels, destinations);
+			}
+		}
+	}
+	Check(passed, "lookups match the bubble sorts", samePermutation);
+
+	//a table of offsets used to repeat every 256 frames, the r2 points don't, and they stay on the texture at the last
+	//frame a UINT counts
+	bool neverRepeats = true;
+	for (UINT frame = 0; frame < 64; frame++)
+	{
+		BlueNoiseFrameOffset offset = table.GetFrameOffset(frame);
+		BlueNoiseFrameOffset later = table.GetFrameOffset(frame + 256);
+		neverRepeats = neverRepeats && (offset.x != later.x || offset.y != later.y);
+	}
+	BlueNoiseFrameOffset last = table.GetFrameOffset(UINT_MAX);
+	Check(passed, "offsets don't repeat every 256 frames", neverRepeats && last.x < noiseWidth && last.y < noiseHeight);
+
+	std::filesystem::path tableFile = std::filesystem::temp_directory_path() / "blue_noise_permutations_test.bin";
+	BlueNoisePermutationTable loaded;
+	bool roundTrip = table.Save(tableFile) && loaded.Load(tableFile) && loaded.GetBlockOrders() == table.GetBlockOrders()
+		&& loaded.GetFrameOffset(9).x == table.GetFrameOffset(9).x && loaded.GetNoiseWidth() == noiseWidth && loaded.GetNoiseHeight() == noiseHeight;
+	Check(passed, "save and load round trip", roundTrip);
+
+	//a corrupt width and a truncated file both have to fail before anything is sized from them
+	UINT corruptWidth = 0x40000000;
+	table.Save(tableFile);
+	{
+		std::fstream file(tableFile, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(2 * sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(&corruptWidth), sizeof(corruptWidth));
+	}
+	bool rejected = !loaded.Load(tableFile);
+	table.Save(tableFile);
+	std::error_code error;
+	std::filesystem::resize_file(tableFile, std::filesystem::file_size(tableFile, error) - 1, error);
+	rejected = rejected && !loaded.Load(tableFile);
+	std::filesystem::remove(tableFile, error);
+	Check(passed, "corrupt tables rejected", rejected);
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkBlueNoisePermutations(const std::filesystem::path& noiseFile)
+{
+	std::vector<UINT8> noise;
+	UINT width, height;
+	if (!LoadBlueNoiseBMP(noiseFile, noise, width, height))
+	{
+		//a stand in of the same size as movemask2.bmp
+		width = height = 512;
+		noise.resize(width * height);
+		std::mt19937 generator(3);
+		for (UINT8& value : noise)
+		{
+			value = (UINT8)generator();
+		}
+	}
+
+	UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	BlueNoisePermutationTable table;
+	table.Build(noise.data(), width, height, 1);
+	double serialTime = table.GetBuildTime();
+	table.Build(noise.data(), width, height, threadCount);
+	printf("Blue noise permutation table, %ux%u noise\n", width, height);
+	printf("  offline build: %.1f ms on 1 thread, %.1f ms on %u, %.1f KB\n", serialTime, table.GetBuildTime(), threadCount, table.GetSizeInBytes() / 1024.0);
+
+	//the per frame work the table removes, emulated on one cpu thread since the gpu can't be timed here. The bubble
+	//sorts ran on one thread of each group, 240 dependent compares while the other 15 waited. Ranking is 16 compares
+	//on each thread
+	UINT resolutions[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (auto& resolution : resolutions)
+	{
+		UINT blocksX = resolution[0] / BLUE_NOISE_BLOCK;
+		UINT blocksY = resolution[1] / BLUE_NOISE_BLOCK;
+		std::vector<float> intensities((size_t)blocksX * blocksY * BlockPixels);
+		for (float& intensity : intensities)
+		{
+			intensity = unit(generator);
+		}
+
+		BlueNoiseFrameOffset offset = table.GetFrameOffset(1);
+		UINT checksum = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (UINT by = 0; by < blocksY; by++)
+		{
+			for (UINT bx = 0; bx < blocksX; bx++)
+			{
+				float blockNoise[BlockPixels];
+				for (UINT i = 0; i < BlockPixels; i++)
+				{
+					UINT x = (bx * BLUE_NOISE_BLOCK + i % BLUE_NOISE_BLOCK + offset.x) % width;
+					UINT y = (by * BLUE_NOISE_BLOCK + i / BLUE_NOISE_BLOCK + offset.y) % height;
+					blockNoise[i] = noise[y * width + x];
+				}
+				UINT destinations[BlockPixels];
+				BubbleSortPermutation(&intensities[((size_t)by * blocksX + bx) * BlockPixels], blockNoise, destinations);
+				checksum += destinations[0];
+			}
+		}
+		auto middle = std::chrono::high_resolution_clock::now();
+		for (UINT by = 0; by < blocksY; by++)
+		{
+			for (UINT bx = 0; bx < blocksX; bx++)
+			{
+				UINT destinations[BlockPixels];
+				UINT64 order = table.GetBlockOrder(bx * BLUE_NOISE_BLOCK + offset.x, by * BLUE_NOISE_BLOCK + offset.y);
+				TablePermutation(&intensities[((size_t)by * blocksX + bx) * BlockPixels], order, destinations);
+				checksum += destinations[0];
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double sortTime = std::chrono::duration<double, std::milli>(middle - start).count();
+		double lookupTime = std::chrono::duration<double, std::milli>(end - middle).count();
+		double saved = sortTime - lookupTime;
+		benchmarkSink = checksum;
+		printf("  %4ux%-4u %6u blocks: sorting %.2f ms, lookup %.2f ms, the build pays for itself in %.0f frames\n", resolution[0], resolution[1],
+			blocksX * blocksY, sortTime, lookupTime, saved > 0.0 ? table.GetBuildTime() / saved : 0.0);
+	}
+	printf("  per block: 240 serial compares on one thread before, 16 per thread and one 8 byte load now, no noise texture reads\n");
+}
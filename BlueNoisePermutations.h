@@ -0,0 +1,62 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+#include<vector>
+
+//pixels per side of the blocks ComputeBlueNoisePermutedSequencesCS permutes seeds within
+#define BLUE_NOISE_BLOCK 4
+
+//the whole-pixel offset a frame scrolls the blue noise and retarget textures by, the r2 sequence the shaders used to
+//work out themselves. Worked out on the cpu every frame, not stored in the table
+struct BlueNoiseFrameOffset
+{
+	UINT16 x;
+	UINT16 y;
+};
+
+//everything in the seed permutation that doesn't depend on the rendered image, worked out offline. The blue noise
+//values under a block only depend on where the block lands in the texture, so for every texel the table keeps the
+//order the 4x4 window starting there sorts into, the block's pixels as nibbles from the lowest noise value up. At
+//runtime the pass ranks the block's intensities and looks up where each rank goes
+class BlueNoisePermutationTable
+{
+	UINT noiseWidth;
+	UINT noiseHeight;
+	//hash of the noise values the table was built from, a changed texture rebuilds it
+	UINT64 noiseHash;
+	std::vector<UINT64> blockOrders;
+	double buildTime;
+
+public:
+	BlueNoisePermutationTable();
+	~BlueNoisePermutationTable();
+
+	//noise is one byte per texel, row by row. Rows of windows are split between the workers
+	void Build(const UINT8* noise, UINT width, UINT height, UINT workerCount = 0);
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+	//loads the table saved for this noise texture, building and saving it when there isn't one or the texture changed
+	void LoadOrBuild(const std::filesystem::path& tableFile, const std::filesystem::path& noiseFile);
+
+	//the r2 point of the frame in doubles, so the offsets don't repeat for as long as the frame count doesn't
+	BlueNoiseFrameOffset GetFrameOffset(UINT frame);
+	//the order of the window starting at texel x, y, both wrapped
+	UINT64 GetBlockOrder(UINT x, UINT y);
+
+	UINT GetNoiseWidth();
+	UINT GetNoiseHeight();
+	const std::vector<UINT64>& GetBlockOrders();
+	size_t GetSizeInBytes();
+	double GetBuildTime();
+};
+
+//the red channel of an uncompressed 24 or 32 bit bmp, top row first like the texture the gpu sees
+bool LoadBlueNoiseBMP(const std::filesystem::path& fileName, std::vector<UINT8>& red, UINT& width, UINT& height);
+
+//the table's permutation against the bubble sorts the shader used to do, over every block of a frame with ties, and
+//the save and load round trip
+void ValidateBlueNoisePermutations();
+
+//offline build time on one and all threads against the per frame sorting it replaces, emulated on the cpu
+void BenchmarkBlueNoisePermutations(const std::filesystem::path& noiseFile = "../../Assets/Textures/movemask2.bmp");
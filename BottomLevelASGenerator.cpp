@@ -128,6 +128,23 @@ void BottomLevelASGenerator::ComputeASBufferSizes(
                                 // the acceleration structure
     UINT64 *resultSizeInBytes   // Required GPU memory to store the acceleration
                                 // structure
+) {
+  ComputeASBufferSizes(device, allowUpdate, false, scratchSizeInBytes,
+                       resultSizeInBytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Same as above, with the option to compact the structure after the build
+void BottomLevelASGenerator::ComputeASBufferSizes(
+    ID3D12Device5 *device, // Device on which the build will be performed
+    bool allowUpdate,     // If true, the resulting acceleration structure will
+                          // allow iterative updates
+    bool allowCompaction, // If true, the resulting acceleration structure can
+                          // be compacted after the build
+    UINT64 *scratchSizeInBytes, // Required scratch memory on the GPU to build
+                                // the acceleration structure
+    UINT64 *resultSizeInBytes   // Required GPU memory to store the acceleration
+                                // structure
 ) {
   // The generated AS can support iterative updates. This may change the final
   // size of the AS as well as the temporary memory requirements, and hence has
@@ -137,6 +154,14 @@ void BottomLevelASGenerator::ComputeASBufferSizes(
           ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE
           : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
 
+  // Static geometry is traced far more often than it is built, so a compactable
+  // structure also asks for the faster traversal
+  if (allowCompaction) {
+    m_flags |=
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION |
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+  }
+
   // Describe the work being requested, in this case the construction of a
   // (possibly dynamic) bottom-level hierarchy, with the given vertex buffers
   
@@ -183,25 +208,28 @@ void BottomLevelASGenerator::Generate(
         *resultBuffer, // Result buffer storing the acceleration structure
     bool updateOnly,   // If true, simply refit the existing
                        // acceleration structure
-    ID3D12Resource *previousResult // Optional previous acceleration
-                                   // structure, used if an iterative update
-                                   // is requested
+    ID3D12Resource *previousResult, // Optional previous acceleration
+                                    // structure, used if an iterative update
+                                    // is requested
+    D3D12_GPU_VIRTUAL_ADDRESS compactedSizeAddress // Optional address
+                                                   // receiving the compacted
+                                                   // size
 ) {
 
+  bool allowUpdate =
+      (m_flags &
+       D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE) != 0;
+
   D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = m_flags;
   // The stored flags represent whether the AS has been built for updates or
   // not. If yes and an update is requested, the builder is told to only update
   // the AS instead of fully rebuilding it
-  if (flags ==
-          D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE &&
-      updateOnly) {
-    flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+  if (allowUpdate && updateOnly) {
+    flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
   }
 
   // Sanity checks
-  if (m_flags !=
-          D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE &&
-      updateOnly) {
+  if (!allowUpdate && updateOnly) {
     throw std::logic_error(
         "Cannot update a bottom-level AS not originally built for updates");
   }
@@ -230,8 +258,23 @@ void BottomLevelASGenerator::Generate(
       previousResult ? previousResult->GetGPUVirtualAddress() : 0;
   buildDesc.Inputs.Flags = flags;
 
+  if (compactedSizeAddress != 0 && !IsCompactionAllowed()) {
+    throw std::logic_error(
+        "The compacted size can only be queried for a bottom-level AS built "
+        "with compaction allowed");
+  }
+
+  // The compacted size is written by the build itself, so it is available as
+  // soon as the command list has executed
+  D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildDesc = {};
+  postbuildDesc.InfoType =
+      D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+  postbuildDesc.DestBuffer = compactedSizeAddress;
+
   // Build the AS
-  commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+  commandList->BuildRaytracingAccelerationStructure(
+      &buildDesc, compactedSizeAddress != 0 ? 1 : 0,
+      compactedSizeAddress != 0 ? &postbuildDesc : nullptr);
 
   // Wait for the builder to complete by setting a barrier on the resulting
   // buffer. This is particularly important as the construction of the top-level
@@ -243,4 +286,41 @@ void BottomLevelASGenerator::Generate(
   uavBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
   commandList->ResourceBarrier(1, &uavBarrier);
 }
+
+//--------------------------------------------------------------------------------------------------
+// Enqueue the copy of a structure built with compaction allowed into a buffer
+// of its compacted size
+void BottomLevelASGenerator::Compact(
+    ID3D12GraphicsCommandList4
+        *commandList, // Command list on which the copy will be enqueued
+    ID3D12Resource *sourceBuffer,   // Acceleration structure to compact
+    ID3D12Resource *compactedBuffer // Buffer of at least the compacted size
+) {
+  commandList->CopyRaytracingAccelerationStructure(
+      compactedBuffer->GetGPUVirtualAddress(),
+      sourceBuffer->GetGPUVirtualAddress(),
+      D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+
+  // Same as after a build, the top-level AS may reference the compacted
+  // structure right away
+  D3D12_RESOURCE_BARRIER uavBarrier;
+  uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+  uavBarrier.UAV.pResource = compactedBuffer;
+  uavBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+  commandList->ResourceBarrier(1, &uavBarrier);
+}
+
+UINT64 BottomLevelASGenerator::GetScratchSizeInBytes() const {
+  return m_scratchSizeInBytes;
+}
+
+UINT64 BottomLevelASGenerator::GetResultSizeInBytes() const {
+  return m_resultSizeInBytes;
+}
+
+bool BottomLevelASGenerator::IsCompactionAllowed() const {
+  return (m_flags &
+          D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION) !=
+         0;
+}
 } // namespace nv_helpers_dx12
@@ -140,6 +140,20 @@ public:
                                   /// acceleration structure
   );
 
+  /// Same as above, with the option to compact the structure after the build. Compactable
+  /// structures are meant for static geometry and are built with PREFER_FAST_TRACE
+  void ComputeASBufferSizes(
+      ID3D12Device5* device, /// Device on which the build will be performed
+      bool allowUpdate,           /// If true, the resulting acceleration structure will
+                                  /// allow iterative updates
+      bool allowCompaction,       /// If true, the resulting acceleration structure can be
+                                  /// compacted once its compacted size is known
+      UINT64* scratchSizeInBytes, /// Required scratch memory on the GPU to
+                                  /// build the acceleration structure
+      UINT64* resultSizeInBytes   /// Required GPU memory to store the
+                                  /// acceleration structure
+  );
+
   /// Enqueue the construction of the acceleration structure on a command list, using
   /// application-provided buffers and possibly a pointer to the previous acceleration structure in
   /// case of iterative updates. Note that the update can be done in place: the result and
@@ -150,10 +164,26 @@ public:
                                      /// store temporary data
       ID3D12Resource* resultBuffer,  /// Result buffer storing the acceleration structure
       bool updateOnly = false,       /// If true, simply refit the existing acceleration structure
-      ID3D12Resource* previousResult = nullptr /// Optional previous acceleration structure, used
-                                               /// if an iterative update is requested
+      ID3D12Resource* previousResult = nullptr, /// Optional previous acceleration structure, used
+                                                /// if an iterative update is requested
+      D3D12_GPU_VIRTUAL_ADDRESS compactedSizeAddress = 0 /// Optional address receiving the
+                                                         /// compacted size as a UINT64, in a
+                                                         /// buffer in the UNORDERED_ACCESS state
   );
 
+  /// Enqueue the copy of a structure built with compaction allowed into a buffer of its
+  /// compacted size. The source can be released once the copy has executed
+  static void Compact(
+      ID3D12GraphicsCommandList4* commandList, /// Command list on which the copy will be enqueued
+      ID3D12Resource* sourceBuffer,            /// Acceleration structure to compact
+      ID3D12Resource* compactedBuffer          /// Buffer of at least the compacted size
+  );
+
+  /// Sizes computed by the last ComputeASBufferSizes call
+  UINT64 GetScratchSizeInBytes() const;
+  UINT64 GetResultSizeInBytes() const;
+  bool IsCompactionAllowed() const;
+
 private:
   /// Vertex buffer descriptors used to generate the AS
   std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> m_vertexBuffers = {};
@@ -166,6 +196,7 @@ private:
 
   /// Flags for the builder, specifying whether to allow iterative updates, or
   /// when to perform an update
-  D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS m_flags;
+  D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS m_flags =
+      D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
 };
 } // namespace nv_helpers_dx12
@@ -0,0 +1,540 @@
+#include "ClusteredLightGrid.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cfloat>
+#include<chrono>
+#include<random>
+#include<thread>
+
+//the light's sphere of influence in the grid's view space, radius in w. Lights without a range reach everything
+static Vector4 GetViewSphere(const Light& light, const Vector3& position, const Vector3& right, const Vector3& up, const Vector3& forward)
+{
+	if (light.type != LIGHT_TYPE_POINT && light.type != LIGHT_TYPE_SPOT)
+		return Vector4(0.0f, 0.0f, 0.0f, FLT_MAX);
+
+	//a spot light's cone is inside its sphere, good enough for the assignment
+	Vector3 offset = light.position - position;
+	return Vector4(offset.Dot(right), offset.Dot(up), offset.Dot(forward), light.range);
+}
+
+static void GetViewBasis(const ClusterView& view, Vector3& right, Vector3& up, Vector3& forward)
+{
+	forward = view.forward;
+	forward.Normalize();
+	right = view.up.Cross(forward);
+	right.Normalize();
+	up = forward.Cross(right);
+}
+
+//distance from the center to the interval along one axis, 0 inside
+static float AxisDistance(float boundsMin, float boundsMax, float center)
+{
+	return std::max(std::max(boundsMin - center, center - boundsMax), 0.0f);
+}
+
+ClusteredLightGrid::ClusteredLightGrid(const ClusterGridDesc& desc, UINT workerCount)
+	: desc(desc)
+{
+	if (desc.width == 0 || desc.height == 0 || desc.tileSize == 0 || desc.depthSlices == 0 || !(desc.farZ > desc.nearZ) || !(desc.nearZ > 0.0f))
+		throw std::logic_error("Invalid cluster grid");
+
+	tilesX = (desc.width + desc.tileSize - 1) / desc.tileSize;
+	tilesY = (desc.height + desc.tileSize - 1) / desc.tileSize;
+	rowStride = (tilesX + 3) & ~3u;
+
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	this->workerCount = std::min(workerCount, desc.depthSlices);
+	workerPairs.resize(this->workerCount);
+
+	sliceDepths.resize(desc.depthSlices + 1);
+	for (UINT i = 0; i <= desc.depthSlices; i++)
+	{
+		sliceDepths[i] = desc.nearZ * powf(desc.farZ / desc.nearZ, (float)i / desc.depthSlices);
+	}
+	sliceDepths[desc.depthSlices] = desc.farZ;
+
+	//view space x at depth z is ndc x * z * scaleX, the tiles are widest at the far end of the slice
+	float scaleY = tanf(desc.fovY * 0.5f);
+	float scaleX = scaleY * desc.width / desc.height;
+
+	tileMinX.assign(desc.depthSlices * rowStride, FLT_MAX);
+	tileMaxX.assign(desc.depthSlices * rowStride, FLT_MAX);
+	tileMinY.resize(desc.depthSlices * tilesY);
+	tileMaxY.resize(desc.depthSlices * tilesY);
+
+	for (UINT s = 0; s < desc.depthSlices; s++)
+	{
+		float depths[2] = { sliceDepths[s], sliceDepths[s + 1] };
+
+		for (UINT x = 0; x < tilesX; x++)
+		{
+			float ndc[2] = { 2.0f * x * desc.tileSize / desc.width - 1.0f, 2.0f * std::min((x + 1) * desc.tileSize, desc.width) / desc.width - 1.0f };
+			float boundsMin = FLT_MAX;
+			float boundsMax = -FLT_MAX;
+			for (float u : ndc)
+			{
+				for (float z : depths)
+				{
+					boundsMin = std::min(boundsMin, u * z * scaleX);
+					boundsMax = std::max(boundsMax, u * z * scaleX);
+				}
+			}
+			tileMinX[s * rowStride + x] = boundsMin;
+			tileMaxX[s * rowStride + x] = boundsMax;
+		}
+
+		//rows go down the screen
+		for (UINT y = 0; y < tilesY; y++)
+		{
+			float ndc[2] = { 1.0f - 2.0f * y * desc.tileSize / desc.height, 1.0f - 2.0f * std::min((y + 1) * desc.tileSize, desc.height) / desc.height };
+			float boundsMin = FLT_MAX;
+			float boundsMax = -FLT_MAX;
+			for (float v : ndc)
+			{
+				for (float z : depths)
+				{
+					boundsMin = std::min(boundsMin, v * z * scaleY);
+					boundsMax = std::max(boundsMax, v * z * scaleY);
+				}
+			}
+			tileMinY[s * tilesY + y] = boundsMin;
+			tileMaxY[s * tilesY + y] = boundsMax;
+		}
+	}
+
+	clusters.resize(desc.depthSlices * tilesY * tilesX);
+	ZeroMemory(&stats, sizeof(ClusteredLightGridStats));
+}
+
+ClusteredLightGrid::~ClusteredLightGrid()
+{
+}
+
+UINT ClusteredLightGrid::GetSlice(float viewZ)
+{
+	if (!(viewZ > desc.nearZ))
+		return 0;
+
+	float slice = logf(viewZ / desc.nearZ) / logf(desc.farZ / desc.nearZ) * desc.depthSlices;
+	if (slice >= desc.depthSlices)
+		return desc.depthSlices - 1;
+	return (UINT)slice;
+}
+
+UINT ClusteredLightGrid::GetClusterIndex(UINT pixelX, UINT pixelY, float viewZ)
+{
+	return (GetSlice(viewZ) * tilesY + pixelY / desc.tileSize) * tilesX + pixelX / desc.tileSize;
+}
+
+void ClusteredLightGrid::GetClusterBounds(UINT cluster, Vector3& boundsMin, Vector3& boundsMax)
+{
+	UINT x = cluster % tilesX;
+	UINT y = (cluster / tilesX) % tilesY;
+	UINT s = cluster / (tilesX * tilesY);
+
+	boundsMin = Vector3(tileMinX[s * rowStride + x], tileMinY[s * tilesY + y], sliceDepths[s]);
+	boundsMax = Vector3(tileMaxX[s * rowStride + x], tileMaxY[s * tilesY + y], sliceDepths[s + 1]);
+}
+
+void ClusteredLightGrid::BuildSlices(UINT worker, UINT firstSlice, UINT endSlice, const Vector4* spheres, UINT lightCount)
+{
+	std::vector<ClusterLight>& pairs = workerPairs[worker];
+	pairs.clear();
+
+	for (UINT i = 0; i < lightCount; i++)
+	{
+		const Vector4& sphere = spheres[i];
+		float radius2 = sphere.w * sphere.w;
+
+		//the ranges below are a tile or slice wider than the sphere's bounds so rounding can't lose a cluster, the
+		//distance test decides
+		UINT sliceBegin = GetSlice(sphere.z - sphere.w);
+		UINT sliceEnd = GetSlice(sphere.z + sphere.w) + 2;
+		sliceBegin = std::max(sliceBegin > 0 ? sliceBegin - 1 : 0, firstSlice);
+		sliceEnd = std::min(sliceEnd, endSlice);
+
+		for (UINT s = sliceBegin; s < sliceEnd; s++)
+		{
+			float dz = AxisDistance(sliceDepths[s], sliceDepths[s + 1], sphere.z);
+			float dz2 = dz * dz;
+			if (dz2 > radius2)
+				continue;
+
+			//x bounds grow with the column, y bounds shrink with the row
+			const float* minX = &tileMinX[s * rowStride];
+			const float* maxX = &tileMaxX[s * rowStride];
+			const float* minY = &tileMinY[s * tilesY];
+			const float* maxY = &tileMaxY[s * tilesY];
+
+			UINT xBegin = (UINT)(std::partition_point(maxX, maxX + tilesX, [&sphere](float v) { return v < sphere.x - sphere.w; }) - maxX);
+			UINT xEnd = (UINT)(std::partition_point(minX, minX + tilesX, [&sphere](float v) { return v <= sphere.x + sphere.w; }) - minX);
+			UINT yBegin = (UINT)(std::partition_point(minY, minY + tilesY, [&sphere](float v) { return v > sphere.y + sphere.w; }) - minY);
+			UINT yEnd = (UINT)(std::partition_point(maxY, maxY + tilesY, [&sphere](float v) { return v >= sphere.y - sphere.w; }) - maxY);
+			xBegin = xBegin > 0 ? xBegin - 1 : 0;
+			xEnd = std::min(xEnd + 1, tilesX);
+			yBegin = yBegin > 0 ? yBegin - 1 : 0;
+			yEnd = std::min(yEnd + 1, tilesY);
+
+			XMVECTOR centerX = XMVectorReplicate(sphere.x);
+			XMVECTOR radius2X = XMVectorReplicate(radius2);
+
+			for (UINT y = yBegin; y < yEnd; y++)
+			{
+				float dy = AxisDistance(minY[y], maxY[y], sphere.y);
+				float dyz2 = dy * dy + dz2;
+				if (dyz2 > radius2)
+					continue;
+
+				UINT rowCluster = (s * tilesY + y) * tilesX;
+				XMVECTOR dyz2X = XMVectorReplicate(dyz2);
+
+				//four columns at a time, the rows are padded to four
+				for (UINT x = xBegin & ~3u; x < xEnd; x += 4)
+				{
+					XMVECTOR boundsMin = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(minX + x));
+					XMVECTOR boundsMax = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(maxX + x));
+					XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(boundsMin, centerX), XMVectorSubtract(centerX, boundsMax)), XMVectorZero());
+					XMVECTOR distance2 = XMVectorAdd(XMVectorMultiply(dx, dx), dyz2X);
+					int mask = _mm_movemask_ps(XMVectorLessOrEqual(distance2, radius2X));
+
+					if (mask == 0)
+						continue;
+
+					for (UINT lane = 0; lane < 4; lane++)
+					{
+						UINT column = x + lane;
+						if ((mask & (1 << lane)) && column >= xBegin && column < xEnd)
+							pairs.push_back({ rowCluster + column, i });
+					}
+				}
+			}
+		}
+	}
+
+	//the worker's slices are its own, so are the clusters in them
+	for (size_t i = 0; i < pairs.size(); i++)
+	{
+		clusters[pairs[i].cluster].count++;
+	}
+}
+
+void ClusteredLightGrid::Build(const ClusterView& view, const Light* lights, UINT lightCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Vector3 right, up, forward;
+	GetViewBasis(view, right, up, forward);
+
+	std::vector<Vector4> spheres(lightCount);
+	for (UINT i = 0; i < lightCount; i++)
+	{
+		spheres[i] = GetViewSphere(lights[i], view.position, right, up, forward);
+	}
+
+	ZeroMemory(clusters.data(), clusters.size() * sizeof(ClusterRange));
+
+	auto sliceBegin = [this](UINT worker) { return desc.depthSlices * worker / workerCount; };
+
+	std::vector<std::thread> workers;
+	for (UINT w = 1; w < workerCount; w++)
+	{
+		workers.emplace_back(&ClusteredLightGrid::BuildSlices, this, w, sliceBegin(w), sliceBegin(w + 1), spheres.data(), lightCount);
+	}
+	BuildSlices(0, sliceBegin(0), sliceBegin(1), spheres.data(), lightCount);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	UINT offset = 0;
+	stats.occupiedClusters = 0;
+	stats.maxClusterLights = 0;
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		clusters[i].offset = offset;
+		offset += clusters[i].count;
+		stats.occupiedClusters += clusters[i].count > 0;
+		stats.maxClusterLights = std::max(stats.maxClusterLights, clusters[i].count);
+		clusters[i].count = 0;
+	}
+	lightIndices.resize(offset);
+	stats.indexCount = offset;
+
+	//each worker wrote its lights in order, so the lights of a cluster come out sorted
+	auto scatter = [this](UINT worker)
+	{
+		const std::vector<ClusterLight>& pairs = workerPairs[worker];
+		for (size_t i = 0; i < pairs.size(); i++)
+		{
+			ClusterRange& cluster = clusters[pairs[i].cluster];
+			lightIndices[cluster.offset + cluster.count++] = pairs[i].light;
+		}
+	};
+
+	workers.clear();
+	for (UINT w = 1; w < workerCount; w++)
+	{
+		workers.emplace_back(scatter, w);
+	}
+	scatter(0);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool ClusteredLightGrid::Matches(const ClusterRange* otherClusters, UINT clusterCount, const UINT* otherIndices, UINT indexCount, std::string& error)
+{
+	if (clusterCount != clusters.size())
+	{
+		error = "cluster count " + std::to_string(clusterCount) + ", expected " + std::to_string(clusters.size());
+		return false;
+	}
+
+	std::vector<UINT> expected;
+	std::vector<UINT> actual;
+	for (UINT i = 0; i < clusterCount; i++)
+	{
+		const ClusterRange& other = otherClusters[i];
+		if ((UINT64)other.offset + other.count > indexCount)
+		{
+			error = "cluster " + std::to_string(i) + " reads past the index list";
+			return false;
+		}
+
+		if (other.count != clusters[i].count)
+		{
+			error = "cluster " + std::to_string(i) + " has " + std::to_string(other.count) + " lights, expected " + std::to_string(clusters[i].count);
+			return false;
+		}
+
+		expected.assign(lightIndices.begin() + clusters[i].offset, lightIndices.begin() + clusters[i].offset + clusters[i].count);
+		actual.assign(otherIndices + other.offset, otherIndices + other.offset + other.count);
+		std::sort(actual.begin(), actual.end());
+		if (actual != expected)
+		{
+			size_t j = std::mismatch(expected.begin(), expected.end(), actual.begin()).first - expected.begin();
+			error = "cluster " + std::to_string(i) + " has light " + std::to_string(actual[j]) + " where " + std::to_string(expected[j]) + " was expected";
+			return false;
+		}
+	}
+
+	error.clear();
+	return true;
+}
+
+const std::vector<ClusterRange>& ClusteredLightGrid::GetClusters()
+{
+	return clusters;
+}
+
+const std::vector<UINT>& ClusteredLightGrid::GetLightIndices()
+{
+	return lightIndices;
+}
+
+UINT ClusteredLightGrid::GetTilesX()
+{
+	return tilesX;
+}
+
+UINT ClusteredLightGrid::GetTilesY()
+{
+	return tilesY;
+}
+
+UINT ClusteredLightGrid::GetClusterCount()
+{
+	return (UINT)clusters.size();
+}
+
+ClusterShaderData ClusteredLightGrid::GetShaderData()
+{
+	return { tilesX, tilesY, desc.tileSize, desc.depthSlices, desc.nearZ, desc.depthSlices / logf(desc.farZ / desc.nearZ) };
+}
+
+const ClusteredLightGridStats& ClusteredLightGrid::GetStats()
+{
+	return stats;
+}
+
+static std::vector<Light> MakeRandomLights(UINT count, float extent, float minRange, float maxRange, UINT seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::uniform_real_distribution<float> range(minRange, maxRange);
+
+	std::vector<Light> lights(count);
+	for (UINT i = 0; i < count; i++)
+	{
+		Light light = {};
+		light.type = LIGHT_TYPE_POINT;
+		light.color = Vector3(1, 1, 1);
+		light.position = Vector3(position(generator), position(generator), position(generator));
+		light.range = range(generator);
+		light.intensity = 1;
+		lights[i] = light;
+	}
+	return lights;
+}
+
+void ValidateClusteredLightGrid()
+{
+	printf("Clustered light grid\n");
+	bool passed = true;
+
+	//the last tile row is cut by the screen edge
+	ClusterGridDesc desc = { 1280, 720, 32, 16, 0.1f, 200.0f, 0.25f * 3.1415926535f };
+	ClusterView view = { Vector3(5, 10, -40), Vector3(0.2f, -0.1f, 1), Vector3(0, 1, 0) };
+
+	std::vector<Light> lights = MakeRandomLights(1500, 60.0f, 1.0f, 12.0f, 7);
+	lights[10].type = LIGHT_TYPE_DIR;
+	lights[20].type = LIGHT_TYPE_AREA_RECT;
+	lights[30].type = LIGHT_TYPE_SPOT;
+	//behind the camera and touching the near plane
+	lights[40].position = view.position - view.forward * 5.0f;
+	lights[40].range = 1.0f;
+	lights[50].position = view.position;
+	lights[50].range = 0.5f;
+
+	//every light against every cluster
+	ClusteredLightGrid reference(desc, 1);
+	Vector3 right, up, forward;
+	GetViewBasis(view, right, up, forward);
+	std::vector<ClusterRange> bruteClusters(reference.GetClusterCount());
+	std::vector<UINT> bruteIndices;
+	for (UINT c = 0; c < reference.GetClusterCount(); c++)
+	{
+		Vector3 boundsMin, boundsMax;
+		reference.GetClusterBounds(c, boundsMin, boundsMax);
+		bruteClusters[c].offset = (UINT)bruteIndices.size();
+		for (UINT i = 0; i < lights.size(); i++)
+		{
+			Vector4 sphere = GetViewSphere(lights[i], view.position, right, up, forward);
+			float dx = AxisDistance(boundsMin.x, boundsMax.x, sphere.x);
+			float dy = AxisDistance(boundsMin.y, boundsMax.y, sphere.y);
+			float dz = AxisDistance(boundsMin.z, boundsMax.z, sphere.z);
+			if (dx * dx + (dy * dy + dz * dz) <= sphere.w * sphere.w)
+				bruteIndices.push_back(i);
+		}
+		bruteClusters[c].count = (UINT)bruteIndices.size() - bruteClusters[c].offset;
+	}
+
+	std::string error;
+	UINT workerCounts[] = { 1, 3, 8 };
+	for (UINT workers : workerCounts)
+	{
+		ClusteredLightGrid grid(desc, workers);
+		grid.Build(view, lights.data(), (UINT)lights.size());
+		bool matches = grid.Matches(bruteClusters.data(), (UINT)bruteClusters.size(), bruteIndices.data(), (UINT)bruteIndices.size(), error);
+		std::string name = "matches brute force on " + std::to_string(workers) + " workers";
+		Check(passed, name.c_str(), matches);
+		if (!matches)
+			printf("    %s\n", error.c_str());
+	}
+
+	ClusteredLightGrid grid(desc, 4);
+	grid.Build(view, lights.data(), (UINT)lights.size());
+	const std::vector<ClusterRange>& clusters = grid.GetClusters();
+	const std::vector<UINT>& indices = grid.GetLightIndices();
+
+	bool everywhere = true;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const UINT* begin = indices.data() + clusters[c].offset;
+		const UINT* end = begin + clusters[c].count;
+		everywhere = everywhere && std::binary_search(begin, end, 10u) && std::binary_search(begin, end, 20u) && !std::binary_search(begin, end, 40u);
+	}
+	Check(passed, "lights without range in every cluster", everywhere);
+
+	//a gpu writes the lights of a cluster in any order
+	std::vector<UINT> shuffled = indices;
+	for (size_t c = 0; c < clusters.size(); c++)
+		std::reverse(shuffled.begin() + clusters[c].offset, shuffled.begin() + clusters[c].offset + clusters[c].count);
+	Check(passed, "order inside a cluster ignored", grid.Matches(clusters.data(), (UINT)clusters.size(), shuffled.data(), (UINT)shuffled.size(), error));
+
+	std::vector<ClusterRange> missing = clusters;
+	size_t occupied = std::find_if(missing.begin(), missing.end(), [](const ClusterRange& c) { return c.count > 1; }) - missing.begin();
+	missing[occupied].count--;
+	Check(passed, "missing light found", !grid.Matches(missing.data(), (UINT)missing.size(), indices.data(), (UINT)indices.size(), error));
+
+	std::vector<UINT> swapped = indices;
+	swapped[clusters[occupied].offset] = (UINT)lights.size();
+	Check(passed, "wrong light found", !grid.Matches(clusters.data(), (UINT)clusters.size(), swapped.data(), (UINT)swapped.size(), error));
+
+	//a point projected to the screen lands in a cluster whose bounds hold it
+	bool inside = true;
+	float scaleY = tanf(desc.fovY * 0.5f);
+	float scaleX = scaleY * desc.width / desc.height;
+	for (UINT i = 0; i < 200; i++)
+	{
+		Vector4 point = GetViewSphere(lights[i * 7], view.position, right, up, forward);
+		if (lights[i * 7].type != LIGHT_TYPE_POINT || point.z <= desc.nearZ || point.z >= desc.farZ)
+			continue;
+		float pixelX = (point.x / (point.z * scaleX) + 1.0f) * 0.5f * desc.width;
+		float pixelY = (1.0f - point.y / (point.z * scaleY)) * 0.5f * desc.height;
+		if (pixelX < 0 || pixelY < 0 || pixelX >= desc.width || pixelY >= desc.height)
+			continue;
+
+		Vector3 boundsMin, boundsMax;
+		grid.GetClusterBounds(grid.GetClusterIndex((UINT)pixelX, (UINT)pixelY, point.z), boundsMin, boundsMax);
+		float epsilon = 1e-3f * point.z;
+		inside = inside && point.x >= boundsMin.x - epsilon && point.x <= boundsMax.x + epsilon && point.y >= boundsMin.y - epsilon
+			&& point.y <= boundsMax.y + epsilon && point.z >= boundsMin.z - epsilon && point.z <= boundsMax.z + epsilon;
+	}
+	Check(passed, "screen points land in their cluster", inside);
+
+	//the pbr shaders' lookup in ClusteredLighting.hlsli, in the middle of every slice and past both ends of the grid
+	ClusterShaderData shaderData = grid.GetShaderData();
+	auto shaderSlice = [&shaderData](float viewZ)
+	{
+		if (!(viewZ > shaderData.nearZ))
+			return 0u;
+		return std::min((UINT)(logf(viewZ / shaderData.nearZ) * shaderData.sliceScale), shaderData.depthSlices - 1);
+	};
+	bool sameSlices = shaderData.tilesX == grid.GetTilesX() && shaderData.tilesY == grid.GetTilesY();
+	for (UINT s = 0; s < desc.depthSlices; s++)
+	{
+		float middle = desc.nearZ * powf(desc.farZ / desc.nearZ, (s + 0.5f) / desc.depthSlices);
+		sameSlices = sameSlices && shaderSlice(middle) == s && grid.GetSlice(middle) == s;
+	}
+	sameSlices = sameSlices && shaderSlice(0.01f) == 0 && shaderSlice(desc.farZ * 2.0f) == desc.depthSlices - 1;
+	Check(passed, "shader lookup finds the same slices", sameSlices);
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkClusteredLightGrid(int frameCount)
+{
+	std::vector<Light> lights = MakeRandomLights(20000, 100.0f, 2.0f, 10.0f, 1);
+	ClusterView view = { Vector3(0, 0, -120), Vector3(0, 0, 1), Vector3(0, 1, 0) };
+
+	UINT resolutions[][2] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	printf("Clustered light assignment, %zu lights, 64px tiles, 24 slices, %d frames\n", lights.size(), frameCount);
+	for (auto& resolution : resolutions)
+	{
+		ClusterGridDesc desc = { resolution[0], resolution[1], 64, 24, 0.1f, 2000.0f, 0.25f * 3.1415926535f };
+		UINT workerCounts[] = { 1, threadCount };
+		for (UINT workers : workerCounts)
+		{
+			ClusteredLightGrid grid(desc, workers);
+			double time = 0.0;
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				view.position.x = frame * 0.5f;
+				grid.Build(view, lights.data(), (UINT)lights.size());
+				time += grid.GetStats().buildTime;
+			}
+
+			const ClusteredLightGridStats& stats = grid.GetStats();
+			printf("  %4ux%-4u %5u clusters, %2u threads: %7.3f ms, %7u indices, %5u occupied, at most %u lights\n", resolution[0], resolution[1],
+				grid.GetClusterCount(), workers, time / frameCount, stats.indexCount, stats.occupiedClusters, stats.maxClusterLights);
+		}
+	}
+}
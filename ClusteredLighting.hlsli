@@ -0,0 +1,33 @@
+#ifndef __CLUSTERED_LIGHTING_HLSLI__
+#define __CLUSTERED_LIGHTING_HLSLI__
+
+//the clustered light grid ClusteredLightGrid builds on the cpu. Screen tiles split into depth slices, a cluster's lights
+//are ClusterLightIndices[range.x, range.x + range.y)
+struct ClusterData
+{
+	uint tilesX;
+	uint tilesY;
+	uint tileSize;
+	uint depthSlices;
+	float nearZ;
+	//depth slices over log(farZ / nearZ)
+	float sliceScale;
+};
+
+ConstantBuffer<ClusterData> clusterData : register(b4);
+StructuredBuffer<uint2> ClusterRanges : register(t2, space2);
+StructuredBuffer<uint> ClusterLightIndices : register(t3, space2);
+
+//the offset and count of the cluster a pixel falls in, viewZ is the distance along the camera's forward. Depths outside
+//the grid go to the first or last slice, as ClusteredLightGrid::GetSlice does
+uint2 GetClusterRange(float2 pixel, float viewZ)
+{
+	uint slice = 0;
+	if (viewZ > clusterData.nearZ)
+		slice = min((uint)(log(viewZ / clusterData.nearZ) * clusterData.sliceScale), clusterData.depthSlices - 1);
+
+	uint2 tile = min((uint2)pixel / clusterData.tileSize, uint2(clusterData.tilesX - 1, clusterData.tilesY - 1));
+	return ClusterRanges[(slice * clusterData.tilesY + tile.y) * clusterData.tilesX + tile.x];
+}
+
+#endif
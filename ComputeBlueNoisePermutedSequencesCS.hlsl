@@ -1,6 +1,7 @@
 #include "Common.hlsl"
 
-Texture2D blueNoise : register(t0);
+//the blue noise window starting at each texel sorted offline, the block's pixels as nibbles from the lowest value up
+StructuredBuffer<uint2> blueNoiseOrders : register(t0);
 Texture2D prevFrame : register(t1);
 Texture2D retargetTex : register(t2);
 RWStructuredBuffer<uint> newSequences : register(u0);
@@ -13,6 +14,9 @@ SamplerState pointSampler : register(s0);
 cbuffer ExternData : register(b0, space1)
 {
     uint frameNum;
+    uint2 noiseOffset;
+    uint noiseWidth;
+    uint noiseHeight;
 }
 
 // Generates a seed for a random number generator from 2 inputs plus a backoff
@@ -41,78 +45,6 @@ uint InitSeed2(uint3 thread, uint width)
 #define BLOCK 4
 #define F_BLOCK 4.0f
 
-// A function to implement bubble sort  
-void BubbleSort(inout float3 arr[BLOCK * BLOCK])
-{
-        
-    int i, j;
-    int n = BLOCK * BLOCK;
-    for (i = 0; i < n - 1; i++)
-    {
-        for (j = 0; j < n - i - 1; j++)
-        {
-            if (arr[j].r > arr[j + 1].r)
-            {
-                float3 temp = arr[j];
-                arr[j] = arr[j + 1];
-                arr[j + 1] = temp;
-            }
-        }
-    }
-}
-
-//http://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
-float2 GenerateR2Sequence(uint n)
-{
-    float g = 1.32471795724474602596;
-
-    float a1 = 1.0 / g;
-
-    float a2 = 1.0 / (g * g);
-
-    float x = (a1 * n) % 1;
-
-    float y = (a2 * n) % 1;
-
-    return float2(x, y);
-}
-
-//https://gamedev.stackexchange.com/questions/135947/how-to-sort-tiled-decal-list
-void BitonicSort(inout float3 arr1[BLOCK * BLOCK], uint groupIndex)
-{
-    uint numArray = BLOCK*BLOCK;
-
-    // Round the number of items up to the nearest power of two
-    uint numArrayPowerOfTwo = 1;
-    while (numArrayPowerOfTwo < numArray)
-        numArrayPowerOfTwo <<= 1;
-
-    GroupMemoryBarrierWithGroupSync();
-
-    for (uint nMergeSize = 2; nMergeSize <= numArrayPowerOfTwo; nMergeSize = nMergeSize * 2)
-    {
-        for (uint nMergeSubSize = nMergeSize >> 1; nMergeSubSize > 0; nMergeSubSize = nMergeSubSize >> 1)
-        {
-            uint tmp_index = groupIndex; // It is the SV_GroupIndex, the flattened index of the thread within the threadgroup
-            uint index_low = tmp_index & (nMergeSubSize - 1);
-            uint index_high = 2 * (tmp_index - index_low);
-            uint index = index_high + index_low;
-
-            uint nSwapElem = nMergeSubSize == nMergeSize >> 1 ? index_high + (2 * nMergeSubSize - 1) - index_low : index_high + nMergeSubSize + index_low;
-            if (nSwapElem < numArray && index < numArray)
-            {
-                if (arr1[index].r > arr1[nSwapElem].r)
-                {
-                    float3 uTemp = arr1[index];
-                    arr1[index] = arr1[nSwapElem];
-                    arr1[nSwapElem] = uTemp;
-                }
-            }
-            GroupMemoryBarrierWithGroupSync();
-        }
-    }
-}
-  
 float CalcIntensity(float3 color)
 {
     return (color.r*0.3f + color.g*0.59f + color.b*0.11f);
@@ -126,10 +58,7 @@ float InterleavedGradientNoise(float2 pixel)
 
 
 
-groupshared uint newRandSeeds[BLOCK * BLOCK];
-groupshared float3 colors[BLOCK * BLOCK];
-groupshared float3 blueNoiseColors[BLOCK * BLOCK];
-groupshared uint randSeeds[BLOCK * BLOCK];
+groupshared float intensities[BLOCK * BLOCK];
 
 [numthreads(BLOCK, BLOCK, 1)]
 void main(uint3 groupID : SV_GroupID, // 3D index of the thread group in the dispatch.
@@ -137,44 +66,29 @@ uint3 groupThreadID : SV_GroupThreadID, // 3D index of local thread ID in a thre
 uint3 dispatchThreadID : SV_DispatchThreadID, // 3D index of global thread ID in the dispatch.
 uint groupIndex : SV_GroupIndex)
 {
-    
-    int texWidth;
-    int texHeight;
-    
-    blueNoise.GetDimensions(texWidth, texHeight);
-    
-    float2 offset = GenerateR2Sequence(frameNum);
-    
-    uint initialSeed = InitSeed(dispatchThreadID.x, dispatchThreadID.y);
-    randSeeds[groupIndex] = initialSeed;
-    
     if (frameNum == 0)
     {
-        newSequences[(dispatchThreadID.y) * WIDTH + (dispatchThreadID.x)] = initialSeed;
+        newSequences[(dispatchThreadID.y) * WIDTH + (dispatchThreadID.x)] = InitSeed(dispatchThreadID.x, dispatchThreadID.y);
         return;
     }
     
-    randSeeds[groupIndex] = retargettedSequences[(dispatchThreadID.y) * WIDTH + (dispatchThreadID.x)];
-    
-    colors[groupIndex] = float3(CalcIntensity(prevFrame[dispatchThreadID.xy].rgb), groupThreadID.x, groupThreadID.y);
-
-    uint samplePosX = (dispatchThreadID.x + offset.x * (texWidth - 1)) % texWidth;
-    uint samplePosY = (dispatchThreadID.y + offset.y * (texHeight - 1)) % texHeight;
-    blueNoiseColors[groupIndex] = float3(blueNoise[uint2(samplePosX,samplePosY)].r, dispatchThreadID.x, dispatchThreadID.y);
+    intensities[groupIndex] = CalcIntensity(prevFrame[dispatchThreadID.xy].rgb);
     
     GroupMemoryBarrierWithGroupSync();
     
-    if (groupIndex == 0)
+    //this pixel's place among the block's intensities, ties in thread order like a stable sort
+    float intensity = intensities[groupIndex];
+    uint rank = 0;
+    for (uint i = 0; i < BLOCK * BLOCK; i++)
     {
-        BubbleSort(colors);
-        BubbleSort(blueNoiseColors);
+        rank += (intensities[i] < intensity || (intensities[i] == intensity && i < groupIndex)) ? 1 : 0;
     }
     
-    GroupMemoryBarrierWithGroupSync();
-
-    uint outIndex = blueNoiseColors[groupIndex].z * WIDTH + blueNoiseColors[groupIndex].y;
-    uint currentIndex = colors[groupIndex].z * BLOCK + colors[groupIndex].y;
+    //the seed goes where the blue noise value of the same rank is
+    uint2 windowStart = (groupID.xy * BLOCK + noiseOffset) % uint2(noiseWidth, noiseHeight);
+    uint2 order = blueNoiseOrders[windowStart.y * noiseWidth + windowStart.x];
+    uint destination = ((rank < 8 ? order.x >> (rank * 4) : order.y >> ((rank - 8) * 4))) & 0xF;
     
-    newSequences[outIndex] = randSeeds[currentIndex];
-
-}
\ No newline at end of file
+    uint2 outPos = groupID.xy * BLOCK + uint2(destination % BLOCK, destination / BLOCK);
+    newSequences[outPos.y * WIDTH + outPos.x] = retargettedSequences[(dispatchThreadID.y) * WIDTH + (dispatchThreadID.x)];
+}
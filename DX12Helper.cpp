@@ -1,4 +1,6 @@
 #include "DX12Helper.h"
+#include "RootSignatureCache.h"
+#include "PipelineStateCache.h"
 #include <fstream>
 
 
@@ -13,10 +15,6 @@ CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle;
 CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle;
 UINT handleIncrementSize;
 
-//Utitlity Resources
-ComPtr<ID3D12PipelineState> ltcTexPrefilterPSO;
-ComPtr<ID3D12RootSignature> ltcTexPrefilterRootSig;
-
 //BMFR Preprocess Resources
 ComPtr<ID3D12PipelineState> bmfrPreProcessPSO;
 ComPtr<ID3D12RootSignature> bmfrPreProcessRootSig;
@@ -97,11 +95,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
         computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, 1, &samplerDesc);
     
-        ComPtr<ID3DBlob> computeSignature;
-        ComPtr<ID3DBlob> computeError;
-    
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-        ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&generateMipMapsRootSig)));
+        generateMipMapsRootSig = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "generateMipMapsRootSig");
     
         ComPtr<ID3DBlob> shaderBlob;
         ThrowIfFailed(D3DReadFileToBlob(L"GenerateMipMapsCS.cso", shaderBlob.GetAddressOf()));
@@ -110,52 +104,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         computePSODesc.pRootSignature = generateMipMapsRootSig.Get();
         computePSODesc.CS = CD3DX12_SHADER_BYTECODE(shaderBlob.Get());
     
-        ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(generateMipMapsPSO.GetAddressOf())));
-    }
-
-    //prefilter ltc tex
-    {
-        CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
-        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0);
-        ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0);
-
-        CD3DX12_ROOT_PARAMETER1 rootParams[3];
-        rootParams[0].InitAsDescriptorTable(1, &ranges[0]);
-        rootParams[1].InitAsDescriptorTable(1, &ranges[1]);
-        rootParams[2].InitAsConstants(5, 0, 0);
-
-        D3D12_STATIC_SAMPLER_DESC samplerDesc = {};
-        samplerDesc.Filter = D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT;
-        samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        samplerDesc.MipLODBias = 0.0f;
-        samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-        samplerDesc.MinLOD = 0.0f;
-        samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
-        samplerDesc.MaxAnisotropy = 0;
-        samplerDesc.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK;
-        samplerDesc.ShaderRegister = 0;
-        samplerDesc.RegisterSpace = 0;
-        samplerDesc.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-
-        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
-        computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, 1, &samplerDesc);
-
-        ComPtr<ID3DBlob> computeSignature;
-        ComPtr<ID3DBlob> computeError;
-
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-        ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&ltcTexPrefilterRootSig)));
-
-        ComPtr<ID3DBlob> shaderBlob;
-        ThrowIfFailed(D3DReadFileToBlob(L"PrefilterLTCTextureCS.cso", shaderBlob.GetAddressOf()));
-
-        D3D12_COMPUTE_PIPELINE_STATE_DESC computePSODesc = {};
-        computePSODesc.pRootSignature = ltcTexPrefilterRootSig.Get();
-        computePSODesc.CS = CD3DX12_SHADER_BYTECODE(shaderBlob.Get());
-
-        ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(ltcTexPrefilterPSO.GetAddressOf())));
+        generateMipMapsPSO = GetPipelineStateCache().Get(device.Get(), computePSODesc, "generateMipMapsPSO");
     }
 
     D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
@@ -196,14 +145,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
             _countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-            signature.GetAddressOf(), error.GetAddressOf()));
-
-        ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-            IID_PPV_ARGS(bmfrPreProcessRootSig.GetAddressOf())));
+        bmfrPreProcessRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "bmfrPreProcessRootSig");
 
         ComPtr<ID3DBlob> fullcreenVS;
         ComPtr<ID3DBlob> pixelShader;
@@ -227,7 +169,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         PSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
         PSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
         PSODesc.SampleDesc.Count = 1;
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&PSODesc, IID_PPV_ARGS(bmfrPreProcessPSO.GetAddressOf())));
+        bmfrPreProcessPSO = GetPipelineStateCache().Get(device.Get(), PSODesc, "bmfrPreProcessPSO");
 
     }
 
@@ -268,11 +210,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
         computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, 1, &samplerDesc);
 
-        ComPtr<ID3DBlob> computeSignature;
-        ComPtr<ID3DBlob> computeError;
-
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-        ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&bmfrRegressionRootSig)));
+        bmfrRegressionRootSig = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "bmfrRegressionRootSig");
 
         ComPtr<ID3DBlob> shaderBlob;
         ThrowIfFailed(D3DReadFileToBlob(L"BMFRRegressionCS.cso", shaderBlob.GetAddressOf()));
@@ -281,7 +219,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         computePSODesc.pRootSignature = bmfrRegressionRootSig.Get();
         computePSODesc.CS = CD3DX12_SHADER_BYTECODE(shaderBlob.Get());
 
-        ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(bmfrRegressionPSO.GetAddressOf())));
+        bmfrRegressionPSO = GetPipelineStateCache().Get(device.Get(), computePSODesc, "bmfrRegressionPSO");
     }
 
     //BMFR post process
@@ -312,14 +250,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
             _countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-            signature.GetAddressOf(), error.GetAddressOf()));
-
-        ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-            IID_PPV_ARGS(bmfrPostProcessRootSig.GetAddressOf())));
+        bmfrPostProcessRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "bmfrPostProcessRootSig");
 
         ComPtr<ID3DBlob> fullcreenVS;
         ComPtr<ID3DBlob> pixelShader;
@@ -343,7 +274,7 @@ void InitResources(ComPtr<ID3D12Device> device, ComPtr<ID3D12GraphicsCommandList
         PSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
         PSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
         PSODesc.SampleDesc.Count = 1;
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&PSODesc, IID_PPV_ARGS(bmfrPostProcessPSO.GetAddressOf())));
+        bmfrPostProcessPSO = GetPipelineStateCache().Get(device.Get(), PSODesc, "bmfrPostProcessPSO");
     }
 }
 
@@ -655,90 +586,6 @@ void GenerateMipMaps(ComPtr<ID3D12Resource>& texture)
 
 }
 
-void PrefilterLTCTexture(ComPtr<ID3D12Resource> texture)
-{
-    auto texWidth = texture->GetDesc().Width;
-    auto texHeight = texture->GetDesc().Height;
-
-
-    auto transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    appResources.commandList->ResourceBarrier(1, &transition);
-
-    SubmitGraphicsCommandList(appResources.commandList);
-
-    ID3D12DescriptorHeap* ppHeaps[] = { srvUavCBVDescriptorHeap.Get() };
-
-    appResources.computeCommandList->SetPipelineState(ltcTexPrefilterPSO.Get());
-    appResources.computeCommandList->SetComputeRootSignature(ltcTexPrefilterRootSig.Get());
-    appResources.computeCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-
-    auto desc = texture->GetDesc();
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Format = desc.Format;
-    srvDesc.Texture2D.MipLevels = 1;
-
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-    uavDesc.Format = desc.Format;
-    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-
-    for (int i = 0; i < desc.MipLevels - 1; i++)
-    {
-
-        auto destWidth = std::max<UINT>(texWidth >> (i + 1), 1);
-        auto destHeight = std::max<UINT>(texHeight >> (i + 1), 1);
-
-        srvDesc.Texture2D.MostDetailedMip = i;
-        uavDesc.Texture2D.MipSlice = i + 1 ;
-
-        transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, i);
-        appResources.computeCommandList->ResourceBarrier(1, &transition);
-        appResources.device->CreateShaderResourceView(texture.Get(), &srvDesc, cpuHandle);
-        cpuHandle.Offset(1, handleIncrementSize);
-        lastResourceIndex++;
-        appResources.device->CreateUnorderedAccessView(texture.Get(), 0, &uavDesc, cpuHandle);
-        cpuHandle.Offset(1, handleIncrementSize);
-        lastResourceIndex++;
-
-        appResources.computeCommandList->SetComputeRootDescriptorTable(0, gpuHandle);
-        gpuHandle.Offset(1, handleIncrementSize);
-        appResources.computeCommandList->SetComputeRootDescriptorTable(1, gpuHandle);
-        gpuHandle.Offset(1, handleIncrementSize);
-
-        appResources.computeCommandList->SetComputeRoot32BitConstant(2, destWidth, 0);
-        appResources.computeCommandList->SetComputeRoot32BitConstant(2, destHeight, 1);
-        appResources.computeCommandList->SetComputeRoot32BitConstant(2, texWidth, 2);
-        appResources.computeCommandList->SetComputeRoot32BitConstant(2, texHeight, 3);
-        appResources.computeCommandList->SetComputeRoot32BitConstant(2, i, 4);
-
-
-        //Dispatch the compute shader with one thread per 8x8 pixels
-        appResources.computeCommandList->Dispatch(std::max<UINT>(destWidth / 8, 1u), std::max<UINT>(destHeight / 8, 1u), 1);
-
-        // appResources.computeCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-        //     D3D12_RESOURCE_STATE_UNORDERED_ACCESS, i));
-
-         //Wait for all accesses to the destination texture UAV to be finished before generating the next mipmap, as it will be the source texture for the next mipmap
-        auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(texture.Get());
-        appResources.computeCommandList->ResourceBarrier(1, &uavBarrier);
-    }
-
-    transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, desc.MipLevels - 1);
-    appResources.commandList->ResourceBarrier(1, &transition);
-
-    transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    appResources.commandList->ResourceBarrier(1, &transition);
-
-    SubmitComputeCommandList(appResources.computeCommandList, appResources.commandList);
-    SubmitGraphicsCommandList(appResources.commandList);
-
-}
-
 void DenoiseBMFR(ManagedResource inputTex, ManagedResource inputNorm, ManagedResource inputWorld, ManagedResource inputAlbedo, ManagedResource prevNorm, ManagedResource prevWorld, ManagedResource prevAlbedo)
 {
 }
@@ -251,8 +251,6 @@ void GetHardwareAdapter(IDXGIFactory2* pFactory, IDXGIAdapter1** ppAdapter);
 
 void GenerateMipMaps(ComPtr<ID3D12Resource>& texture);
 
-void PrefilterLTCTexture(ComPtr<ID3D12Resource>& texture);
-
 void DenoiseBMFR(ManagedResource inputTex, ManagedResource inputNorm, ManagedResource inputWorld,
 	ManagedResource inputAlbedo, ManagedResource prevNorm, ManagedResource prevWorld,
 	ManagedResource prevAlbedo);
@@ -277,8 +275,6 @@ UINT DispatchSize(UINT tgSize, UINT numElements);
 
 float* ReadHDR(const wchar_t* textureFile, unsigned int* width, unsigned int* height);
 
-void LoadPrefilteredLTCTexture(ManagedResource tex);
-
 ApplicationResources& GetAppResources();
 
 void SubmitGraphicsCommandList(const ComPtr<ID3D12GraphicsCommandList>& commandList);
@@ -8,32 +8,12 @@ Emitter::Emitter(int maxParticles, int particlesPerSecond, float lifetime,
 	ComPtr<ID3D12RootSignature>& particleRoot, 
 	std::wstring textureName)
 {
-	this->maxParticles = maxParticles; //max particles spewed
-	this->particlesPerSecond = particlesPerSecond; //particles spewed per second
-	this->secondsPerParticle = 1.0f / particlesPerSecond; //amount after which a particle is spawned
-	this->lifetime = lifetime; //lifetime of each particle
-	this->startSize = startSize; //start size
-	this->endSize = endSize; //end size
-	this->startColor = startColor; //start color to interpolate from
-	this->endColor = endColor; //end color to interpolate to
-	this->startVelocity = startVelocity; //start velocity
-	this->velocityRandomRange = velocityRandomRange; //range of velocity
-	this->emitterPosition = emitterPosition; //position of emitter
-	this->positionRandomRange = positionRandomRange; //range of pos
-	this->rotationRandomRanges = rotationRandomRanges; //random ranges of rotation
-	this->emitterAcceleration = emitterAcceleration; //acceleration of emmiter
+	InitEmitterParams(maxParticles, particlesPerSecond, lifetime, startSize, endSize, startColor, endColor,
+		startVelocity, velocityRandomRange, emitterPosition, positionRandomRange, rotationRandomRanges, emitterAcceleration);
 	this->particlePSO = particlePipeline;
 	this->particleRootSig = particleRoot;
-
-	timeSinceEmit = 0;//how long since the last particle was emmited
-	livingParticleCount = 0; //count of how many particles
-	//circular buffer indices
-	firstAliveIndex = 0;
-	firstDeadIndex = 0;
-	isDead = false;
-	isTemp = false;
-	emitterAge = true;
-	explosive = false;
+	isPooled = false;
+	emitterIndex = 0;
 
 	particles = new Particle[maxParticles];
 	ZeroMemory(particles, sizeof(Particle) * maxParticles);
@@ -92,9 +72,63 @@ Emitter::Emitter(int maxParticles, int particlesPerSecond, float lifetime,
 	delete[] indices;
 }
 
+Emitter::Emitter(int maxParticles, int particlesPerSecond, float lifetime,
+	float startSize, float endSize, Vector4 startColor, Vector4 endColor,
+	Vector3 startVelocity, Vector3 velocityRandomRange, Vector3 emitterPosition,
+	Vector3 positionRandomRange, Vector4 rotationRandomRanges, Vector3 emitterAcceleration,
+	Particle* particlePool, UINT emitterIndex)
+{
+	InitEmitterParams(maxParticles, particlesPerSecond, lifetime, startSize, endSize, startColor, endColor,
+		startVelocity, velocityRandomRange, emitterPosition, positionRandomRange, rotationRandomRanges, emitterAcceleration);
+
+	//the pool range is owned by the emitter system
+	particles = particlePool;
+	isPooled = true;
+	this->emitterIndex = emitterIndex;
+	particleDataBegin = nullptr;
+	externDataBegin = nullptr;
+	particleTextureIndex = 0;
+
+	ZeroMemory(particles, sizeof(Particle) * maxParticles);
+}
+
 Emitter::~Emitter()
 {
-	delete[] particles;
+	if (!isPooled)
+	{
+		delete[] particles;
+	}
+}
+
+void Emitter::InitEmitterParams(int maxParticles, int particlesPerSecond, float lifetime,
+	float startSize, float endSize, Vector4 startColor, Vector4 endColor,
+	Vector3 startVelocity, Vector3 velocityRandomRange, Vector3 emitterPosition,
+	Vector3 positionRandomRange, Vector4 rotationRandomRanges, Vector3 emitterAcceleration)
+{
+	this->maxParticles = maxParticles; //max particles spewed
+	this->particlesPerSecond = particlesPerSecond; //particles spewed per second
+	this->secondsPerParticle = 1.0f / particlesPerSecond; //amount after which a particle is spawned
+	this->lifetime = lifetime; //lifetime of each particle
+	this->startSize = startSize; //start size
+	this->endSize = endSize; //end size
+	this->startColor = startColor; //start color to interpolate from
+	this->endColor = endColor; //end color to interpolate to
+	this->startVelocity = startVelocity; //start velocity
+	this->velocityRandomRange = velocityRandomRange; //range of velocity
+	this->emitterPosition = emitterPosition; //position of emitter
+	this->positionRandomRange = positionRandomRange; //range of pos
+	this->rotationRandomRanges = rotationRandomRanges; //random ranges of rotation
+	this->emitterAcceleration = emitterAcceleration; //acceleration of emmiter
+
+	timeSinceEmit = 0;//how long since the last particle was emmited
+	livingParticleCount = 0; //count of how many particles
+	//circular buffer indices
+	firstAliveIndex = 0;
+	firstDeadIndex = 0;
+	isDead = false;
+	isTemp = false;
+	emitterAge = true;
+	explosive = false;
 }
 
 Vector3 Emitter::GetPosition()
@@ -170,6 +204,10 @@ void Emitter::UpdateParticles(float deltaTime, float currentTime)
 
 void Emitter::Draw(std::shared_ptr<GPUHeapRingBuffer>& ringBuffer,Matrix view, Matrix projection, float currentTime)
 {
+	//pooled emitters are drawn by the emitter system
+	if (isPooled)
+		return;
+
 	memcpy(particleDataBegin, particles, sizeof(Particle) * maxParticles);
 
 	//setting the up the buffer
@@ -237,6 +275,71 @@ DescriptorHeapWrapper& Emitter::GetDescriptor()
 	return descriptorHeap;
 }
 
+UINT Emitter::CopyLiveParticles(Particle* dst)
+{
+	if (livingParticleCount <= 0)
+		return 0;
+
+	//the living particles are contiguous unless the circular buffer wrapped around
+	if (firstAliveIndex < firstDeadIndex)
+	{
+		memcpy(dst, particles + firstAliveIndex, sizeof(Particle) * livingParticleCount);
+	}
+
+	else
+	{
+		UINT tailCount = maxParticles - firstAliveIndex;
+		memcpy(dst, particles + firstAliveIndex, sizeof(Particle) * tailCount);
+		memcpy(dst + tailCount, particles, sizeof(Particle) * firstDeadIndex);
+	}
+
+	return livingParticleCount;
+}
+
+UINT Emitter::GetStandaloneDrawCount()
+{
+	if (livingParticleCount <= 0)
+		return 0;
+
+	//a wrapped circular buffer is drawn in two parts
+	return (firstAliveIndex < firstDeadIndex) ? 1 : 2;
+}
+
+UINT64 Emitter::GetStandaloneMemorySize()
+{
+	//default and upload index heaps, the particle upload buffer and the 64kb constant buffer
+	UINT64 indexBufferSize = sizeof(unsigned int) * 6 * (UINT64)maxParticles;
+	return indexBufferSize * 2 + sizeof(Particle) * (UINT64)maxParticles + 1024 * 64;
+}
+
+ParticleEmitterData Emitter::GetEmitterData()
+{
+	ParticleEmitterData data = {};
+	data.acceleration = emitterAcceleration;
+	data.lifetime = lifetime;
+	data.startColor = startColor;
+	data.endColor = endColor;
+	data.startSize = startSize;
+	data.endSize = endSize;
+	data.textureIndex = particleTextureIndex;
+	return data;
+}
+
+int Emitter::GetMaxParticles()
+{
+	return maxParticles;
+}
+
+int Emitter::GetLivingParticleCount()
+{
+	return livingParticleCount;
+}
+
+bool Emitter::IsPooled()
+{
+	return isPooled;
+}
+
 void Emitter::UpdateSingleParticle(float dt, int index, float currentTime)
 {
 	float age = currentTime - particles[index].spawnTime;
@@ -261,6 +364,7 @@ void Emitter::SpawnParticle(float currentTime)
 
 	//spawinig a new particle
 	particles[firstDeadIndex].spawnTime = currentTime;
+	particles[firstDeadIndex].emitterIndex = emitterIndex;
 
 	//random position and veloctiy of the particle
 	std::random_device rd;
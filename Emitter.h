@@ -25,6 +25,21 @@ struct ParticleExternalData
 	float currentTime;
 };
 
+//per emitter parameters, read by the batched particle shader through the particle's emitter index
+struct ParticleEmitterData
+{
+	Vector3 acceleration;
+	float lifetime;
+
+	Vector4 startColor;
+	Vector4 endColor;
+
+	float startSize;
+	float endSize;
+	UINT textureIndex;
+	float padding;
+};
+
 class Emitter
 {
 public:
@@ -46,6 +61,26 @@ public:
 		ComPtr<ID3D12RootSignature>& particleRoot,
 		std::wstring textureName
 	);
+
+	//pooled emitter, the particles live in a range of a pool owned by the emitter system
+	//and no gpu resources are created
+	Emitter(
+		int maxParticles,
+		int particlesPerSecond,
+		float lifetime,
+		float startSize,
+		float endSize,
+		Vector4 startColor,
+		Vector4 endColor,
+		Vector3 startVelocity,
+		Vector3 velocityRandomRange,
+		Vector3 emitterPosition,
+		Vector3 positionRandomRange,
+		Vector4 rotationRandomRanges,
+		Vector3 emitterAcceleration,
+		Particle* particlePool,
+		UINT emitterIndex
+	);
 	~Emitter();
 
 	Vector3 GetPosition();
@@ -61,6 +96,17 @@ public:
 
 	DescriptorHeapWrapper& GetDescriptor();
 
+	//copies the living particles contiguously into dst and returns how many were copied
+	UINT CopyLiveParticles(Particle* dst);
+	//number of draw calls the emitter would need if drawn on its own
+	UINT GetStandaloneDrawCount();
+	//bytes of gpu memory the emitter would allocate if created on its own
+	UINT64 GetStandaloneMemorySize();
+	ParticleEmitterData GetEmitterData();
+	int GetMaxParticles();
+	int GetLivingParticleCount();
+	bool IsPooled();
+
 	UINT particleTextureIndex;
 
 private:
@@ -91,6 +137,8 @@ private:
 
 	// Particle array
 	Particle* particles;
+	bool isPooled;
+	UINT emitterIndex;
 	int maxParticles;
 	int firstDeadIndex;
 	int firstAliveIndex;
@@ -128,6 +176,10 @@ private:
 	DescriptorHeapWrapper descriptorHeap;
 
 	// Update Methods
+	void InitEmitterParams(int maxParticles, int particlesPerSecond, float lifetime,
+		float startSize, float endSize, Vector4 startColor, Vector4 endColor,
+		Vector3 startVelocity, Vector3 velocityRandomRange, Vector3 emitterPosition,
+		Vector3 positionRandomRange, Vector4 rotationRandomRanges, Vector3 emitterAcceleration);
 	void UpdateSingleParticle(float dt, int index, float currentTime);
 	void SpawnParticle(float currentTime);
 };
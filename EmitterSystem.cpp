@@ -0,0 +1,205 @@
+#include "EmitterSystem.h"
+
+EmitterSystem::EmitterSystem(UINT poolSize, ComPtr<ID3D12PipelineState>& particlePipeline, ComPtr<ID3D12RootSignature>& particleRoot)
+{
+	this->poolSize = poolSize;
+	this->particlePSO = particlePipeline;
+	this->particleRootSig = particleRoot;
+
+	poolOffset = 0;
+	textureCount = 0;
+	particleTexturesIndex = 0;
+	copiedTextureCount = 0;
+	ZeroMemory(&stats, sizeof(EmitterSystemStats));
+
+	particlePool = new Particle[poolSize];
+	ZeroMemory(particlePool, sizeof(Particle) * poolSize);
+
+	//every particle is one instance of the same quad
+	unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+	indexBuffer = CreateIBView(indices, 6, defaultIndexHeap, uploadIndexHeap);
+
+	descriptorHeap.Create(MAX_PARTICLE_TEXTURES, false, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	//live particles of all the emitters, one copy per frame in flight
+	auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(Particle) * (UINT64)poolSize * numFrames);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(particleBuffer.GetAddressOf())
+	));
+
+	particleBuffer->SetName(L"particle pool");
+	particleBuffer->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&particleDataBegin));
+
+	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(ParticleEmitterData) * MAX_EMITTERS * numFrames);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(emitterDataBuffer.GetAddressOf())
+	));
+
+	emitterDataBuffer->SetName(L"particle emitter data");
+	emitterDataBuffer->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&emitterDataBegin));
+
+	//constant buffers have to be 256 byte aligned
+	externDataSize = (sizeof(ParticleSystemExternalData) + 255) & ~255;
+	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(externDataSize * numFrames);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(externalDataResource.GetAddressOf())
+	));
+
+	externalDataResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&externDataBegin));
+
+	stats.memorySize = sizeof(Particle) * (UINT64)poolSize * numFrames
+		+ sizeof(ParticleEmitterData) * MAX_EMITTERS * numFrames
+		+ externDataSize * numFrames
+		+ sizeof(indices) * 2;
+}
+
+EmitterSystem::~EmitterSystem()
+{
+	//the emitters only point into the pool, release them first
+	emitters.clear();
+	delete[] particlePool;
+}
+
+std::shared_ptr<Emitter> EmitterSystem::AddEmitter(int maxParticles, int particlesPerSecond, float lifetime,
+	float startSize, float endSize, Vector4 startColor, Vector4 endColor,
+	Vector3 startVelocity, Vector3 velocityRandomRange, Vector3 emitterPosition,
+	Vector3 positionRandomRange, Vector4 rotationRandomRanges, Vector3 emitterAcceleration,
+	std::wstring textureName)
+{
+	if (poolOffset + maxParticles > poolSize || emitters.size() >= MAX_EMITTERS)
+		return nullptr;
+
+	//emitters that share a texture share its descriptor
+	UINT textureIndex = 0;
+	auto texture = textureIndices.find(textureName);
+	if (texture != textureIndices.end())
+	{
+		textureIndex = texture->second;
+	}
+
+	else
+	{
+		if (textureCount == MAX_PARTICLE_TEXTURES)
+			return nullptr;
+
+		descriptorHeap.CreateDescriptor(textureName, textures[textureCount], RESOURCE_TYPE_SRV, TEXTURE_TYPE_DEAULT);
+		textureIndex = textureCount;
+		textureIndices[textureName] = textureCount;
+		textureCount++;
+	}
+
+	auto emitter = std::make_shared<Emitter>(maxParticles, particlesPerSecond, lifetime, startSize, endSize,
+		startColor, endColor, startVelocity, velocityRandomRange, emitterPosition, positionRandomRange,
+		rotationRandomRanges, emitterAcceleration, particlePool + poolOffset, (UINT)emitters.size());
+	emitter->particleTextureIndex = textureIndex;
+
+	poolOffset += maxParticles;
+	emitters.emplace_back(emitter);
+
+	stats.emitterCount = (UINT)emitters.size();
+	stats.standaloneMemorySize += emitter->GetStandaloneMemorySize();
+
+	return emitter;
+}
+
+void EmitterSystem::AllocateDescriptors(std::shared_ptr<GPUHeapRingBuffer>& ringBuffer)
+{
+	//the whole table is reserved up front so it never moves when textures are added
+	particleTexturesIndex = ringBuffer->ReserveStaticDescriptors(MAX_PARTICLE_TEXTURES);
+	copiedTextureCount = 0;
+}
+
+void EmitterSystem::Update(float deltaTime, float currentTime)
+{
+	for (size_t i = 0; i < emitters.size(); i++)
+	{
+		emitters[i]->UpdateParticles(deltaTime, currentTime);
+	}
+}
+
+void EmitterSystem::Draw(std::shared_ptr<GPUHeapRingBuffer>& ringBuffer, Matrix view, Matrix projection, float currentTime, UINT frameIndex)
+{
+	Particle* frameParticles = reinterpret_cast<Particle*>(particleDataBegin) + (UINT64)poolSize * frameIndex;
+	ParticleEmitterData* frameEmitterData = reinterpret_cast<ParticleEmitterData*>(emitterDataBegin) + MAX_EMITTERS * frameIndex;
+
+	//pack the living particles of every emitter back to back
+	UINT livingParticles = 0;
+	UINT standaloneDrawCalls = 0;
+	for (size_t i = 0; i < emitters.size(); i++)
+	{
+		frameEmitterData[i] = emitters[i]->GetEmitterData();
+		standaloneDrawCalls += emitters[i]->GetStandaloneDrawCount();
+		livingParticles += emitters[i]->CopyLiveParticles(frameParticles + livingParticles);
+	}
+
+	stats.livingParticles = livingParticles;
+	stats.standaloneDrawCalls = standaloneDrawCalls;
+	stats.drawCalls = livingParticles > 0 ? 1 : 0;
+
+	if (livingParticles == 0)
+		return;
+
+	//only the slots of new textures are written, frames in flight never read those
+	if (copiedTextureCount < textureCount)
+	{
+		ringBuffer->CopyStaticDescriptors(particleTexturesIndex + copiedTextureCount, textureCount - copiedTextureCount,
+			descriptorHeap, copiedTextureCount);
+		copiedTextureCount = textureCount;
+	}
+
+	ParticleSystemExternalData externData = {};
+	externData.view = view;
+	externData.projection = projection;
+	externData.currentTime = currentTime;
+	memcpy(externDataBegin + externDataSize * frameIndex, &externData, sizeof(externData));
+
+	auto commandList = GetAppResources().commandList;
+
+	commandList->IASetIndexBuffer(&indexBuffer);
+	commandList->IASetVertexBuffers(0, 1, nullptr);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	commandList->SetPipelineState(particlePSO.Get());
+	commandList->SetGraphicsRootSignature(particleRootSig.Get());
+	commandList->SetGraphicsRootShaderResourceView(ParticleSystemRootIndices::ParticleSystemParticlesSRV,
+		particleBuffer->GetGPUVirtualAddress() + sizeof(Particle) * (UINT64)poolSize * frameIndex);
+	commandList->SetGraphicsRootShaderResourceView(ParticleSystemRootIndices::ParticleSystemEmitterDataSRV,
+		emitterDataBuffer->GetGPUVirtualAddress() + sizeof(ParticleEmitterData) * MAX_EMITTERS * frameIndex);
+	commandList->SetGraphicsRootConstantBufferView(ParticleSystemRootIndices::ParticleSystemExternDataCBV,
+		externalDataResource->GetGPUVirtualAddress() + externDataSize * frameIndex);
+	commandList->SetGraphicsRootDescriptorTable(ParticleSystemRootIndices::ParticleSystemTexturesSRV,
+		ringBuffer->GetDescriptorHeap().GetGPUHandle(particleTexturesIndex));
+
+	//one instance per living particle, the instance reads its emitter through the emitter index
+	commandList->DrawIndexedInstanced(6, livingParticles, 0, 0, 0);
+}
+
+DescriptorHeapWrapper& EmitterSystem::GetDescriptor()
+{
+	return descriptorHeap;
+}
+
+UINT EmitterSystem::GetTextureCount()
+{
+	return textureCount;
+}
+
+const EmitterSystemStats& EmitterSystem::GetStats()
+{
+	return stats;
+}
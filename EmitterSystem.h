@@ -0,0 +1,109 @@
+#pragma once
+#include "DX12Helper.h"
+#include "DescriptorHeapWrapper.h"
+#include"GPUHeapRingBuffer.h"
+#include"Emitter.h"
+#include<unordered_map>
+
+//must match the texture range in the particle system root signature
+#define MAX_PARTICLE_TEXTURES 8
+#define MAX_EMITTERS 1024
+
+struct ParticleSystemExternalData
+{
+	Matrix view;
+	Matrix projection;
+	float currentTime;
+	Vector3 padding;
+};
+
+struct EmitterSystemStats
+{
+	UINT emitterCount;
+	UINT livingParticles;
+	UINT drawCalls; //draw calls issued by the emitter system
+	UINT standaloneDrawCalls; //draw calls the same emitters would issue on their own
+	UINT64 memorySize; //gpu memory used by the emitter system
+	UINT64 standaloneMemorySize; //gpu memory the same emitters would use on their own
+};
+
+//owns every pooled emitter, allocates their particles from one shared pool
+//and draws all of them with a single instanced draw call
+class EmitterSystem
+{
+public:
+	EmitterSystem(
+		UINT poolSize,
+		ComPtr<ID3D12PipelineState>& particlePipeline,
+		ComPtr<ID3D12RootSignature>& particleRoot
+	);
+	~EmitterSystem();
+
+	//returns nullptr when the pool or the texture table is full
+	std::shared_ptr<Emitter> AddEmitter(
+		int maxParticles,
+		int particlesPerSecond,
+		float lifetime,
+		float startSize,
+		float endSize,
+		Vector4 startColor,
+		Vector4 endColor,
+		Vector3 startVelocity,
+		Vector3 velocityRandomRange,
+		Vector3 emitterPosition,
+		Vector3 positionRandomRange,
+		Vector4 rotationRandomRanges,
+		Vector3 emitterAcceleration,
+		std::wstring textureName
+	);
+
+	//reserves the particle texture table in the ring buffer's static descriptors. Textures are copied into it when
+	//they are added, so emitters added after this still find their descriptors
+	void AllocateDescriptors(std::shared_ptr<GPUHeapRingBuffer>& ringBuffer);
+
+	void Update(float deltaTime, float currentTime);
+	void Draw(std::shared_ptr<GPUHeapRingBuffer>& ringBuffer, Matrix view, Matrix projection, float currentTime, UINT frameIndex);
+
+	DescriptorHeapWrapper& GetDescriptor();
+	UINT GetTextureCount();
+	const EmitterSystemStats& GetStats();
+
+private:
+	static const UINT numFrames = 3;
+
+	std::vector<std::shared_ptr<Emitter>> emitters;
+
+	//shared particle pool, every emitter owns the range [poolOffset, poolOffset + maxParticles)
+	Particle* particlePool;
+	UINT poolSize;
+	UINT poolOffset;
+
+	//particle textures, deduplicated by file name
+	std::unordered_map<std::wstring, UINT> textureIndices;
+	ManagedResource textures[MAX_PARTICLE_TEXTURES];
+	UINT textureCount;
+	//index of the first particle texture in the ring buffer, and how many textures were copied there
+	UINT particleTexturesIndex;
+	UINT copiedTextureCount;
+
+	//quad index buffer shared by every particle instance
+	D3D12_INDEX_BUFFER_VIEW indexBuffer;
+	ComPtr<ID3D12Resource> defaultIndexHeap;
+	ComPtr<ID3D12Resource> uploadIndexHeap;
+
+	ComPtr<ID3D12PipelineState> particlePSO;
+	ComPtr<ID3D12RootSignature> particleRootSig;
+
+	//per frame copies of the live particles, emitter data and constant buffer
+	ComPtr<ID3D12Resource> particleBuffer;
+	UINT8* particleDataBegin;
+	ComPtr<ID3D12Resource> emitterDataBuffer;
+	UINT8* emitterDataBegin;
+	ComPtr<ID3D12Resource> externalDataResource;
+	UINT8* externDataBegin;
+	UINT externDataSize;
+
+	DescriptorHeapWrapper descriptorHeap;
+
+	EmitterSystemStats stats;
+};
@@ -19,6 +19,8 @@ Entity::Entity(entt::registry& registry, ComPtr<ID3D12PipelineState>& pipelineSt
 
 	XMStoreFloat4(&rotation, XMQuaternionIdentity()); //identity quaternion
 
+	SaveSimulationState();
+
 	//body = nullptr;
 
 	//don't need to recalculate matrix now
@@ -278,14 +280,15 @@ DirectX::BoundingBox Entity::GetBounds()
 	return material;
 }*/
 
-/**/void Entity::PrepareMaterial(Matrix view, Matrix projection)
+/**/void Entity::PrepareMaterial(Matrix view, Matrix projection, float interpolationAlpha)
 {
+	XMMATRIX world = GetInterpolatedModelMatrix(interpolationAlpha);
 
-	constantBufferData.world = GetModelMatrix();
+	XMStoreFloat4x4(&constantBufferData.world, XMMatrixTranspose(world));
 	constantBufferData.view = view;
 	constantBufferData.projection = projection;
 
-	XMMATRIX invTransposeTemp = GetRawModelMatrix();
+	XMMATRIX invTransposeTemp = world;
 
 	invTransposeTemp = XMMatrixInverse(nullptr, invTransposeTemp);
 	XMStoreFloat4x4(&constantBufferData.worldInvTranspose, invTransposeTemp);
@@ -330,9 +333,30 @@ bool Entity::ManipulateTransforms(Matrix& view, Matrix& proj, ImGuizmo::OPERATIO
 	SetScale(tempScale);
 	SetRotation(tempRot);
 
+	//moving the entity with the gizmo is a teleport, not something to interpolate
+	if (manipulated)
+		SaveSimulationState();
+
 	return manipulated;
 }
 
+void Entity::SaveSimulationState()
+{
+	prevSimulationPosition = position;
+	prevSimulationScale = scale;
+	prevSimulationRotation = rotation;
+}
+
+XMMATRIX Entity::GetInterpolatedModelMatrix(float alpha)
+{
+	XMVECTOR interpolatedPosition = XMVectorLerp(XMLoadFloat3(&prevSimulationPosition), XMLoadFloat3(&position), alpha);
+	XMVECTOR interpolatedScale = XMVectorLerp(XMLoadFloat3(&prevSimulationScale), XMLoadFloat3(&scale), alpha);
+	XMVECTOR interpolatedRotation = XMQuaternionSlerp(XMLoadFloat4(&prevSimulationRotation), XMLoadFloat4(&rotation), alpha);
+
+	return XMMatrixScalingFromVector(interpolatedScale) * XMMatrixRotationQuaternion(interpolatedRotation)
+		* XMMatrixTranslationFromVector(interpolatedPosition);
+}
+
 void Entity::PrepareConstantBuffers(D3DX12Residency::ResidencyManager resManager,
 	std::shared_ptr<D3DX12Residency::ResidencySet>& residencySet)
 {
@@ -40,6 +40,11 @@ protected:
 	//model matrix of the entity
 	Matrix prevModelMatrix;
 
+	//transform before the last simulation step, rendering interpolates from it to the current one
+	Vector3 prevSimulationPosition;
+	Vector3 prevSimulationScale;
+	Quaternion prevSimulationRotation;
+
 	bool recalculateMatrix; // boolean to check if any transform has changed
 
 	std::shared_ptr<Mesh> mesh; //mesh associated with this entity
@@ -132,7 +137,11 @@ public:
 	//method that prepares the material and sends it to the gpu
 	void PrepareConstantBuffers(D3DX12Residency::ResidencyManager resManager,
 		std::shared_ptr<D3DX12Residency::ResidencySet>& residencySet);
-	void PrepareMaterial(Matrix view, Matrix projection);
+	void PrepareMaterial(Matrix view, Matrix projection, float interpolationAlpha = 1.0f);
+
+	//called before every fixed simulation step
+	void SaveSimulationState();
+	XMMATRIX GetInterpolatedModelMatrix(float alpha);
 
 	virtual void Update(float deltaTime);
 	virtual void GetInput(float deltaTime);
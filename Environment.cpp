@@ -1,18 +1,16 @@
 #include "Environment.h"
 
-Environment::Environment(ComPtr<ID3D12RootSignature>& irradianceRootSignature, ComPtr<ID3D12RootSignature>& prefilteredRootSignature, ComPtr<ID3D12RootSignature>& brdfRootSignature,
-	ComPtr<ID3D12PipelineState>& irradiencePSO, ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
+Environment::Environment(const std::filesystem::path& environmentFile, ComPtr<ID3D12RootSignature>& prefilteredRootSignature, ComPtr<ID3D12RootSignature>& brdfRootSignature,
+	ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
 	ComPtr<ID3D12PipelineState>& brdfLUTPSO,
 	CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxHandle, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle,
 	D3D12_VERTEX_BUFFER_VIEW skyboxCube, D3D12_INDEX_BUFFER_VIEW indexBuffer, UINT indexCount)
 {
-    this->irradiencePSO = irradiencePSO;
     this->prefilteredMapPSO = prefilteredMapPSO;
     this->brdfLUTPSO = brdfLUTPSO;
     this->prefilteredRootSignature = prefilteredRootSignature;
-    this->irradianceRootSignature = irradianceRootSignature;
     this->brdfRootSignature = brdfRootSignature;
-    ThrowIfFailed(srvDescriptorHeap.Create( 3, false, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+    ThrowIfFailed(srvDescriptorHeap.Create( 2, false, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
 
     ThrowIfFailed(rtvDescriptorHeap.Create( 43, false, D3D12_DESCRIPTOR_HEAP_TYPE_RTV));
 
@@ -87,7 +85,7 @@ Environment::Environment(ComPtr<ID3D12RootSignature>& irradianceRootSignature, C
 
 	cube = std::make_shared<Mesh>("../../Assets/Models/cube.obj");
 
-	CreateIrradianceMap(skyboxHandle,depthStencilHandle);
+	CreateIrradianceSH(environmentFile);
 	CreatePrefilteredEnvironmentMap(skyboxHandle,depthStencilHandle);
 	CreateBRDFLut(depthStencilHandle);
 
@@ -98,93 +96,28 @@ Environment::~Environment()
 {
 }
 
-void Environment::CreateIrradianceMap(CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxHandle, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle)
+void Environment::CreateIrradianceSH(const std::filesystem::path& environmentFile)
 {
-	D3D12_RESOURCE_DESC irradienaceTextureDesc = {};
-	irradienaceTextureDesc.DepthOrArraySize = 6;
-	irradienaceTextureDesc.MipLevels = 1;
-	irradienaceTextureDesc.Width = 64;
-	irradienaceTextureDesc.Height = 64;
-	irradienaceTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-	irradienaceTextureDesc.SampleDesc.Count = 1;
-	irradienaceTextureDesc.SampleDesc.Quality = 0;
-	irradienaceTextureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	irradienaceTextureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	IrradianceSH irradianceSH;
+	std::filesystem::path cacheFile = environmentFile;
+	irradianceSH.LoadOrProject(cacheFile.replace_extension(".irradiancesh"), environmentFile);
 
-
-	FLOAT color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
-
-	D3D12_CLEAR_VALUE rtvClearVal = {};
-	rtvClearVal.Color[0] = color[0];
-	rtvClearVal.Color[1] = color[1];
-	rtvClearVal.Color[2] = color[2];
-	rtvClearVal.Color[3] = color[3];
-	rtvClearVal.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-
-	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(&GetAppResources().defaultHeapType,
+	//constant buffers are 256 byte aligned
+	auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(256);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
 		D3D12_HEAP_FLAG_NONE,
-		&irradienaceTextureDesc,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-		&rtvClearVal,
-		IID_PPV_ARGS(irradienceMapTexture.resource.GetAddressOf())));
-
-	irradienceMapTexture.currentState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-
-	//creating the irradiance srv
-	srvDescriptorHeap.CreateDescriptor(irradienceMapTexture, RESOURCE_TYPE_SRV, 0, 512, 512, 0, 1);
-
-	viewPort = {};
-	viewPort.Height = 64;
-	viewPort.Width = 64;
-	viewPort.MaxDepth = 1.f;
-	viewPort.MinDepth = 0.0f;
-	viewPort.TopLeftX = 0.f;
-	viewPort.TopLeftY = 0.0f;
-
-	scissorRect = {};
-	scissorRect.bottom = 64;
-	scissorRect.right = 64;
-	scissorRect.left = 0;
-	scissorRect.top = 0;
-
-	GetAppResources().commandList->SetGraphicsRootSignature(irradianceRootSignature.Get());
-	GetAppResources().commandList->SetPipelineState(irradiencePSO.Get());
-	GetAppResources().commandList->RSSetViewports(1, &viewPort);
-	GetAppResources().commandList->RSSetScissorRects(1, &scissorRect);
-
-	const float clearColor[] = { 0.4f, 0.6f, 0.75f, 0.0f };
-	//commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-	GetAppResources().commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	GetAppResources().commandList->SetGraphicsRootConstantBufferView(EnvironmentRootIndices::EnvironmentTexturesData, constantBufferResource->GetGPUVirtualAddress());
-
-	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(irradienceMapTexture.resource.Get(), irradienceMapTexture.currentState, D3D12_RESOURCE_STATE_RENDER_TARGET);
-	GetAppResources().commandList->ResourceBarrier(1, &transition);
-	irradienceMapTexture.currentState = D3D12_RESOURCE_STATE_RENDER_TARGET;
-
-
-	for (int i = 0; i < 6; i++)
-	{
-		rtvDescriptorHeap.CreateDescriptor(irradienceMapTexture, RESOURCE_TYPE_RTV, 0, 64, 64, i, 0);
-		auto rtvCPUHandle = irradienceMapTexture.rtvCPUHandle;
-		GetAppResources().commandList->ClearRenderTargetView(rtvCPUHandle, clearColor, 0, 0);
-		GetAppResources().commandList->OMSetRenderTargets(1, &rtvCPUHandle, FALSE, &depthStencilHandle);
-		GetAppResources().commandList->ClearDepthStencilView(depthStencilHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, 0);
-
-		XMStoreFloat4x4(&environmentData.world, XMMatrixIdentity());
-		environmentData.view = cubemapViews[i];
-		environmentData.projection = cubemapProj;
-		environmentData.cameraPos = XMFLOAT3(0, 0, 0);
-
-		memcpy(environmentDataBegin, &environmentData, sizeof(environmentData));
-
-		GetAppResources().commandList->SetGraphicsRootDescriptorTable(EnvironmentRootIndices::EnvironmentTextureSRV, skyboxHandle);
-		GetAppResources().commandList->SetGraphicsRoot32BitConstant(EnvironmentRootIndices::EnvironmentFaceIndices, i, 0);
-		GetAppResources().commandList->DrawInstanced(3, 1, 0, 0);
-	}
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(irradianceSHBuffer.GetAddressOf())
+	));
+	irradianceSHBuffer->SetName(L"irradianceSH");
 
-	transition = CD3DX12_RESOURCE_BARRIER::Transition(irradienceMapTexture.resource.Get(), irradienceMapTexture.currentState, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	GetAppResources().commandList->ResourceBarrier(1, &transition);
-	irradienceMapTexture.currentState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	UINT8* irradianceSHBegin = nullptr;
+	ThrowIfFailed(irradianceSHBuffer->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&irradianceSHBegin)));
+	memcpy(irradianceSHBegin, &irradianceSH.GetData(), sizeof(IrradianceSHData));
+	irradianceSHBuffer->Unmap(0, nullptr);
 }
 
 void Environment::CreateBRDFLut(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle)
@@ -363,3 +296,8 @@ DescriptorHeapWrapper Environment::GetSRVDescriptorHeap()
 {
 	return srvDescriptorHeap;
 }
+
+ComPtr<ID3D12Resource>& Environment::GetIrradianceSHBuffer()
+{
+	return irradianceSHBuffer;
+}
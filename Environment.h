@@ -2,6 +2,8 @@
 #include"DX12Helper.h"
 #include"DescriptorHeapWrapper.h"
 #include"Mesh.h"
+#include"IrradianceSH.h"
+#include<filesystem>
 #include<memory>
 
 struct EnvironmentData
@@ -17,14 +19,15 @@ class Environment
 {
 	std::vector<Matrix> cubemapViews;
 	Matrix cubemapProj;
-	ManagedResource irradienceMapTexture;
-	ManagedResource irradienceDepthStencil;
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
 	
 
 	D3D12_VIEWPORT viewPort;
 	D3D12_RECT scissorRect;
 
+	//the diffuse irradiance as spherical harmonics, the pbr shaders' irradianceSH constant buffer
+	ComPtr<ID3D12Resource> irradianceSHBuffer;
+
 	//prefiltered environment map textures
 	ManagedResource prefilteredMapTextures;
 
@@ -34,12 +37,10 @@ class Environment
 
 
 	//pipeline state objects
-	ComPtr<ID3D12PipelineState> irradiencePSO;
 	ComPtr<ID3D12PipelineState> prefilteredMapPSO;
 	ComPtr<ID3D12PipelineState> brdfLUTPSO;
 
 	//root signatures
-	ComPtr<ID3D12RootSignature> irradianceRootSignature;
 	ComPtr<ID3D12RootSignature> prefilteredRootSignature;
 	ComPtr<ID3D12RootSignature> brdfRootSignature;
 
@@ -61,16 +62,18 @@ class Environment
 	std::shared_ptr<Mesh> cube;
 
 public:
-	Environment(ComPtr<ID3D12RootSignature>& irradianceRootSignature, ComPtr<ID3D12RootSignature>& prefilteredRootSignature, ComPtr<ID3D12RootSignature>& brdfRootSignature,
-		ComPtr<ID3D12PipelineState>& irradiencePSO, ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
+	Environment(const std::filesystem::path& environmentFile, ComPtr<ID3D12RootSignature>& prefilteredRootSignature, ComPtr<ID3D12RootSignature>& brdfRootSignature,
+		ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
 		ComPtr<ID3D12PipelineState>& brdfLUTPSO,
 		CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxHandle, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle,
 		D3D12_VERTEX_BUFFER_VIEW skyboxCube,D3D12_INDEX_BUFFER_VIEW indexBuffer,UINT indexCount);
 	~Environment();
-	void CreateIrradianceMap(CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxHandle, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle);
+	//projects the hdr's irradiance on the cpu, or loads it from the .irradiancesh next to the hdr, into irradianceSHBuffer
+	void CreateIrradianceSH(const std::filesystem::path& environmentFile);
 	void CreatePrefilteredEnvironmentMap(CD3DX12_GPU_DESCRIPTOR_HANDLE skyboxHandle,D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle);
 	void CreateBRDFLut(D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle);
 	DescriptorHeapWrapper GetSRVDescriptorHeap();
+	ComPtr<ID3D12Resource>& GetIrradianceSHBuffer();
 
 
 };
@@ -0,0 +1,381 @@
+#include "FFTPlan.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cassert>
+#include<chrono>
+#include<complex>
+#include<execution>
+#include<mutex>
+#include<numeric>
+#include<unordered_map>
+
+//tile size of the transposes, 32x32 complex values stay within L1
+static const int transposeTileSize = 32;
+
+//multiplies the two packed complex numbers by i
+inline XMVECTOR XM_CALLCONV ComplexMultiplyI2(FXMVECTOR q)
+{
+	return XMVectorMultiply(XMVectorSwizzle<1, 0, 3, 2>(q), XMVectorSet(-1.0f, 1.0f, -1.0f, 1.0f));
+}
+
+FFTPlan::FFTPlan(int size)
+{
+	//the radix 4 butterflies are done two at a time
+	assert(size >= 4 && (size & (size - 1)) == 0);
+
+	this->size = size;
+	log2Size = 0;
+	while ((1 << log2Size) < size)
+		log2Size++;
+
+	CreateBitReversedIndices();
+	CreateRadix4Stages();
+	CreateTwiddleTextureData();
+}
+
+std::shared_ptr<FFTPlan> FFTPlan::Get(int size)
+{
+	static std::mutex planMutex;
+	static std::unordered_map<int, std::shared_ptr<FFTPlan>> plans;
+
+	std::lock_guard<std::mutex> lock(planMutex);
+
+	auto plan = plans.find(size);
+	if (plan != plans.end())
+		return plan->second;
+
+	auto newPlan = std::make_shared<FFTPlan>(size);
+	plans[size] = newPlan;
+	return newPlan;
+}
+
+void FFTPlan::CreateBitReversedIndices()
+{
+	bitReversed.resize(size);
+	bitReversed[0] = 0;
+
+	//the reverse of i is the reverse of i/2 shifted down, with the low bit of i moved to the top
+	for (int i = 1; i < size; i++)
+	{
+		bitReversed[i] = (bitReversed[i >> 1] >> 1) | ((i & 1) << (log2Size - 1));
+	}
+}
+
+void FFTPlan::CreateRadix4Stages()
+{
+	radix2FirstStage = (log2Size % 2) == 1;
+
+	int span = radix2FirstStage ? 2 : 1;
+	while (span * 4 <= size)
+	{
+		FFTRadix4Stage stage;
+		stage.span = span;
+		stage.w1.resize(span);
+		stage.w2.resize(span);
+		stage.w3.resize(span);
+
+		//inverse transform, so the twiddles rotate counter clockwise
+		for (int j = 0; j < span; j++)
+		{
+			double angle = XM_2PI * (double)j / (4.0 * span);
+			stage.w1[j] = OceanComplex((float)cos(2.0 * angle), (float)sin(2.0 * angle));
+			stage.w2[j] = OceanComplex((float)cos(angle), (float)sin(angle));
+			stage.w3[j] = OceanComplex((float)cos(3.0 * angle), (float)sin(3.0 * angle));
+		}
+
+		radix4Stages.emplace_back(std::move(stage));
+		span *= 4;
+	}
+}
+
+void FFTPlan::CreateTwiddleTextureData()
+{
+	twiddleTextureData.resize((size_t)log2Size * size);
+
+	for (int stage = 0; stage < log2Size; stage++)
+	{
+		int butterflySpan = 1 << stage;
+
+		for (int i = 0; i < size; i++)
+		{
+			int k = (i * (size / (butterflySpan * 2))) % size;
+			double angle = XM_2PI * (double)k / size;
+			bool topWing = (i % (butterflySpan * 2)) < butterflySpan;
+
+			XMFLOAT4& twiddle = twiddleTextureData[(size_t)stage * size + i];
+			twiddle.x = (float)cos(angle);
+			twiddle.y = (float)sin(angle);
+
+			//indices of the first stage are bit reversed
+			if (stage == 0)
+			{
+				twiddle.z = (float)(topWing ? bitReversed[i] : bitReversed[i - 1]);
+				twiddle.w = (float)(topWing ? bitReversed[i + 1] : bitReversed[i]);
+			}
+
+			else
+			{
+				twiddle.z = (float)(topWing ? i : i - butterflySpan);
+				twiddle.w = (float)(topWing ? i + butterflySpan : i);
+			}
+		}
+	}
+}
+
+void FFTPlan::Inverse1D(OceanComplex* data)
+{
+	for (int i = 0; i < size; i++)
+	{
+		int j = bitReversed[i];
+		if (i < j)
+			std::swap(data[i], data[j]);
+	}
+
+	if (radix2FirstStage)
+	{
+		for (int i = 0; i < size; i += 2)
+		{
+			OceanComplex a = data[i];
+			OceanComplex b = data[i + 1];
+			data[i] = OceanComplex(a.x + b.x, a.y + b.y);
+			data[i + 1] = OceanComplex(a.x - b.x, a.y - b.y);
+		}
+	}
+
+	//every radix 4 stage does the work of two radix 2 stages on four consecutive blocks of span elements
+	for (size_t s = 0; s < radix4Stages.size(); s++)
+	{
+		const FFTRadix4Stage& stage = radix4Stages[s];
+		int span = stage.span;
+
+		for (int block = 0; block < size; block += span * 4)
+		{
+			OceanComplex* a = data + block;
+			OceanComplex* b = a + span;
+			OceanComplex* c = b + span;
+			OceanComplex* d = c + span;
+
+			//the first stage has a span of one and no twiddles
+			if (span == 1)
+			{
+				OceanComplex t0 = OceanComplex(a->x + b->x, a->y + b->y);
+				OceanComplex t1 = OceanComplex(a->x - b->x, a->y - b->y);
+				OceanComplex t2 = OceanComplex(c->x + d->x, c->y + d->y);
+				OceanComplex t3 = OceanComplex(-(c->y - d->y), c->x - d->x);
+
+				*a = OceanComplex(t0.x + t2.x, t0.y + t2.y);
+				*b = OceanComplex(t1.x + t3.x, t1.y + t3.y);
+				*c = OceanComplex(t0.x - t2.x, t0.y - t2.y);
+				*d = OceanComplex(t1.x - t3.x, t1.y - t3.y);
+				continue;
+			}
+
+			for (int j = 0; j < span; j += 2)
+			{
+				XMVECTOR va = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(a + j));
+				XMVECTOR vb = ComplexMultiply2(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&stage.w1[j])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(b + j)));
+				XMVECTOR vc = ComplexMultiply2(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&stage.w2[j])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(c + j)));
+				XMVECTOR vd = ComplexMultiply2(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&stage.w3[j])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(d + j)));
+
+				XMVECTOR t0 = XMVectorAdd(va, vb);
+				XMVECTOR t1 = XMVectorSubtract(va, vb);
+				XMVECTOR t2 = XMVectorAdd(vc, vd);
+				XMVECTOR t3 = ComplexMultiplyI2(XMVectorSubtract(vc, vd));
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(a + j), XMVectorAdd(t0, t2));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(b + j), XMVectorAdd(t1, t3));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(c + j), XMVectorSubtract(t0, t2));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(d + j), XMVectorSubtract(t1, t3));
+			}
+		}
+	}
+}
+
+void FFTPlan::Transpose(const OceanComplex* src, OceanComplex* dst)
+{
+	std::vector<int> tileRows(size / transposeTileSize > 0 ? size / transposeTileSize : 1);
+	std::iota(tileRows.begin(), tileRows.end(), 0);
+	int tileSize = std::min(size, transposeTileSize);
+
+	std::for_each(std::execution::par, tileRows.begin(), tileRows.end(), [&](int tileRow)
+		{
+			int startY = tileRow * tileSize;
+
+			for (int startX = 0; startX < size; startX += tileSize)
+			{
+				for (int y = startY; y < startY + tileSize; y++)
+				{
+					for (int x = startX; x < startX + tileSize; x++)
+					{
+						dst[(size_t)x * size + y] = src[(size_t)y * size + x];
+					}
+				}
+			}
+		});
+}
+
+void FFTPlan::Inverse2D(OceanComplex* data, OceanComplex* scratch)
+{
+	std::vector<int> rows(size);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	//rows are contiguous, so both passes stream through memory instead of striding down columns
+	std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y)
+		{
+			Inverse1D(data + (size_t)y * size);
+		});
+
+	Transpose(data, scratch);
+
+	std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y)
+		{
+			Inverse1D(scratch + (size_t)y * size);
+		});
+
+	Transpose(scratch, data);
+}
+
+int FFTPlan::GetSize()
+{
+	return size;
+}
+
+int FFTPlan::GetLog2Size()
+{
+	return log2Size;
+}
+
+int FFTPlan::GetBitReversedIndex(int index)
+{
+	return bitReversed[index];
+}
+
+const std::vector<XMFLOAT4>& FFTPlan::GetTwiddleTextureData()
+{
+	return twiddleTextureData;
+}
+
+//largest error of the 1D and 2D transforms of one size, relative to the largest value of the reference
+static void ValidateFFTPlanSize(bool& passed, int size)
+{
+	auto plan = FFTPlan::Get(size);
+
+	std::mt19937 randomGenerator(1);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<OceanComplex> data((size_t)size * size);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = OceanComplex(dist(randomGenerator), dist(randomGenerator));
+	}
+
+	//naive dft in double precision, exp(2 pi i nk/N) with no normalization to match the plan
+	auto naiveDFT = [size](const std::complex<double>* src, std::complex<double>* dst, size_t stride)
+	{
+		for (int k = 0; k < size; k++)
+		{
+			std::complex<double> sum = 0.0;
+			for (int n = 0; n < size; n++)
+			{
+				double angle = XM_2PI * (double)((long long)n * k % size) / size;
+				sum += src[n * stride] * std::complex<double>(cos(angle), sin(angle));
+			}
+			dst[k * stride] = sum;
+		}
+	};
+
+	//1D against the first row
+	std::vector<std::complex<double>> reference((size_t)size * size);
+	std::vector<std::complex<double>> referenceScratch((size_t)size * size);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		reference[i] = std::complex<double>(data[i].x, data[i].y);
+	}
+
+	std::vector<OceanComplex> row(data.begin(), data.begin() + size);
+	plan->Inverse1D(row.data());
+	naiveDFT(reference.data(), referenceScratch.data(), 1);
+
+	double maxError1D = 0.0;
+	double maxValue1D = 0.0;
+	for (int i = 0; i < size; i++)
+	{
+		maxError1D = std::max(maxError1D, std::abs(referenceScratch[i] - std::complex<double>(row[i].x, row[i].y)));
+		maxValue1D = std::max(maxValue1D, std::abs(referenceScratch[i]));
+	}
+
+	//2D as a dft of every row followed by a dft of every column
+	std::vector<OceanComplex> scratch(data.size());
+	plan->Inverse2D(data.data(), scratch.data());
+
+	for (int y = 0; y < size; y++)
+	{
+		naiveDFT(reference.data() + (size_t)y * size, referenceScratch.data() + (size_t)y * size, 1);
+	}
+
+	for (int x = 0; x < size; x++)
+	{
+		naiveDFT(referenceScratch.data() + x, reference.data() + x, size);
+	}
+
+	double maxError2D = 0.0;
+	double maxValue2D = 0.0;
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		maxError2D = std::max(maxError2D, std::abs(reference[i] - std::complex<double>(data[i].x, data[i].y)));
+		maxValue2D = std::max(maxValue2D, std::abs(reference[i]));
+	}
+
+	//float rounding grows with log2 of the size, a wrong twiddle or index is off by the size of the values themselves
+	double relativeError1D = maxError1D / maxValue1D;
+	double relativeError2D = maxError2D / maxValue2D;
+	printf("    %d: 1D error %e, 2D error %e\n", size, relativeError1D, relativeError2D);
+
+	std::string name = std::to_string(size) + " 1D within 1e-5";
+	Check(passed, name.c_str(), relativeError1D < 1e-5);
+	name = std::to_string(size) + " 2D within 1e-5";
+	Check(passed, name.c_str(), relativeError2D < 1e-5);
+}
+
+void ValidateFFTPlan()
+{
+	printf("FFT plan\n");
+	bool passed = true;
+
+	//64 and 256 are all radix 4 stages, 128 starts with a radix 2 stage
+	int sizes[3] = { 64, 128, 256 };
+	for (int i = 0; i < 3; i++)
+	{
+		ValidateFFTPlanSize(passed, sizes[i]);
+	}
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkFFTPlan(int iterations)
+{
+	int resolutions[3] = { 256, 512, 1024 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		int size = resolutions[i];
+		auto plan = FFTPlan::Get(size);
+
+		std::vector<OceanComplex> data((size_t)size * size, OceanComplex(1.0f, 0.0f));
+		std::vector<OceanComplex> scratch(data.size());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			plan->Inverse2D(data.data(), scratch.data());
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+		double pointsPerSecond = (double)size * size / (milliseconds / 1000.0);
+		printf("fft %dx%d: %.3f ms, %.1f million points/s\n", size, size, milliseconds, pointsPerSecond / 1000000.0);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<vector>
+#include<memory>
+
+//complex numbers are stored as (real, imaginary) pairs so that two of them fit in one XMVECTOR
+typedef XMFLOAT2 OceanComplex;
+
+//multiplies the two complex numbers packed in q by the two packed in w
+inline XMVECTOR XM_CALLCONV ComplexMultiply2(FXMVECTOR w, FXMVECTOR q)
+{
+	XMVECTOR wReal = XMVectorSwizzle<0, 0, 2, 2>(w);
+	XMVECTOR wIm = XMVectorSwizzle<1, 1, 3, 3>(w);
+	XMVECTOR qSwapped = XMVectorSwizzle<1, 0, 3, 2>(q);
+	XMVECTOR sign = XMVectorSet(-1.0f, 1.0f, -1.0f, 1.0f);
+
+	return XMVectorMultiplyAdd(wReal, q, XMVectorMultiply(XMVectorMultiply(wIm, qSwapped), sign));
+}
+
+//twiddles of one radix 4 stage, with w = e^(2 pi i / 4span): w1 = w^2j, w2 = w^j and w3 = w^3j for every j of the span
+struct FFTRadix4Stage
+{
+	int span;
+	std::vector<OceanComplex> w1;
+	std::vector<OceanComplex> w2;
+	std::vector<OceanComplex> w3;
+};
+
+//tables for the inverse fft of one power of two size, built once and shared through Get
+class FFTPlan
+{
+	int size;
+	int log2Size;
+
+	std::vector<int> bitReversed;
+
+	//a radix 2 stage is needed first when log2Size is odd
+	bool radix2FirstStage;
+	std::vector<FFTRadix4Stage> radix4Stages;
+
+	//same layout TwiddleFactorsCS writes, log2Size stages of size (real, imaginary, top index, bottom index)
+	std::vector<XMFLOAT4> twiddleTextureData;
+
+	void CreateBitReversedIndices();
+	void CreateRadix4Stages();
+	void CreateTwiddleTextureData();
+
+	void Transpose(const OceanComplex* src, OceanComplex* dst);
+
+public:
+	FFTPlan(int size);
+
+	static std::shared_ptr<FFTPlan> Get(int size);
+
+	//unnormalized inverse transform of size elements in place
+	void Inverse1D(OceanComplex* data);
+
+	//unnormalized inverse transform of a size x size grid, rows are transformed, the grid is transposed
+	//so the columns become rows as well, and transposed back. scratch needs size x size elements
+	void Inverse2D(OceanComplex* data, OceanComplex* scratch);
+
+	int GetSize();
+	int GetLog2Size();
+	int GetBitReversedIndex(int index);
+	const std::vector<XMFLOAT4>& GetTwiddleTextureData();
+};
+
+//the 1D and 2D inverse transforms against a naive double precision dft, for sizes with and without the radix 2 stage
+void ValidateFFTPlan();
+
+//prints the cost of a 2D inverse transform at 256, 512 and 1024
+void BenchmarkFFTPlan(int iterations = 20);
@@ -21,6 +21,21 @@ void GPUHeapRingBuffer::AllocateStaticDescriptors(UINT numDescriptors, Descripto
 	descriptorHeap.IncrementLastResourceIndex(numDescriptors);
 }
 
+UINT GPUHeapRingBuffer::ReserveStaticDescriptors(UINT numDescriptors)
+{
+	UINT index = numStaticResources;
+	numStaticResources += numDescriptors;
+	descriptorHeap.IncrementLastResourceIndex(numDescriptors);
+	return index;
+}
+
+void GPUHeapRingBuffer::CopyStaticDescriptors(UINT index, UINT numDescriptors, DescriptorHeapWrapper& otherDescHeap, UINT otherIndex)
+{
+	auto cpuHandle = descriptorHeap.GetCPUHandle(index);
+	auto otherCPUHandle = otherDescHeap.GetCPUHandle(otherIndex);
+	GetAppResources().device->CopyDescriptorsSimple(numDescriptors, cpuHandle, otherCPUHandle, otherDescHeap.GetDescriptorHeapType());
+}
+
 void GPUHeapRingBuffer::AddDescriptor(UINT numDescriptors, DescriptorHeapWrapper& otherDescHeap, UINT frameIndex)
 {
 	auto cpuHandle = descriptorHeap.GetCPUHandle(tail);
@@ -19,6 +19,12 @@ public:
 	//allocate static descriptors to the beginning of the ring buffer
 	void AllocateStaticDescriptors(UINT numDescriptors, DescriptorHeapWrapper& otherDescHeap);
 
+	//reserves static descriptors that are written later with CopyStaticDescriptors, returns the first one
+	UINT ReserveStaticDescriptors(UINT numDescriptors);
+
+	//overwrites static descriptors from index on with the other heap's descriptors from otherIndex on
+	void CopyStaticDescriptors(UINT index, UINT numDescriptors, DescriptorHeapWrapper& otherDescHeap, UINT otherIndex);
+
 	void AddDescriptor(UINT numDescriptors, DescriptorHeapWrapper& otherDescHeap, UINT frameIndex);
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE GetStaticDescriptorOffset();
@@ -1,7 +1,10 @@
 #include "Game.h"
-#include"LTC.h"
+#include"LTCTable.h"
+#include"LTCTexturePrefilter.h"
 #include "Vertex.h"
 #include"FlockingSystem.h"
+#include"Validation.h"
+#include<numeric>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -37,10 +40,13 @@ Game::Game(HINSTANCE hInstance)
 	cameraBufferBegin = 0;
 	lightCbufferBegin = 0;
 	lightingCbufferBegin = 0;
-	lightBufferBegin = 0;
+	memset(lightUploadBegin, 0, sizeof(lightUploadBegin));
+	memset(lightCullUploadBegin, 0, sizeof(lightCullUploadBegin));
+	memset(clusterRangeBegin, 0, sizeof(clusterRangeBegin));
+	memset(clusterLightIndexBegin, 0, sizeof(clusterLightIndexBegin));
+	memset(clusterLightIndexCapacity, 0, sizeof(clusterLightIndexCapacity));
 	lightCullingExternBegin = 0;
 	previousBuffer = nullptr;
-	lightCount = 0;
 	raster = true;
 	inlineRaytracing = true;
 
@@ -62,7 +68,6 @@ Game::Game(HINSTANCE hInstance)
 	entityNames.resize(10000000);
 
 	fogDensity = 1.f;
-	lights = nullptr;
 
 	enableTAA = false;
 
@@ -80,11 +85,6 @@ Game::~Game()
 		delete[] visibleLightIndices;
 	}
 
-	if (lights != nullptr)
-	{
-		delete[] lights;
-	}
-
 	for (int i = 0; i < flockers.size(); i++)
 	{
 		registry.destroy(flockers[i]->GetEntityID());
@@ -118,6 +118,18 @@ HRESULT Game::Init()
 	else
 		isRaytracingAllowed = true;
 
+	//pipelines stored by the last run are only loaded when this is the driver that compiled them
+	GetPipelineStateCache().SetDriverVersion(GetPipelineDriverVersion(adapter.Get()));
+
+	//-validate on the command line runs the cpu validations and benchmarks before anything loads
+	if (strstr(GetCommandLineA(), "-validate"))
+	{
+#if !defined(DEBUG) && !defined(_DEBUG)
+		CreateConsoleWindow(500, 120, 32, 120);
+#endif
+		RunValidations();
+	}
+
 	frameIndex = this->swapChain->GetCurrentBackBufferIndex();
 
 	HRESULT hr;
@@ -478,11 +490,12 @@ HRESULT Game::Init()
 	renderTargetSRVHeap.CreateDescriptor(fsrOutputTexture, RESOURCE_TYPE_SRV, 0, width, height, 0, 1);
 	renderTargetSRVHeap.CreateDescriptor(fsrOutputTexture, RESOURCE_TYPE_UAV, 0, width, height, 0, 0);
 
-	renderTargetSRVHeap.CreateDescriptor(L"../../Assets/Textures/movemask2.bmp", blueNoiseTex, RESOURCE_TYPE_SRV, TEXTURE_TYPE_DEAULT);
 	renderTargetSRVHeap.CreateDescriptor(L"../../Assets/Textures/movemask2.bmp", retargetTex, RESOURCE_TYPE_SRV, TEXTURE_TYPE_DEAULT);
-	blueNoiseTex.resource->SetName(L"bluenoise");
 	retargetTex.resource->SetName(L"Retarget");
 
+	//the blue noise in movemask2's red channel only goes to the permutation table, built once and kept next to it
+	blueNoisePermutations.LoadOrBuild("../../Assets/Textures/movemask2.permutations", "../../Assets/Textures/movemask2.bmp");
+
 
 	//optimized clear value for depth stencil buffer
 	D3D12_CLEAR_VALUE depthClearValue = {};
@@ -591,10 +604,10 @@ HRESULT Game::Init()
 
 	gpuHeapRingBuffer->AllocateStaticDescriptors(1, skybox->GetDescriptorHeap());
 	skybox->skyboxTextureIndex = gpuHeapRingBuffer->GetNumStaticResources() - 1;
-	skybox->CreateEnvironment(skyboxRootSignature, skyboxRootSignature, irradiencePSO, prefilteredMapPSO, brdfLUTPSO, dsDescriptorHeap.GetCPUHandle(depthStencilBuffer.heapOffset));
+	skybox->CreateEnvironment(skyboxRootSignature, skyboxRootSignature, prefilteredMapPSO, brdfLUTPSO, dsDescriptorHeap.GetCPUHandle(depthStencilBuffer.heapOffset));
 	auto heap = skybox->GetEnvironmentHeap();
-	gpuHeapRingBuffer->AllocateStaticDescriptors(3, heap);
-	skybox->environmentTexturesIndex = gpuHeapRingBuffer->GetNumStaticResources() - 1 - 2;
+	gpuHeapRingBuffer->AllocateStaticDescriptors(2, heap);
+	skybox->environmentTexturesIndex = gpuHeapRingBuffer->GetNumStaticResources() - 2;
 
 	CreateLTCTexture();
 
@@ -603,7 +616,11 @@ HRESULT Game::Init()
 	gpuHeapRingBuffer->AllocateStaticDescriptors(1, flame->GetDescriptorHeap());
 	flame->volumeTextureIndex = gpuHeapRingBuffer->GetNumStaticResources() - 1;
 
-	emitter1 = std::make_shared<Emitter>(10000, //max particles
+	//all the emitters share one particle pool and are drawn with one instanced draw
+	emitterSystem = std::make_shared<EmitterSystem>(100000, particleSystemPSO, particleSystemRootSig);
+	emitterSystem->AllocateDescriptors(gpuHeapRingBuffer);
+
+	emitter1 = emitterSystem->AddEmitter(10000, //max particles
 		100, //particles per second
 		5.f, //lifetime
 		0.8f, //start size
@@ -616,14 +633,31 @@ HRESULT Game::Init()
 		XMFLOAT3(0.1f, 0.1f, 0.1f), //position deviation range
 		XMFLOAT4(-2, 2, -2, 2), //rotation around z axis
 		XMFLOAT3(0.f, 1.f, 0.f),  //acceleration	
-		particlesPSO, particleRootSig, L"../../Assets/Textures/particle.jpg");
+		L"../../Assets/Textures/particle.jpg");
 	emitters.emplace_back(emitter1);
 
-	for (int i = 0; i < emitters.size(); i++)
+	//entities and particles are stepped at fixed rates, rendering interpolates between the last two steps
+	for (size_t i = 0; i < entities.size(); i++)
 	{
-		gpuHeapRingBuffer->AllocateStaticDescriptors(1, emitters[i]->GetDescriptor());
-		emitters[i]->particleTextureIndex = gpuHeapRingBuffer->GetNumStaticResources() - 1;
+		entities[i]->SaveSimulationState();
 	}
+	entity6->SaveSimulationState();
+
+	entitySimulationIndex = simulationClock.AddSystem("entities", 60.0f, [this](float stepTime, double simulationTime)
+		{
+			for (size_t i = 0; i < entities.size(); i++)
+			{
+				entities[i]->SaveSimulationState();
+				entities[i]->Update(stepTime);
+			}
+
+			//FlockingSystem::FlockerSystem(registry, flockers, stepTime);
+		});
+
+	particleSimulationIndex = simulationClock.AddSystem("particles", 30.0f, [this](float stepTime, double simulationTime)
+		{
+			emitterSystem->Update(stepTime, (float)(simulationTime + stepTime));
+		});
 
 	//gpuHeapRingBuffer->AllocateStaticDescriptors(1, depthDesc);
 	//depthTex.heapOffset = gpuHeapRingBuffer->GetNumStaticResources() - 1;
@@ -659,16 +693,34 @@ HRESULT Game::Init()
 
 	if (isRaytracingAllowed)
 	{
-		CreateGbufferRaytracingPipeline();
-		CreateRayTracingPipeline();
+		shaderLibraryCache = std::make_shared<ShaderLibraryCache>("ShaderCache", CompileShaderLibraryDXC);
+		CreateRaytracingPipelineSources();
+
+		std::vector<size_t> pipelines(raytracingPipelineSources.size());
+		std::iota(pipelines.begin(), pipelines.end(), 0);
+		ShaderBuildReport shaderBuild = BuildRaytracingPipelines(pipelines);
+		if (shaderBuild.failedCount > 0)
+			throw std::logic_error(shaderBuild.error);
+
+		const ShaderCacheStats& shaderStats = shaderLibraryCache->GetStats();
+		printf("Shader libraries: %u requests, %u compiled in %.1fms, %u from memory, %u from disk in %.1fms, %.1fms saved\n",
+			shaderStats.requests, shaderStats.compiles, shaderStats.compileTime, shaderStats.memoryHits, shaderStats.diskHits,
+			shaderStats.loadTime, shaderStats.timeSaved);
+
 		CreateRaytracingOutputBuffer();
 		CreateRaytracingDescriptorHeap();
 		CreateShaderBindingTable();
+		WatchShaders();
 	}
 	InitializeGUI();
 
 	SubmitComputeCommandList(computeCommandList, commandList);
 	SubmitGraphicsCommandList(commandList);
+
+	GetRootSignatureCache().PrintReport();
+	GetRootSignatureCache().Save();
+	GetPipelineStateCache().PrintReport();
+	GetPipelineStateCache().Save(device.Get());
 	return S_OK;
 
 }
@@ -725,7 +777,7 @@ void Game::LoadShaders()
 	CD3DX12_ROOT_PARAMETER1 rootParams[EntityRootIndices::EntityNumRootIndices]; // specifies the descriptor table
 	ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
 	ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
-	ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+	ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 1, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
 	ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 3, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
 	ranges[4].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 3);
 	ranges[5].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 4, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
@@ -740,6 +792,10 @@ void Game::LoadShaders()
 	rootParams[EntityRootIndices::EntityEnvironmentSRV].InitAsDescriptorTable(1, &ranges[2], D3D12_SHADER_VISIBILITY_PIXEL);
 	rootParams[EntityRootIndices::EntityLTCSRV].InitAsDescriptorTable(1, &ranges[3], D3D12_SHADER_VISIBILITY_PIXEL);
 	rootParams[EntityRootIndices::AccelerationStructureSRV].InitAsShaderResourceView(0, 4, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParams[EntityRootIndices::EntityIrradianceSHCBV].InitAsConstantBufferView(3, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParams[EntityRootIndices::EntityClusterRangesSRV].InitAsShaderResourceView(2, 2, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParams[EntityRootIndices::EntityClusterLightIndicesSRV].InitAsShaderResourceView(3, 2, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParams[EntityRootIndices::EntityClusterDataConstants].InitAsConstants(sizeof(ClusterShaderData) / sizeof(UINT), 4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 	//rootParams[EntityRootIndices::EntityNoiseTextures].InitAsDescriptorTable(1, &ranges[5], D3D12_SHADER_VISIBILITY_PIXEL);
 
 	CD3DX12_STATIC_SAMPLER_DESC staticSamplers[2];//(0, D3D12_FILTER_ANISOTROPIC);
@@ -758,15 +814,7 @@ void Game::LoadShaders()
 	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
 	rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, _countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-	ComPtr<ID3DBlob> signature;
-	ComPtr<ID3DBlob> error;
-
-	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-		signature.GetAddressOf(), error.GetAddressOf()));
-	//if (FAILED(hr)) return hr;
-
-	ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-		IID_PPV_ARGS(rootSignature.GetAddressOf())));
+	rootSignature = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "rootSignature");
 
 	//if (FAILED(hr)) return hr;
 	ComPtr<ID3DBlob> vertexShaderBlob;
@@ -812,7 +860,7 @@ void Game::LoadShaders()
 		psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 		psoDesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		psoDesc.SampleDesc.Count = 1;
-		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipelineState.GetAddressOf())));
+		pipelineState = GetPipelineStateCache().Get(device.Get(), psoDesc, "pipelineState");
 	}
 
 	{
@@ -838,7 +886,7 @@ void Game::LoadShaders()
 		psoDescPBR.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 		psoDescPBR.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		psoDescPBR.SampleDesc.Count = 1;
-		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDescPBR, IID_PPV_ARGS(pbrPipelineState.GetAddressOf())));
+		pbrPipelineState = GetPipelineStateCache().Get(device.Get(), psoDescPBR, "pbrPipelineState");
 	}
 
 	//creating a pipeline state object
@@ -856,7 +904,7 @@ void Game::LoadShaders()
 	sssDescPBR.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	sssDescPBR.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	sssDescPBR.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&sssDescPBR, IID_PPV_ARGS(sssPipelineState.GetAddressOf())));
+	sssPipelineState = GetPipelineStateCache().Get(device.Get(), sssDescPBR, "sssPipelineState");
 
 	//creating a depth prepass pipeline state
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC depthPrePassPSODesc = {};
@@ -873,7 +921,7 @@ void Game::LoadShaders()
 	depthPrePassPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	depthPrePassPSODesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
 	depthPrePassPSODesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&depthPrePassPSODesc, IID_PPV_ARGS(depthPrePassPipelineState.GetAddressOf())));
+	depthPrePassPipelineState = GetPipelineStateCache().Get(device.Get(), depthPrePassPSODesc, "depthPrePassPipelineState");
 
 
 	CD3DX12_DESCRIPTOR_RANGE1 volumeRanges[1];
@@ -884,17 +932,12 @@ void Game::LoadShaders()
 	volumeRootParams[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_ALL);
 	volumeRootParams[1].InitAsDescriptorTable(1, &volumeRanges[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
-	ComPtr<ID3DBlob> volumeSignature;
-	ComPtr<ID3DBlob> volumeError;
-
 	CD3DX12_STATIC_SAMPLER_DESC staticSamplersVolume[1];//(0, D3D12_FILTER_ANISOTROPIC);
 	staticSamplersVolume[0].Init(0, D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 	rootSignatureDesc.Init_1_1(_countof(volumeRootParams), volumeRootParams, _countof(staticSamplersVolume), staticSamplersVolume, rootSignatureFlags);
 
-	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, volumeSignature.GetAddressOf(), volumeError.GetAddressOf()));
-
-	ThrowIfFailed(device->CreateRootSignature(0, volumeSignature->GetBufferPointer(), volumeSignature->GetBufferSize(), IID_PPV_ARGS(volumeRootSignature.GetAddressOf())));
+	volumeRootSignature = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "volumeRootSignature");
 
 	ComPtr<ID3DBlob> rayMarchedVolumeVS;
 	ComPtr<ID3DBlob> raymarcedVolumePS;
@@ -930,7 +973,7 @@ void Game::LoadShaders()
 	psoDescVolume.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	psoDescVolume.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	psoDescVolume.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDescVolume, IID_PPV_ARGS(volumePSO.GetAddressOf())));
+	volumePSO = GetPipelineStateCache().Get(device.Get(), psoDescVolume, "volumePSO");
 
 	//creating particle root sig and pso
 
@@ -947,20 +990,13 @@ void Game::LoadShaders()
 		particleRootParams[1].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
 		particleRootParams[2].InitAsDescriptorTable(1, &particleDescriptorRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
-		ComPtr<ID3DBlob> particleSignature;
-		ComPtr<ID3DBlob> particleError;
-
 		CD3DX12_STATIC_SAMPLER_DESC staticSamplersParticle[1];//(0, D3D12_FILTER_ANISOTROPIC);
 		staticSamplersParticle[0].Init(0);
 
 		rootSignatureDesc.Init_1_1(_countof(particleRootParams), particleRootParams,
 			_countof(staticSamplersParticle), staticSamplersParticle, rootSignatureFlags);
 
-		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-			particleSignature.GetAddressOf(), particleError.GetAddressOf()));
-
-		ThrowIfFailed(device->CreateRootSignature(0, particleSignature->GetBufferPointer(), particleSignature->GetBufferSize(),
-			IID_PPV_ARGS(particleRootSig.GetAddressOf())));
+		particleRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "particleRootSig");
 
 		ComPtr<ID3DBlob> particleVS;
 		ComPtr<ID3DBlob> particlePS;
@@ -997,7 +1033,40 @@ void Game::LoadShaders()
 		psoDescParticle.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 		psoDescParticle.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		psoDescParticle.SampleDesc.Count = 1;
-		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDescParticle, IID_PPV_ARGS(particlesPSO.GetAddressOf())));
+		particlesPSO = GetPipelineStateCache().Get(device.Get(), psoDescParticle, "particlesPSO");
+
+		//creating the batched particle system root sig and pso
+		CD3DX12_DESCRIPTOR_RANGE1 particleSystemRange[1];
+		CD3DX12_ROOT_PARAMETER1 particleSystemRootParams[ParticleSystemRootIndices::ParticleSystemNumRootIndices];
+
+		//the emitters only touch the textures they use, the rest of the table may be left unset
+		particleSystemRange[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, MAX_PARTICLE_TEXTURES, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+
+		particleSystemRootParams[ParticleSystemRootIndices::ParticleSystemParticlesSRV].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_VERTEX);
+		particleSystemRootParams[ParticleSystemRootIndices::ParticleSystemEmitterDataSRV].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_VERTEX);
+		particleSystemRootParams[ParticleSystemRootIndices::ParticleSystemExternDataCBV].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+		particleSystemRootParams[ParticleSystemRootIndices::ParticleSystemTexturesSRV].InitAsDescriptorTable(1, &particleSystemRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
+
+		CD3DX12_STATIC_SAMPLER_DESC staticSamplersParticleSystem[1];
+		staticSamplersParticleSystem[0].Init(0);
+
+		rootSignatureDesc.Init_1_1(_countof(particleSystemRootParams), particleSystemRootParams,
+			_countof(staticSamplersParticleSystem), staticSamplersParticleSystem, rootSignatureFlags);
+
+		particleSystemRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "particleSystemRootSig");
+
+		ComPtr<ID3DBlob> particleSystemVS;
+		ComPtr<ID3DBlob> particleSystemPS;
+
+		ThrowIfFailed(D3DReadFileToBlob(L"ParticleSystemPS.cso", particleSystemPS.GetAddressOf()));
+		ThrowIfFailed(D3DReadFileToBlob(L"ParticleSystemVS.cso", particleSystemVS.GetAddressOf()));
+
+		//same blending and depth state as the single emitter pipeline
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescParticleSystem = psoDescParticle;
+		psoDescParticleSystem.pRootSignature = particleSystemRootSig.Get();
+		psoDescParticleSystem.VS = CD3DX12_SHADER_BYTECODE(particleSystemVS.Get());
+		psoDescParticleSystem.PS = CD3DX12_SHADER_BYTECODE(particleSystemPS.Get());
+		particleSystemPSO = GetPipelineStateCache().Get(device.Get(), psoDescParticleSystem, "particleSystemPSO");
 	}
 
 	//Interior mapping
@@ -1027,9 +1096,6 @@ void Game::LoadShaders()
 		rootParams[InteriorMappingRootIndices::SDFTextureSRV].InitAsDescriptorTable(1, &ranges[4], D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-		ComPtr<ID3DBlob> interiorSignature;
-		ComPtr<ID3DBlob> interiorError;
-
 		CD3DX12_STATIC_SAMPLER_DESC staticSamplers[2];//(0, D3D12_FILTER_ANISOTROPIC);
 		staticSamplers[0].Init(0);
 		staticSamplers[1].Init(1, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_BORDER, D3D12_TEXTURE_ADDRESS_MODE_BORDER, D3D12_TEXTURE_ADDRESS_MODE_BORDER);
@@ -1037,11 +1103,7 @@ void Game::LoadShaders()
 		rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
 			_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-			interiorSignature.GetAddressOf(), interiorError.GetAddressOf()));
-
-		ThrowIfFailed(device->CreateRootSignature(0, interiorSignature->GetBufferPointer(), interiorSignature->GetBufferSize(),
-			IID_PPV_ARGS(interiorMappingRootSig.GetAddressOf())));
+		interiorMappingRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "interiorMappingRootSig");
 
 		ComPtr<ID3DBlob> interiorMappingVS;
 		ComPtr<ID3DBlob> interiorMappingPS;
@@ -1064,7 +1126,7 @@ void Game::LoadShaders()
 		interiorMappingPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 		interiorMappingPSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		interiorMappingPSODesc.SampleDesc.Count = 1;
-		ThrowIfFailed(device->CreateGraphicsPipelineState(&interiorMappingPSODesc, IID_PPV_ARGS(interiorMappingPSO.GetAddressOf())));
+		interiorMappingPSO = GetPipelineStateCache().Get(device.Get(), interiorMappingPSODesc, "interiorMappingPSO");
 
 	}
 
@@ -1075,7 +1137,7 @@ void Game::LoadShaders()
 		CD3DX12_DESCRIPTOR_RANGE1 computeRootRanges[1];
 		CD3DX12_ROOT_PARAMETER1 lightCullingRootParams[LightCullingNumParameters];
 		computeRootRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
-		lightCullingRootParams[LightCullingRootIndices::LightListSRV].InitAsShaderResourceView(0, 2, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_ALL);
+		lightCullingRootParams[LightCullingRootIndices::LightCullDataSRV].InitAsShaderResourceView(0, 3, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_ALL);
 		lightCullingRootParams[LightCullingRootIndices::DepthMapSRV].InitAsDescriptorTable(1, &computeRootRanges[0]);
 		lightCullingRootParams[LightCullingRootIndices::VisibleLightIndicesUAV].InitAsUnorderedAccessView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE);
 		lightCullingRootParams[LightCullingRootIndices::LightCullingExternalDataCBV].InitAsConstantBufferView(0, 0);
@@ -1084,11 +1146,7 @@ void Game::LoadShaders()
 		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
 		computeRootSignatureDesc.Init_1_1(_countof(lightCullingRootParams), lightCullingRootParams);
 
-		ComPtr<ID3DBlob> computeSignature;
-		ComPtr<ID3DBlob> computeError;
-
-		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-		ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&computeRootSignature)));
+		computeRootSignature = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "computeRootSignature");
 
 		ComPtr<ID3DBlob> lightCullingCS;
 
@@ -1098,7 +1156,7 @@ void Game::LoadShaders()
 		computePSODesc.pRootSignature = computeRootSignature.Get();
 		computePSODesc.CS = CD3DX12_SHADER_BYTECODE(lightCullingCS.Get());
 
-		ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(computePipelineState.GetAddressOf())));
+		computePipelineState = GetPipelineStateCache().Get(device.Get(), computePSODesc, "computePipelineState");
 	}
 
 	//vmf solver set up
@@ -1115,11 +1173,7 @@ void Game::LoadShaders()
 		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
 		computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams);
 
-		ComPtr<ID3DBlob> computeSignature;
-		ComPtr<ID3DBlob> computeError;
-
-		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-		ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&vmfSofverRootSignature)));
+		vmfSofverRootSignature = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "vmfSofverRootSignature");
 
 		ComPtr<ID3DBlob> vmfSolverBlob;
 		ThrowIfFailed(D3DReadFileToBlob(L"VMFSolverCS.cso", vmfSolverBlob.GetAddressOf()));
@@ -1128,7 +1182,7 @@ void Game::LoadShaders()
 		computePSODesc.pRootSignature = vmfSofverRootSignature.Get();
 		computePSODesc.CS = CD3DX12_SHADER_BYTECODE(vmfSolverBlob.Get());
 
-		ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(vmfSolverPSO.GetAddressOf())));
+		vmfSolverPSO = GetPipelineStateCache().Get(device.Get(), computePSODesc, "vmfSolverPSO");
 
 	}
 
@@ -1139,17 +1193,10 @@ void Game::LoadShaders()
 		velocityRootParams[1].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-		ComPtr<ID3DBlob> velocitySignature;
-		ComPtr<ID3DBlob> velocityError;
-
 		rootSignatureDesc.Init_1_1(_countof(velocityRootParams), velocityRootParams,
 			0, nullptr, rootSignatureFlags);
 
-		ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-			velocitySignature.GetAddressOf(), velocityError.GetAddressOf()));
-
-		ThrowIfFailed(device->CreateRootSignature(0, velocitySignature->GetBufferPointer(), velocitySignature->GetBufferSize(),
-			IID_PPV_ARGS(velRootSig.GetAddressOf())));
+		velRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "velRootSig");
 
 		ComPtr<ID3DBlob> velocityWriteVS;
 		ComPtr<ID3DBlob> velocityWritePS;
@@ -1172,7 +1219,7 @@ void Game::LoadShaders()
 		velocityDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 		velocityDesc.RTVFormats[0] = DXGI_FORMAT_R32G32_FLOAT;
 		velocityDesc.SampleDesc.Count = 1;
-		ThrowIfFailed(device->CreateGraphicsPipelineState(&velocityDesc, IID_PPV_ARGS(velPSO.GetAddressOf())));
+		velPSO = GetPipelineStateCache().Get(device.Get(), velocityDesc, "velPSO");
 	}
 
 	//setting up post processing shaders
@@ -1189,20 +1236,13 @@ void Game::LoadShaders()
 			tonemappingRootParams[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
 			tonemappingRootParams[1].InitAsDescriptorTable(1, &toneMappingDescriptorRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
-			ComPtr<ID3DBlob> tonemappingSignature;
-			ComPtr<ID3DBlob> tonemappingError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(tonemappingRootParams), tonemappingRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				tonemappingSignature.GetAddressOf(), tonemappingError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, tonemappingSignature->GetBufferPointer(), tonemappingSignature->GetBufferSize(),
-				IID_PPV_ARGS(toneMappingRootSig.GetAddressOf())));
+			toneMappingRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "toneMappingRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> tonemappingPS;
@@ -1226,7 +1266,7 @@ void Game::LoadShaders()
 			toneMappingPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			toneMappingPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 			toneMappingPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&toneMappingPSODesc, IID_PPV_ARGS(toneMappingPSO.GetAddressOf())));
+			toneMappingPSO = GetPipelineStateCache().Get(device.Get(), toneMappingPSODesc, "toneMappingPSO");
 		}
 
 		//TAA
@@ -1248,9 +1288,6 @@ void Game::LoadShaders()
 			taaRootParams[4].InitAsDescriptorTable(1, &taaDescriptorRange[3], D3D12_SHADER_VISIBILITY_PIXEL);
 			taaRootParams[5].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);
 
-			ComPtr<ID3DBlob> taaSignature;
-			ComPtr<ID3DBlob> taaError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[2];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 			staticSamplers[1].Init(1, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
@@ -1258,11 +1295,7 @@ void Game::LoadShaders()
 			rootSignatureDesc.Init_1_1(_countof(taaRootParams), taaRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				taaSignature.GetAddressOf(), taaError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, taaSignature->GetBufferPointer(), taaSignature->GetBufferSize(),
-				IID_PPV_ARGS(taaRootSig.GetAddressOf())));
+			taaRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "taaRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> taaPS;
@@ -1286,7 +1319,7 @@ void Game::LoadShaders()
 			taaPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			taaPSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 			taaPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&taaPSODesc, IID_PPV_ARGS(taaPSO.GetAddressOf())));
+			taaPSO = GetPipelineStateCache().Get(device.Get(), taaPSODesc, "taaPSO");
 		}
 
 		//Sharpness
@@ -1301,20 +1334,13 @@ void Game::LoadShaders()
 			sharpenRootParams[0].InitAsDescriptorTable(1, &sharpenDescriptorRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-			ComPtr<ID3DBlob> sharpenSignature;
-			ComPtr<ID3DBlob> sharpenError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(sharpenRootParams), sharpenRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				sharpenSignature.GetAddressOf(), sharpenError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, sharpenSignature->GetBufferPointer(), sharpenSignature->GetBufferSize(),
-				IID_PPV_ARGS(sharpenRootSig.GetAddressOf())));
+			sharpenRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "sharpenRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> sharpenPS;
@@ -1338,7 +1364,7 @@ void Game::LoadShaders()
 			sharpenPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			sharpenPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 			sharpenPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&sharpenPSODesc, IID_PPV_ARGS(sharpenPSO.GetAddressOf())));
+			sharpenPSO = GetPipelineStateCache().Get(device.Get(), sharpenPSODesc, "sharpenPSO");
 		}
 
 		//FXAA
@@ -1353,20 +1379,13 @@ void Game::LoadShaders()
 			fxaaRootParams[0].InitAsDescriptorTable(1, &fxaaDescriptorRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-			ComPtr<ID3DBlob> fxaaSignature;
-			ComPtr<ID3DBlob> fxaaError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(fxaaRootParams), fxaaRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				fxaaSignature.GetAddressOf(), fxaaError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, fxaaSignature->GetBufferPointer(), fxaaSignature->GetBufferSize(),
-				IID_PPV_ARGS(fxaaRootSig.GetAddressOf())));
+			fxaaRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "fxaaRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> fxaaPS;
@@ -1390,7 +1409,7 @@ void Game::LoadShaders()
 			fxaaPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			fxaaPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 			fxaaPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&fxaaPSODesc, IID_PPV_ARGS(fxaaPSO.GetAddressOf())));
+			fxaaPSO = GetPipelineStateCache().Get(device.Get(), fxaaPSODesc, "fxaaPSO");
 		}
 
 		//fullscreen pass through
@@ -1405,20 +1424,13 @@ void Game::LoadShaders()
 			passthroughRootParams[0].InitAsDescriptorTable(1, &passthroughDescriptorRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-			ComPtr<ID3DBlob> passthroughSignature;
-			ComPtr<ID3DBlob> passthroughError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(passthroughRootParams), passthroughRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				passthroughSignature.GetAddressOf(), passthroughError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, passthroughSignature->GetBufferPointer(), passthroughSignature->GetBufferSize(),
-				IID_PPV_ARGS(passthroughRootSig.GetAddressOf())));
+			passthroughRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "passthroughRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> passthroughPS;
@@ -1442,7 +1454,7 @@ void Game::LoadShaders()
 			passthroughPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			passthroughPSODesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 			passthroughPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&passthroughPSODesc, IID_PPV_ARGS(passthroughPSO.GetAddressOf())));
+			passthroughPSO = GetPipelineStateCache().Get(device.Get(), passthroughPSODesc, "passthroughPSO");
 		}
 
 		{
@@ -1458,20 +1470,13 @@ void Game::LoadShaders()
 			rootParams[1].InitAsDescriptorTable(1, &descriptorRange[0]);
 			rootParams[2].InitAsDescriptorTable(1, &descriptorRange[1]);
 
-			ComPtr<ID3DBlob> signature;
-			ComPtr<ID3DBlob> error;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				signature.GetAddressOf(), error.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-				IID_PPV_ARGS(fsrRootSig.GetAddressOf())));
+			fsrRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "fsrRootSig");
 
 			ComPtr<ID3DBlob> shaderRCAS;
 			ComPtr<ID3DBlob> shaderEASU;
@@ -1484,14 +1489,14 @@ void Game::LoadShaders()
 			rcasPsoDesc.pRootSignature = fsrRootSig.Get();
 			rcasPsoDesc.CS = CD3DX12_SHADER_BYTECODE(shaderRCAS.Get());
 			
-			ThrowIfFailed(device->CreateComputePipelineState(&rcasPsoDesc, IID_PPV_ARGS(fsrRCASPso.GetAddressOf())));
+			fsrRCASPso = GetPipelineStateCache().Get(device.Get(), rcasPsoDesc, "fsrRCASPso");
 
 			//creating a passthrough pipeline state
 			D3D12_COMPUTE_PIPELINE_STATE_DESC easuPsoDesc = {};
 			easuPsoDesc.pRootSignature = fsrRootSig.Get();
 			easuPsoDesc.CS = CD3DX12_SHADER_BYTECODE(shaderEASU.Get());
 
-			ThrowIfFailed(device->CreateComputePipelineState(&easuPsoDesc, IID_PPV_ARGS(fsrEASUPso.GetAddressOf())));
+			fsrEASUPso = GetPipelineStateCache().Get(device.Get(), easuPsoDesc, "fsrEASUPso");
 		}
 
 		{
@@ -1522,17 +1527,10 @@ void Game::LoadShaders()
 
 
 
-			ComPtr<ID3DBlob> signature;
-			ComPtr<ID3DBlob> error;
-
 			rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
 				0, nullptr, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				signature.GetAddressOf(), error.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-				IID_PPV_ARGS(restirSpatialReuseRootSig.GetAddressOf())));
+			restirSpatialReuseRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "restirSpatialReuseRootSig");
 
 			{
 				ComPtr<ID3DBlob> shader;
@@ -1544,7 +1542,7 @@ void Game::LoadShaders()
 				rcasPsoDesc.pRootSignature = restirSpatialReuseRootSig.Get();
 				rcasPsoDesc.CS = CD3DX12_SHADER_BYTECODE(shader.Get());
 
-				ThrowIfFailed(device->CreateComputePipelineState(&rcasPsoDesc, IID_PPV_ARGS(restirSpatialReusePSO.GetAddressOf())));
+				restirSpatialReusePSO = GetPipelineStateCache().Get(device.Get(), rcasPsoDesc, "restirSpatialReusePSO");
 			}
 
 			{
@@ -1557,7 +1555,7 @@ void Game::LoadShaders()
 				rcasPsoDesc.pRootSignature = restirSpatialReuseRootSig.Get();
 				rcasPsoDesc.CS = CD3DX12_SHADER_BYTECODE(shader.Get());
 
-				ThrowIfFailed(device->CreateComputePipelineState(&rcasPsoDesc, IID_PPV_ARGS(restirGISpatialReusePSO.GetAddressOf())));
+				restirGISpatialReusePSO = GetPipelineStateCache().Get(device.Get(), rcasPsoDesc, "restirGISpatialReusePSO");
 			}
 		}
 
@@ -1579,20 +1577,13 @@ void Game::LoadShaders()
 			rtCombineRootParams[3].InitAsDescriptorTable(1, &rtCombineDescriptorRange[3], D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-			ComPtr<ID3DBlob> rtCombineSignature;
-			ComPtr<ID3DBlob> rtCombineError;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
 
 			rootSignatureDesc.Init_1_1(_countof(rtCombineRootParams), rtCombineRootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				rtCombineSignature.GetAddressOf(), rtCombineError.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, rtCombineSignature->GetBufferPointer(), rtCombineSignature->GetBufferSize(),
-				IID_PPV_ARGS(rtCombineRootSig.GetAddressOf())));
+			rtCombineRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "rtCombineRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> rtCombine;
@@ -1616,7 +1607,7 @@ void Game::LoadShaders()
 			rtCombinePSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			rtCombinePSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 			rtCombinePSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&rtCombinePSODesc, IID_PPV_ARGS(rtCombinePSO.GetAddressOf())));
+			rtCombinePSO = GetPipelineStateCache().Get(device.Get(), rtCombinePSODesc, "rtCombinePSO");
 		}
 
 
@@ -1635,20 +1626,13 @@ void Game::LoadShaders()
 			rootParams[BilateralBlur::BilateralBlurExternalData].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
 
-			ComPtr<ID3DBlob> signature;
-			ComPtr<ID3DBlob> error;
-
 			CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1];//(0, D3D12_FILTER_ANISOTROPIC);
 			staticSamplers[0].Init(0, D3D12_FILTER_MAXIMUM_MIN_MAG_MIP_POINT);
 
 			rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams,
 				_countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-				signature.GetAddressOf(), error.GetAddressOf()));
-
-			ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-				IID_PPV_ARGS(bilateralRootSig.GetAddressOf())));
+			bilateralRootSig = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "bilateralRootSig");
 
 			ComPtr<ID3DBlob> fullcreenVS;
 			ComPtr<ID3DBlob> bilateral;
@@ -1672,22 +1656,21 @@ void Game::LoadShaders()
 			bilateralPSODesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 			bilateralPSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 			bilateralPSODesc.SampleDesc.Count = 1;
-			ThrowIfFailed(device->CreateGraphicsPipelineState(&bilateralPSODesc, IID_PPV_ARGS(bilateralPSO.GetAddressOf())));
+			bilateralPSO = GetPipelineStateCache().Get(device.Get(), bilateralPSODesc, "bilateralPSO");
 		}
 
 		//blue noise permutation pass
 		{
 
-			CD3DX12_DESCRIPTOR_RANGE1 rootRanges[3];
+			CD3DX12_DESCRIPTOR_RANGE1 rootRanges[2];
 			CD3DX12_ROOT_PARAMETER1 rootParams[BlueNoiseDithering::BNDSNumParams];
 
-			rootRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
-			rootRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
-			rootRanges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2);
+			rootRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+			rootRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2);
 
-			rootParams[BlueNoiseDithering::BlueNoiseTex].InitAsDescriptorTable(1, &rootRanges[0]);
-			rootParams[BlueNoiseDithering::PrevFrameNoisy].InitAsDescriptorTable(1, &rootRanges[1]);
-			rootParams[BlueNoiseDithering::RetargetTex].InitAsDescriptorTable(1, &rootRanges[2]);
+			rootParams[BlueNoiseDithering::BlueNoiseOrders].InitAsShaderResourceView(0, 0);
+			rootParams[BlueNoiseDithering::PrevFrameNoisy].InitAsDescriptorTable(1, &rootRanges[0]);
+			rootParams[BlueNoiseDithering::RetargetTex].InitAsDescriptorTable(1, &rootRanges[1]);
 			rootParams[BlueNoiseDithering::NewSequences].InitAsUnorderedAccessView(0, 0);
 			rootParams[BlueNoiseDithering::RetargettedSequencesBNDS].InitAsUnorderedAccessView(1, 0);
 			rootParams[BlueNoiseDithering::FrameNum].InitAsConstantBufferView(0,1);
@@ -1699,11 +1682,7 @@ void Game::LoadShaders()
 			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
 			computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, _countof(staticSamplers), staticSamplers);
 
-			ComPtr<ID3DBlob> computeSignature;
-			ComPtr<ID3DBlob> computeError;
-
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-			ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&bndsComputeRootSignature)));
+			bndsComputeRootSignature = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "bndsComputeRootSignature");
 
 			ComPtr<ID3DBlob> computeShader;
 
@@ -1713,7 +1692,7 @@ void Game::LoadShaders()
 			computePSODesc.pRootSignature = bndsComputeRootSignature.Get();
 			computePSODesc.CS = CD3DX12_SHADER_BYTECODE(computeShader.Get());
 
-			ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(bndsPipelineState.GetAddressOf())));
+			bndsPipelineState = GetPipelineStateCache().Get(device.Get(), computePSODesc, "bndsPipelineState");
 		}
 
 		//blue noise retargeting pass
@@ -1736,11 +1715,7 @@ void Game::LoadShaders()
 			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC computeRootSignatureDesc;
 			computeRootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, _countof(staticSamplers), staticSamplers);
 
-			ComPtr<ID3DBlob> computeSignature;
-			ComPtr<ID3DBlob> computeError;
-
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&computeRootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1, &computeSignature, &computeError));
-			ThrowIfFailed(device->CreateRootSignature(0, computeSignature->GetBufferPointer(), computeSignature->GetBufferSize(), IID_PPV_ARGS(&retargetingRootSignature)));
+			retargetingRootSignature = GetRootSignatureCache().Get(device.Get(), computeRootSignatureDesc, "retargetingRootSignature");
 
 			ComPtr<ID3DBlob> computeShader;
 
@@ -1750,7 +1725,7 @@ void Game::LoadShaders()
 			computePSODesc.pRootSignature = retargetingRootSignature.Get();
 			computePSODesc.CS = CD3DX12_SHADER_BYTECODE(computeShader.Get());
 
-			ThrowIfFailed(device->CreateComputePipelineState(&computePSODesc, IID_PPV_ARGS(retargetingPipelineState.GetAddressOf())));
+			retargetingPipelineState = GetPipelineStateCache().Get(device.Get(), computePSODesc, "retargetingPipelineState");
 		}
 	}
 
@@ -1858,14 +1833,82 @@ void Game::CreateBasicGeometry()
 	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(Light) * MAX_LIGHTS);
 	//creating the light list srv
 	ThrowIfFailed(device->CreateCommittedResource(
-		&GetAppResources().uploadHeapType,
+		&GetAppResources().defaultHeapType,
 		D3D12_HEAP_FLAG_NONE,
 		&bufferDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 		nullptr,
 		IID_PPV_ARGS(lightListResource.GetAddressOf())
 	));
 
+	for (int i = 0; i < frameCount; i++)
+	{
+		ThrowIfFailed(device->CreateCommittedResource(
+			&GetAppResources().uploadHeapType,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(lightUploadResources[i].GetAddressOf())
+		));
+	}
+
+	//positions and ranges on their own, all the light culling reads
+	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(LightCullData) * MAX_LIGHTS);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&GetAppResources().defaultHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		nullptr,
+		IID_PPV_ARGS(lightCullDataResource.GetAddressOf())
+	));
+
+	for (int i = 0; i < frameCount; i++)
+	{
+		ThrowIfFailed(device->CreateCommittedResource(
+			&GetAppResources().uploadHeapType,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(lightCullUploadResources[i].GetAddressOf())
+		));
+	}
+
+	//64 pixel tiles and 24 slices over the camera's depth range
+	ClusterGridDesc clusterDesc = { (UINT)renderWidth, (UINT)renderHeight, 64, 24, 0.1f, 2000.0f, 0.25f * 3.1415926535f };
+	//the scene's hundred or so lights don't pay for starting threads every frame
+	clusteredLightGrid = std::make_unique<ClusteredLightGrid>(clusterDesc, 1);
+
+	//the index lists start with room for a light per cluster
+	UINT clusterCount = clusteredLightGrid->GetClusterCount();
+	for (int i = 0; i < frameCount; i++)
+	{
+		bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(ClusterRange) * clusterCount);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&GetAppResources().uploadHeapType,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(clusterRangeResources[i].GetAddressOf())
+		));
+		clusterRangeResources[i]->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&clusterRangeBegin[i]));
+
+		bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT) * clusterCount);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&GetAppResources().uploadHeapType,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(clusterLightIndexResources[i].GetAddressOf())
+		));
+		clusterLightIndexResources[i]->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&clusterLightIndexBegin[i]));
+		clusterLightIndexCapacity[i] = clusterCount;
+	}
+
 	int workGroupsX = (renderWidth + (renderWidth % TILE_SIZE)) / TILE_SIZE;
 	int workGroupsY = (renderHeight + (renderHeight % TILE_SIZE)) / TILE_SIZE;
 	size_t numberOfTiles = workGroupsX * workGroupsY;
@@ -1898,6 +1941,23 @@ void Game::CreateBasicGeometry()
 
 	sampleSequences.currentState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
 
+	//the sorted blue noise windows, a uint2 for every texel
+	const std::vector<UINT64>& blueNoiseOrders = blueNoisePermutations.GetBlockOrders();
+	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(blueNoiseOrders.size() * sizeof(UINT64));
+	ThrowIfFailed(device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(blueNoiseOrdersResource.GetAddressOf())
+	));
+
+	UINT8* blueNoiseOrdersBegin;
+	ThrowIfFailed(blueNoiseOrdersResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&blueNoiseOrdersBegin)));
+	memcpy(blueNoiseOrdersBegin, blueNoiseOrders.data(), blueNoiseOrders.size() * sizeof(UINT64));
+	blueNoiseOrdersResource->Unmap(0, nullptr);
+
 	ThrowIfFailed(device->CreateCommittedResource(
 		&GetAppResources().defaultHeapType,
 		D3D12_HEAP_FLAG_NONE,
@@ -1933,7 +1993,7 @@ void Game::CreateBasicGeometry()
 
 	intermediateReservoir.currentState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
 
-	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(AlignUp(renderWidth * renderHeight * sizeof(GIReservoir), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(AlignUp(renderWidth * renderHeight * sizeof(PackedGIReservoir), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
 	ThrowIfFailed(device->CreateCommittedResource(
 		&GetAppResources().defaultHeapType,
@@ -1959,9 +2019,7 @@ void Game::CreateBasicGeometry()
 
 	bndsCBResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&bndsDataBegin));
 
-	lights = new Light[MAX_LIGHTS];
-
-	ZeroMemory(lights, MAX_LIGHTS * sizeof(Light));
+	Light light = {};
 
 	//lights[lightCount].type = LIGHT_TYPE_DIR;
 	//lights[lightCount].direction = XMFLOAT3(1, -1, 0);
@@ -1998,42 +2056,42 @@ void Game::CreateBasicGeometry()
 	//lights[lightCount].intensity = 1;
 	//lightCount++;
 
-	lights[lightCount].type = LIGHT_TYPE_POINT;
-	lights[lightCount].color = XMFLOAT3(1, 0, 0);
-	lights[lightCount].range = 50;
-	lights[lightCount].position = XMFLOAT3(30, 30, 0);
-	lights[lightCount].intensity = 3;
-	lightCount++;
-
-	lights[lightCount].type = LIGHT_TYPE_POINT;
-	lights[lightCount].color = XMFLOAT3(0, 1, 0);
-	lights[lightCount].range = 50;
-	lights[lightCount].position = XMFLOAT3(-30, 30, 0);
-	lights[lightCount].intensity = 3;
-	lightCount++;
-
-	lights[lightCount].type = LIGHT_TYPE_POINT;
-	lights[lightCount].color = XMFLOAT3(1, 0, 0);
-	lights[lightCount].range = 50;
-	lights[lightCount].position = XMFLOAT3(0, 30, -30);
-	lights[lightCount].intensity = 3;
-	lightCount++;
+	light.type = LIGHT_TYPE_POINT;
+	light.color = XMFLOAT3(1, 0, 0);
+	light.range = 50;
+	light.position = XMFLOAT3(30, 30, 0);
+	light.intensity = 3;
+	lightManager.AddLight(light);
+
+	light.type = LIGHT_TYPE_POINT;
+	light.color = XMFLOAT3(0, 1, 0);
+	light.range = 50;
+	light.position = XMFLOAT3(-30, 30, 0);
+	light.intensity = 3;
+	lightManager.AddLight(light);
+
+	light.type = LIGHT_TYPE_POINT;
+	light.color = XMFLOAT3(1, 0, 0);
+	light.range = 50;
+	light.position = XMFLOAT3(0, 30, -30);
+	light.intensity = 3;
+	lightManager.AddLight(light);
 	
 	for (int i = 0; i < 100; i++)
 	{
-		lights[lightCount].type = LIGHT_TYPE_POINT;
-		lights[lightCount].color = GetRandomFloat3(0, 1);
-		lights[lightCount].range = 50;
-		lights[lightCount].position = GetRandomFloat3(-50, 50);
-		lights[lightCount].intensity = 1;
-		lightCount++;
+		light.type = LIGHT_TYPE_POINT;
+		light.color = GetRandomFloat3(0, 1);
+		light.range = 50;
+		light.position = GetRandomFloat3(-50, 50);
+		light.intensity = 1;
+		lightManager.AddLight(light);
 	}
 
 	lightConstantBufferResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightCbufferBegin));
 	memcpy(lightCbufferBegin, &lightData, sizeof(lightData));
 
 	lightingData.cameraPosition = mainCamera->GetPosition();
-	lightingData.lightCount = lightCount;
+	lightingData.lightCount = lightManager.GetLightCount();
 	lightingData.cameraForward = mainCamera->GetDirection();
 
 	lightingConstantBufferResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightingCbufferBegin));
@@ -2042,8 +2100,12 @@ void Game::CreateBasicGeometry()
 	lightCullingCBVResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightCullingExternBegin));
 
 
-	lightListResource->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightBufferBegin));
-	memcpy(lightBufferBegin, lights, MAX_LIGHTS * sizeof(Light));
+	for (int i = 0; i < frameCount; i++)
+	{
+		lightUploadResources[i]->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightUploadBegin[i]));
+		lightCullUploadResources[i]->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&lightCullUploadBegin[i]));
+	}
+	CopyDirtyLights();
 
 	bmfrPreProcessCBV->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&bmfrPreprocessBegin));
 
@@ -2255,15 +2317,7 @@ void Game::CreateEnvironment()
 	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
 	rootSignatureDesc.Init_1_1(_countof(rootParams), rootParams, _countof(staticSamplers), staticSamplers, rootSignatureFlags);
 
-	ComPtr<ID3DBlob> signature;
-	ComPtr<ID3DBlob> error;
-
-	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_1,
-		signature.GetAddressOf(), error.GetAddressOf()));
-	//if (FAILED(hr)) return hr;
-
-	ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
-		IID_PPV_ARGS(skyboxRootSignature.GetAddressOf())));
+	skyboxRootSignature = GetRootSignatureCache().Get(device.Get(), rootSignatureDesc, "skyboxRootSignature");
 
 	//if (FAILED(hr)) return hr;
 	ComPtr<ID3DBlob> vertexShaderBlob;
@@ -2303,7 +2357,7 @@ void Game::CreateEnvironment()
 	psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	psoDesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	psoDesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(skyboxPSO.GetAddressOf())));
+	skyboxPSO = GetPipelineStateCache().Get(device.Get(), psoDesc, "skyboxPSO");
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(mainCPUDescriptorHandle, (INT)entities.size() + 1, cbvDescriptorSize);
 	//creating the skybox
@@ -2313,33 +2367,6 @@ void Game::CreateEnvironment()
 
 	//loading the shaders for image based lighting
 
-	//irradiance map calculations
-
-
-	//load shaders
-	ThrowIfFailed(D3DReadFileToBlob(L"FullScreenTriangleVS.cso", vertexShaderBlob.GetAddressOf()));
-	ThrowIfFailed(D3DReadFileToBlob(L"IrradianceMapPS.cso", pixelShaderBlob.GetAddressOf()));
-	//creating a pipeline state object
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC irradiancePsoDesc = {};
-	irradiancePsoDesc.InputLayout = { inputElementDesc,_countof(inputElementDesc) };
-	irradiancePsoDesc.pRootSignature = skyboxRootSignature.Get();
-	irradiancePsoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-	irradiancePsoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
-	//irradiancePsoDescDesc.DepthStencilState.DepthEnable = FALSE; //= CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT); // a default depth stencil state
-	//irradiancePsoDescsc.DepthStencilState.StencilEnable = FALSE;
-	irradiancePsoDesc.DepthStencilState.DepthEnable = FALSE; //= CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT); // a default depth stencil state
-	irradiancePsoDesc.DepthStencilState.StencilEnable = FALSE;
-	//integrationBRDFDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-	irradiancePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT); // a default rasterizer state.
-	irradiancePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT); // a default blent state.
-	irradiancePsoDesc.SampleMask = UINT_MAX;
-	irradiancePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	irradiancePsoDesc.NumRenderTargets = 1;
-	irradiancePsoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-	irradiancePsoDesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	irradiancePsoDesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&irradiancePsoDesc, IID_PPV_ARGS(irradiencePSO.GetAddressOf())));
-
 	//prefilteredmap
 	ThrowIfFailed(D3DReadFileToBlob(L"FullScreenTriangleVS.cso", vertexShaderBlob.GetAddressOf()));
 	ThrowIfFailed(D3DReadFileToBlob(L"PrefilteredMapPS.cso", pixelShaderBlob.GetAddressOf()));
@@ -2363,7 +2390,7 @@ void Game::CreateEnvironment()
 	prefiltermapPSODesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 	prefiltermapPSODesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	prefiltermapPSODesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&prefiltermapPSODesc, IID_PPV_ARGS(prefilteredMapPSO.GetAddressOf())));
+	prefilteredMapPSO = GetPipelineStateCache().Get(device.Get(), prefiltermapPSODesc, "prefilteredMapPSO");
 
 	//BRDF LUT
 
@@ -2386,7 +2413,7 @@ void Game::CreateEnvironment()
 	integrationBRDFDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 	integrationBRDFDesc.RTVFormats[0] = DXGI_FORMAT_R32G32_FLOAT;
 	integrationBRDFDesc.SampleDesc.Count = 1;
-	ThrowIfFailed(device->CreateGraphicsPipelineState(&integrationBRDFDesc, IID_PPV_ARGS(brdfLUTPSO.GetAddressOf())));
+	brdfLUTPSO = GetPipelineStateCache().Get(device.Get(), integrationBRDFDesc, "brdfLUTPSO");
 
 
 
@@ -2394,242 +2421,99 @@ void Game::CreateEnvironment()
 
 void Game::CreateShaderBindingTable()
 {
-	//Direct Lighting
-	{
-		//shader binding tables define the raygen, miss, and hit group shaders
-		//these resources are interpreted by the shader
-		sbtGenerator.Reset();
-
-		//getting the descriptor heap handle
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
-
-		//reinterpreting the above pointer as a void pointer
-		auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
-
-		//the ray generation shader needs external data therefore it needs the pointer to the heap
-		//the miss and hit group shaders don't have any data
-		sbtGenerator.AddRayGenerationProgram(L"RayGen", { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(), (void*)retargetedSequences.resource->GetGPUVirtualAddress(),
-			(void*)currentReservoir.resource->GetGPUVirtualAddress(), (void*)intermediateReservoir.resource->GetGPUVirtualAddress()});
-		sbtGenerator.AddMissProgram(L"Miss", { heapPointer });
-
-		for (size_t i = 0; i < entities.size(); i++)
-		{
-			auto meshes = entities[i]->GetModel()->GetMeshes();
-			for (size_t j = 0; j < meshes.size(); j++)
-			{
-				UINT64 materialIndex = meshes[j]->GetMaterialID();
-				auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
-				sbtGenerator.AddHitGroup(L"HitGroup", { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
-					(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
-				sbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-			}
-		}
+	//shader binding tables define the raygen, miss, and hit group shaders
+	//these resources are interpreted by the shader
 
-		sbtGenerator.AddMissProgram(L"ShadowMiss", {});
-		sbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
+	//getting the descriptor heap handle
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
 
-		//compute the size of the SBT
-		UINT32 sbtSize = sbtGenerator.ComputeSBTSize()*2;
+	//reinterpreting the above pointer as a void pointer
+	auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
 
-		//upload heap for the sbt
-		sbtResource = nv_helpers_dx12::CreateBuffer(device.Get(), AlignUp(sbtSize, 256u), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	//every pipeline has a hit group and a shadow hit group per geometry record, the hit group index of the instances
+	//was taken from the records when the acceleration structures were created
+	std::vector<SBTRayType> rayTypes = { { L"HitGroup", true }, { L"ShadowHitGroup", false } };
+	std::vector<SBTMissProgram> missPrograms = { { L"Miss", { heapPointer } }, { L"ShadowMiss", {} } };
 
-		sbtResource->SetName(L"SBT Resource");
-
-		if (!sbtResource)
-			throw std::logic_error("Could not create SBT resource");
-
-		//compile the sbt from the above info
-		sbtGenerator.Generate(sbtResource.Get(), rtStateObjectProps.Get());
-	}
-
-		//Direct Transparent Lighting
+	//Direct Lighting
 	{
-		//shader binding tables define the raygen, miss, and hit group shaders
-		//these resources are interpreted by the shader
-		transparentSbtGenerator.Reset();
-
-		//getting the descriptor heap handle
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
-
-		//reinterpreting the above pointer as a void pointer
-		auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
-
 		//the ray generation shader needs external data therefore it needs the pointer to the heap
 		//the miss and hit group shaders don't have any data
-		transparentSbtGenerator.AddRayGenerationProgram(L"RayGenTransparency", { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(), (void*)retargetedSequences.resource->GetGPUVirtualAddress(),
-			(void*)currentReservoir.resource->GetGPUVirtualAddress(), (void*)intermediateReservoir.resource->GetGPUVirtualAddress()});
-		transparentSbtGenerator.AddMissProgram(L"Miss", { heapPointer });
-
-		for (size_t i = 0; i < entities.size(); i++)
-		{
-			auto meshes = entities[i]->GetModel()->GetMeshes();
-			for (size_t j = 0; j < meshes.size(); j++)
-			{
-				UINT64 materialIndex = meshes[j]->GetMaterialID();
-				auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
-				transparentSbtGenerator.AddHitGroup(L"HitGroup", { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
-					(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
-				transparentSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-			}
-		}
-
-		transparentSbtGenerator.AddMissProgram(L"ShadowMiss", {});
-		transparentSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-
-		//compute the size of the SBT
-		UINT32 sbtSize = transparentSbtGenerator.ComputeSBTSize()*2;
-
-		//upload heap for the sbt
-		transparentSbtResource = nv_helpers_dx12::CreateBuffer(device.Get(), AlignUp(sbtSize, 256u), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-
-		transparentSbtResource->SetName(L"SBT Resource");
-
-		if (!transparentSbtResource)
-			throw std::logic_error("Could not create SBT resource");
+		SBTPipelineDesc desc = {};
+		desc.rayGen = L"RayGen";
+		desc.rayGenArguments = { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(), (void*)retargetedSequences.resource->GetGPUVirtualAddress(),
+			(void*)currentReservoir.resource->GetGPUVirtualAddress(), (void*)intermediateReservoir.resource->GetGPUVirtualAddress() };
+		desc.missPrograms = missPrograms;
+		desc.rayTypes = rayTypes;
+		desc.trailingHitGroups = { L"ShadowHitGroup" };
+		directSbtPipeline = sbtManager->AddPipeline("Direct Lighting", desc, rtStateObjectProps);
+	}
 
-		//compile the sbt from the above info
-		transparentSbtGenerator.Generate(transparentSbtResource.Get(), rtTransparentStateObjectProps.Get());
+	//Direct Transparent Lighting
+	{
+		SBTPipelineDesc desc = {};
+		desc.rayGen = L"RayGenTransparency";
+		desc.rayGenArguments = { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(), (void*)retargetedSequences.resource->GetGPUVirtualAddress(),
+			(void*)currentReservoir.resource->GetGPUVirtualAddress(), (void*)intermediateReservoir.resource->GetGPUVirtualAddress() };
+		desc.missPrograms = missPrograms;
+		desc.rayTypes = rayTypes;
+		desc.trailingHitGroups = { L"ShadowHitGroup" };
+		transparentSbtPipeline = sbtManager->AddPipeline("Direct Transparent Lighting", desc, rtTransparentStateObjectProps);
 	}
 
 	//Indirect Diffuse
 	{
-		//shader binding tables define the raygen, miss, and hit group shaders
-		//these resources are interpreted by the shader
-		indirectDiffuseSbtGenerator.Reset();
-
-		//getting the descriptor heap handle
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
-
-		//reinterpreting the above pointer as a void pointer
-		auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
-
-		//the ray generation shader needs external data therefore it needs the pointer to the heap
-		//the miss and hit group shaders don't have any data
-		indirectDiffuseSbtGenerator.AddRayGenerationProgram(L"IndirectDiffuseRayGen", { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
-			, (void*)retargetedSequences.resource->GetGPUVirtualAddress(), (void*)indirectDiffuseTemporalReservoir.resource->GetGPUVirtualAddress(), (void*)indirectDiffuseSpatialReservoir.resource->GetGPUVirtualAddress() });
-		indirectDiffuseSbtGenerator.AddMissProgram(L"Miss", { heapPointer });
-
-		for (size_t i = 0; i < entities.size(); i++)
-		{
-			auto meshes = entities[i]->GetModel()->GetMeshes();
-			for (size_t j = 0; j < meshes.size(); j++)
-			{
-				UINT64 materialIndex = meshes[j]->GetMaterialID();
-				auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
-				indirectDiffuseSbtGenerator.AddHitGroup(L"HitGroup", { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
-					(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
-				indirectDiffuseSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-			}
-		}
-
-		indirectDiffuseSbtGenerator.AddMissProgram(L"ShadowMiss", {});
-		indirectDiffuseSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-
-		//compute the size of the SBT
-		UINT32 sbtSize = indirectDiffuseSbtGenerator.ComputeSBTSize();
-
-		//upload heap for the sbt
-		indirectDiffuseSbtResource = nv_helpers_dx12::CreateBuffer(device.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-
-		if (!indirectDiffuseSbtResource)
-			throw std::logic_error("Could not create SBT resource");
-
-		//compile the sbt from the above info
-		indirectDiffuseSbtGenerator.Generate(indirectDiffuseSbtResource.Get(), indirectDiffuseRtStateObjectProps.Get());
+		SBTPipelineDesc desc = {};
+		desc.rayGen = L"IndirectDiffuseRayGen";
+		desc.rayGenArguments = { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
+			, (void*)retargetedSequences.resource->GetGPUVirtualAddress(), (void*)indirectDiffuseTemporalReservoir.resource->GetGPUVirtualAddress(), (void*)indirectDiffuseSpatialReservoir.resource->GetGPUVirtualAddress() };
+		desc.missPrograms = missPrograms;
+		desc.rayTypes = rayTypes;
+		desc.trailingHitGroups = { L"ShadowHitGroup" };
+		indirectDiffuseSbtPipeline = sbtManager->AddPipeline("Indirect Diffuse", desc, indirectDiffuseRtStateObjectProps);
 	}
 
 	//Indirect Specular
 	{
-		//shader binding tables define the raygen, miss, and hit group shaders
-		//these resources are interpreted by the shader
-		indirectSpecularSbtGenerator.Reset();
-
-		//getting the descriptor heap handle
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
-
-		//reinterpreting the above pointer as a void pointer
-		auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
-
-		//the ray generation shader needs external data therefore it needs the pointer to the heap
-		//the miss and hit group shaders don't have any data
-		indirectSpecularSbtGenerator.AddRayGenerationProgram(L"IndirectSpecularRayGen", { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
-			, (void*)retargetedSequences.resource->GetGPUVirtualAddress() });
-		indirectSpecularSbtGenerator.AddMissProgram(L"Miss", { heapPointer });
-
-		for (size_t i = 0; i < entities.size(); i++)
-		{
-			auto meshes = entities[i]->GetModel()->GetMeshes();
-			for (size_t j = 0; j < meshes.size(); j++)
-			{
-				UINT64 materialIndex = meshes[j]->GetMaterialID();
-				auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
-				indirectSpecularSbtGenerator.AddHitGroup(L"HitGroup", { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
-					(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
-				indirectSpecularSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-			}
-		}
-
-		indirectSpecularSbtGenerator.AddMissProgram(L"ShadowMiss", {});
-		indirectSpecularSbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-
-		//compute the size of the SBT
-		UINT32 sbtSize = indirectSpecularSbtGenerator.ComputeSBTSize();
-
-		//upload heap for the sbt
-		indirectSpecularSbtResource = nv_helpers_dx12::CreateBuffer(device.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-
-		if (!indirectSpecularSbtResource)
-			throw std::logic_error("Could not create SBT resource");
-
-		//compile the sbt from the above info
-		indirectSpecularSbtGenerator.Generate(indirectSpecularSbtResource.Get(), indirectSpecularRtStateObjectProps.Get());
+		SBTPipelineDesc desc = {};
+		desc.rayGen = L"IndirectSpecularRayGen";
+		desc.rayGenArguments = { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
+			, (void*)retargetedSequences.resource->GetGPUVirtualAddress() };
+		desc.missPrograms = missPrograms;
+		desc.rayTypes = rayTypes;
+		desc.trailingHitGroups = { L"ShadowHitGroup" };
+		indirectSpecularSbtPipeline = sbtManager->AddPipeline("Indirect Specular", desc, indirectSpecularRtStateObjectProps);
 	}
 
-
 	//creating the sbt for the gbuffer
 	{
-		//shader binding tables define the raygen, miss, and hit group shaders
-		//these resources are interpreted by the shader
-		GBsbtGenerator.Reset();
-
-		//getting the descriptor heap handle
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = rtDescriptorHeap.GetHeap()->GetGPUDescriptorHandleForHeapStart();
-
-		//reinterpreting the above pointer as a void pointer
-		auto heapPointer = reinterpret_cast<UINT64*>(gpuHandle.ptr);
+		SBTPipelineDesc desc = {};
+		desc.rayGen = L"GBufferRayGen";
+		desc.rayGenArguments = { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
+			, (void*)retargetedSequences.resource->GetGPUVirtualAddress() };
+		desc.missPrograms = { { L"GBufferMiss", { heapPointer } } };
+		desc.rayTypes = { { L"GBufferHitGroup", true }, { L"ShadowHitGroup", false } };
+		GBsbtPipeline = sbtManager->AddPipeline("GBuffer", desc, GBrtStateObjectProps);
+	}
 
-		//the ray generation shader needs external data therefore it needs the pointer to the heap
-		//the miss and hit group shaders don't have any data
-		GBsbtGenerator.AddRayGenerationProgram(L"GBufferRayGen", { heapPointer,(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress()
-			, (void*)retargetedSequences.resource->GetGPUVirtualAddress() });
-		GBsbtGenerator.AddMissProgram(L"GBufferMiss", { heapPointer });
-		for (size_t i = 0; i < entities.size(); i++)
+	//the hit group arguments are the same in every pipeline, records shared by several meshes are set more than once
+	//to the same values which doesn't dirty them again
+	UINT recordIndex = 0;
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		auto meshes = entities[i]->GetModel()->GetMeshes();
+		for (size_t j = 0; j < meshes.size(); j++)
 		{
-			auto meshes = entities[i]->GetModel()->GetMeshes();
-			for (size_t j = 0; j < meshes.size(); j++)
-			{
-				UINT64 materialIndex = meshes[j]->GetMaterialID();
-				auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
-				GBsbtGenerator.AddHitGroup(L"GBufferHitGroup", { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
-					(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
-				GBsbtGenerator.AddHitGroup(L"ShadowHitGroup", {});
-			}
+			UINT64 materialIndex = meshes[j]->GetMaterialID();
+			auto matIndexPtr = reinterpret_cast<UINT*>(materialIndex);
+			sbtManager->SetGeometryArguments(sbtRecordHandles[recordIndex++], { (void*)meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(),
+				(void*)lightingConstantBufferResource->GetGPUVirtualAddress(), (void*)lightListResource->GetGPUVirtualAddress(),heapPointer, matIndexPtr });
 		}
-
-
-		//compute the size of the GBsbt
-		UINT32 GBsbtSize = GBsbtGenerator.ComputeSBTSize();
-
-		//upload heap for the GBsbt
-		GBsbtResource = nv_helpers_dx12::CreateBuffer(device.Get(), GBsbtSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-
-		if (!GBsbtResource)
-			throw std::logic_error("Could not create GBsbt resource");
-
-		//compile the GBsbt from the above info
-		GBsbtGenerator.Generate(GBsbtResource.Get(), GBrtStateObjectProps.Get());
 	}
+
+	//compile the sbt from the above info
+	auto sbtStats = sbtManager->Update();
+	printf("SBT: %u records, %u shared sections, %llu bytes\n", sbtManager->GetRecordCount(), sbtStats.sharedSections, sbtStats.tableSize);
 }
 
 
@@ -2719,80 +2603,56 @@ void Game::ExecuteAndResetGraphicsCommandList(ComPtr<ID3D12GraphicsCommandList>
 	ThrowIfFailed(computeCommandList->Reset(aCommandAllocator[frameIndex].Get(), aPipelineState.Get()));
 }
 
-AccelerationStructureBuffers Game::CreateBottomLevelAS(std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vertexBuffers)
-{
-	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS; //bottom level as generator
-
-	for (const auto& buffer : vertexBuffers)
-	{
-		bottomLevelAS.AddVertexBuffer(buffer.first.Get(), 0, buffer.second, sizeof(Vertex), 0, 0);
-	}
-
-	//allocating scratch space to store temporary information
-	UINT64 scratchInBytes = 0;
-	UINT64 resultSizeInBytes = 0;
-
-	bottomLevelAS.ComputeASBufferSizes(device.Get(), false, &scratchInBytes, &resultSizeInBytes);
-
-	//onmce the size is obtained ,then we need to create the necessary buffers
-	AccelerationStructureBuffers buffers;
-	buffers.pScratch = nv_helpers_dx12::CreateBuffer(device.Get(), scratchInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
-	buffers.pResult = nv_helpers_dx12::CreateBuffer(device.Get(), resultSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nv_helpers_dx12::kDefaultHeapProps);
-
-	//build the acceleration structure
-	bottomLevelAS.Generate(commandList.Get(), buffers.pScratch.Get(), buffers.pResult.Get(), false, nullptr);
-
-	return buffers;
-}
-
 void Game::CreateTopLevelAS(const std::vector<EntityInstance>& instances, bool updateOnly)
 {
 
 	if (!updateOnly)
 	{
-		topLevelAsGenerator = nv_helpers_dx12::TopLevelASGenerator();
+		topLevelAS = std::make_shared<DynamicTLAS>(device, static_cast<UINT>(instances.size()));
+		tlasInstanceHandles.clear();
 		for (int i = 0; i < instances.size(); i++)
 		{
-			topLevelAsGenerator.AddInstance(instances[i].bottomLevelBuffer.Get(), instances[i].modelMatrix, static_cast<UINT>(i), static_cast<UINT>(i * 2), D3D12_RAYTRACING_INSTANCE_FLAG_NONE, instances[i].instanceMask);
+			tlasInstanceHandles.emplace_back(topLevelAS->GetInstances().AddInstance(instances[i].bottomLevelBuffer.Get(), instances[i].modelMatrix,
+				static_cast<UINT>(i), sbtManager->GetHitGroupIndex(sbtRecordHandles[i]), instances[i].instanceMask));
 		}
+	}
 
-		UINT64 scratchSize, resultSize, instanceDescsSize;
-
-		//allocating scratch space, result space, and instance space
-		topLevelAsGenerator.ComputeASBufferSizes(device.Get(), true, &scratchSize, &resultSize, &instanceDescsSize);
+	else
+	{
+		//only the instances that moved are written to the instance buffer
+		for (int i = 0; i < instances.size(); i++)
+		{
+			topLevelAS->GetInstances().SetTransform(tlasInstanceHandles[i], instances[i].modelMatrix);
+		}
+	}
 
-		topLevelAsBuffers.pScratch = nv_helpers_dx12::CreateBuffer(device.Get(),
-			scratchSize,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-			nv_helpers_dx12::kDefaultHeapProps);
+	tlasWorldBounds.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		tlasWorldBounds[i] = TLASRebuildPolicy::TransformBounds(tlasLocalBounds[i], instances[i].modelMatrix);
+	}
 
-		topLevelAsBuffers.pResult = nv_helpers_dx12::CreateBuffer(device.Get(), resultSize,
-			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-			nv_helpers_dx12::kDefaultHeapProps);
+	// the buffers are only recreated when the instance table outgrows them. Updates refit the existing AS in place
+	// until the policy estimates the refitted tree has degraded enough to be worth a rebuild
+	TLASRebuildDecision rebuildDecision = tlasRebuildPolicy.Evaluate(tlasWorldBounds, !updateOnly);
+	topLevelAS->Build(commandList.Get(), !rebuildDecision.rebuild);
 
-		// The buffer describing the instances: ID, shader binding information,
-		// matrices ... Those will be copied into the buffer by the helper through
-		// mapping, so the buffer has to be allocated on the upload heap.
-		topLevelAsBuffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(
-			device.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-	}
+	if (!topLevelAS->WasRefit())
+		tlasRebuildPolicy.OnBuild(tlasWorldBounds);
 
-	// After all the buffers are allocated, or if only an update is required, we
-	// can build the acceleration structure. Note that in the case of the update
-	// we also pass the existing AS as the 'previous' AS, so that it can be
-	// refitted in place.
-	topLevelAsGenerator.Generate(commandList.Get(),
-		topLevelAsBuffers.pScratch.Get(),
-		topLevelAsBuffers.pResult.Get(),
-		topLevelAsBuffers.pInstanceDesc.Get(),
-		updateOnly, topLevelAsBuffers.pResult.Get());
+	topLevelAsBuffers.pScratch = topLevelAS->GetBuffers().pScratch;
+	topLevelAsBuffers.pResult = topLevelAS->GetBuffers().pResult;
+	topLevelAsBuffers.pInstanceDesc = topLevelAS->GetBuffers().pInstanceDesc;
 
 }
 
 void Game::CreateAccelerationStructures()
 {
-	std::vector<AccelerationStructureBuffers> bottomLevelBuffers;
+	//entities that share geometry share one bottom level structure, every mesh still gets its own instance
+	blasCache = std::make_shared<BLASCache>(std::make_shared<D3D12BLASBuildBackend>(device, commandList));
+
+	//the hit group records are filled in with the shader binding table, but their slots are needed for the instances
+	sbtManager = std::make_shared<ShaderBindingTableManager>(device);
 
 	for (int i = 0; i < entities.size(); i++)
 	{
@@ -2800,16 +2660,34 @@ void Game::CreateAccelerationStructures()
 
 		for (size_t j = 0; j < meshes.size(); j++)
 		{
-			AccelerationStructureBuffers blasBuffer = CreateBottomLevelAS({ meshes[j]->GetVertexBufferResourceAndCount() });
-			bottomLevelBuffers.emplace_back(blasBuffer);
+			blasHandles.emplace_back(blasCache->Acquire(meshes[j]));
+			sbtRecordHandles.emplace_back(sbtManager->AcquireGeometryRecord({ meshes[j]->GetVertexBufferResource()->GetGPUVirtualAddress(), meshes[j]->GetMaterialID() }));
+
+			auto& vertices = meshes[j]->GetVerts();
+			tlasLocalBounds.emplace_back(TLASRebuildPolicy::ComputeBounds(vertices.empty() ? nullptr : &vertices[0].Position,
+				vertices.size(), sizeof(Vertex)));
 		}
 
 	}
 
-	for (UINT i = 0; i < bottomLevelBuffers.size(); i++)
+	blasCache->BuildPending();
+
+	//the compacted sizes are only known once the builds have run
+	commandList->Close();
+	ID3D12CommandList* buildCommandLists[] = { commandList.Get() };
+	commandQueue->ExecuteCommandLists(_countof(buildCommandLists), buildCommandLists);
+
+	WaitForPreviousFrame();
+
+	ThrowIfFailed(
+		commandList->Reset(commandAllocators[frameIndex].Get(), pipelineState.Get()));
+
+	blasCache->CompactPending();
+
+	for (UINT i = 0; i < blasHandles.size(); i++)
 	{
 		RaytracingInstanceMask mask = i == 1 || i == 2 ? RAYTRACING_INSTANCE_TRANSCLUCENT : RAYTRACING_INSTANCE_OPAQUE;
-		EntityInstance instance = { i ,bottomLevelBuffers[i].pResult, entities[i]->GetRawModelMatrix(), mask };
+		EntityInstance instance = { i ,blasCache->GetResult(blasHandles[i]), entities[i]->GetRawModelMatrix(), mask };
 		bottomLevelBufferInstances.emplace_back(instance);
 	}
 
@@ -2824,6 +2702,13 @@ void Game::CreateAccelerationStructures()
 	ThrowIfFailed(
 		commandList->Reset(commandAllocators[frameIndex].Get(), pipelineState.Get()));
 
+	//the copies into the compacted structures are done
+	blasCache->ReleaseRetired();
+
+	auto& blasStats = blasCache->GetStats();
+	printf("BLAS: %u structures, %u compacted, %.2f MB saved, %.2f MB resident\n", blasStats.entryCount, blasStats.compactedCount,
+		blasStats.compactionSavings / (1024.0 * 1024.0), blasStats.resultMemory / (1024.0 * 1024.0));
+
 }
 
 ComPtr<ID3D12RootSignature> Game::CreateRayGenRootSignature()
@@ -3033,6 +2918,156 @@ void Game::CreateRaytracingDescriptorHeap()
 
 }
 
+ComPtr<IDxcBlob> Game::LoadShaderLibrary(LPCWSTR fileName)
+{
+	//a second Get for a library the graph just compiled would count as a memory hit and as time saved
+	{
+		std::lock_guard<std::mutex> lock(builtLibrariesMutex);
+		auto built = builtLibraries.find(fileName);
+		if (built != builtLibraries.end())
+			return CreateShaderLibraryBlob(*built->second);
+	}
+
+	ShaderLibraryDesc desc = {};
+	desc.fileName = fileName;
+	return CreateShaderLibraryBlob(*shaderLibraryCache->Get(desc));
+}
+
+void Game::CreateRaytracingPipelineSources()
+{
+	raytracingPipelineSources = {
+		{ "GBuffer pipeline", &Game::CreateGbufferRaytracingPipeline,
+			{ L"../../GBufferRayGen.hlsl", L"../../GBufferMiss.hlsl", L"../../GbufferHit.hlsl", L"../../ShadowRay.hlsl" } },
+		{ "Direct lighting pipeline", &Game::CreateRayTracingDirectLightingPipeline,
+			{ L"../../RayGen.hlsl", L"../../Miss.hlsl", L"../../Hit.hlsl", L"../../ShadowRay.hlsl" } },
+		{ "Transparency pipeline", &Game::CreateRaytracingTransparencyPipeline,
+			{ L"../../RayGenTransparency.hlsl", L"../../Miss.hlsl", L"../../Hit.hlsl", L"../../ShadowRay.hlsl" } },
+		{ "Indirect diffuse pipeline", &Game::CreateRayTracingIndirectDiffusePipeline,
+			{ L"../../RayGenIndirectDiffuse.hlsl", L"../../Miss.hlsl", L"../../Hit.hlsl", L"../../ShadowRay.hlsl" } },
+		{ "Indirect specular pipeline", &Game::CreateRayTracingIndirectSpecularPipeline,
+			{ L"../../RayGenIndirectSpecular.hlsl", L"../../Miss.hlsl", L"../../Hit.hlsl", L"../../ShadowRay.hlsl" } } };
+}
+
+ShaderBuildReport Game::BuildRaytracingPipelines(const std::vector<size_t>& pipelines)
+{
+	//libraries compile on the workers, the pipelines write shared root signatures so they stay on this thread in the
+	//order they were created in before, each waiting for its own libraries only
+	ShaderBuildGraph graph;
+	std::unordered_map<std::wstring, UINT> libraryNodes;
+	for (size_t i = 0; i < pipelines.size(); i++)
+	{
+		const RaytracingPipelineSource& source = raytracingPipelineSources[pipelines[i]];
+
+		std::vector<UINT> inputs;
+		for (size_t j = 0; j < source.libraries.size(); j++)
+		{
+			auto found = libraryNodes.find(source.libraries[j]);
+			if (found == libraryNodes.end())
+			{
+				std::filesystem::path fileName = source.libraries[j];
+				UINT node = graph.AddNode(fileName.filename().string(), SHADER_BUILD_SHADER, [this, fileName]()
+				{
+					ShaderLibraryDesc desc = {};
+					desc.fileName = fileName;
+					auto bytecode = shaderLibraryCache->Get(desc);
+
+					std::lock_guard<std::mutex> lock(builtLibrariesMutex);
+					builtLibraries[fileName.wstring()] = bytecode;
+				});
+				found = libraryNodes.insert({ source.libraries[j], node }).first;
+			}
+			inputs.push_back(found->second);
+		}
+
+		auto create = source.create;
+		graph.AddNode(source.name, SHADER_BUILD_PIPELINE, [this, create]() { (this->*create)(); }, inputs, true);
+	}
+
+	ShaderBuildReport report = graph.Run();
+	builtLibraries.clear();
+	report.Print();
+	return report;
+}
+
+void Game::WatchShaders()
+{
+	shaderWatcher = std::make_shared<ShaderWatcher>();
+	if (!shaderWatcher->WatchDirectory(L"../../"))
+	{
+		printf("Shader hot reload disabled, can't watch the shader directory\n");
+		shaderWatcher = nullptr;
+		return;
+	}
+
+	for (size_t i = 0; i < raytracingPipelineSources.size(); i++)
+		for (size_t j = 0; j < raytracingPipelineSources[i].libraries.size(); j++)
+			shaderWatcher->SetDependencies(raytracingPipelineSources[i].libraries[j],
+				shaderLibraryCache->HashSource(raytracingPipelineSources[i].libraries[j]).files);
+}
+
+void Game::ReloadChangedShaders()
+{
+	if (!shaderWatcher)
+		return;
+
+	std::vector<std::filesystem::path> libraries = shaderWatcher->Poll();
+	if (libraries.empty())
+		return;
+
+	//Draw only waits for the frame that last used the next back buffer, so up to two frames can still be using the
+	//state objects being released and the shader tables being rewritten. Reloads are rare, so flush the whole queue
+	WaitForPreviousFrame();
+
+	std::set<std::wstring> changed;
+	for (size_t i = 0; i < libraries.size(); i++)
+	{
+		shaderLibraryCache->Invalidate(libraries[i]);
+		changed.insert(ShaderWatcher::GetFileKey(libraries[i]));
+	}
+
+	std::vector<size_t> pipelines;
+	for (size_t i = 0; i < raytracingPipelineSources.size(); i++)
+	{
+		const std::vector<LPCWSTR>& sources = raytracingPipelineSources[i].libraries;
+		for (size_t j = 0; j < sources.size(); j++)
+		{
+			if (changed.count(ShaderWatcher::GetFileKey(sources[j])))
+			{
+				pipelines.push_back(i);
+				break;
+			}
+		}
+	}
+
+	//a pipeline whose libraries failed to compile is skipped and keeps its old state object
+	ShaderBuildReport report = BuildRaytracingPipelines(pipelines);
+
+	//includes can have been added or removed
+	for (size_t i = 0; i < libraries.size(); i++)
+	{
+		try
+		{
+			shaderWatcher->SetDependencies(libraries[i], shaderLibraryCache->HashSource(libraries[i]).files);
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	sbtManager->SetPipelineProperties(GBsbtPipeline, GBrtStateObjectProps);
+	sbtManager->SetPipelineProperties(directSbtPipeline, rtStateObjectProps);
+	sbtManager->SetPipelineProperties(transparentSbtPipeline, rtTransparentStateObjectProps);
+	sbtManager->SetPipelineProperties(indirectDiffuseSbtPipeline, indirectDiffuseRtStateObjectProps);
+	sbtManager->SetPipelineProperties(indirectSpecularSbtPipeline, indirectSpecularRtStateObjectProps);
+	sbtManager->Update();
+
+	UINT rebuilt = 0;
+	for (size_t i = 0; i < report.nodes.size(); i++)
+		if (report.nodes[i].type == SHADER_BUILD_PIPELINE && !report.nodes[i].failed && !report.nodes[i].skipped)
+			rebuilt++;
+	printf("Reloaded %zu shader libraries, %u of %zu pipelines rebuilt\n", libraries.size(), rebuilt, pipelines.size());
+}
+
 void Game::CreateRayTracingPipeline()
 {
 	CreateRayTracingDirectLightingPipeline();
@@ -3046,9 +3081,9 @@ void Game::CreateRayTracingDirectLightingPipeline()
 	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
 
 	//the raytracing pipeline contains all the shader code
-	rayGenLib = nv_helpers_dx12::CompileShaderLibrary(L"../../RayGen.hlsl");
-	missLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Miss.hlsl");
-	hitLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Hit.hlsl");
+	rayGenLib = LoadShaderLibrary(L"../../RayGen.hlsl");
+	missLib = LoadShaderLibrary(L"../../Miss.hlsl");
+	hitLib = LoadShaderLibrary(L"../../Hit.hlsl");
 
 
 	//add the libraies to pipeliene
@@ -3061,7 +3096,7 @@ void Game::CreateRayTracingDirectLightingPipeline()
 	missRootSig = CreateMissRootSignature();
 	closestHitRootSignature = CreateClosestHitRootSignature();
 
-	shadowRayLib = nv_helpers_dx12::CompileShaderLibrary(L"../../ShadowRay.hlsl");
+	shadowRayLib = LoadShaderLibrary(L"../../ShadowRay.hlsl");
 	pipeline.AddLibrary(shadowRayLib.Get(), { L"ShadowClosestHit",L"ShadowMiss" });
 	shadowRootSig = CreateClosestHitRootSignature();
 
@@ -3099,9 +3134,9 @@ void Game::CreateRaytracingTransparencyPipeline()
 	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
 
 	//the raytracing pipeline contains all the shader code
-	transparencyRayGenLib = nv_helpers_dx12::CompileShaderLibrary(L"../../RayGenTransparency.hlsl");
-	missLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Miss.hlsl");
-	hitLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Hit.hlsl");
+	transparencyRayGenLib = LoadShaderLibrary(L"../../RayGenTransparency.hlsl");
+	missLib = LoadShaderLibrary(L"../../Miss.hlsl");
+	hitLib = LoadShaderLibrary(L"../../Hit.hlsl");
 
 
 	//add the libraies to pipeliene
@@ -3114,7 +3149,7 @@ void Game::CreateRaytracingTransparencyPipeline()
 	missRootSig = CreateMissRootSignature();
 	closestHitRootSignature = CreateClosestHitRootSignature();
 
-	shadowRayLib = nv_helpers_dx12::CompileShaderLibrary(L"../../ShadowRay.hlsl");
+	shadowRayLib = LoadShaderLibrary(L"../../ShadowRay.hlsl");
 	pipeline.AddLibrary(shadowRayLib.Get(), { L"ShadowClosestHit",L"ShadowMiss" });
 	shadowRootSig = CreateClosestHitRootSignature();
 
@@ -3152,9 +3187,9 @@ void Game::CreateRayTracingIndirectDiffusePipeline()
 	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
 
 	//the raytracing pipeline contains all the shader code
-	indirectDiffuseRayGenLib = nv_helpers_dx12::CompileShaderLibrary(L"../../RayGenIndirectDiffuse.hlsl");
-	missLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Miss.hlsl");
-	hitLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Hit.hlsl");
+	indirectDiffuseRayGenLib = LoadShaderLibrary(L"../../RayGenIndirectDiffuse.hlsl");
+	missLib = LoadShaderLibrary(L"../../Miss.hlsl");
+	hitLib = LoadShaderLibrary(L"../../Hit.hlsl");
 
 
 	//add the libraies to pipeliene
@@ -3167,7 +3202,7 @@ void Game::CreateRayTracingIndirectDiffusePipeline()
 	missRootSig = CreateMissRootSignature();
 	closestHitRootSignature = CreateClosestHitRootSignature();
 
-	shadowRayLib = nv_helpers_dx12::CompileShaderLibrary(L"../../ShadowRay.hlsl");
+	shadowRayLib = LoadShaderLibrary(L"../../ShadowRay.hlsl");
 	pipeline.AddLibrary(shadowRayLib.Get(), { L"ShadowClosestHit",L"ShadowMiss" });
 	shadowRootSig = CreateClosestHitRootSignature();
 
@@ -3205,9 +3240,9 @@ void Game::CreateRayTracingIndirectSpecularPipeline()
 	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
 
 	//the raytracing pipeline contains all the shader code
-	indirectSpecularRayGenLib = nv_helpers_dx12::CompileShaderLibrary(L"../../RayGenIndirectSpecular.hlsl");
-	missLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Miss.hlsl");
-	hitLib = nv_helpers_dx12::CompileShaderLibrary(L"../../Hit.hlsl");
+	indirectSpecularRayGenLib = LoadShaderLibrary(L"../../RayGenIndirectSpecular.hlsl");
+	missLib = LoadShaderLibrary(L"../../Miss.hlsl");
+	hitLib = LoadShaderLibrary(L"../../Hit.hlsl");
 
 
 	//add the libraies to pipeliene
@@ -3220,7 +3255,7 @@ void Game::CreateRayTracingIndirectSpecularPipeline()
 	missRootSig = CreateMissRootSignature();
 	closestHitRootSignature = CreateClosestHitRootSignature();
 
-	shadowRayLib = nv_helpers_dx12::CompileShaderLibrary(L"../../ShadowRay.hlsl");
+	shadowRayLib = LoadShaderLibrary(L"../../ShadowRay.hlsl");
 	pipeline.AddLibrary(shadowRayLib.Get(), { L"ShadowClosestHit",L"ShadowMiss" });
 	shadowRootSig = CreateClosestHitRootSignature();
 
@@ -3258,9 +3293,9 @@ void Game::CreateGbufferRaytracingPipeline()
 	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
 
 	//the raytracing pipeline contains all the shader code
-	GBrayGenLib = nv_helpers_dx12::CompileShaderLibrary(L"../../GBufferRayGen.hlsl");
-	GBmissLib = nv_helpers_dx12::CompileShaderLibrary(L"../../GBufferMiss.hlsl");
-	GBhitLib = nv_helpers_dx12::CompileShaderLibrary(L"../../GbufferHit.hlsl");
+	GBrayGenLib = LoadShaderLibrary(L"../../GBufferRayGen.hlsl");
+	GBmissLib = LoadShaderLibrary(L"../../GBufferMiss.hlsl");
+	GBhitLib = LoadShaderLibrary(L"../../GbufferHit.hlsl");
 
 	//add the libraies to pipeliene
 	pipeline.AddLibrary(GBrayGenLib.Get(), { L"GBufferRayGen" });
@@ -3273,7 +3308,7 @@ void Game::CreateGbufferRaytracingPipeline()
 	closestHitRootSignature = CreateClosestHitRootSignature();
 
 
-	shadowRayLib = nv_helpers_dx12::CompileShaderLibrary(L"../../ShadowRay.hlsl");
+	shadowRayLib = LoadShaderLibrary(L"../../ShadowRay.hlsl");
 	pipeline.AddLibrary(shadowRayLib.Get(), { L"ShadowClosestHit",L"ShadowMiss" });
 	shadowRootSig = CreateClosestHitRootSignature();
 
@@ -3314,6 +3349,7 @@ void Game::Update(float deltaTime, float totalTime)
 {
 
 	dynamicBufferRing.OnBeginFrame();
+	ReloadChangedShaders();
 
 	auto kb = keyboard->GetState();
 	auto mouseState = mouse->GetState();
@@ -3404,7 +3440,7 @@ void Game::Update(float deltaTime, float totalTime)
 	memcpy(lightCbufferBegin, &lightData, sizeof(lightData));
 
 	lightingData.cameraPosition = mainCamera->GetPosition();
-	lightingData.lightCount = lightCount;
+	lightingData.lightCount = lightManager.GetLightCount();
 	lightingData.cameraForward = mainCamera->GetDirection();
 	lightingData.totalTime += deltaTime;
 	lightingData.fogDense = fogDensity;
@@ -3413,19 +3449,19 @@ void Game::Update(float deltaTime, float totalTime)
 	lightCullingExternData.view = mainCamera->GetViewMatrix();
 	lightCullingExternData.projection = mainCamera->GetProjectionMatrix();
 	lightCullingExternData.inverseProjection = mainCamera->GetInverseProjection();
-	lightCullingExternData.lightCount = lightCount;
+	lightCullingExternData.lightCount = lightManager.GetLightCount();
 	lightCullingExternData.cameraPosition = mainCamera->GetPosition();
 
 	memcpy(lightingCbufferBegin, &lightingData, sizeof(lightingData));
-	memcpy(lightBufferBegin, lights, sizeof(Light) * MAX_LIGHTS);
 	memcpy(lightCullingExternBegin, &lightCullingExternData, sizeof(lightCullingExternData));
 
+	simulationClock.Advance(deltaTime);
+	entityInterpolationAlpha = simulationClock.GetInterpolationAlpha(entitySimulationIndex);
+
 	for (size_t i = 0; i < entities.size(); i++)
 	{
-		entities[i]->Update(deltaTime);
-
 		if(isRaytracingAllowed)
-			bottomLevelBufferInstances[i].modelMatrix = entities[i]->GetRawModelMatrix();
+			bottomLevelBufferInstances[i].modelMatrix = entities[i]->GetInterpolatedModelMatrix(entityInterpolationAlpha);
 	}
 
 	if (isRaytracingAllowed)
@@ -3445,11 +3481,6 @@ void Game::Update(float deltaTime, float totalTime)
 		CreateTopLevelAS(bottomLevelBufferInstances, true);
 	}
 
-	for (int i = 0; i < emitters.size(); i++)
-	{
-		//emitters[i]->UpdateParticles(deltaTime, totalTime);
-	}
-
 
 
 	//if (!raster)
@@ -3458,7 +3489,7 @@ void Game::Update(float deltaTime, float totalTime)
 		//rtDescriptorHeap.UpdateRaytracingAccelerationStruct(device, topLevelAsBuffers);
 	//}
 
-	//FlockingSystem::FlockerSystem(registry, flockers, deltaTime);
+	//flocking is stepped by the entities simulation system
 
 
 	velocityBufferData.projection = mainCamera->GetProjectionMatrix();
@@ -3579,6 +3610,36 @@ void Game::RenderGUI(float deltaTime, float totalTime)
 		ImGui::End();
 	}
 
+	{
+		auto& particleStats = emitterSystem->GetStats();
+		ImGui::Begin("Particles");
+		ImGui::Text("Emitters: %u, living particles: %u", particleStats.emitterCount, particleStats.livingParticles);
+		ImGui::Text("Draw calls: %u (%u unbatched)", particleStats.drawCalls, particleStats.standaloneDrawCalls);
+		ImGui::Text("Memory: %.2f MB (%.2f MB unbatched)", particleStats.memorySize / (1024.0f * 1024.0f),
+			particleStats.standaloneMemorySize / (1024.0f * 1024.0f));
+		ImGui::End();
+	}
+
+	{
+		ImGui::Begin("Simulation");
+		for (UINT i = 0; i < simulationClock.GetSystemCount(); i++)
+		{
+			auto& system = simulationClock.GetSystem(i);
+			ImGui::Text("%s: %.0f Hz, %u steps, alpha %.2f, dropped %.2f s", system.name.c_str(), 1.0f / system.stepTime,
+				system.stepsLastFrame, simulationClock.GetInterpolationAlpha(i), system.droppedTime);
+		}
+
+		if (isRaytracingAllowed)
+		{
+			auto& tlasStats = tlasRebuildPolicy.GetStats();
+			ImGui::Text("TLAS: %u refits, %u rebuilds, %u frames since build", tlasStats.refitCount, tlasStats.rebuildCount, tlasStats.framesSinceBuild);
+			ImGui::Text("TLAS: displacement %.3f, growth %.2f, sah ratio %.2f", tlasStats.lastDecision.maxDisplacement,
+				tlasStats.lastDecision.boundsGrowth, tlasStats.lastDecision.sahRatio);
+			ImGui::SliderFloat("TLAS Rebuild Threshold", &tlasRebuildPolicy.GetSettings().sahDegradationThreshold, 1.0f, 3.0f);
+		}
+		ImGui::End();
+	}
+
 
 	if(pickingIndex!=-1)
 		entityManipulated = entities[pickingIndex]->ManipulateTransforms(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), gizmoMode);
@@ -3672,14 +3733,21 @@ void Game::RenderGUI(float deltaTime, float totalTime)
 				float matrixRotation[] = { angles.pitch, angles.yaw, angles.roll };
 				float matrixScale[] = { scal.x, scal.y, scal.z };
 
-				gizmoMode = ImGui::DragFloat3("Position", matrixTranslation) ? gizmoMode = ImGuizmo::TRANSLATE : gizmoMode;
-				gizmoMode = ImGui::DragFloat3("Rotation", matrixRotation) ? gizmoMode = ImGuizmo::ROTATE : gizmoMode;
-				gizmoMode = ImGui::DragFloat3("Scale", matrixScale) ? gizmoMode = ImGuizmo::SCALE : gizmoMode;
+				bool positionEdited = ImGui::DragFloat3("Position", matrixTranslation);
+				bool rotationEdited = ImGui::DragFloat3("Rotation", matrixRotation);
+				bool scaleEdited = ImGui::DragFloat3("Scale", matrixScale);
+				gizmoMode = positionEdited ? gizmoMode = ImGuizmo::TRANSLATE : gizmoMode;
+				gizmoMode = rotationEdited ? gizmoMode = ImGuizmo::ROTATE : gizmoMode;
+				gizmoMode = scaleEdited ? gizmoMode = ImGuizmo::SCALE : gizmoMode;
 
 
 				entities[pickingIndex]->SetPosition(Vector3(matrixTranslation[0], matrixTranslation[1], matrixTranslation[2]));
 				entities[pickingIndex]->SetScale(Vector3(matrixScale[0], matrixScale[1], matrixScale[2]));
 				entities[pickingIndex]->SetRotation(matrixRotation[0], matrixRotation[1], matrixRotation[2]);
+
+				//edits from the inspector are teleports, not something to interpolate
+				if (positionEdited || rotationEdited || scaleEdited)
+					entities[pickingIndex]->SaveSimulationState();
 			}
 
 
@@ -3849,7 +3917,7 @@ void Game::DepthPrePass()
 	gpuCBVSRVUAVHandle = gpuHeapRingBuffer->GetStaticDescriptorOffset();
 	for (UINT i = 0; i < entities.size(); i++)
 	{
-		entities[i]->PrepareMaterial(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix());
+		entities[i]->PrepareMaterial(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), entityInterpolationAlpha);
 		commandList->SetPipelineState(depthPrePassPipelineState.Get());
 		entities[i]->Draw(commandList, gpuHeapRingBuffer);
 	}
@@ -3887,14 +3955,13 @@ void Game::BNDSPrePass()
 	computeCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
 	TransitionManagedResource(commandList, rtCombineOutput, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-	TransitionManagedResource(commandList, blueNoiseTex, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	TransitionManagedResource(commandList, retargetTex, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	TransitionManagedResource(commandList, sharpenOutput, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
 
 	auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(sampleSequences.resource.Get());
 	computeCommandList->ResourceBarrier(1, &barrier);
-	computeCommandList->SetComputeRootDescriptorTable(BlueNoiseDithering::BlueNoiseTex, blueNoiseTex.srvGPUHandle);
+	computeCommandList->SetComputeRootShaderResourceView(BlueNoiseDithering::BlueNoiseOrders, blueNoiseOrdersResource->GetGPUVirtualAddress());
 	computeCommandList->SetComputeRootDescriptorTable(BlueNoiseDithering::PrevFrameNoisy, rtCombineOutput.srvGPUHandle);
 	computeCommandList->SetComputeRootDescriptorTable(BlueNoiseDithering::RetargetTex, retargetTex.srvGPUHandle);
 	computeCommandList->SetComputeRootUnorderedAccessView(BlueNoiseDithering::NewSequences, sampleSequences.resource->GetGPUVirtualAddress());
@@ -3907,8 +3974,13 @@ void Game::BNDSPrePass()
 		frameCount = 0;
 	}
 
+	BlueNoiseFrameOffset noiseOffset = blueNoisePermutations.GetFrameOffset(frameCount);
 	bndsData = {};
 	bndsData.frame = frameCount;
+	bndsData.noiseOffsetX = noiseOffset.x;
+	bndsData.noiseOffsetY = noiseOffset.y;
+	bndsData.noiseWidth = blueNoisePermutations.GetNoiseWidth();
+	bndsData.noiseHeight = blueNoisePermutations.GetNoiseHeight();
 
 	memcpy(bndsDataBegin, &bndsData, sizeof(BNDSExternalData));
 
@@ -3943,8 +4015,13 @@ void Game::BNDSRetargetingPass()
 		frameCount = 0;
 	}
 
+	BlueNoiseFrameOffset noiseOffset = blueNoisePermutations.GetFrameOffset(frameCount);
 	bndsData = {};
 	bndsData.frame = frameCount;
+	bndsData.noiseOffsetX = noiseOffset.x;
+	bndsData.noiseOffsetY = noiseOffset.y;
+	bndsData.noiseWidth = blueNoisePermutations.GetNoiseWidth();
+	bndsData.noiseHeight = blueNoisePermutations.GetNoiseHeight();
 
 	memcpy(bndsDataBegin, &bndsData, sizeof(BNDSExternalData));
 
@@ -4011,6 +4088,66 @@ void Game::RenderVelocityBuffer()
 
 }
 
+void Game::CopyDirtyLights()
+{
+	//this frame's upload buffers were last read by the frame MoveToNextFrame waited for, the frames still in flight
+	//only read the default heap buffers and the copies are ordered after them on the queues that read each buffer
+	lightManager.FlushDirty(lightUploadBegin[frameIndex], lightCullUploadBegin[frameIndex]);
+	const std::vector<LightRange>& ranges = lightManager.GetFlushedRanges();
+	if (ranges.empty())
+		return;
+
+	const D3D12_RESOURCE_STATES lightListState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(lightListResource.Get(), lightListState, D3D12_RESOURCE_STATE_COPY_DEST);
+	commandList->ResourceBarrier(1, &transition);
+	transition = CD3DX12_RESOURCE_BARRIER::Transition(lightCullDataResource.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+	computeCommandList->ResourceBarrier(1, &transition);
+
+	//the light list is read on the direct queue, the culling data only by the light culling on the compute queue
+	for (const LightRange& range : ranges)
+	{
+		commandList->CopyBufferRegion(lightListResource.Get(), range.first * sizeof(Light), lightUploadResources[frameIndex].Get(),
+			range.first * sizeof(Light), range.count * sizeof(Light));
+		computeCommandList->CopyBufferRegion(lightCullDataResource.Get(), range.first * sizeof(LightCullData), lightCullUploadResources[frameIndex].Get(),
+			range.first * sizeof(LightCullData), range.count * sizeof(LightCullData));
+	}
+
+	transition = CD3DX12_RESOURCE_BARRIER::Transition(lightListResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, lightListState);
+	commandList->ResourceBarrier(1, &transition);
+	transition = CD3DX12_RESOURCE_BARRIER::Transition(lightCullDataResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	computeCommandList->ResourceBarrier(1, &transition);
+}
+
+void Game::BuildLightClusters()
+{
+	clusteredLightGrid->Build({ mainCamera->GetPosition(), mainCamera->GetDirection(), Vector3(0.0f, 1.0f, 0.0f) },
+		lightManager.GetLights(), lightManager.GetLightCount());
+
+	const std::vector<ClusterRange>& clusters = clusteredLightGrid->GetClusters();
+	const std::vector<UINT>& lightIndices = clusteredLightGrid->GetLightIndices();
+	memcpy(clusterRangeBegin[frameIndex], clusters.data(), clusters.size() * sizeof(ClusterRange));
+
+	//the frame that last read this buffer is done, so it can be replaced
+	if (lightIndices.size() > clusterLightIndexCapacity[frameIndex])
+	{
+		UINT capacity = std::max((UINT)lightIndices.size(), clusterLightIndexCapacity[frameIndex] * 2);
+		auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT) * (UINT64)capacity);
+		clusterLightIndexResources[frameIndex].Reset();
+		ThrowIfFailed(device->CreateCommittedResource(
+			&GetAppResources().uploadHeapType,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(clusterLightIndexResources[frameIndex].GetAddressOf())
+		));
+		clusterLightIndexResources[frameIndex]->Map(0, &GetAppResources().zeroZeroRange, reinterpret_cast<void**>(&clusterLightIndexBegin[frameIndex]));
+		clusterLightIndexCapacity[frameIndex] = capacity;
+	}
+
+	memcpy(clusterLightIndexBegin[frameIndex], lightIndices.data(), lightIndices.size() * sizeof(UINT));
+}
+
 void Game::LightCullingPass()
 {
 	computeCommandList->SetComputeRootSignature(computeRootSignature.Get());
@@ -4022,7 +4159,7 @@ void Game::LightCullingPass()
 	TransitionManagedResource(commandList, depthTex, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
 	computeCommandList->SetComputeRootDescriptorTable(LightCullingRootIndices::DepthMapSRV, depthTex.srvGPUHandle);
-	computeCommandList->SetComputeRootShaderResourceView(LightCullingRootIndices::LightListSRV, lightListResource->GetGPUVirtualAddress());
+	computeCommandList->SetComputeRootShaderResourceView(LightCullingRootIndices::LightCullDataSRV, lightCullDataResource->GetGPUVirtualAddress());
 	computeCommandList->SetComputeRootUnorderedAccessView(LightCullingRootIndices::VisibleLightIndicesUAV, visibleLightIndicesBuffer.resource->GetGPUVirtualAddress());
 	computeCommandList->SetComputeRootConstantBufferView(LightCullingRootIndices::LightCullingExternalDataCBV, lightCullingCBVResource->GetGPUVirtualAddress());
 
@@ -4040,6 +4177,8 @@ void Game::PopulateCommandList()
 
 	residencySet->Open();
 
+	CopyDirtyLights();
+	BuildLightClusters();
 
 	auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(retargetedSequences.resource.Get());
 
@@ -4106,7 +4245,12 @@ void Game::PopulateCommandList()
 		commandList->SetGraphicsRootConstantBufferView(EntityRootIndices::EntityPixelCBV, lightingConstantBufferResource->GetGPUVirtualAddress());
 		commandList->SetGraphicsRootShaderResourceView(EntityRootIndices::EntityLightListSRV, lightListResource->GetGPUVirtualAddress());
 		commandList->SetGraphicsRootShaderResourceView(EntityRootIndices::EntityLightIndices, visibleLightIndicesBuffer.resource->GetGPUVirtualAddress());
+		ClusterShaderData clusterData = clusteredLightGrid->GetShaderData();
+		commandList->SetGraphicsRootShaderResourceView(EntityRootIndices::EntityClusterRangesSRV, clusterRangeResources[frameIndex]->GetGPUVirtualAddress());
+		commandList->SetGraphicsRootShaderResourceView(EntityRootIndices::EntityClusterLightIndicesSRV, clusterLightIndexResources[frameIndex]->GetGPUVirtualAddress());
+		commandList->SetGraphicsRoot32BitConstants(EntityRootIndices::EntityClusterDataConstants, sizeof(ClusterShaderData) / sizeof(UINT), &clusterData, 0);
 		commandList->SetGraphicsRootDescriptorTable(EntityRootIndices::EntityEnvironmentSRV, gpuHeapRingBuffer->GetDescriptorHeap().GetGPUHandle(skybox->environmentTexturesIndex));
+		commandList->SetGraphicsRootConstantBufferView(EntityRootIndices::EntityIrradianceSHCBV, skybox->GetIrradianceSHBuffer()->GetGPUVirtualAddress());
 		commandList->SetGraphicsRootDescriptorTable(EntityRootIndices::EntityLTCSRV, gpuHeapRingBuffer->GetDescriptorHeap().GetGPUHandle(ltcLUT.heapOffset));
 		//commandList->SetGraphicsRootDescriptorTable(EntityRootIndices::EntityNoiseTextures, gpuHeapRingBuffer->GetDescriptorHeap().GetGPUHandle(blueNoiseTexture.heapOffset));
 		commandList->SetGraphicsRoot32BitConstant(EntityRootIndices::EnableIndirectLighting, raster, 0);
@@ -4117,13 +4261,13 @@ void Game::PopulateCommandList()
 
 		for (UINT i = 0; i < entities.size(); i++)
 		{
-			entities[i]->PrepareMaterial(mainCamera->GetViewMatrix(), projectionMat);
+			entities[i]->PrepareMaterial(mainCamera->GetViewMatrix(), projectionMat, entityInterpolationAlpha);
 			commandList->SetPipelineState(entities[i]->GetPipelineState().Get());
 			entities[i]->Draw(commandList, gpuHeapRingBuffer);
 		}
 
 		commandList->SetGraphicsRootSignature(entity6->GetRootSignature().Get());
-		entity6->PrepareMaterial(mainCamera->GetViewMatrix(), projectionMat);
+		entity6->PrepareMaterial(mainCamera->GetViewMatrix(), projectionMat, entityInterpolationAlpha);
 		commandList->SetPipelineState(entity6->GetPipelineState().Get());
 
 		auto cameraPos = mainCamera->GetPosition();
@@ -4153,10 +4297,8 @@ void Game::PopulateCommandList()
 		flame->PrepareForDraw(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), mainCamera->GetPosition(), totalTime);
 		flame->Render(gpuHeapRingBuffer);
 
-		for (int i = 0; i < emitters.size(); i++)
-		{
-			//emitter1->Draw(commandList, gpuHeapRingBuffer, mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), totalTime);
-		}
+		emitterSystem->Draw(gpuHeapRingBuffer, mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(),
+			(float)simulationClock.GetInterpolatedTime(particleSimulationIndex), frameIndex);
 
 		if(raster)
 			RenderPostProcessing(taaInput);
@@ -4599,22 +4741,7 @@ void Game::CreateGBufferRays()
 {
 	//creating a dispatch rays description
 	D3D12_DISPATCH_RAYS_DESC desc = {};
-	//raygeneration location
-	desc.RayGenerationShaderRecord.StartAddress = GBsbtResource->GetGPUVirtualAddress();
-	//desc.RayGenerationShaderRecord.StartAddress = (desc.RayGenerationShaderRecord.StartAddress + 63) & ~63;
-	desc.RayGenerationShaderRecord.SizeInBytes = GBsbtGenerator.GetRayGenSectionSize();
-
-	//miss shaders
-	desc.MissShaderTable.StartAddress = GBsbtResource->GetGPUVirtualAddress() + GBsbtGenerator.GetRayGenSectionSize();
-	desc.MissShaderTable.SizeInBytes = GBsbtGenerator.GetMissSectionSize();
-	//desc.MissShaderTable.StartAddress = (desc.MissShaderTable.StartAddress + 63) & ~63;
-	desc.MissShaderTable.StrideInBytes = GBsbtGenerator.GetMissEntrySize();
-
-	//hit groups
-	desc.HitGroupTable.StartAddress = GBsbtResource->GetGPUVirtualAddress() + GBsbtGenerator.GetRayGenSectionSize() + GBsbtGenerator.GetMissSectionSize();
-	//desc.HitGroupTable.StartAddress = (desc.HitGroupTable.StartAddress + 63) & ~63;
-	desc.HitGroupTable.SizeInBytes = GBsbtGenerator.GetHitGroupSectionSize();
-	desc.HitGroupTable.StrideInBytes = GBsbtGenerator.GetHitGroupEntrySize();
+	sbtManager->FillDispatchDesc(GBsbtPipeline, desc);
 
 	//scene description
 	desc.Height = renderHeight;
@@ -4629,22 +4756,7 @@ void Game::CreateDirectRays()
 {
 	//creating a dispatch rays description
 	D3D12_DISPATCH_RAYS_DESC desc = {};
-	//raygeneration location
-	desc.RayGenerationShaderRecord.StartAddress = sbtResource->GetGPUVirtualAddress();
-	//desc.RayGenerationShaderRecord.StartAddress = (desc.RayGenerationShaderRecord.StartAddress + 63) & ~63;
-	desc.RayGenerationShaderRecord.SizeInBytes = sbtGenerator.GetRayGenSectionSize();
-
-	//miss shaders
-	desc.MissShaderTable.StartAddress = desc.RayGenerationShaderRecord.StartAddress + sbtGenerator.GetRayGenSectionSize();
-	desc.MissShaderTable.SizeInBytes = sbtGenerator.GetMissSectionSize();
-	desc.MissShaderTable.StartAddress = AlignUp(desc.MissShaderTable.StartAddress, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
-	desc.MissShaderTable.StrideInBytes = AlignUp(sbtGenerator.GetMissEntrySize(), D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
-
-	//hit groups
-	desc.HitGroupTable.StartAddress = desc.MissShaderTable.StartAddress + sbtGenerator.GetMissSectionSize();
-	//desc.HitGroupTable.StartAddress = AlignUp(desc.HitGroupTable.StartAddress, 1);
-	desc.HitGroupTable.SizeInBytes = sbtGenerator.GetHitGroupSectionSize();
-	desc.HitGroupTable.StrideInBytes = AlignUp(sbtGenerator.GetHitGroupEntrySize(), D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
+	sbtManager->FillDispatchDesc(directSbtPipeline, desc);
 
 	//scene description
 	desc.Height = renderHeight;
@@ -4695,22 +4807,7 @@ void Game::CreateIndirectDiffuseRays()
 {
 	//creating a dispatch rays description
 	D3D12_DISPATCH_RAYS_DESC desc = {};
-	//raygeneration location
-	desc.RayGenerationShaderRecord.StartAddress = indirectDiffuseSbtResource->GetGPUVirtualAddress();
-	//desc.RayGenerationShaderRecord.StartAddress = (desc.RayGenerationShaderRecord.StartAddress + 63) & ~63;
-	desc.RayGenerationShaderRecord.SizeInBytes = indirectDiffuseSbtGenerator.GetRayGenSectionSize();
-
-	//miss shaders
-	desc.MissShaderTable.StartAddress = indirectDiffuseSbtResource->GetGPUVirtualAddress() + indirectDiffuseSbtGenerator.GetRayGenSectionSize();
-	desc.MissShaderTable.SizeInBytes = indirectDiffuseSbtGenerator.GetMissSectionSize();
-	//desc.MissShaderTable.StartAddress = AlignUp(desc.MissShaderTable.StartAddress, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
-	desc.MissShaderTable.StrideInBytes = indirectDiffuseSbtGenerator.GetMissEntrySize();
-
-	//hit groups
-	desc.HitGroupTable.StartAddress = indirectDiffuseSbtResource->GetGPUVirtualAddress() + indirectDiffuseSbtGenerator.GetRayGenSectionSize() + indirectDiffuseSbtGenerator.GetMissSectionSize();
-	//desc.HitGroupTable.StartAddress = (desc.HitGroupTable.StartAddress + 63) & ~63;
-	desc.HitGroupTable.SizeInBytes = indirectDiffuseSbtGenerator.GetHitGroupSectionSize();
-	desc.HitGroupTable.StrideInBytes = indirectDiffuseSbtGenerator.GetHitGroupEntrySize();
+	sbtManager->FillDispatchDesc(indirectDiffuseSbtPipeline, desc);
 
 	//scene description
 	desc.Height = renderHeight;
@@ -4758,22 +4855,7 @@ void Game::CreateIndirectSpecularRays()
 {
 	//creating a dispatch rays description
 	D3D12_DISPATCH_RAYS_DESC desc = {};
-	//raygeneration location
-	desc.RayGenerationShaderRecord.StartAddress = indirectSpecularSbtResource->GetGPUVirtualAddress();
-	//desc.RayGenerationShaderRecord.StartAddress = (desc.RayGenerationShaderRecord.StartAddress + 63) & ~63;
-	desc.RayGenerationShaderRecord.SizeInBytes = indirectSpecularSbtGenerator.GetRayGenSectionSize();
-
-	//miss shaders
-	desc.MissShaderTable.StartAddress = indirectSpecularSbtResource->GetGPUVirtualAddress() + indirectSpecularSbtGenerator.GetRayGenSectionSize();
-	desc.MissShaderTable.SizeInBytes = indirectSpecularSbtGenerator.GetMissSectionSize();
-	//desc.MissShaderTable.StartAddress = (desc.MissShaderTable.StartAddress + 63) & ~63;
-	desc.MissShaderTable.StrideInBytes = indirectSpecularSbtGenerator.GetMissEntrySize();
-
-	//hit groups
-	desc.HitGroupTable.StartAddress = indirectSpecularSbtResource->GetGPUVirtualAddress() + indirectSpecularSbtGenerator.GetRayGenSectionSize() + indirectSpecularSbtGenerator.GetMissSectionSize();
-	//desc.HitGroupTable.StartAddress = (desc.HitGroupTable.StartAddress + 63) & ~63;
-	desc.HitGroupTable.SizeInBytes = indirectSpecularSbtGenerator.GetHitGroupSectionSize();
-	desc.HitGroupTable.StrideInBytes = indirectSpecularSbtGenerator.GetHitGroupEntrySize();
+	sbtManager->FillDispatchDesc(indirectSpecularSbtPipeline, desc);
 
 	//scene description
 	desc.Height = renderHeight;
@@ -4788,22 +4870,7 @@ void Game::CreateTransparencyRays()
 {
 	//creating a dispatch rays description
 	D3D12_DISPATCH_RAYS_DESC desc = {};
-	//raygeneration location
-	desc.RayGenerationShaderRecord.StartAddress = transparentSbtResource->GetGPUVirtualAddress();
-	//desc.RayGenerationShaderRecord.StartAddress = (desc.RayGenerationShaderRecord.StartAddress + 63) & ~63;
-	desc.RayGenerationShaderRecord.SizeInBytes = transparentSbtGenerator.GetRayGenSectionSize();
-
-	//miss shaders
-	desc.MissShaderTable.StartAddress = transparentSbtResource->GetGPUVirtualAddress() + transparentSbtGenerator.GetRayGenSectionSize();
-	desc.MissShaderTable.SizeInBytes = transparentSbtGenerator.GetMissSectionSize();
-	//desc.MissShaderTable.StartAddress = (desc.MissShaderTable.StartAddress + 63) & ~63;
-	desc.MissShaderTable.StrideInBytes = transparentSbtGenerator.GetMissEntrySize();
-
-	//hit groups
-	desc.HitGroupTable.StartAddress = transparentSbtResource->GetGPUVirtualAddress() + transparentSbtGenerator.GetRayGenSectionSize() + transparentSbtGenerator.GetMissSectionSize();
-	//desc.HitGroupTable.StartAddress = (desc.HitGroupTable.StartAddress + 63) & ~63;
-	desc.HitGroupTable.SizeInBytes = transparentSbtGenerator.GetHitGroupSectionSize();
-	desc.HitGroupTable.StrideInBytes = transparentSbtGenerator.GetHitGroupEntrySize();
+	sbtManager->FillDispatchDesc(transparentSbtPipeline, desc);
 
 	//scene description
 	desc.Height = renderHeight;
@@ -4818,90 +4885,16 @@ void Game::CreateLTCTexture()
 {
 	ltcDescriptorHeap.Create( 3 + 1 + 100, false, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	ltcTempDescriptorHeap.Create( 3 + 1 + 100, false, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	ltcDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/ltc_1.png", ltcLUT, RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	ltcDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/ltc_2.png", ltcLUT2, RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_0.png", ltcTexture[0], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[0].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_1.png", ltcTexture[1], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[1].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_2.png", ltcTexture[2], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[2].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_3.png", ltcTexture[3], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[3].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_4.png", ltcTexture[4], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[4].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_5.png", ltcTexture[5], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[5].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_6.png", ltcTexture[6], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[6].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
-	ltcTempDescriptorHeap.CreateDescriptor(L"../../Assets/Textures/Brick_7.png", ltcTexture[7], RESOURCE_TYPE_SRV,   TEXTURE_TYPE_DEAULT, false);
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcTexture[7].resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	commandList->ResourceBarrier(1, &transition);
+	//both ltc tables come from the one half float lut, fitted and saved there if it's missing
+	LTCTable ltcTable;
+	ltcTable.LoadOrFit("../../Assets/Textures/ltc.lut");
+	ltcTable.CreateTexture(0, ltcLUT, ltcLUTUploadHeaps[0]);
+	ltcTable.CreateTexture(1, ltcLUT2, ltcLUTUploadHeaps[1]);
+	ltcDescriptorHeap.CreateDescriptor(ltcLUT, RESOURCE_TYPE_SRV, 0, 0, 0, 0, 1);
+	ltcDescriptorHeap.CreateDescriptor(ltcLUT2, RESOURCE_TYPE_SRV, 0, 0, 0, 0, 1);
 
-	auto desc = ltcTexture[0].resource->GetDesc();
-	//creating the texture cube array
-	D3D12_RESOURCE_DESC resourceDesc = {};
-	resourceDesc.Format = desc.Format;
-	resourceDesc.MipLevels = desc.MipLevels;
-	resourceDesc.DepthOrArraySize = 8;
-	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	resourceDesc.SampleDesc.Count = 1;
-	resourceDesc.SampleDesc.Quality = 0;
-	resourceDesc.Width = desc.Width;
-	resourceDesc.Height = desc.Height;
-
-
-	ThrowIfFailed
-	(
-		GetAppResources().device->CreateCommittedResource
-		(
-			&GetAppResources().defaultHeapType,
-			D3D12_HEAP_FLAG_NONE,
-			&resourceDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(ltcPrefilterTexture.resource.GetAddressOf())
-		)
-	);
-
-	ltcPrefilterTexture.resource->SetName(L"ltcprefiltertexture");
-
-	D3D12_BOX box = {};
-	box.top = 0;
-	box.left = 0;
-	box.bottom = desc.Height;
-	box.right = desc.Width;
-	box.front = 0;
-	box.back = 1;
-
-	for (size_t i = 0; i < 8; i++)
-	{
-		// Copy
-		D3D12_TEXTURE_COPY_LOCATION destLoc = {};
-		destLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		destLoc.pResource = ltcPrefilterTexture.resource.Get();
-		destLoc.SubresourceIndex = D3D12CalcSubresource(0, i, 0, desc.MipLevels, 0);
-
-		D3D12_TEXTURE_COPY_LOCATION srcLoc = {};
-		srcLoc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		srcLoc.pResource = ltcTexture[i].resource.Get();
-		srcLoc.SubresourceIndex = D3D12CalcSubresource(0, 0, 0, desc.MipLevels, 0);
-
-		commandList->CopyTextureRegion(&destLoc, 0, 0, 0, &srcLoc, &box);
-	}
-
-	 transition = CD3DX12_RESOURCE_BARRIER::Transition(ltcPrefilterTexture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	commandList->ResourceBarrier(1, &transition);
-
-	ltcDescriptorHeap.CreateDescriptor(ltcPrefilterTexture, RESOURCE_TYPE_SRV, 0, 0, 0, 0, desc.MipLevels, true);
+	PrefilterLTCTextures();
+	ltcDescriptorHeap.CreateDescriptor(ltcPrefilterTexture, RESOURCE_TYPE_SRV, 0, 0, 0, 0, ltcPrefilterTexture.resource->GetDesc().MipLevels, true);
 
 
 	if (gpuHeapRingBuffer != nullptr)
@@ -4925,7 +4918,11 @@ void Game::CreateLTCTexture()
 
 void Game::PrefilterLTCTextures()
 {
-
+	//every blur of the area light texture with its mips, prefiltered on the cpu the first time and loaded from the
+	//cache while Brick_0.png doesn't change
+	LTCPrefilteredTexture prefiltered;
+	prefiltered.LoadOrPrefilter("../../Assets/Textures/Brick.ltcprefilter", "../../Assets/Textures/Brick_0.png");
+	prefiltered.CreateTexture(ltcPrefilterTexture, ltcPrefilterUploadHeap);
 }
 
 
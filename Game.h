@@ -7,7 +7,22 @@
 #include"Mesh.h"
 #include"Entity.h"
 #include"Emitter.h"
+#include"EmitterSystem.h"
+#include"SimulationClock.h"
+#include"BLASCache.h"
+#include"TLASInstanceTable.h"
+#include"TLASRebuildPolicy.h"
+#include"ShaderBindingTableManager.h"
+#include"ShaderLibraryCache.h"
+#include"ShaderBuildGraph.h"
+#include"ShaderWatcher.h"
+#include"RootSignatureCache.h"
+#include"PipelineStateCache.h"
 #include"Lights.h"
+#include"LightManager.h"
+#include"ClusteredLightGrid.h"
+#include"ReservoirPacking.h"
+#include"BlueNoisePermutations.h"
 #include"DescriptorHeapWrapper.h"
 #include"CommonStructs.h"
 #include"Material.h"
@@ -111,24 +126,6 @@ struct Reservoir
 	float W; //Probablistic weight
 };
 
-struct Sample
-{
-	Vector3 visiblePos;
-	Vector3 visibleNormal;
-	Vector3 samplePos;
-	Vector3 sampleNormal;
-	Vector3 color;
-	Vector3 RandomNums;
-};
-
-struct GIReservoir
-{
-	Sample sample;
-	float wsum; // the sum of weights
-	float M; //the number of samples seen so far
-	float W; //Probablistic weight
-};
-
 inline ID3D12Resource* CreateRBBuffer(ID3D12Resource* buffer, ID3D12Device* device, UINT bufferSize)
 {
 	if (buffer != nullptr)
@@ -165,6 +162,11 @@ struct RayTraceCameraData
 struct BNDSExternalData
 {
 	UINT frame;
+	//this frame's scroll of the noise and retarget textures, from the permutation table
+	UINT noiseOffsetX;
+	UINT noiseOffsetY;
+	UINT noiseWidth;
+	UINT noiseHeight;
 };
 
 class Game
@@ -189,7 +191,6 @@ public:
 	//------------------Raytracing Functions--------------------------
 
 	//create the acceleration structure for the buffers
-	AccelerationStructureBuffers CreateBottomLevelAS(std::vector<std::pair<ComPtr<ID3D12Resource>,uint32_t>> vertexBuffers);
 	//create top level acceleration structures
 	void CreateTopLevelAS(const std::vector<EntityInstance>& instances, bool updateOnly = false);
 	//create both top and bottom structures
@@ -205,6 +206,12 @@ public:
 	void CreateRaytracingDescriptorHeap();
 
 	//create dxr pipeline
+	ComPtr<IDxcBlob> LoadShaderLibrary(LPCWSTR fileName);
+	void CreateRaytracingPipelineSources();
+	ShaderBuildReport BuildRaytracingPipelines(const std::vector<size_t>& pipelines);
+	void WatchShaders();
+	//rebuilds the pipelines using shaders that changed on disk, called at the start of the frame
+	void ReloadChangedShaders();
 	void CreateRayTracingPipeline();
 	void CreateRayTracingDirectLightingPipeline();
 	void CreateRaytracingTransparencyPipeline();
@@ -250,6 +257,8 @@ public:
 	void BNDSPrePass();
 	void BNDSRetargetingPass();
 	void RenderVelocityBuffer();
+	void CopyDirtyLights();
+	void BuildLightClusters();
 	void LightCullingPass();
 	void Update(float deltaTime, float totalTime);
 	void UpdateGUI(float deltaTime, float totalTime);
@@ -328,10 +337,24 @@ private:
 	ComPtr<ID3D12Resource> lightingConstantBufferResource;
 	UINT8* lightingCbufferBegin;
 	LightingData lightingData;
-	Light* lights;
-	UINT8* lightBufferBegin;
+	LightManager lightManager;
+	//the shaders read the lights from the default heap, every frame in flight stages its dirty lights in its own upload
+	//buffers and copies them over on its command lists
 	ComPtr<ID3D12Resource> lightListResource;
-	UINT lightCount;
+	ComPtr<ID3D12Resource> lightCullDataResource;
+	Light* lightUploadBegin[frameCount];
+	ComPtr<ID3D12Resource> lightUploadResources[frameCount];
+	LightCullData* lightCullUploadBegin[frameCount];
+	ComPtr<ID3D12Resource> lightCullUploadResources[frameCount];
+
+	//the pbr shaders look their lights up in a clustered grid built on the cpu every frame, each frame in flight reads
+	//its own upload buffers. The index list buffer grows when a frame needs more
+	std::unique_ptr<ClusteredLightGrid> clusteredLightGrid;
+	ComPtr<ID3D12Resource> clusterRangeResources[frameCount];
+	ClusterRange* clusterRangeBegin[frameCount];
+	ComPtr<ID3D12Resource> clusterLightIndexResources[frameCount];
+	UINT* clusterLightIndexBegin[frameCount];
+	UINT clusterLightIndexCapacity[frameCount];
 
 	ManagedResource visibleLightIndicesBuffer;
 	UINT8* visibleLightIndicesResource;
@@ -374,7 +397,8 @@ private:
 	ComPtr<ID3D12Resource> bndsCBResource;
 
 	//blue noise permulation variables
-	ManagedResource blueNoiseTex;
+	BlueNoisePermutationTable blueNoisePermutations;
+	ComPtr<ID3D12Resource> blueNoiseOrdersResource;
 	ManagedResource retargetTex;
 	ManagedResource sampleSequences;
 	ManagedResource retargetedSequences;
@@ -530,8 +554,14 @@ private:
 	bool doRestirGI;
 	bool restirSpatialReuse;
 	ComPtr<ID3D12Resource> bottomLevelAs; //storage for bottom level as
-	nv_helpers_dx12::TopLevelASGenerator topLevelAsGenerator;
+	std::shared_ptr<DynamicTLAS> topLevelAS;
+	std::vector<UINT> tlasInstanceHandles;
+	TLASRebuildPolicy tlasRebuildPolicy;
+	std::vector<TLASInstanceBounds> tlasLocalBounds;
+	std::vector<TLASInstanceBounds> tlasWorldBounds;
 	AccelerationStructureBuffers topLevelAsBuffers;
+	std::shared_ptr<BLASCache> blasCache;
+	std::vector<UINT> blasHandles;
 	std::vector<EntityInstance> bottomLevelBufferInstances;
 	ComPtr<ID3D12Resource> previousBuffer;
 
@@ -589,17 +619,30 @@ private:
 	ManagedResource outPrevFramePixels;
 	DescriptorHeapWrapper rtDescriptorHeap;
 
-	//SBT variables
-	nv_helpers_dx12::ShaderBindingTableGenerator sbtGenerator;
-	ComPtr<ID3D12Resource> sbtResource;
-	nv_helpers_dx12::ShaderBindingTableGenerator transparentSbtGenerator;
-	ComPtr<ID3D12Resource> transparentSbtResource;
-	nv_helpers_dx12::ShaderBindingTableGenerator indirectDiffuseSbtGenerator;
-	ComPtr<ID3D12Resource> indirectDiffuseSbtResource;
-	nv_helpers_dx12::ShaderBindingTableGenerator indirectSpecularSbtGenerator;
-	ComPtr<ID3D12Resource> indirectSpecularSbtResource;
-	nv_helpers_dx12::ShaderBindingTableGenerator GBsbtGenerator;
-	ComPtr<ID3D12Resource> GBsbtResource;
+	//compiled libraries on disk and shared between the pipelines
+	std::shared_ptr<ShaderLibraryCache> shaderLibraryCache;
+
+	//a raytracing pipeline and the libraries it is built from
+	struct RaytracingPipelineSource
+	{
+		const char* name;
+		void (Game::* create)();
+		std::vector<LPCWSTR> libraries;
+	};
+	std::vector<RaytracingPipelineSource> raytracingPipelineSources;
+	//libraries the build graph got from the cache, handed to the pipelines so they don't ask the cache again
+	std::unordered_map<std::wstring, std::shared_ptr<const ShaderBytecode>> builtLibraries;
+	std::mutex builtLibrariesMutex;
+	std::shared_ptr<ShaderWatcher> shaderWatcher;
+
+	//SBT variables, the tables of every pipeline live in one buffer
+	std::shared_ptr<ShaderBindingTableManager> sbtManager;
+	std::vector<UINT> sbtRecordHandles;
+	UINT directSbtPipeline;
+	UINT transparentSbtPipeline;
+	UINT indirectDiffuseSbtPipeline;
+	UINT indirectSpecularSbtPipeline;
+	UINT GBsbtPipeline;
 
 	//camera
 	RayTraceCameraData rtCamera;
@@ -615,19 +658,11 @@ private:
 
 	//Linearly transformed cosines
 	DescriptorHeapWrapper ltcDescriptorHeap;
-	DescriptorHeapWrapper ltcTempDescriptorHeap;
 	ComPtr<ID3D12Resource> ltcTextureUploadHeap;
+	ComPtr<ID3D12Resource> ltcLUTUploadHeaps[2];
+	ComPtr<ID3D12Resource> ltcPrefilterUploadHeap;
 	ManagedResource ltcLUT;
 	ManagedResource ltcLUT2;
-	ManagedResource ltcTexture[8];
-	ManagedResource ltcTexture0;
-	ManagedResource ltcTexture1;
-	ManagedResource ltcTexture2;
-	ManagedResource ltcTexture3;
-	ManagedResource ltcTexture4;
-	ManagedResource ltcTexture5;
-	ManagedResource ltcTexture6;
-	ManagedResource ltcTexture7;
 
 	ManagedResource ltcPrefilterTexture;
 
@@ -666,12 +701,10 @@ private:
 	//image based lighting 
 
 		//pipeline state objects
-	ComPtr<ID3D12PipelineState> irradiencePSO;
 	ComPtr<ID3D12PipelineState> prefilteredMapPSO;
 	ComPtr<ID3D12PipelineState> brdfLUTPSO;
 
 	//root signatures
-	ComPtr<ID3D12RootSignature> irradianceRootSignature;
 	ComPtr<ID3D12RootSignature> prefilteredRootSignature;
 	ComPtr<ID3D12RootSignature> brdfRootSignature;
 
@@ -681,8 +714,18 @@ private:
 	ComPtr<ID3D12PipelineState> particlesPSO;
 	ComPtr<ID3D12RootSignature> particleRootSig;
 
+	ComPtr<ID3D12PipelineState> particleSystemPSO;
+	ComPtr<ID3D12RootSignature> particleSystemRootSig;
+
 	std::shared_ptr<Emitter> emitter1;
 	std::vector<std::shared_ptr<Emitter>> emitters;
+	std::shared_ptr<EmitterSystem> emitterSystem;
+
+	//fixed step simulation
+	SimulationClock simulationClock;
+	UINT entitySimulationIndex;
+	UINT particleSimulationIndex;
+	float entityInterpolationAlpha = 1.0f;
 
 	//ECS variables
 	entt::registry registry;
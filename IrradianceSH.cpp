@@ -0,0 +1,622 @@
+#include "IrradianceSH.h"
+#include"Validation.h"
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<functional>
+#include<random>
+#include<thread>
+#include<vector>
+
+using namespace DirectX;
+
+static const UINT IrradianceSHMagic = 0x48534952;
+static const UINT IrradianceSHVersion = 1;
+//the clamped cosine's band factors over pi, 1, 2/3 and 1/4, times the square of each basis function's constant.
+//Turns sums of radiance times the basis polynomials into coefficients of irradiance over pi
+static const float CoefficientScales[IRRADIANCE_SH_COEFFICIENTS] =
+{
+	1.0f / (4.0f * XM_PI),
+	1.0f / (2.0f * XM_PI), 1.0f / (2.0f * XM_PI), 1.0f / (2.0f * XM_PI),
+	15.0f / (16.0f * XM_PI), 15.0f / (16.0f * XM_PI), 5.0f / (64.0f * XM_PI), 15.0f / (16.0f * XM_PI), 15.0f / (64.0f * XM_PI)
+};
+//keeps the benchmark loops from being optimized out
+static volatile float benchmarkSink;
+
+static UINT64 HashFile(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	UINT64 hash = 14695981039346656037ull;
+	for (char byte : bytes)
+	{
+		hash = (hash ^ (UINT8)byte) * 1099511628211ull;
+	}
+	return hash;
+}
+
+//runs rows 0 to rowCount on the workers, worker 0 being the caller
+static void ForEachRow(UINT rowCount, UINT workerCount, const std::function<void(UINT row)>& rowFunction)
+{
+	auto work = [rowCount, workerCount, &rowFunction](UINT worker)
+	{
+		for (UINT row = worker; row < rowCount; row += workerCount)
+		{
+			rowFunction(row);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (UINT w = 1; w < std::min(workerCount, rowCount); w++)
+	{
+		workers.emplace_back(work, w);
+	}
+	work(0);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+//1, y, z, x, xy, yz, 3z^2 - 1, xz and x^2 - y^2, the basis without its constants
+static void BasisPolynomials(const Vector3& direction, float polynomials[IRRADIANCE_SH_COEFFICIENTS])
+{
+	polynomials[0] = 1.0f;
+	polynomials[1] = direction.y;
+	polynomials[2] = direction.z;
+	polynomials[3] = direction.x;
+	polynomials[4] = direction.x * direction.y;
+	polynomials[5] = direction.y * direction.z;
+	polynomials[6] = 3.0f * direction.z * direction.z - 1.0f;
+	polynomials[7] = direction.x * direction.z;
+	polynomials[8] = direction.x * direction.x - direction.y * direction.y;
+}
+
+//DirectionToLatLongUV in Utils.hlsli
+static void DirectionToLatLongUV(const Vector3& direction, float& u, float& v)
+{
+	float theta = acosf(std::clamp(direction.y, -1.0f, 1.0f));
+	float phi = atan2f(direction.z, -direction.x);
+	u = (XM_PI + phi) / XM_2PI;
+	v = theta / XM_PI;
+}
+
+//the inverse of DirectionToLatLongUV
+static Vector3 LatLongDirection(float u, float v)
+{
+	float theta = XM_PI * v;
+	float phi = XM_2PI * u - XM_PI;
+	return Vector3(-sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+}
+
+IrradianceSH::IrradianceSH()
+{
+	ZeroMemory(&data, sizeof(data));
+	sourceHash = 0;
+	projectTime = 0.0;
+}
+
+IrradianceSH::~IrradianceSH()
+{
+}
+
+void IrradianceSH::Project(const float* pixels, UINT width, UINT height, UINT workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//cos phi, sin phi, cos 2 phi and sin 2 phi at the centre of every column, the same on all rows
+	std::vector<XMFLOAT4> columnPhis(width);
+	for (UINT x = 0; x < width; x++)
+	{
+		float phi = XM_2PI * (x + 0.5f) / width - XM_PI;
+		columnPhis[x] = XMFLOAT4(cosf(phi), sinf(phi), cosf(2.0f * phi), sinf(2.0f * phi));
+	}
+
+	//every row's sums of radiance times the polynomials over the solid angle, added up in row order after so the
+	//coefficients don't depend on the worker count
+	std::vector<XMFLOAT4> rowSums((size_t)height * IRRADIANCE_SH_COEFFICIENTS);
+	ForEachRow(height, workerCount, [&](UINT y)
+	{
+		//along a row only phi changes, so the polynomials at (-sin theta cos phi, cos theta, sin theta sin phi) only
+		//need the row's radiance times 1, cos phi, sin phi, cos 2 phi and sin 2 phi
+		XMVECTOR sum = XMVectorZero();
+		XMVECTOR cosSum = XMVectorZero();
+		XMVECTOR sinSum = XMVectorZero();
+		XMVECTOR cos2Sum = XMVectorZero();
+		XMVECTOR sin2Sum = XMVectorZero();
+		const XMFLOAT4* row = reinterpret_cast<const XMFLOAT4*>(pixels) + (size_t)y * width;
+		for (UINT x = 0; x < width; x++)
+		{
+			XMVECTOR radiance = XMLoadFloat4(&row[x]);
+			XMVECTOR phis = XMLoadFloat4(&columnPhis[x]);
+			sum = XMVectorAdd(sum, radiance);
+			cosSum = XMVectorMultiplyAdd(radiance, XMVectorSplatX(phis), cosSum);
+			sinSum = XMVectorMultiplyAdd(radiance, XMVectorSplatY(phis), sinSum);
+			cos2Sum = XMVectorMultiplyAdd(radiance, XMVectorSplatZ(phis), cos2Sum);
+			sin2Sum = XMVectorMultiplyAdd(radiance, XMVectorSplatW(phis), sin2Sum);
+		}
+
+		float theta = XM_PI * (y + 0.5f) / height;
+		float s = sinf(theta);
+		float c = cosf(theta);
+		//every texel of a row covers the same solid angle
+		float solidAngle = (XM_2PI / width) * (XM_PI / height) * s;
+		XMVECTOR polynomialSums[IRRADIANCE_SH_COEFFICIENTS] =
+		{
+			sum,
+			XMVectorScale(sum, c),
+			XMVectorScale(sinSum, s),
+			XMVectorScale(cosSum, -s),
+			XMVectorScale(cosSum, -s * c),
+			XMVectorScale(sinSum, s * c),
+			XMVectorSubtract(XMVectorScale(sum, 1.5f * s * s - 1.0f), XMVectorScale(cos2Sum, 1.5f * s * s)),
+			XMVectorScale(sin2Sum, -0.5f * s * s),
+			XMVectorAdd(XMVectorScale(sum, 0.5f * s * s - c * c), XMVectorScale(cos2Sum, 0.5f * s * s))
+		};
+		for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+		{
+			XMStoreFloat4(&rowSums[(size_t)y * IRRADIANCE_SH_COEFFICIENTS + k], XMVectorScale(polynomialSums[k], solidAngle));
+		}
+	});
+
+	for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+	{
+		double red = 0.0;
+		double green = 0.0;
+		double blue = 0.0;
+		for (UINT y = 0; y < height; y++)
+		{
+			const XMFLOAT4& rowSum = rowSums[(size_t)y * IRRADIANCE_SH_COEFFICIENTS + k];
+			red += rowSum.x;
+			green += rowSum.y;
+			blue += rowSum.z;
+		}
+		data.coefficients[k] = Vector4((float)(red * CoefficientScales[k]), (float)(green * CoefficientScales[k]), (float)(blue * CoefficientScales[k]), 0.0f);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	projectTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool IrradianceSH::Load(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != IrradianceSHMagic || header[1] != IrradianceSHVersion)
+		return false;
+
+	sourceHash = (UINT64)header[2] | ((UINT64)header[3] << 32);
+	file.read(reinterpret_cast<char*>(&data), sizeof(data));
+	projectTime = 0.0;
+	return file.good();
+}
+
+bool IrradianceSH::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = { IrradianceSHMagic, IrradianceSHVersion, (UINT)sourceHash, (UINT)(sourceHash >> 32) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&data), sizeof(data));
+	return file.good();
+}
+
+void IrradianceSH::LoadOrProject(const std::filesystem::path& cacheFile, const std::filesystem::path& environmentFile)
+{
+	UINT64 hash = HashFile(environmentFile);
+	if (Load(cacheFile) && sourceHash == hash)
+		return;
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	float* pixels = ReadHDR(environmentFile.c_str(), &width, &height);
+	if (pixels == nullptr)
+		throw std::logic_error("Couldn't read the environment map");
+
+	Project(pixels, width, height);
+	delete[] pixels;
+	sourceHash = hash;
+	Save(cacheFile);
+}
+
+Vector3 IrradianceSH::Evaluate(const Vector3& normal)
+{
+	float polynomials[IRRADIANCE_SH_COEFFICIENTS];
+	BasisPolynomials(normal, polynomials);
+
+	Vector3 irradiance(0.0f, 0.0f, 0.0f);
+	for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+	{
+		irradiance += Vector3(data.coefficients[k].x, data.coefficients[k].y, data.coefficients[k].z) * polynomials[k];
+	}
+	//ringing can take bands 0 to 2 below zero opposite a bright sun, the shaders clamp the same way
+	return Vector3::Max(irradiance, Vector3(0.0f, 0.0f, 0.0f));
+}
+
+const IrradianceSHData& IrradianceSH::GetData()
+{
+	return data;
+}
+
+double IrradianceSH::GetProjectTime()
+{
+	return projectTime;
+}
+
+//the projection the obvious way, the basis evaluated at every texel's direction and summed in doubles
+static IrradianceSHData ProjectPerTexel(const float* pixels, UINT width, UINT height)
+{
+	double sums[IRRADIANCE_SH_COEFFICIENTS][3] = {};
+	for (UINT y = 0; y < height; y++)
+	{
+		float solidAngle = (XM_2PI / width) * (XM_PI / height) * sinf(XM_PI * (y + 0.5f) / height);
+		for (UINT x = 0; x < width; x++)
+		{
+			float polynomials[IRRADIANCE_SH_COEFFICIENTS];
+			BasisPolynomials(LatLongDirection((x + 0.5f) / width, (y + 0.5f) / height), polynomials);
+			const float* radiance = &pixels[((size_t)y * width + x) * 4];
+			for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+			{
+				for (UINT c = 0; c < 3; c++)
+				{
+					sums[k][c] += (double)radiance[c] * polynomials[k] * solidAngle;
+				}
+			}
+		}
+	}
+
+	IrradianceSHData projected;
+	for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+	{
+		projected.coefficients[k] = Vector4((float)(sums[k][0] * CoefficientScales[k]), (float)(sums[k][1] * CoefficientScales[k]), (float)(sums[k][2] * CoefficientScales[k]), 0.0f);
+	}
+	return projected;
+}
+
+//bilinear tap of a lat long map, u wrapping and v clamping like the skybox's sampler
+static Vector3 SampleLatLong(const float* pixels, UINT width, UINT height, float u, float v)
+{
+	float x = u * width - 0.5f;
+	float y = std::clamp(v * height - 0.5f, 0.0f, (float)(height - 1));
+	float x0 = floorf(x);
+	float y0 = floorf(y);
+	float fx = x - x0;
+	float fy = y - y0;
+	UINT left = (UINT)(((int)x0 % (int)width + (int)width) % (int)width);
+	UINT right = (left + 1) % width;
+	UINT top = (UINT)y0;
+	UINT bottom = std::min(top + 1, height - 1);
+
+	auto texel = [&](UINT column, UINT row)
+	{
+		const float* radiance = &pixels[((size_t)row * width + column) * 4];
+		return Vector3(radiance[0], radiance[1], radiance[2]);
+	};
+	return (texel(left, top) * (1.0f - fx) + texel(right, top) * fx) * (1.0f - fy) + (texel(left, bottom) * (1.0f - fx) + texel(right, bottom) * fx) * fy;
+}
+
+//IrradianceMapPS's sum for one normal before its 2.2 curve, with bilinear taps of the top mip where the shader let
+//the derivatives pick one
+static Vector3 IrradianceMapIntegral(const float* pixels, UINT width, UINT height, const Vector3& normal)
+{
+	Vector3 up(0.0f, 1.0f, 0.0f);
+	Vector3 right = up.Cross(normal);
+	right.Normalize();
+	up = normal.Cross(right);
+	up.Normalize();
+
+	Vector3 irradiance(0.0f, 0.0f, 0.0f);
+	float sampleCount = 0.0f;
+	for (float phi = 0.0f; phi < 2.0f * XM_PI; phi += 0.025f)
+	{
+		for (float theta = 0.0f; theta < XM_PI * 0.5f; theta += 0.025f)
+		{
+			Vector3 direction = right * (sinf(theta) * cosf(phi)) + up * (sinf(theta) * sinf(phi)) + normal * cosf(theta);
+			direction.Normalize();
+			float u, v;
+			DirectionToLatLongUV(direction, u, v);
+			irradiance += SampleLatLong(pixels, width, height, u, v) * (sinf(theta) * cosf(theta));
+			sampleCount++;
+		}
+	}
+	return irradiance * (XM_PI / sampleCount);
+}
+
+//the normal of a cube face texel, the way IrradianceMapPS picked it from the full screen triangle's uv
+static Vector3 CubeFaceNormal(UINT face, float u, float v)
+{
+	float x = u * 2.0f - 1.0f;
+	float y = v * 2.0f - 1.0f;
+	Vector3 normal;
+	switch (face)
+	{
+	default:
+	case 0: normal = Vector3(1.0f, -y, -x); break;
+	case 1: normal = Vector3(-1.0f, -y, x); break;
+	case 2: normal = Vector3(x, 1.0f, y); break;
+	case 3: normal = Vector3(x, -1.0f, -y); break;
+	case 4: normal = Vector3(x, -y, 1.0f); break;
+	case 5: normal = Vector3(-x, -y, -1.0f); break;
+	}
+	normal.Normalize();
+	return normal;
+}
+
+static float Sum(const Vector3& value)
+{
+	return value.x + value.y + value.z;
+}
+
+static float AbsoluteSum(const Vector3& value)
+{
+	return fabsf(value.x) + fabsf(value.y) + fabsf(value.z);
+}
+
+void ValidateIrradianceSH(const std::filesystem::path& environmentFile)
+{
+	printf("Irradiance spherical harmonics\n");
+	bool passed = true;
+
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	auto randomDirection = [&]()
+	{
+		Vector3 direction;
+		do
+		{
+			direction = Vector3(distribution(generator), distribution(generator), distribution(generator));
+		} while (direction.LengthSquared() > 1.0f || direction.LengthSquared() < 0.01f);
+		direction.Normalize();
+		return direction;
+	};
+
+	float largestDirectionError = 0.0f;
+	for (UINT i = 0; i < 1000; i++)
+	{
+		Vector3 direction = randomDirection();
+		float u, v;
+		DirectionToLatLongUV(direction, u, v);
+		largestDirectionError = std::max(largestDirectionError, (LatLongDirection(u, v) - direction).Length());
+	}
+	Check(passed, "texel directions invert DirectionToLatLongUV", largestDirectionError < 1e-4f);
+
+	//radiance constant, linear and quadratic in the cosine to an axis. Their irradiance over pi is the constant,
+	//1 + cos / 3 for 1 + cos / 2, and (1 + cos^2) / 4 for cos^2, each channel scaled by the tint
+	const UINT width = 512;
+	const UINT height = 256;
+	const Vector3 tint(1.0f, 0.5f, 0.25f);
+	Vector3 axis(0.3f, 0.8f, -0.52f);
+	axis.Normalize();
+	std::vector<float> environments[3];
+	for (std::vector<float>& environment : environments)
+	{
+		environment.resize((size_t)width * height * 4);
+	}
+	for (UINT y = 0; y < height; y++)
+	{
+		for (UINT x = 0; x < width; x++)
+		{
+			float cosine = LatLongDirection((x + 0.5f) / width, (y + 0.5f) / height).Dot(axis);
+			float radiances[3] = { 1.0f, 1.0f + 0.5f * cosine, cosine * cosine };
+			for (UINT e = 0; e < 3; e++)
+			{
+				float* texel = &environments[e][((size_t)y * width + x) * 4];
+				texel[0] = radiances[e] * tint.x;
+				texel[1] = radiances[e] * tint.y;
+				texel[2] = radiances[e] * tint.z;
+				texel[3] = 1.0f;
+			}
+		}
+	}
+
+	const char* analyticNames[3] = { "constant radiance", "linear radiance", "quadratic radiance" };
+	for (UINT e = 0; e < 3; e++)
+	{
+		IrradianceSH analytic;
+		analytic.Project(environments[e].data(), width, height);
+		float largestError = 0.0f;
+		for (UINT i = 0; i < 256; i++)
+		{
+			Vector3 normal = randomDirection();
+			float cosine = normal.Dot(axis);
+			float expected[3] = { 1.0f, 1.0f + cosine / 3.0f, 0.25f * (1.0f + cosine * cosine) };
+			largestError = std::max(largestError, AbsoluteSum(analytic.Evaluate(normal) - tint * expected[e]) / Sum(tint * expected[e]));
+		}
+		printf("    %s: largest relative error %.2e\n", analyticNames[e], largestError);
+		Check(passed, analyticNames[e], largestError < 1e-3f);
+	}
+
+	//a bright sun over noise, the row sums against the basis at every texel
+	std::vector<float> noise((size_t)width * height * 4);
+	for (UINT y = 0; y < height; y++)
+	{
+		for (UINT x = 0; x < width; x++)
+		{
+			float* texel = &noise[((size_t)y * width + x) * 4];
+			bool sun = ((int)x - 100) * ((int)x - 100) + ((int)y - 60) * ((int)y - 60) < 36;
+			for (UINT c = 0; c < 3; c++)
+			{
+				texel[c] = (sun ? 400.0f : 0.0f) + (distribution(generator) + 1.0f) * (c + 1.0f);
+			}
+			texel[3] = 1.0f;
+		}
+	}
+	IrradianceSH projected;
+	projected.Project(noise.data(), width, height);
+	IrradianceSHData perTexel = ProjectPerTexel(noise.data(), width, height);
+	float largestCoefficientError = 0.0f;
+	for (UINT k = 0; k < IRRADIANCE_SH_COEFFICIENTS; k++)
+	{
+		Vector4 difference = projected.GetData().coefficients[k] - perTexel.coefficients[k];
+		largestCoefficientError = std::max(largestCoefficientError, std::max({ fabsf(difference.x) / perTexel.coefficients[0].x,
+			fabsf(difference.y) / perTexel.coefficients[0].y, fabsf(difference.z) / perTexel.coefficients[0].z }));
+	}
+	printf("    row sums against per texel: largest difference %.2e of the dc term\n", largestCoefficientError);
+	Check(passed, "row sums match the per texel projection", largestCoefficientError < 1e-4f);
+
+	IrradianceSH serial;
+	serial.Project(noise.data(), width, height, 1);
+	IrradianceSH threaded;
+	threaded.Project(noise.data(), width, height, 7);
+	Check(passed, "same coefficients on any worker count", memcmp(&serial.GetData(), &threaded.GetData(), sizeof(IrradianceSHData)) == 0);
+
+	std::filesystem::path roundTripFile = std::filesystem::temp_directory_path() / "irradiance_sh_validation.bin";
+	IrradianceSH reloaded;
+	bool roundTrip = projected.Save(roundTripFile) && reloaded.Load(roundTripFile) && memcmp(&reloaded.GetData(), &projected.GetData(), sizeof(IrradianceSHData)) == 0;
+	std::error_code error;
+	std::filesystem::remove(roundTripFile, error);
+	Check(passed, "save and load round trip", roundTrip);
+
+	//the irradiance map this replaces at every eighth texel of its 64x64 faces, and both against the cosine integral
+	//over every texel of the hdr. The map's 0.025 radian steps alias a sun a few texels wide, so on skies with one
+	//the map is the one that's off
+	unsigned int environmentWidth = 0;
+	unsigned int environmentHeight = 0;
+	float* pixels = ReadHDR(environmentFile.c_str(), &environmentWidth, &environmentHeight);
+	if (pixels != nullptr)
+	{
+		IrradianceSH environment;
+		environment.Project(pixels, environmentWidth, environmentHeight);
+		printf("    %s, %ux%u, projected in %.1f ms\n", environmentFile.filename().string().c_str(), environmentWidth, environmentHeight, environment.GetProjectTime());
+
+		//direction and solid angle over pi of every texel
+		std::vector<Vector4> texelDirections((size_t)environmentWidth * environmentHeight);
+		for (UINT y = 0; y < environmentHeight; y++)
+		{
+			float solidAngle = (XM_2PI / environmentWidth) * (XM_PI / environmentHeight) * sinf(XM_PI * (y + 0.5f) / environmentHeight);
+			for (UINT x = 0; x < environmentWidth; x++)
+			{
+				Vector3 direction = LatLongDirection((x + 0.5f) / environmentWidth, (y + 0.5f) / environmentHeight);
+				texelDirections[(size_t)y * environmentWidth + x] = Vector4(direction.x, direction.y, direction.z, solidAngle / XM_PI);
+			}
+		}
+
+		const UINT faceSize = 64;
+		const UINT stride = 8;
+		const UINT faceTexels = faceSize / stride;
+		std::vector<Vector3> normals(6 * faceTexels * faceTexels);
+		std::vector<Vector3> irradianceMap(normals.size());
+		std::vector<Vector3> exact(normals.size());
+		ForEachRow(6 * faceTexels, std::max(std::thread::hardware_concurrency(), 1u), [&](UINT row)
+		{
+			UINT face = row / faceTexels;
+			UINT y = row % faceTexels;
+			for (UINT x = 0; x < faceTexels; x++)
+			{
+				size_t i = (size_t)row * faceTexels + x;
+				normals[i] = CubeFaceNormal(face, (x * stride + stride / 2 + 0.5f) / faceSize, (y * stride + stride / 2 + 0.5f) / faceSize);
+				irradianceMap[i] = IrradianceMapIntegral(pixels, environmentWidth, environmentHeight, normals[i]);
+				exact[i] = Vector3(0.0f, 0.0f, 0.0f);
+				for (size_t t = 0; t < texelDirections.size(); t++)
+				{
+					const Vector4& texel = texelDirections[t];
+					float cosine = texel.x * normals[i].x + texel.y * normals[i].y + texel.z * normals[i].z;
+					if (cosine > 0.0f)
+						exact[i] += Vector3(pixels[t * 4], pixels[t * 4 + 1], pixels[t * 4 + 2]) * (cosine * texel.w);
+				}
+			}
+		});
+
+		//errors relative to the face's mean so the dark side of a sun lit sky doesn't dominate
+		float worstMapMean = 0.0f;
+		float worstExactMean = 0.0f;
+		float worstExactLargest = 0.0f;
+		for (UINT face = 0; face < 6; face++)
+		{
+			size_t first = (size_t)face * faceTexels * faceTexels;
+			size_t count = (size_t)faceTexels * faceTexels;
+			double faceIrradiance = 0.0;
+			for (size_t i = first; i < first + count; i++)
+			{
+				faceIrradiance += Sum(exact[i]) / count;
+			}
+			double mapError = 0.0;
+			double exactError = 0.0;
+			double mapExactError = 0.0;
+			float largest = 0.0f;
+			for (size_t i = first; i < first + count; i++)
+			{
+				Vector3 irradiance = environment.Evaluate(normals[i]);
+				float relative = (float)(AbsoluteSum(irradiance - exact[i]) / faceIrradiance);
+				mapError += AbsoluteSum(irradiance - irradianceMap[i]) / faceIrradiance / count;
+				exactError += relative / count;
+				mapExactError += AbsoluteSum(irradianceMap[i] - exact[i]) / faceIrradiance / count;
+				largest = std::max(largest, relative);
+			}
+			printf("    face %u: %.2f%% from the irradiance map, %.2f%% from the integral (largest %.2f%%), the map %.2f%% from it\n", face,
+				mapError * 100.0, exactError * 100.0, largest * 100.0f, mapExactError * 100.0);
+			worstMapMean = std::max(worstMapMean, (float)mapError);
+			worstExactMean = std::max(worstExactMean, (float)exactError);
+			worstExactLargest = std::max(worstExactLargest, largest);
+		}
+		delete[] pixels;
+		Check(passed, "within 3% of the irradiance map on average", worstMapMean < 0.03f);
+		Check(passed, "within 3% of the integral on average", worstExactMean < 0.03f);
+		Check(passed, "within 10% of the integral everywhere", worstExactLargest < 0.1f);
+	}
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkIrradianceSH(const std::filesystem::path& environmentFile)
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	float* pixels = ReadHDR(environmentFile.c_str(), &width, &height);
+	std::vector<float> standIn;
+	if (pixels == nullptr)
+	{
+		//a stand in of the same size as skybox5.hdr
+		width = 1024;
+		height = 512;
+		standIn.resize((size_t)width * height * 4);
+		std::mt19937 generator(3);
+		std::uniform_real_distribution<float> distribution(0.0f, 4.0f);
+		for (float& value : standIn)
+		{
+			value = distribution(generator);
+		}
+	}
+	const float* source = pixels != nullptr ? pixels : standIn.data();
+
+	UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	IrradianceSH irradianceSH;
+	irradianceSH.Project(source, width, height, 1);
+	double serialTime = irradianceSH.GetProjectTime();
+	irradianceSH.Project(source, width, height, threadCount);
+	printf("Irradiance spherical harmonics, %ux%u\n", width, height);
+	printf("  projection: %.2f ms on 1 thread, %.2f ms on %u, %.0f Mtexels/s\n", serialTime, irradianceSH.GetProjectTime(), threadCount,
+		(double)width * height / (irradianceSH.GetProjectTime() * 1000.0));
+
+	auto start = std::chrono::high_resolution_clock::now();
+	IrradianceSHData perTexel = ProjectPerTexel(source, width, height);
+	auto end = std::chrono::high_resolution_clock::now();
+	benchmarkSink = perTexel.coefficients[0].x;
+	printf("  per texel projection: %.2f ms on 1 thread\n", std::chrono::duration<double, std::milli>(end - start).count());
+
+	std::filesystem::path cacheFile = std::filesystem::temp_directory_path() / "irradiance_sh_benchmark.bin";
+	irradianceSH.Save(cacheFile);
+	start = std::chrono::high_resolution_clock::now();
+	IrradianceSH loaded;
+	bool load = loaded.Load(cacheFile);
+	UINT64 hash = HashFile(environmentFile);
+	end = std::chrono::high_resolution_clock::now();
+	benchmarkSink = load ? (float)hash : 0.0f;
+	std::error_code error;
+	std::filesystem::remove(cacheFile, error);
+	printf("  cached start: %.2f ms to load and hash the hdr\n", std::chrono::duration<double, std::milli>(end - start).count());
+
+	delete[] pixels;
+}
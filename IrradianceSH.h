@@ -0,0 +1,49 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+
+//bands 0 to 2 of the real spherical harmonics, what EvaluateIrradianceSH in SphericalHarmonics.hlsli sums
+#define IRRADIANCE_SH_COEFFICIENTS 9
+
+//the pbr shaders' irradianceSH constant buffer. Rgb in xyz, already convolved with the clamped cosine, divided by pi
+//and multiplied by the basis constants so the shaders only evaluate the polynomials
+struct IrradianceSHData
+{
+	Vector4 coefficients[IRRADIANCE_SH_COEFFICIENTS];
+};
+
+//the diffuse image based lighting of an environment map as 9 rgb spherical harmonics coefficients, standing in for
+//the 64x64 irradiance cube map the engine used to render. Projected from the lat long hdr the skybox samples
+class IrradianceSH
+{
+	IrradianceSHData data;
+	//hash of the hdr file the coefficients were projected from, a changed file projects again
+	UINT64 sourceHash;
+	double projectTime;
+
+public:
+	IrradianceSH();
+	~IrradianceSH();
+
+	//pixels are rgba floats of a lat long map laid out like DirectionToLatLongUV, as ReadHDR returns them. Every row
+	//is reduced to five sums over phi with simd and the rows are split between the workers
+	void Project(const float* pixels, UINT width, UINT height, UINT workerCount = 0);
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+	//loads the coefficients projected from this hdr, projecting and saving them when there aren't any or the hdr
+	//changed
+	void LoadOrProject(const std::filesystem::path& cacheFile, const std::filesystem::path& environmentFile);
+
+	//irradiance over pi at a unit normal, what the irradiance map held before the shaders' 2.2 curve
+	Vector3 Evaluate(const Vector3& normal);
+	const IrradianceSHData& GetData();
+	double GetProjectTime();
+};
+
+//the projection against the per texel sums and analytic environments, the save and load round trip, and when the hdr
+//loads the coefficients against the irradiance map's integral and the exact one for normals of every face
+void ValidateIrradianceSH(const std::filesystem::path& environmentFile = "../../Assets/Textures/skybox5.hdr");
+
+//projecting on one and all threads and per texel, against loading the cache
+void BenchmarkIrradianceSH(const std::filesystem::path& environmentFile = "../../Assets/Textures/skybox5.hdr");
@@ -0,0 +1,743 @@
+#include "LTCTable.h"
+#include"Validation.h"
+#include<DirectXPackedVector.h>
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<thread>
+
+static const UINT LUTMagic = 0x4C43544C;
+static const UINT LUTVersion = 1;
+static const UINT LUTTableCount = 2;
+static const UINT LUTTexels = LTC_LUT_SIZE * LTC_LUT_SIZE;
+//samples a side of the grids the fit integrates over, fitLTC's Nsample
+static const UINT FitSamples = 32;
+//smallest ggx alpha the fit uses, a zero roughness lobe is a delta
+static const float MinAlpha = 0.00001f;
+static const float Pi = 3.14159265f;
+//keeps the benchmark loops from being optimized out
+static volatile float benchmarkSink;
+
+//row major, m[row][column]
+struct LTCMatrix
+{
+	float m[3][3];
+};
+
+static LTCMatrix MultiplyMatrices(const LTCMatrix& a, const LTCMatrix& b)
+{
+	LTCMatrix result = {};
+	for (UINT row = 0; row < 3; row++)
+	{
+		for (UINT column = 0; column < 3; column++)
+		{
+			result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] + a.m[row][2] * b.m[2][column];
+		}
+	}
+	return result;
+}
+
+static float Determinant(const LTCMatrix& a)
+{
+	return a.m[0][0] * (a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1])
+		- a.m[0][1] * (a.m[1][0] * a.m[2][2] - a.m[1][2] * a.m[2][0])
+		+ a.m[0][2] * (a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0]);
+}
+
+static LTCMatrix InverseMatrix(const LTCMatrix& a)
+{
+	float inverseDeterminant = 1.0f / Determinant(a);
+	LTCMatrix result;
+	for (UINT row = 0; row < 3; row++)
+	{
+		for (UINT column = 0; column < 3; column++)
+		{
+			//the cofactor of the transposed entry
+			UINT r0 = (column + 1) % 3, r1 = (column + 2) % 3;
+			UINT c0 = (row + 1) % 3, c1 = (row + 2) % 3;
+			result.m[row][column] = (a.m[r0][c0] * a.m[r1][c1] - a.m[r0][c1] * a.m[r1][c0]) * inverseDeterminant;
+		}
+	}
+	return result;
+}
+
+static Vector3 Transform(const LTCMatrix& a, const Vector3& v)
+{
+	return Vector3(a.m[0][0] * v.x + a.m[0][1] * v.y + a.m[0][2] * v.z,
+		a.m[1][0] * v.x + a.m[1][1] * v.y + a.m[1][2] * v.z,
+		a.m[2][0] * v.x + a.m[2][1] * v.y + a.m[2][2] * v.z);
+}
+
+static float GGXLambda(float cosTheta, float alpha)
+{
+	if (cosTheta >= 1.0f)
+		return 0.0f;
+	float a = 1.0f / (alpha * tanf(acosf(cosTheta)));
+	return 0.5f * (-1.0f + sqrtf(1.0f + 1.0f / (a * a)));
+}
+
+//ggx with height correlated shadowing times the cosine, the specular the pbr shaders integrate. pdf is that of
+//SampleGGX's directions
+static float EvaluateGGX(const Vector3& view, const Vector3& light, float alpha, float& pdf)
+{
+	pdf = 0.0f;
+	if (view.z <= 0.0f)
+		return 0.0f;
+
+	float shadowing = light.z > 0.0f ? 1.0f / (1.0f + GGXLambda(view.z, alpha) + GGXLambda(light.z, alpha)) : 0.0f;
+
+	Vector3 half = view + light;
+	half.Normalize();
+	float slopeX = half.x / half.z;
+	float slopeY = half.y / half.z;
+	float d = 1.0f / (1.0f + (slopeX * slopeX + slopeY * slopeY) / (alpha * alpha));
+	d = d * d / (Pi * alpha * alpha * half.z * half.z * half.z * half.z);
+
+	pdf = fabsf(d * half.z / (4.0f * view.Dot(half)));
+	return d * shadowing / (4.0f * view.z);
+}
+
+static Vector3 SampleGGX(const Vector3& view, float alpha, float u1, float u2)
+{
+	float phi = 2.0f * Pi * u1;
+	float r = alpha * sqrtf(u2 / (1.0f - u2));
+	Vector3 half(r * cosf(phi), r * sinf(phi), 1.0f);
+	half.Normalize();
+	return -view + half * (2.0f * half.Dot(view));
+}
+
+//a clamped cosine through the matrix m, scaled by magnitude. The matrix is built from the frame x, y, z and the
+//scales and skew the fit varies
+struct LTCLobe
+{
+	float magnitude;
+	float fresnel;
+	Vector3 x;
+	Vector3 y;
+	Vector3 z;
+	float m11;
+	float m22;
+	float m13;
+	LTCMatrix m;
+	LTCMatrix inverseM;
+	float determinant;
+
+	LTCLobe() : magnitude(1.0f), fresnel(1.0f), x(1, 0, 0), y(0, 1, 0), z(0, 0, 1), m11(1.0f), m22(1.0f), m13(0.0f)
+	{
+		Update();
+	}
+
+	void Update()
+	{
+		LTCMatrix frame = { { { x.x, y.x, z.x }, { x.y, y.y, z.y }, { x.z, y.z, z.z } } };
+		LTCMatrix scales = { { { m11, 0.0f, m13 }, { 0.0f, m22, 0.0f }, { 0.0f, 0.0f, 1.0f } } };
+		m = MultiplyMatrices(frame, scales);
+		inverseM = InverseMatrix(m);
+		determinant = fabsf(Determinant(m));
+	}
+
+	float Evaluate(const Vector3& light) const
+	{
+		Vector3 original = Transform(inverseM, light);
+		original.Normalize();
+		float length = Transform(m, original).Length();
+		float jacobian = determinant / (length * length * length);
+		return magnitude * std::max(original.z, 0.0f) / (Pi * jacobian);
+	}
+
+	Vector3 Sample(float u1, float u2) const
+	{
+		float theta = acosf(sqrtf(u1));
+		float phi = 2.0f * Pi * u2;
+		Vector3 light = Transform(m, Vector3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)));
+		light.Normalize();
+		return light;
+	}
+};
+
+//the ggx's albedo, the part of it schlick's (1 - v.h)^5 weights and its average direction
+static void ComputeAverageTerms(const Vector3& view, float alpha, float& magnitude, float& fresnel, Vector3& averageDirection)
+{
+	magnitude = 0.0f;
+	fresnel = 0.0f;
+	averageDirection = Vector3(0, 0, 0);
+	for (UINT j = 0; j < FitSamples; j++)
+	{
+		for (UINT i = 0; i < FitSamples; i++)
+		{
+			Vector3 light = SampleGGX(view, alpha, (i + 0.5f) / FitSamples, (j + 0.5f) / FitSamples);
+			float pdf;
+			float value = EvaluateGGX(view, light, alpha, pdf);
+			if (pdf > 0.0f)
+			{
+				float weight = value / pdf;
+				Vector3 half = view + light;
+				half.Normalize();
+				magnitude += weight;
+				fresnel += weight * powf(1.0f - std::max(view.Dot(half), 0.0f), 5.0f);
+				averageDirection += light * weight;
+			}
+		}
+	}
+	magnitude /= (float)(FitSamples * FitSamples);
+	fresnel /= (float)(FitSamples * FitSamples);
+	averageDirection.y = 0.0f;
+	averageDirection.Normalize();
+}
+
+//the cubed difference between the lobe and the ggx, sampling both and weighting by their pdfs
+static float ComputeFitError(const LTCLobe& lobe, const Vector3& view, float alpha)
+{
+	double error = 0.0;
+	auto addSample = [&](const Vector3& light)
+	{
+		float ggxPdf;
+		float ggx = EvaluateGGX(view, light, alpha, ggxPdf);
+		float ltc = lobe.Evaluate(light);
+		double difference = fabsf(ggx - ltc);
+		error += difference * difference * difference / (ltc / lobe.magnitude + ggxPdf);
+	};
+
+	for (UINT j = 0; j < FitSamples; j++)
+	{
+		for (UINT i = 0; i < FitSamples; i++)
+		{
+			float u1 = (i + 0.5f) / FitSamples;
+			float u2 = (j + 0.5f) / FitSamples;
+			addSample(lobe.Sample(u1, u2));
+			addSample(SampleGGX(view, alpha, u1, u2));
+		}
+	}
+	return (float)(error / (FitSamples * FitSamples));
+}
+
+//the mean absolute difference between the lobe and the ggx, against the ggx's albedo. What the validation compares
+//tables by, the fit's own error cubes the differences and isn't comparable between cells
+static float ComputeLobeError(const LTCLobe& lobe, const Vector3& view, float alpha)
+{
+	double difference = 0.0;
+	double albedo = 0.0;
+	for (UINT j = 0; j < FitSamples; j++)
+	{
+		for (UINT i = 0; i < FitSamples; i++)
+		{
+			float u1 = (i + 0.5f) / FitSamples;
+			float u2 = (j + 0.5f) / FitSamples;
+			const Vector3 lights[2] = { lobe.Sample(u1, u2), SampleGGX(view, alpha, u1, u2) };
+			for (const Vector3& light : lights)
+			{
+				float ggxPdf;
+				float ggx = EvaluateGGX(view, light, alpha, ggxPdf);
+				float ltc = lobe.Evaluate(light);
+				//balance heuristic over the two sample sets
+				float pdf = 0.5f * (ltc / lobe.magnitude + ggxPdf);
+				if (pdf > 0.0f)
+				{
+					difference += fabsf(ggx - ltc) / pdf;
+					albedo += ggx / pdf;
+				}
+			}
+		}
+	}
+	return albedo > 0.0 ? (float)(difference / albedo) : 0.0f;
+}
+
+//nelder mead over m11, m22 and m13, fitLTC's simplex with its coefficients
+static void FitLobe(LTCLobe& lobe, const Vector3& view, float alpha, bool isotropic)
+{
+	auto update = [&](const float* parameters)
+	{
+		lobe.m11 = std::max(parameters[0], 1e-7f);
+		lobe.m22 = isotropic ? lobe.m11 : std::max(parameters[1], 1e-7f);
+		lobe.m13 = isotropic ? 0.0f : parameters[2];
+		lobe.Update();
+	};
+	auto objective = [&](const float* parameters)
+	{
+		update(parameters);
+		return ComputeFitError(lobe, view, alpha);
+	};
+
+	const UINT dimensions = 3;
+	const UINT points = dimensions + 1;
+	const float delta = 0.05f;
+	const float tolerance = 1e-5f;
+	const UINT maxIterations = 100;
+
+	float simplex[points][dimensions];
+	float values[points];
+	for (UINT i = 0; i < points; i++)
+	{
+		simplex[i][0] = lobe.m11;
+		simplex[i][1] = lobe.m22;
+		simplex[i][2] = lobe.m13;
+		if (i > 0)
+			simplex[i][i - 1] += delta;
+	}
+	for (UINT i = 0; i < points; i++)
+	{
+		values[i] = objective(simplex[i]);
+	}
+
+	UINT lowest = 0;
+	for (UINT iteration = 0; iteration < maxIterations; iteration++)
+	{
+		UINT highest = 0, nextHighest = 0;
+		lowest = 0;
+		for (UINT i = 1; i < points; i++)
+		{
+			if (values[i] < values[lowest])
+				lowest = i;
+			if (values[i] > values[highest])
+			{
+				nextHighest = highest;
+				highest = i;
+			}
+			else if (values[i] > values[nextHighest])
+				nextHighest = i;
+		}
+
+		float low = fabsf(values[lowest]);
+		float high = fabsf(values[highest]);
+		if (2.0f * fabsf(low - high) < (low + high) * tolerance)
+			break;
+
+		float centroid[dimensions] = {};
+		for (UINT i = 0; i < points; i++)
+		{
+			if (i == highest)
+				continue;
+			for (UINT d = 0; d < dimensions; d++)
+			{
+				centroid[d] += simplex[i][d] / dimensions;
+			}
+		}
+
+		auto along = [&](float scale, float* point)
+		{
+			for (UINT d = 0; d < dimensions; d++)
+			{
+				point[d] = centroid[d] + scale * (centroid[d] - simplex[highest][d]);
+			}
+		};
+		auto replaceHighest = [&](const float* point, float value)
+		{
+			std::copy(point, point + dimensions, simplex[highest]);
+			values[highest] = value;
+		};
+
+		float reflected[dimensions];
+		along(1.0f, reflected);
+		float reflectedValue = objective(reflected);
+		if (reflectedValue < values[lowest])
+		{
+			float expanded[dimensions];
+			along(2.0f, expanded);
+			float expandedValue = objective(expanded);
+			if (expandedValue < reflectedValue)
+			{
+				replaceHighest(expanded, expandedValue);
+				continue;
+			}
+		}
+		if (reflectedValue < values[nextHighest])
+		{
+			replaceHighest(reflected, reflectedValue);
+			continue;
+		}
+
+		float contracted[dimensions];
+		along(-0.5f, contracted);
+		float contractedValue = objective(contracted);
+		if (contractedValue < values[highest])
+		{
+			replaceHighest(contracted, contractedValue);
+			continue;
+		}
+
+		for (UINT i = 0; i < points; i++)
+		{
+			if (i == lowest)
+				continue;
+			for (UINT d = 0; d < dimensions; d++)
+			{
+				simplex[i][d] = simplex[lowest][d] + 0.5f * (simplex[i][d] - simplex[lowest][d]);
+			}
+			values[i] = objective(simplex[i]);
+		}
+	}
+
+	update(simplex[lowest]);
+}
+
+static float CellAlpha(UINT roughnessIndex)
+{
+	float roughness = roughnessIndex / (float)(LTC_LUT_SIZE - 1);
+	return std::max(roughness * roughness, MinAlpha);
+}
+
+//rows are parameterised by sqrt(1 - cos theta), the last one stopping just short of grazing
+static Vector3 CellView(UINT thetaIndex)
+{
+	float x = thetaIndex / (float)(LTC_LUT_SIZE - 1);
+	float theta = std::min(1.57f, acosf(1.0f - x * x));
+	return Vector3(sinf(theta), 0.0f, cosf(theta));
+}
+
+//fits the cell from the lobe it holds, normal incidence ones are isotropic around z
+static void FitCell(LTCLobe& lobe, UINT roughnessIndex, UINT thetaIndex)
+{
+	float alpha = CellAlpha(roughnessIndex);
+	Vector3 view = CellView(thetaIndex);
+	Vector3 averageDirection;
+	ComputeAverageTerms(view, alpha, lobe.magnitude, lobe.fresnel, averageDirection);
+
+	if (thetaIndex == 0)
+	{
+		lobe.x = Vector3(1, 0, 0);
+		lobe.y = Vector3(0, 1, 0);
+		lobe.z = Vector3(0, 0, 1);
+		lobe.m13 = 0.0f;
+	}
+	else
+	{
+		lobe.x = Vector3(averageDirection.z, 0.0f, -averageDirection.x);
+		lobe.y = Vector3(0, 1, 0);
+		lobe.z = averageDirection;
+	}
+	lobe.Update();
+	FitLobe(lobe, view, alpha, thetaIndex == 0);
+}
+
+//the lobe a texel of table 0 and the magnitude of table 1 describe, the inverse of what the fit stores
+static LTCLobe TexelLobe(const Vector4& matrix, float magnitude)
+{
+	LTCLobe lobe;
+	lobe.inverseM = { { { matrix.x, 0.0f, matrix.z }, { 0.0f, 1.0f, 0.0f }, { matrix.y, 0.0f, matrix.w } } };
+	lobe.m = InverseMatrix(lobe.inverseM);
+	lobe.determinant = fabsf(Determinant(lobe.m));
+	lobe.magnitude = magnitude;
+	return lobe;
+}
+
+//the cosine weighted solid angle of a sphere of angular radius sigma above the horizon, at elevation omega from the
+//normal, Snyder's formula as fitLTC tabulates it
+static float ClippedSphereIntegral(float omega, float sigma)
+{
+	float sinSigmaSquared = sinf(sigma) * sinf(sigma);
+	if (omega <= Pi / 2.0f - sigma)
+		return Pi * cosf(omega) * sinSigmaSquared;
+	if (omega >= Pi / 2.0f + sigma)
+		return 0.0f;
+
+	float gamma = asinf(cosf(sigma) / sinf(omega));
+	float g = -2.0f * sinf(omega) * cosf(sigma) * cosf(gamma) + Pi / 2.0f - gamma + sinf(gamma) * cosf(gamma);
+	float cosGammaSquared = cosf(gamma) * cosf(gamma);
+	float h = cosf(omega) * (cosf(gamma) * sqrtf(std::max(sinSigmaSquared - cosGammaSquared, 0.0f)) + sinSigmaSquared * asinf(std::min(cosf(gamma) / sinf(sigma), 1.0f)));
+	if (omega < Pi / 2.0f)
+		return Pi * cosf(omega) * sinSigmaSquared + g - h;
+	return g + h;
+}
+
+//how much of the unclipped form factor is left, columns are the average direction's z from -1 to 1 and rows the
+//form factor's length
+static float SphereScale(UINT zIndex, UINT lengthIndex)
+{
+	float z = 2.0f * zIndex / (LTC_LUT_SIZE - 1) - 1.0f;
+	float length = lengthIndex / (float)(LTC_LUT_SIZE - 1);
+	if (length == 0.0f)
+		return std::max(z, 0.0f);
+	return ClippedSphereIntegral(acosf(z), asinf(sqrtf(length))) / (Pi * length);
+}
+
+LTCTable::LTCTable()
+{
+	fitTime = 0.0;
+}
+
+LTCTable::~LTCTable()
+{
+}
+
+void LTCTable::Fit(UINT workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	workerCount = std::min(workerCount, (UINT)LTC_LUT_SIZE);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//the normal incidence lobes start from the rougher one's, in order from roughness 1
+	std::vector<LTCLobe> lobes(LUTTexels);
+	LTCLobe lobe;
+	for (UINT a = LTC_LUT_SIZE; a-- > 0;)
+	{
+		FitCell(lobe, a, 0);
+		lobes[a] = lobe;
+	}
+
+	//every other lobe starts from the one before it at the same roughness
+	auto work = [&lobes, workerCount](UINT worker)
+	{
+		for (UINT a = worker; a < LTC_LUT_SIZE; a += workerCount)
+		{
+			LTCLobe lobe = lobes[a];
+			for (UINT t = 1; t < LTC_LUT_SIZE; t++)
+			{
+				FitCell(lobe, a, t);
+				lobes[t * LTC_LUT_SIZE + a] = lobe;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (UINT w = 1; w < workerCount; w++)
+	{
+		workers.emplace_back(work, w);
+	}
+	work(0);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	values.resize(LUTTableCount * LUTTexels * 4);
+	for (UINT t = 0; t < LTC_LUT_SIZE; t++)
+	{
+		for (UINT a = 0; a < LTC_LUT_SIZE; a++)
+		{
+			const LTCLobe& fitted = lobes[t * LTC_LUT_SIZE + a];
+			LTCMatrix inverseM = fitted.inverseM;
+			float scale = 1.0f / inverseM.m[1][1];
+			float texels[LUTTableCount][4] =
+			{
+				{ inverseM.m[0][0] * scale, inverseM.m[2][0] * scale, inverseM.m[0][2] * scale, inverseM.m[2][2] * scale },
+				{ fitted.magnitude, fitted.fresnel, 0.0f, SphereScale(a, t) }
+			};
+
+			size_t texel = (size_t)(LTC_LUT_SIZE - 1 - t) * LTC_LUT_SIZE + a;
+			for (UINT table = 0; table < LUTTableCount; table++)
+			{
+				for (UINT c = 0; c < 4; c++)
+				{
+					values[(table * LUTTexels + texel) * 4 + c] = DirectX::PackedVector::XMConvertFloatToHalf(texels[table][c]);
+				}
+			}
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	fitTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool LTCTable::Load(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != LUTMagic || header[1] != LUTVersion || header[2] != LTC_LUT_SIZE || header[3] != LUTTableCount)
+		return false;
+
+	values.resize(LUTTableCount * LUTTexels * 4);
+	file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(UINT16));
+	fitTime = 0.0;
+	return file.good();
+}
+
+bool LTCTable::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = { LUTMagic, LUTVersion, LTC_LUT_SIZE, LUTTableCount };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(UINT16));
+	return file.good();
+}
+
+void LTCTable::LoadOrFit(const std::filesystem::path& fileName)
+{
+	if (Load(fileName))
+		return;
+
+	Fit();
+	Save(fileName);
+}
+
+Vector4 LTCTable::GetValue(UINT table, UINT roughnessIndex, UINT thetaIndex)
+{
+	const UINT16* texel = &values[(table * LUTTexels + (LTC_LUT_SIZE - 1 - thetaIndex) * LTC_LUT_SIZE + roughnessIndex) * 4];
+	return Vector4(DirectX::PackedVector::XMConvertHalfToFloat(texel[0]), DirectX::PackedVector::XMConvertHalfToFloat(texel[1]),
+		DirectX::PackedVector::XMConvertHalfToFloat(texel[2]), DirectX::PackedVector::XMConvertHalfToFloat(texel[3]));
+}
+
+void LTCTable::CreateTexture(UINT table, ManagedResource& texture, ComPtr<ID3D12Resource>& uploadHeap)
+{
+	auto texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16B16A16_FLOAT, LTC_LUT_SIZE, LTC_LUT_SIZE, 1, 1);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().defaultHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(texture.resource.GetAddressOf())
+	));
+	texture.resource->SetName(table == 0 ? L"ltcLUT" : L"ltcLUT2");
+
+	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, 1);
+	auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(uploadHeap.GetAddressOf())
+	));
+
+	D3D12_SUBRESOURCE_DATA textureData = {};
+	textureData.pData = &values[table * LUTTexels * 4];
+	textureData.RowPitch = LTC_LUT_SIZE * 4 * sizeof(UINT16);
+	textureData.SlicePitch = textureData.RowPitch * LTC_LUT_SIZE;
+
+	UpdateSubresources<1>(GetAppResources().commandList.Get(), texture.resource.Get(), uploadHeap.Get(), 0, 0, 1, &textureData);
+
+	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	GetAppResources().commandList->ResourceBarrier(1, &transition);
+
+	texture.currentState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	texture.resourceType = RESOURCE_TYPE_SRV;
+}
+
+size_t LTCTable::GetSizeInBytes()
+{
+	return values.size() * sizeof(UINT16);
+}
+
+double LTCTable::GetFitTime()
+{
+	return fitTime;
+}
+
+//mean lobe error of a table over every other cell, skipping the grazing row whose lobes are mostly below the horizon
+static float MeanLobeError(LTCTable& table)
+{
+	double error = 0.0;
+	UINT cells = 0;
+	for (UINT t = 0; t < LTC_LUT_SIZE - 1; t += 2)
+	{
+		for (UINT a = 1; a < LTC_LUT_SIZE; a += 2)
+		{
+			LTCLobe lobe = TexelLobe(table.GetValue(0, a, t), table.GetValue(1, a, t).x);
+			error += ComputeLobeError(lobe, CellView(t), CellAlpha(a));
+			cells++;
+		}
+	}
+	return (float)(error / cells);
+}
+
+void ValidateLTCTable(const std::filesystem::path& lutFile)
+{
+	printf("LTC table\n");
+	bool passed = true;
+
+	LTCTable fitted;
+	fitted.Fit();
+	printf("    fitted in %.0f ms\n", fitted.GetFitTime());
+
+	LTCTable shipped;
+	bool loaded = shipped.Load(lutFile);
+	Check(passed, "shipped lut loads", loaded);
+	if (loaded)
+	{
+		//entry by entry, the channels being m00, m20, m02, m22, magnitude, fresnel and the sphere scale
+		const char* names[] = { "m00", "m20", "m02", "m22", "magnitude", "fresnel", "", "sphere" };
+		float largest[8] = {};
+		double mean[8] = {};
+		for (UINT t = 0; t < LTC_LUT_SIZE; t++)
+		{
+			for (UINT a = 0; a < LTC_LUT_SIZE; a++)
+			{
+				for (UINT table = 0; table < LUTTableCount; table++)
+				{
+					Vector4 difference = fitted.GetValue(table, a, t) - shipped.GetValue(table, a, t);
+					float channels[4] = { fabsf(difference.x), fabsf(difference.y), fabsf(difference.z), fabsf(difference.w) };
+					for (UINT c = 0; c < 4; c++)
+					{
+						largest[table * 4 + c] = std::max(largest[table * 4 + c], channels[c]);
+						mean[table * 4 + c] += channels[c] / LUTTexels;
+					}
+				}
+			}
+		}
+		for (UINT c = 0; c < 8; c++)
+		{
+			if (c != 6)
+				printf("    %-10s mean difference %.2e, largest %.2e\n", names[c], mean[c], largest[c]);
+		}
+		Check(passed, "magnitude and fresnel within 1%", largest[4] < 0.01f && largest[5] < 0.01f);
+		Check(passed, "sphere scale within half precision", largest[7] < 1e-3f);
+
+		//the matrices can differ where the fit's error surface is flat, what matters is how well the lobes match
+		float fittedError = MeanLobeError(fitted);
+		float shippedError = MeanLobeError(shipped);
+		printf("    mean lobe error against ggx %.4f fitted, %.4f shipped\n", fittedError, shippedError);
+		Check(passed, "fitted lobes as close to ggx as shipped", fittedError <= shippedError * 1.05f);
+	}
+
+	Vector4 mirror = fitted.GetValue(1, 0, 0);
+	Check(passed, "smooth normal incidence reflects everything", fabsf(mirror.x - 1.0f) < 1e-3f && mirror.y < 1e-3f);
+
+	std::filesystem::path roundTripFile = std::filesystem::temp_directory_path() / "ltc_validation.lut";
+	LTCTable reloaded;
+	bool roundTrip = fitted.Save(roundTripFile) && reloaded.Load(roundTripFile);
+	for (UINT t = 0; roundTrip && t < LTC_LUT_SIZE; t++)
+	{
+		for (UINT a = 0; a < LTC_LUT_SIZE; a++)
+		{
+			roundTrip = roundTrip && fitted.GetValue(0, a, t) == reloaded.GetValue(0, a, t) && fitted.GetValue(1, a, t) == reloaded.GetValue(1, a, t);
+		}
+	}
+	std::error_code error;
+	std::filesystem::remove(roundTripFile, error);
+	Check(passed, "save and load round trip", roundTrip);
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkLTCTable(const std::filesystem::path& lutFile)
+{
+	UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	LTCTable table;
+	table.Fit(1);
+	double serialTime = table.GetFitTime();
+	table.Fit(threadCount);
+	printf("LTC table, %ux%u\n", LTC_LUT_SIZE, LTC_LUT_SIZE);
+	printf("  fit: %.0f ms on 1 thread, %.0f ms on %u\n", serialTime, table.GetFitTime(), threadCount);
+
+	const UINT loads = 100;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (UINT i = 0; i < loads; i++)
+	{
+		LTCTable loaded;
+		if (!loaded.Load(lutFile))
+		{
+			printf("  no lut at %s\n", lutFile.string().c_str());
+			return;
+		}
+		benchmarkSink = loaded.GetValue(0, i % LTC_LUT_SIZE, 0).x;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	//LTC.h was two float4 tables of the same size defined in every translation unit including it
+	size_t floatTables = LUTTableCount * LUTTexels * 4 * sizeof(float);
+	printf("  load: %.3f ms, %.0f KB of halves against the %.0f KB of floats LTC.h compiled in\n",
+		std::chrono::duration<double, std::milli>(end - start).count() / loads, table.GetSizeInBytes() / 1024.0, floatTables / 1024.0);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+#include<vector>
+
+//texels per side of the ltc tables, LUT_SIZE in LTCLighting.hlsli
+#define LTC_LUT_SIZE 64
+
+//the two ltc lookup tables LtcLUT and LtcLUT2 sample, fitted to the engine's ggx on the cpu and kept as halves.
+//Table 0 is the inverse matrix entries m00, m20, m02 and m22 scaled so m11 is 1, table 1 is the ggx magnitude,
+//its fresnel part and the horizon clipped sphere form factor in w. Columns are roughness, rows sqrt(1 - cos theta)
+//from the bottom up like the shaders expect after flipping v
+class LTCTable
+{
+	//two tables of LTC_LUT_SIZE x LTC_LUT_SIZE texels of four halves, top row first
+	std::vector<UINT16> values;
+	double fitTime;
+
+public:
+	LTCTable();
+	~LTCTable();
+
+	//fits every cell with nelder mead like Heitz's fitLTC. The lobes of a roughness are fitted from normal incidence
+	//outwards each starting from the last, so the rows of roughness are split between the workers once the normal
+	//incidence lobes are done
+	void Fit(UINT workerCount = 0);
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+	//loads the table, fitting and saving it when there isn't one
+	void LoadOrFit(const std::filesystem::path& fileName);
+
+	//texel of a table at roughness and theta index, theta 0 being normal incidence
+	Vector4 GetValue(UINT table, UINT roughnessIndex, UINT thetaIndex);
+	//records the upload of a table into a R16G16B16A16_FLOAT texture on the app command list, uploadHeap has to live
+	//until it has run
+	void CreateTexture(UINT table, ManagedResource& texture, ComPtr<ID3D12Resource>& uploadHeap);
+
+	size_t GetSizeInBytes();
+	double GetFitTime();
+};
+
+//the fitted table against the one the engine ships in ltc.lut, entry by entry and by how far each one's lobes are from
+//the ggx they stand for, and the save and load round trip
+void ValidateLTCTable(const std::filesystem::path& lutFile = "../../Assets/Textures/ltc.lut");
+
+//fitting on one and all threads, and loading the lut against the float tables LTC.h compiled in
+void BenchmarkLTCTable(const std::filesystem::path& lutFile = "../../Assets/Textures/ltc.lut");
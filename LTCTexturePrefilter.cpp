@@ -0,0 +1,683 @@
+#include "LTCTexturePrefilter.h"
+#include"Validation.h"
+#include<wincodec.h>
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<functional>
+#include<random>
+#include<thread>
+
+using namespace DirectX;
+
+static const UINT PrefilterMagic = 0x4643544C;
+static const UINT PrefilterVersion = 1;
+//the blur of slice 1 in source texels, each slice after it three times wider. Measured off Brick_1.png and
+//Brick_2.png against Brick_0.png, and what the log 3 lod in GetPrefilteredTextureColor expects
+static const float FirstSigma = 2.0f;
+static const float SigmaGrowth = 3.0f;
+//keeps the benchmark loops from being optimized out
+static volatile UINT benchmarkSink;
+
+//rgba as floats, one XMFLOAT4 a texel
+struct PrefilterImage
+{
+	UINT width;
+	UINT height;
+	std::vector<XMFLOAT4> texels;
+
+	void Resize(UINT newWidth, UINT newHeight)
+	{
+		width = newWidth;
+		height = newHeight;
+		texels.resize((size_t)width * height);
+	}
+};
+
+static UINT64 HashFile(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	UINT64 hash = 14695981039346656037ull;
+	for (char byte : bytes)
+	{
+		hash = (hash ^ (UINT8)byte) * 1099511628211ull;
+	}
+	return hash;
+}
+
+//runs rows 0 to rowCount on the workers, worker 0 being the caller
+static void ForEachRow(UINT rowCount, UINT workerCount, const std::function<void(UINT row)>& rowFunction)
+{
+	auto work = [rowCount, workerCount, &rowFunction](UINT worker)
+	{
+		for (UINT row = worker; row < rowCount; row += workerCount)
+		{
+			rowFunction(row);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (UINT w = 1; w < std::min(workerCount, rowCount); w++)
+	{
+		workers.emplace_back(work, w);
+	}
+	work(0);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+//2x2 box, the last row or column repeated on odd sizes like GenerateMipMapsCS
+static void Downsample(const PrefilterImage& source, PrefilterImage& destination, UINT workerCount)
+{
+	destination.Resize(std::max(source.width / 2, 1u), std::max(source.height / 2, 1u));
+	const XMVECTOR quarter = XMVectorReplicate(0.25f);
+	ForEachRow(destination.height, workerCount, [&](UINT y)
+	{
+		const XMFLOAT4* row0 = &source.texels[(size_t)std::min(2 * y, source.height - 1) * source.width];
+		const XMFLOAT4* row1 = &source.texels[(size_t)std::min(2 * y + 1, source.height - 1) * source.width];
+		XMFLOAT4* output = &destination.texels[(size_t)y * destination.width];
+		for (UINT x = 0; x < destination.width; x++)
+		{
+			UINT x0 = std::min(2 * x, source.width - 1);
+			UINT x1 = std::min(2 * x + 1, source.width - 1);
+			XMVECTOR sum = XMVectorAdd(XMVectorAdd(XMLoadFloat4(&row0[x0]), XMLoadFloat4(&row0[x1])),
+				XMVectorAdd(XMLoadFloat4(&row1[x0]), XMLoadFloat4(&row1[x1])));
+			XMStoreFloat4(&output[x], XMVectorMultiply(sum, quarter));
+		}
+	});
+}
+
+//separable gaussian, clamped at the edges. The horizontal pass runs along each row, the vertical one adds whole rows
+//so both read memory in order
+static void GaussianBlur(PrefilterImage& image, float sigma, UINT workerCount)
+{
+	int radius = std::max((int)ceilf(3.0f * sigma), 1);
+	std::vector<float> weights(2 * radius + 1);
+	float weightSum = 0.0f;
+	for (int i = -radius; i <= radius; i++)
+	{
+		weights[i + radius] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		weightSum += weights[i + radius];
+	}
+	for (float& weight : weights)
+	{
+		weight /= weightSum;
+	}
+
+	int width = (int)image.width;
+	int height = (int)image.height;
+	PrefilterImage horizontal;
+	horizontal.Resize(image.width, image.height);
+	ForEachRow(image.height, workerCount, [&](UINT y)
+	{
+		const XMFLOAT4* input = &image.texels[(size_t)y * width];
+		XMFLOAT4* output = &horizontal.texels[(size_t)y * width];
+		for (int x = 0; x < width; x++)
+		{
+			XMVECTOR sum = XMVectorZero();
+			for (int i = -radius; i <= radius; i++)
+			{
+				int sourceX = std::clamp(x + i, 0, width - 1);
+				sum = XMVectorMultiplyAdd(XMLoadFloat4(&input[sourceX]), XMVectorReplicate(weights[i + radius]), sum);
+			}
+			XMStoreFloat4(&output[x], sum);
+		}
+	});
+
+	ForEachRow(image.height, workerCount, [&](UINT y)
+	{
+		XMFLOAT4* output = &image.texels[(size_t)y * width];
+		for (int x = 0; x < width; x++)
+		{
+			output[x] = XMFLOAT4(0, 0, 0, 0);
+		}
+		for (int i = -radius; i <= radius; i++)
+		{
+			const XMFLOAT4* input = &horizontal.texels[(size_t)std::clamp((int)y + i, 0, height - 1) * width];
+			XMVECTOR weight = XMVectorReplicate(weights[i + radius]);
+			for (int x = 0; x < width; x++)
+			{
+				XMStoreFloat4(&output[x], XMVectorMultiplyAdd(XMLoadFloat4(&input[x]), weight, XMLoadFloat4(&output[x])));
+			}
+		}
+	});
+}
+
+//bilinear from a mip level back up to the source's size. A level's texel covers 2^level source texels even where
+//odd sizes dropped the last row or column, so the texel centres are lined up by that and not by the sizes
+static void Upsample(const PrefilterImage& source, UINT level, PrefilterImage& destination, UINT width, UINT height, UINT workerCount)
+{
+	destination.Resize(width, height);
+	float scaleX = 1.0f / (float)(1u << level);
+	float scaleY = scaleX;
+	ForEachRow(height, workerCount, [&](UINT y)
+	{
+		float sourceY = std::clamp((y + 0.5f) * scaleY - 0.5f, 0.0f, (float)(source.height - 1));
+		UINT y0 = (UINT)sourceY;
+		UINT y1 = std::min(y0 + 1, source.height - 1);
+		XMVECTOR fractionY = XMVectorReplicate(sourceY - y0);
+		const XMFLOAT4* row0 = &source.texels[(size_t)y0 * source.width];
+		const XMFLOAT4* row1 = &source.texels[(size_t)y1 * source.width];
+		XMFLOAT4* output = &destination.texels[(size_t)y * width];
+		for (UINT x = 0; x < width; x++)
+		{
+			float sourceX = std::clamp((x + 0.5f) * scaleX - 0.5f, 0.0f, (float)(source.width - 1));
+			UINT x0 = (UINT)sourceX;
+			UINT x1 = std::min(x0 + 1, source.width - 1);
+			XMVECTOR fractionX = XMVectorReplicate(sourceX - x0);
+			XMVECTOR top = XMVectorLerpV(XMLoadFloat4(&row0[x0]), XMLoadFloat4(&row0[x1]), fractionX);
+			XMVECTOR bottom = XMVectorLerpV(XMLoadFloat4(&row1[x0]), XMLoadFloat4(&row1[x1]), fractionX);
+			XMStoreFloat4(&output[x], XMVectorLerpV(top, bottom, fractionY));
+		}
+	});
+}
+
+static void StoreTexels(const PrefilterImage& image, UINT8* destination, UINT workerCount)
+{
+	const XMVECTOR scale = XMVectorReplicate(255.0f);
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+	ForEachRow(image.height, workerCount, [&](UINT y)
+	{
+		for (UINT x = 0; x < image.width; x++)
+		{
+			size_t texel = (size_t)y * image.width + x;
+			XMFLOAT4 value;
+			XMStoreFloat4(&value, XMVectorMultiplyAdd(XMVectorSaturate(XMLoadFloat4(&image.texels[texel])), scale, half));
+			destination[texel * 4 + 0] = (UINT8)value.x;
+			destination[texel * 4 + 1] = (UINT8)value.y;
+			destination[texel * 4 + 2] = (UINT8)value.z;
+			destination[texel * 4 + 3] = (UINT8)value.w;
+		}
+	});
+}
+
+static float SliceSigma(UINT slice)
+{
+	return slice == 0 ? 0.0f : FirstSigma * powf(SigmaGrowth, (float)(slice - 1));
+}
+
+LTCPrefilteredTexture::LTCPrefilteredTexture()
+{
+	width = 0;
+	height = 0;
+	mipCount = 0;
+	sourceHash = 0;
+	prefilterTime = 0.0;
+}
+
+LTCPrefilteredTexture::~LTCPrefilteredTexture()
+{
+}
+
+//every mip down to 1x1, what Prefilter makes and the texture is created with
+static UINT GetFullMipCount(UINT width, UINT height)
+{
+	UINT mipCount = 1;
+	while ((std::max(width, height) >> mipCount) > 0)
+	{
+		mipCount++;
+	}
+	return mipCount;
+}
+
+void LTCPrefilteredTexture::ComputeSubresourceOffsets()
+{
+	subresourceOffsets.resize(LTC_PREFILTER_SLICES * mipCount + 1);
+	size_t offset = 0;
+	for (UINT slice = 0; slice < LTC_PREFILTER_SLICES; slice++)
+	{
+		for (UINT mip = 0; mip < mipCount; mip++)
+		{
+			subresourceOffsets[D3D12CalcSubresource(mip, slice, 0, mipCount, LTC_PREFILTER_SLICES)] = offset;
+			offset += (size_t)std::max(width >> mip, 1u) * std::max(height >> mip, 1u) * 4;
+		}
+	}
+	subresourceOffsets.back() = offset;
+}
+
+void LTCPrefilteredTexture::Prefilter(const UINT8* source, UINT sourceWidth, UINT sourceHeight, UINT workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	width = sourceWidth;
+	height = sourceHeight;
+	mipCount = GetFullMipCount(width, height);
+	ComputeSubresourceOffsets();
+	texels.resize(subresourceOffsets.back());
+
+	//the source's mip chain, what the wide blurs start from
+	std::vector<PrefilterImage> pyramid(mipCount);
+	pyramid[0].Resize(width, height);
+	for (size_t i = 0; i < pyramid[0].texels.size(); i++)
+	{
+		pyramid[0].texels[i] = XMFLOAT4(source[i * 4] / 255.0f, source[i * 4 + 1] / 255.0f, source[i * 4 + 2] / 255.0f, source[i * 4 + 3] / 255.0f);
+	}
+	for (UINT mip = 1; mip < mipCount; mip++)
+	{
+		Downsample(pyramid[mip - 1], pyramid[mip], workerCount);
+	}
+
+	PrefilterImage blurred;
+	PrefilterImage slice;
+	PrefilterImage mipImage;
+	for (UINT s = 0; s < LTC_PREFILTER_SLICES; s++)
+	{
+		float sigma = SliceSigma(s);
+		if (sigma == 0.0f)
+		{
+			slice = pyramid[0];
+		}
+		else
+		{
+			//the level whose texels are between a half and a quarter of sigma. The box downsampling and the bilinear
+			//upsampling already blur by 4^level / 4 texels squared, the gaussian does the rest
+			UINT level = (UINT)std::clamp((int)floorf(log2f(sigma / 2.0f)), 0, (int)mipCount - 1);
+			float levelScale = (float)(1u << level);
+			float levelSigma = sqrtf(std::max(sigma * sigma / (levelScale * levelScale) - (level > 0 ? 0.25f : 0.0f), 0.25f));
+
+			blurred = pyramid[level];
+			GaussianBlur(blurred, levelSigma, workerCount);
+			if (level == 0)
+				slice = blurred;
+			else
+				Upsample(blurred, level, slice, width, height, workerCount);
+		}
+
+		StoreTexels(slice, &texels[subresourceOffsets[D3D12CalcSubresource(0, s, 0, mipCount, LTC_PREFILTER_SLICES)]], workerCount);
+		const PrefilterImage* previous = &slice;
+		for (UINT mip = 1; mip < mipCount; mip++)
+		{
+			PrefilterImage next;
+			Downsample(*previous, next, workerCount);
+			mipImage = std::move(next);
+			StoreTexels(mipImage, &texels[subresourceOffsets[D3D12CalcSubresource(mip, s, 0, mipCount, LTC_PREFILTER_SLICES)]], workerCount);
+			previous = &mipImage;
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	prefilterTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool LTCPrefilteredTexture::Load(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::error_code error;
+	UINT64 fileSize = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	UINT header[8] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != PrefilterMagic || header[1] != PrefilterVersion || header[4] != LTC_PREFILTER_SLICES)
+		return false;
+
+	//a corrupt header prefilters again instead of sizing the texels or the texture from it
+	if (header[2] == 0 || header[3] == 0 || header[2] > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || header[3] > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION
+		|| header[5] != GetFullMipCount(header[2], header[3]))
+		return false;
+
+	width = header[2];
+	height = header[3];
+	mipCount = header[5];
+	sourceHash = (UINT64)header[6] | ((UINT64)header[7] << 32);
+	ComputeSubresourceOffsets();
+	if (fileSize != sizeof(header) + subresourceOffsets.back())
+		return false;
+
+	texels.resize(subresourceOffsets.back());
+	file.read(reinterpret_cast<char*>(texels.data()), texels.size());
+	prefilterTime = 0.0;
+	return file.good();
+}
+
+bool LTCPrefilteredTexture::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[8] = { PrefilterMagic, PrefilterVersion, width, height, LTC_PREFILTER_SLICES, mipCount, (UINT)sourceHash, (UINT)(sourceHash >> 32) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+	return file.good();
+}
+
+void LTCPrefilteredTexture::LoadOrPrefilter(const std::filesystem::path& cacheFile, const std::filesystem::path& sourceFile)
+{
+	UINT64 hash = HashFile(sourceFile);
+	if (Load(cacheFile) && sourceHash == hash)
+		return;
+
+	std::vector<UINT8> source;
+	UINT sourceWidth, sourceHeight;
+	if (!LoadLTCSourceTexture(sourceFile, source, sourceWidth, sourceHeight))
+		throw std::logic_error("Couldn't read the ltc area light texture");
+
+	Prefilter(source.data(), sourceWidth, sourceHeight);
+	sourceHash = hash;
+	Save(cacheFile);
+}
+
+const UINT8* LTCPrefilteredTexture::GetTexels(UINT slice, UINT mip)
+{
+	return &texels[subresourceOffsets[D3D12CalcSubresource(mip, slice, 0, mipCount, LTC_PREFILTER_SLICES)]];
+}
+
+void LTCPrefilteredTexture::CreateTexture(ManagedResource& texture, ComPtr<ID3D12Resource>& uploadHeap)
+{
+	UINT subresourceCount = LTC_PREFILTER_SLICES * mipCount;
+	auto texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, LTC_PREFILTER_SLICES, mipCount);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().defaultHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(texture.resource.GetAddressOf())
+	));
+	texture.resource->SetName(L"ltcprefiltertexture");
+
+	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, subresourceCount);
+	auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+	ThrowIfFailed(GetAppResources().device->CreateCommittedResource(
+		&GetAppResources().uploadHeapType,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(uploadHeap.GetAddressOf())
+	));
+
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(subresourceCount);
+	for (UINT slice = 0; slice < LTC_PREFILTER_SLICES; slice++)
+	{
+		for (UINT mip = 0; mip < mipCount; mip++)
+		{
+			D3D12_SUBRESOURCE_DATA& data = subresources[D3D12CalcSubresource(mip, slice, 0, mipCount, LTC_PREFILTER_SLICES)];
+			data.pData = GetTexels(slice, mip);
+			data.RowPitch = std::max(width >> mip, 1u) * 4;
+			data.SlicePitch = data.RowPitch * std::max(height >> mip, 1u);
+		}
+	}
+
+	UpdateSubresources(GetAppResources().commandList.Get(), texture.resource.Get(), uploadHeap.Get(), 0, 0, subresourceCount, subresources.data());
+
+	auto transition = CD3DX12_RESOURCE_BARRIER::Transition(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	GetAppResources().commandList->ResourceBarrier(1, &transition);
+
+	texture.currentState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	texture.resourceType = RESOURCE_TYPE_SRV;
+}
+
+UINT LTCPrefilteredTexture::GetWidth()
+{
+	return width;
+}
+
+UINT LTCPrefilteredTexture::GetHeight()
+{
+	return height;
+}
+
+UINT LTCPrefilteredTexture::GetMipCount()
+{
+	return mipCount;
+}
+
+size_t LTCPrefilteredTexture::GetSizeInBytes()
+{
+	return texels.size();
+}
+
+double LTCPrefilteredTexture::GetPrefilterTime()
+{
+	return prefilterTime;
+}
+
+bool LoadLTCSourceTexture(const std::filesystem::path& fileName, std::vector<UINT8>& rgba, UINT& width, UINT& height)
+{
+	//already initialized by whoever got there first is fine
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	ComPtr<IWICImagingFactory> factory;
+	if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))))
+		return false;
+
+	ComPtr<IWICBitmapDecoder> decoder;
+	if (FAILED(factory->CreateDecoderFromFilename(fileName.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())))
+		return false;
+
+	ComPtr<IWICBitmapFrameDecode> frame;
+	ComPtr<IWICFormatConverter> converter;
+	if (FAILED(decoder->GetFrame(0, frame.GetAddressOf())) || FAILED(factory->CreateFormatConverter(converter.GetAddressOf())))
+		return false;
+	if (FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+		return false;
+
+	if (FAILED(converter->GetSize(&width, &height)))
+		return false;
+	rgba.resize((size_t)width * height * 4);
+	return SUCCEEDED(converter->CopyPixels(nullptr, width * 4, (UINT)rgba.size(), rgba.data()));
+}
+
+//mean and largest difference of two rgba8 images in 8 bit steps
+static void CompareTexels(const UINT8* a, const UINT8* b, size_t texelCount, double& mean, UINT& largest)
+{
+	UINT64 sum = 0;
+	largest = 0;
+	for (size_t i = 0; i < texelCount * 4; i++)
+	{
+		UINT difference = (UINT)abs(a[i] - b[i]);
+		sum += difference;
+		largest = std::max(largest, difference);
+	}
+	mean = (double)sum / (texelCount * 4);
+}
+
+void ValidateLTCPrefilter(const std::filesystem::path& sourceFile)
+{
+	printf("LTC texture prefilter\n");
+	bool passed = true;
+
+	//smooth noise with some hard edges, a stand in for a light texture
+	const UINT width = 640;
+	const UINT height = 400;
+	std::mt19937 generator(11);
+	std::vector<UINT8> source((size_t)width * height * 4);
+	for (UINT y = 0; y < height; y++)
+	{
+		for (UINT x = 0; x < width; x++)
+		{
+			UINT8* texel = &source[((size_t)y * width + x) * 4];
+			bool brick = ((x / 24 + (y / 12) % 2) % 2) == 0 && x % 24 > 1 && y % 12 > 1;
+			texel[0] = (UINT8)(brick ? 150 + generator() % 100 : generator() % 40);
+			texel[1] = (UINT8)(brick ? 60 + generator() % 40 : generator() % 40);
+			texel[2] = (UINT8)(generator() % 256);
+			texel[3] = 255;
+		}
+	}
+
+	LTCPrefilteredTexture texture;
+	texture.Prefilter(source.data(), width, height);
+	Check(passed, "slice 0 is the source", memcmp(texture.GetTexels(0, 0), source.data(), source.size()) == 0);
+
+	//the slices the pyramid blurs against the same gaussian at full resolution, in 8 bit steps. Only texels further than
+	//the kernel from the edges, clamping repeats a single edge texel at full resolution and an average of 2^level of
+	//them in the pyramid
+	bool slicesClose = true;
+	for (UINT slice = 1; slice < 5; slice++)
+	{
+		PrefilterImage reference;
+		reference.Resize(width, height);
+		for (size_t i = 0; i < reference.texels.size(); i++)
+		{
+			reference.texels[i] = XMFLOAT4(source[i * 4] / 255.0f, source[i * 4 + 1] / 255.0f, source[i * 4 + 2] / 255.0f, source[i * 4 + 3] / 255.0f);
+		}
+		GaussianBlur(reference, SliceSigma(slice), 1);
+		std::vector<UINT8> referenceTexels(source.size());
+		StoreTexels(reference, referenceTexels.data(), 1);
+
+		const UINT8* texels = texture.GetTexels(slice, 0);
+		UINT margin = (UINT)ceilf(3.0f * SliceSigma(slice));
+		UINT64 sum = 0;
+		UINT count = 0;
+		UINT largest = 0;
+		for (UINT y = margin; y + margin < height; y++)
+		{
+			for (UINT x = margin; x + margin < width; x++)
+			{
+				for (UINT c = 0; c < 4; c++)
+				{
+					size_t i = ((size_t)y * width + x) * 4 + c;
+					UINT difference = (UINT)abs(texels[i] - referenceTexels[i]);
+					sum += difference;
+					count++;
+					largest = std::max(largest, difference);
+				}
+			}
+		}
+		double mean = count > 0 ? (double)sum / count : 0.0;
+		printf("    slice %u, sigma %3.0f: mean difference %.2f, largest %u\n", slice, SliceSigma(slice), mean, largest);
+		slicesClose = slicesClose && count > 0 && mean < 0.5 && largest <= 3;
+	}
+	Check(passed, "slices match full resolution blurs", slicesClose);
+
+	std::vector<UINT8> flat((size_t)width * height * 4, 77);
+	LTCPrefilteredTexture flatTexture;
+	flatTexture.Prefilter(flat.data(), width, height);
+	bool staysFlat = true;
+	for (UINT slice = 0; slice < LTC_PREFILTER_SLICES; slice++)
+	{
+		for (UINT mip = 0; mip < flatTexture.GetMipCount(); mip++)
+		{
+			const UINT8* texels = flatTexture.GetTexels(slice, mip);
+			size_t count = (size_t)std::max(width >> mip, 1u) * std::max(height >> mip, 1u) * 4;
+			staysFlat = staysFlat && std::all_of(texels, texels + count, [](UINT8 value) { return value == 77; });
+		}
+	}
+	Check(passed, "flat images stay flat", staysFlat);
+
+	//mip 1 of slice 0 against a box of the source, within the rounding of the float chain
+	UINT largestMipError = 0;
+	const UINT8* mip1 = texture.GetTexels(0, 1);
+	for (UINT y = 0; y < height / 2; y++)
+	{
+		for (UINT x = 0; x < width / 2; x++)
+		{
+			for (UINT c = 0; c < 4; c++)
+			{
+				UINT sum = source[((2 * y) * width + 2 * x) * 4 + c] + source[((2 * y) * width + 2 * x + 1) * 4 + c]
+					+ source[((2 * y + 1) * width + 2 * x) * 4 + c] + source[((2 * y + 1) * width + 2 * x + 1) * 4 + c];
+				largestMipError = std::max(largestMipError, (UINT)abs((int)mip1[(y * (width / 2) + x) * 4 + c] - (int)((sum + 2) / 4)));
+			}
+		}
+	}
+	Check(passed, "mips are 2x2 boxes", largestMipError <= 1);
+	Check(passed, "full mip chain", texture.GetMipCount() == 10 && texture.GetTexels(0, 9) != nullptr);
+
+	std::filesystem::path roundTripFile = std::filesystem::temp_directory_path() / "ltc_prefilter_validation.bin";
+	LTCPrefilteredTexture reloaded;
+	bool roundTrip = texture.Save(roundTripFile) && reloaded.Load(roundTripFile) && reloaded.GetSizeInBytes() == texture.GetSizeInBytes()
+		&& memcmp(reloaded.GetTexels(0, 0), texture.GetTexels(0, 0), texture.GetSizeInBytes()) == 0;
+	Check(passed, "save and load round trip", roundTrip);
+
+	//a mip count past the shift width, dimensions over the d3d12 limit, and a file cut short
+	auto corruptLoads = [&](UINT index, UINT value)
+	{
+		texture.Save(roundTripFile);
+		{
+			std::fstream file(roundTripFile, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(index * sizeof(UINT));
+			file.write(reinterpret_cast<const char*>(&value), sizeof(UINT));
+		}
+		LTCPrefilteredTexture corrupt;
+		return corrupt.Load(roundTripFile);
+	};
+	bool rejected = !corruptLoads(5, 40) && !corruptLoads(5, texture.GetMipCount() - 1) && !corruptLoads(2, 0x40000000) && !corruptLoads(3, 0);
+	texture.Save(roundTripFile);
+	std::filesystem::resize_file(roundTripFile, std::filesystem::file_size(roundTripFile) - 1);
+	rejected = rejected && !reloaded.Load(roundTripFile);
+	std::error_code error;
+	std::filesystem::remove(roundTripFile, error);
+	Check(passed, "corrupt headers rejected", rejected);
+
+	//the offline prefiltered slices the engine used to load
+	std::vector<UINT8> brick;
+	UINT brickWidth, brickHeight;
+	if (LoadLTCSourceTexture(sourceFile, brick, brickWidth, brickHeight))
+	{
+		LTCPrefilteredTexture bricks;
+		bricks.Prefilter(brick.data(), brickWidth, brickHeight);
+		printf("    %s prefiltered in %.0f ms\n", sourceFile.filename().string().c_str(), bricks.GetPrefilterTime());
+
+		double worstMean = 0.0;
+		for (UINT slice = 1; slice < LTC_PREFILTER_SLICES; slice++)
+		{
+			std::filesystem::path sliceFile = sourceFile.parent_path() / ("Brick_" + std::to_string(slice) + ".png");
+			std::vector<UINT8> shipped;
+			UINT shippedWidth, shippedHeight;
+			if (!LoadLTCSourceTexture(sliceFile, shipped, shippedWidth, shippedHeight) || shippedWidth != brickWidth || shippedHeight != brickHeight)
+				continue;
+
+			double mean;
+			UINT largest;
+			CompareTexels(bricks.GetTexels(slice, 0), shipped.data(), (size_t)brickWidth * brickHeight, mean, largest);
+			printf("    slice %u against %s: mean difference %.2f, largest %u\n", slice, sliceFile.filename().string().c_str(), mean, largest);
+			worstMean = std::max(worstMean, mean);
+		}
+		Check(passed, "slices within 8 steps of the Brick_N.png", worstMean < 8.0);
+	}
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkLTCPrefilter(const std::filesystem::path& sourceFile)
+{
+	std::vector<UINT8> source;
+	UINT width, height;
+	if (!LoadLTCSourceTexture(sourceFile, source, width, height))
+	{
+		//a stand in of the same size as Brick_0.png
+		width = 1600;
+		height = 988;
+		source.resize((size_t)width * height * 4);
+		std::mt19937 generator(3);
+		for (UINT8& value : source)
+		{
+			value = (UINT8)generator();
+		}
+	}
+
+	UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	LTCPrefilteredTexture texture;
+	texture.Prefilter(source.data(), width, height, 1);
+	double serialTime = texture.GetPrefilterTime();
+	texture.Prefilter(source.data(), width, height, threadCount);
+	printf("LTC texture prefilter, %ux%u, %u slices of %u mips\n", width, height, LTC_PREFILTER_SLICES, texture.GetMipCount());
+	printf("  prefilter: %.0f ms on 1 thread, %.0f ms on %u, %.1f MB\n", serialTime, texture.GetPrefilterTime(), threadCount, texture.GetSizeInBytes() / (1024.0 * 1024.0));
+
+	std::filesystem::path cacheFile = std::filesystem::temp_directory_path() / "ltc_prefilter_benchmark.bin";
+	texture.Save(cacheFile);
+	auto start = std::chrono::high_resolution_clock::now();
+	LTCPrefilteredTexture loaded;
+	bool load = loaded.Load(cacheFile);
+	UINT64 hash = HashFile(sourceFile);
+	auto end = std::chrono::high_resolution_clock::now();
+	benchmarkSink = load ? (UINT)hash : 0;
+	std::error_code error;
+	std::filesystem::remove(cacheFile, error);
+	printf("  cached start: %.1f ms to load and hash the source\n", std::chrono::duration<double, std::milli>(end - start).count());
+}
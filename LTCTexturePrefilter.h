@@ -0,0 +1,61 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+#include<vector>
+
+//slices of prefilteredLTCTex, the shaders pick between them by a log 3 lod
+#define LTC_PREFILTER_SLICES 8
+
+//the texture of a textured area light blurred for every lod the ltc lookup can ask for. Slice 0 is the source and
+//slice k a gaussian of 2 * 3^(k - 1) texels, each slice with its full mip chain. The wide blurs are done on a box
+//downsampled copy of the source small enough that the kernel stays a few texels and then scaled back up, so every
+//slice costs about the same
+class LTCPrefilteredTexture
+{
+	UINT width;
+	UINT height;
+	UINT mipCount;
+	//hash of the source file the texture was prefiltered from, a changed file prefilters again
+	UINT64 sourceHash;
+	//rgba8, subresource by subresource in D3D12CalcSubresource order
+	std::vector<UINT8> texels;
+	std::vector<size_t> subresourceOffsets;
+	double prefilterTime;
+
+	void ComputeSubresourceOffsets();
+
+public:
+	LTCPrefilteredTexture();
+	~LTCPrefilteredTexture();
+
+	//source is rgba8, row by row. Rows of every blur, scale and mip are split between the workers
+	void Prefilter(const UINT8* source, UINT width, UINT height, UINT workerCount = 0);
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+	//loads the texture prefiltered from this source, prefiltering and saving it when there isn't one, it's corrupt or
+	//the source changed. The source file is hashed on every call, the hash is what a good cache is checked against
+	void LoadOrPrefilter(const std::filesystem::path& cacheFile, const std::filesystem::path& sourceFile);
+
+	//rgba8 texels of a slice's mip, row by row
+	const UINT8* GetTexels(UINT slice, UINT mip);
+	//records the upload of every slice and mip into a R8G8B8A8_UNORM texture array on the app command list,
+	//uploadHeap has to live until it has run
+	void CreateTexture(ManagedResource& texture, ComPtr<ID3D12Resource>& uploadHeap);
+
+	UINT GetWidth();
+	UINT GetHeight();
+	UINT GetMipCount();
+	size_t GetSizeInBytes();
+	double GetPrefilterTime();
+};
+
+//decodes a png or any other format wic reads into rgba8, top row first
+bool LoadLTCSourceTexture(const std::filesystem::path& fileName, std::vector<UINT8>& rgba, UINT& width, UINT& height);
+
+//slices against full resolution blurs of the same width, flat images staying flat, the mips, the save and load round
+//trip, and the slices against the Brick_N.png files they replace when those load
+void ValidateLTCPrefilter(const std::filesystem::path& sourceFile = "../../Assets/Textures/Brick_0.png");
+
+//prefiltering on one and all threads against loading the cache
+void BenchmarkLTCPrefilter(const std::filesystem::path& sourceFile = "../../Assets/Textures/Brick_0.png");
@@ -1,6 +1,7 @@
 #include "Lighting.hlsli"
 
 Texture2D depthMap : register(t1);
+StructuredBuffer<LightCullData> lightCullData : register(t0, space3);
 RWStructuredBuffer<uint> LightIndices : register(u0);
 RWTexture2D<uint2> LightGrid : register(u1);
 
@@ -57,7 +58,7 @@ ViewFrustum CreateFrustum(int2 tileID, float fMinDepth, float fMaxDepth)
 
     matrix inverseProjView = InvertMatrix(viewProjection);
 
-    float2 ndcSizePerTile = 2 * float2(64, 64) / float2(WIDTH,HEIGHT);
+    float2 ndcSizePerTile = 2 * float2(TILE_SIZE, TILE_SIZE) / float2(WIDTH,HEIGHT);
 
     float2 ndcPoints[4]; // corners of tile in ndc
     ndcPoints[0] = ndcUpperLeft + tileID * ndcSizePerTile; // upper left
@@ -209,63 +210,26 @@ uint groupIndex : SV_GroupIndex)
             break;
         }
         
-        float4 vsPos = mul(float4(lights[lightIndex].position, 1.0), view);
+        LightCullData cullData = lightCullData[lightIndex];
         
-        bool interSects = false;
-        
-        switch (lights[lightIndex].type)
+        //directional and area lights have no range and reach every tile
+        if (cullData.range < 0)
         {
-            case LIGHT_TYPE_DIR:
-            {
-               uint offset;
-               InterlockedAdd(visibleLightCount, 1, offset);
-               visibleLightIndices[offset] = lightIndex;
-            }
-            break;
-    
-            case LIGHT_TYPE_SPOT:
-            {
-                     
-               interSects = false;
-            }
-            break;
-            
-            case LIGHT_TYPE_POINT:
-            {      
-               Sphere sphere;
-               sphere.c = vsPos.xyz;
-               sphere.r = lights[lightIndex].range;
-               if (SphereInsideFrustum(sphere, frustum, nearClipVS, maxDepthVS) && !SphereInsidePlane(sphere, minPlane))
-               {
-                  uint offset;
-                  InterlockedAdd(visibleLightCount, 1, offset);
-                  visibleLightIndices[offset] = lightIndex;
-               }
-             }
-             break;
-            
-            case LIGHT_TYPE_AREA_RECT:    
+            uint offset;
+            InterlockedAdd(visibleLightCount, 1, offset);
+            visibleLightIndices[offset] = lightIndex;
+        }
+        else
+        {
+            Sphere sphere;
+            sphere.c = mul(float4(cullData.position, 1.0), view).xyz;
+            sphere.r = cullData.range;
+            if (SphereInsideFrustum(sphere, frustum, nearClipVS, maxDepthVS) && !SphereInsidePlane(sphere, minPlane))
             {
-                 // Add all rect lights for now    
                 uint offset;
                 InterlockedAdd(visibleLightCount, 1, offset);
                 visibleLightIndices[offset] = lightIndex;
-             }
-            break;
-                     
-            case LIGHT_TYPE_AREA_DISK:
-            {
-                                // Add all rect lights for now    
-                   uint offset;
-                   InterlockedAdd(visibleLightCount, 1, offset);
-                   visibleLightIndices[offset] = lightIndex;
             }
-            break;
-           
-        }
-        
-        if(interSects)
-        {
         }
     }
     
@@ -0,0 +1,232 @@
+#include "Lights.h"
+#include"Validation.h"
+#include "DXRHelper.h"
+#include<d3d12shader.h>
+#include<cstddef>
+#include<string>
+#include<vector>
+
+static_assert(sizeof(AreaLight) == LIGHT_SIZE_AreaLight, "AreaLight size differs from its field list");
+static_assert(sizeof(LightCullData) == 16, "The culling stream is read as one float4 per light");
+static_assert(sizeof(LightShadingData) % 16 == 0, "Shading entries should stay 16 byte aligned");
+
+LightCullData GetLightCullData(const Light& light)
+{
+	LightCullData cull;
+	cull.position = light.position;
+	cull.range = light.type == LIGHT_TYPE_POINT || light.type == LIGHT_TYPE_SPOT ? light.range : -1.0f;
+	return cull;
+}
+
+void SplitLight(const Light& light, UINT areaIndex, LightCullData& cull, LightShadingData& shading)
+{
+	cull = GetLightCullData(light);
+
+	ZeroMemory(&shading, sizeof(LightShadingData));
+	shading.type = light.type;
+	shading.direction = light.direction;
+	shading.intensity = light.intensity;
+	shading.color = light.color;
+	shading.spotFalloff = light.spotFalloff;
+	shading.diffuse = light.diffuse;
+	shading.areaIndex = areaIndex;
+}
+
+struct LightFieldLayout
+{
+	const char* name;
+	UINT offset;
+	UINT size;
+};
+
+struct LightStructLayout
+{
+	const char* name;
+	UINT size;
+	std::vector<LightFieldLayout> fields;
+};
+
+#define LIGHT_FIELD_LAYOUT(type, name) { #name, (UINT)offsetof(LIGHT_LAYOUT_STRUCT, name), LIGHT_SIZE_##type },
+
+static std::vector<LightStructLayout> GetLightLayouts()
+{
+	std::vector<LightStructLayout> layouts;
+
+#define LIGHT_LAYOUT_STRUCT AreaLight
+	layouts.push_back({ "AreaLight", sizeof(AreaLight), { AREA_LIGHT_FIELDS(LIGHT_FIELD_LAYOUT) } });
+#undef LIGHT_LAYOUT_STRUCT
+
+#define LIGHT_LAYOUT_STRUCT Light
+	layouts.push_back({ "Light", sizeof(Light), { LIGHT_FIELDS(LIGHT_FIELD_LAYOUT) } });
+#undef LIGHT_LAYOUT_STRUCT
+
+#define LIGHT_LAYOUT_STRUCT LightCullData
+	layouts.push_back({ "LightCullData", sizeof(LightCullData), { LIGHT_CULL_FIELDS(LIGHT_FIELD_LAYOUT) } });
+#undef LIGHT_LAYOUT_STRUCT
+
+#define LIGHT_LAYOUT_STRUCT LightShadingData
+	layouts.push_back({ "LightShadingData", sizeof(LightShadingData), { LIGHT_SHADING_FIELDS(LIGHT_FIELD_LAYOUT) } });
+#undef LIGHT_LAYOUT_STRUCT
+
+	return layouts;
+}
+
+//the c++ compiler put every field where a structured buffer would, right after the one before
+static bool IsPacked(const LightStructLayout& layout, std::string& error)
+{
+	UINT offset = 0;
+	for (const LightFieldLayout& field : layout.fields)
+	{
+		if (field.offset != offset)
+		{
+			error = std::string(layout.name) + "." + field.name + " at " + std::to_string(field.offset) + ", expected " + std::to_string(offset);
+			return false;
+		}
+		offset += field.size;
+	}
+
+	if (offset != layout.size)
+	{
+		error = std::string(layout.name) + " is " + std::to_string(layout.size) + " bytes, the fields take " + std::to_string(offset);
+		return false;
+	}
+	return true;
+}
+
+//the element type of a structured buffer in a compiled shader against the layout. Returns false with an empty error
+//when the shader isn't there
+static bool MatchesShader(const wchar_t* shaderFile, const char* bufferName, const LightStructLayout& layout, std::string& error)
+{
+	error.clear();
+
+	ComPtr<ID3DBlob> shader;
+	if (FAILED(D3DReadFileToBlob(shaderFile, shader.GetAddressOf())))
+		return false;
+
+	ComPtr<IDxcLibrary> library;
+	ComPtr<IDxcContainerReflection> containerReflection;
+	ComPtr<IDxcBlobEncoding> blob;
+	ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(library.GetAddressOf())));
+	ThrowIfFailed(DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(containerReflection.GetAddressOf())));
+	ThrowIfFailed(library->CreateBlobWithEncodingFromPinned(shader->GetBufferPointer(), (UINT32)shader->GetBufferSize(), 0, blob.GetAddressOf()));
+	ThrowIfFailed(containerReflection->Load(blob.Get()));
+
+	//the DXIL part
+	UINT32 partIndex;
+	ComPtr<ID3D12ShaderReflection> reflection;
+	const UINT32 dxilPart = 'D' | ('X' << 8) | ('I' << 16) | ('L' << 24);
+	if (FAILED(containerReflection->FindFirstPartKind(dxilPart, &partIndex))
+		|| FAILED(containerReflection->GetPartReflection(partIndex, IID_PPV_ARGS(reflection.GetAddressOf()))))
+	{
+		error = "no reflection";
+		return false;
+	}
+
+	//structured buffers reflect as a buffer with one $Element variable
+	ID3D12ShaderReflectionConstantBuffer* buffer = reflection->GetConstantBufferByName(bufferName);
+	D3D12_SHADER_BUFFER_DESC bufferDesc;
+	if (FAILED(buffer->GetDesc(&bufferDesc)) || bufferDesc.Variables != 1)
+	{
+		error = std::string(bufferName) + " isn't in the shader";
+		return false;
+	}
+
+	ID3D12ShaderReflectionType* element = buffer->GetVariableByIndex(0)->GetType();
+	D3D12_SHADER_TYPE_DESC elementDesc;
+	element->GetDesc(&elementDesc);
+	if (elementDesc.Members != layout.fields.size())
+	{
+		error = std::string(bufferName) + " has " + std::to_string(elementDesc.Members) + " fields, expected " + std::to_string(layout.fields.size());
+		return false;
+	}
+
+	for (UINT i = 0; i < elementDesc.Members; i++)
+	{
+		D3D12_SHADER_TYPE_DESC memberDesc;
+		element->GetMemberTypeByIndex(i)->GetDesc(&memberDesc);
+		const char* memberName = element->GetMemberTypeName(i);
+		if (strcmp(memberName, layout.fields[i].name) != 0 || memberDesc.Offset != layout.fields[i].offset)
+		{
+			error = std::string(bufferName) + "." + memberName + " at " + std::to_string(memberDesc.Offset) + ", the c++ " + layout.fields[i].name
+				+ " at " + std::to_string(layout.fields[i].offset);
+			return false;
+		}
+	}
+
+	if (bufferDesc.Size != layout.size)
+	{
+		error = std::string(bufferName) + " stride " + std::to_string(bufferDesc.Size) + ", expected " + std::to_string(layout.size);
+		return false;
+	}
+	return true;
+}
+
+void ValidateLightLayout()
+{
+	printf("Light layout\n");
+	bool passed = true;
+	std::string error;
+
+	std::vector<LightStructLayout> layouts = GetLightLayouts();
+	for (const LightStructLayout& layout : layouts)
+	{
+		std::string name = std::string(layout.name) + " packed tightly";
+		bool packed = IsPacked(layout, error);
+		Check(passed, name.c_str(), packed);
+		if (!packed)
+			printf("    %s\n", error.c_str());
+	}
+
+	struct ShaderBuffer
+	{
+		const wchar_t* shaderFile;
+		const char* bufferName;
+		UINT layout;
+	};
+
+	const ShaderBuffer shaderBuffers[] =
+	{
+		{ L"PixelShaderPBR.cso", "lights", 1 },
+		{ L"LightCullingCS.cso", "lightCullData", 2 },
+	};
+
+	for (const ShaderBuffer& shaderBuffer : shaderBuffers)
+	{
+		std::string name = std::string(shaderBuffer.bufferName) + " matches the compiled shader";
+		bool matches = MatchesShader(shaderBuffer.shaderFile, shaderBuffer.bufferName, layouts[shaderBuffer.layout], error);
+		if (!matches && error.empty())
+		{
+			printf("  %-44s %s\n", name.c_str(), "skipped, no .cso");
+			continue;
+		}
+
+		Check(passed, name.c_str(), matches);
+		if (!matches)
+			printf("    %s\n", error.c_str());
+	}
+
+	//splitting and putting back together keeps every field the shaders read
+	Light light = {};
+	light.type = LIGHT_TYPE_SPOT;
+	light.direction = Vector3(0, -1, 0);
+	light.range = 12;
+	light.position = Vector3(1, 2, 3);
+	light.intensity = 5;
+	light.diffuse = Vector3(0.5f, 0.5f, 0.5f);
+	light.spotFalloff = 16;
+	light.color = Vector3(1, 0.5f, 0.25f);
+
+	LightCullData cull;
+	LightShadingData shading;
+	SplitLight(light, 7, cull, shading);
+	Check(passed, "split keeps the shading fields", cull.position.x == 1 && cull.position.y == 2 && cull.position.z == 3 && cull.range == 12
+		&& shading.type == LIGHT_TYPE_SPOT && shading.direction.y == -1 && shading.intensity == 5 && shading.color.z == 0.25f
+		&& shading.spotFalloff == 16 && shading.diffuse.x == 0.5f && shading.areaIndex == 7);
+
+	light.type = LIGHT_TYPE_DIR;
+	bool dirUnbounded = GetLightCullData(light).range < 0.0f;
+	light.type = LIGHT_TYPE_AREA_RECT;
+	Check(passed, "lights without a range aren't culled", dirUnbounded && GetLightCullData(light).range < 0.0f);
+
+	PrintValidationResult(passed);
+}
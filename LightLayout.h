@@ -0,0 +1,112 @@
+#ifndef __LIGHT_LAYOUT_H__
+#define __LIGHT_LAYOUT_H__
+
+//the gpu light structs, written once as field lists and expanded into both the c++ and the hlsl definitions so the
+//two can't drift apart. Structured buffers pack four byte fields tightly like the c++ compiler does, so the lists
+//only hold four byte scalars, float3s and the structs from here
+
+#ifdef __cplusplus
+#define LIGHT_INT int
+#define LIGHT_UINT UINT
+#define LIGHT_FLOAT float
+#define LIGHT_FLOAT3 Vector3
+#else
+#define LIGHT_INT int
+#define LIGHT_UINT uint
+#define LIGHT_FLOAT float
+#define LIGHT_FLOAT3 float3
+#endif
+
+//bytes a field takes in a structured buffer
+#define LIGHT_SIZE_LIGHT_INT 4
+#define LIGHT_SIZE_LIGHT_UINT 4
+#define LIGHT_SIZE_LIGHT_FLOAT 4
+#define LIGHT_SIZE_LIGHT_FLOAT3 12
+#define LIGHT_SIZE_AreaLight 32
+
+#define AREA_LIGHT_FIELDS(FIELD) \
+	FIELD(LIGHT_FLOAT, width) \
+	FIELD(LIGHT_FLOAT, height) \
+	FIELD(LIGHT_FLOAT, rotY) \
+	FIELD(LIGHT_FLOAT, rotZ) \
+	FIELD(LIGHT_FLOAT, rotX) \
+	FIELD(LIGHT_FLOAT3, padding)
+
+//the whole light, what the cpu edits and the shading functions take
+#define LIGHT_FIELDS(FIELD) \
+	FIELD(LIGHT_INT, type) \
+	FIELD(LIGHT_FLOAT3, direction) \
+	FIELD(LIGHT_FLOAT, range) \
+	FIELD(LIGHT_FLOAT3, position) \
+	FIELD(LIGHT_FLOAT, intensity) \
+	FIELD(LIGHT_FLOAT3, diffuse) \
+	FIELD(LIGHT_FLOAT, spotFalloff) \
+	FIELD(LIGHT_FLOAT3, color) \
+	FIELD(AreaLight, rectLight)
+
+//the hot stream, all culling reads. A negative range marks lights that reach everything
+#define LIGHT_CULL_FIELDS(FIELD) \
+	FIELD(LIGHT_FLOAT3, position) \
+	FIELD(LIGHT_FLOAT, range)
+
+//the rest of what shading reads, the area light parameters are in their own stream at areaIndex
+#define LIGHT_SHADING_FIELDS(FIELD) \
+	FIELD(LIGHT_INT, type) \
+	FIELD(LIGHT_FLOAT3, direction) \
+	FIELD(LIGHT_FLOAT, intensity) \
+	FIELD(LIGHT_FLOAT3, color) \
+	FIELD(LIGHT_FLOAT, spotFalloff) \
+	FIELD(LIGHT_FLOAT3, diffuse) \
+	FIELD(LIGHT_UINT, areaIndex) \
+	FIELD(LIGHT_FLOAT3, padding)
+
+#define LIGHT_DECLARE_FIELD(type, name) type name;
+
+struct AreaLight
+{
+	AREA_LIGHT_FIELDS(LIGHT_DECLARE_FIELD)
+};
+
+struct Light
+{
+	LIGHT_FIELDS(LIGHT_DECLARE_FIELD)
+};
+
+struct LightCullData
+{
+	LIGHT_CULL_FIELDS(LIGHT_DECLARE_FIELD)
+};
+
+struct LightShadingData
+{
+	LIGHT_SHADING_FIELDS(LIGHT_DECLARE_FIELD)
+};
+
+#ifdef __cplusplus
+//the culling entry of a light, only point and spot lights have a range
+LightCullData GetLightCullData(const Light& light);
+//the shading and culling entries of a light whose area parameters are at areaIndex in the area stream
+void SplitLight(const Light& light, UINT areaIndex, LightCullData& cull, LightShadingData& shading);
+
+//the field offsets of the c++ structs against the sizes the field lists give, and against the reflection of the
+//compiled shaders that read them when their .cso files are there
+void ValidateLightLayout();
+#else
+//the light the shading functions take, put back together from the streams
+Light MakeLight(LightCullData cull, LightShadingData shading, AreaLight area)
+{
+	Light light;
+	light.type = shading.type;
+	light.direction = shading.direction;
+	light.range = cull.range;
+	light.position = cull.position;
+	light.intensity = shading.intensity;
+	light.diffuse = shading.diffuse;
+	light.spotFalloff = shading.spotFalloff;
+	light.color = shading.color;
+	light.rectLight = area;
+	return light;
+}
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+#include "LightManager.h"
+#include<algorithm>
+#include<chrono>
+#include<random>
+
+LightManager::LightManager(UINT capacity)
+{
+	lights.resize(std::max(capacity, 1u));
+	dirtyFlags.resize(lights.size());
+	indexHandles.resize(lights.size());
+	ZeroMemory(lights.data(), lights.size() * sizeof(Light));
+
+	lightCount = 0;
+	ZeroMemory(&stats, sizeof(LightManagerStats));
+}
+
+LightManager::~LightManager()
+{
+}
+
+void LightManager::MarkDirty(UINT index)
+{
+	if (dirtyFlags[index])
+		return;
+
+	dirtyFlags[index] = 1;
+	dirtyIndices.emplace_back(index);
+}
+
+UINT LightManager::AddLight(const Light& light)
+{
+	if (lightCount == lights.size())
+		throw std::logic_error("Light buffer is full");
+
+	UINT handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+
+	else
+	{
+		handle = (UINT)handleIndices.size();
+		handleIndices.emplace_back(0);
+	}
+
+	UINT index = lightCount++;
+	handleIndices[handle] = index;
+	indexHandles[index] = handle;
+	lights[index] = light;
+	MarkDirty(index);
+
+	stats.lightCount = lightCount;
+	return handle;
+}
+
+void LightManager::RemoveLight(UINT handle)
+{
+	UINT index = handleIndices[handle];
+	UINT last = lightCount - 1;
+
+	if (index != last)
+	{
+		lights[index] = lights[last];
+		indexHandles[index] = indexHandles[last];
+		handleIndices[indexHandles[index]] = index;
+		MarkDirty(index);
+	}
+
+	handleIndices[handle] = UINT_MAX;
+	freeHandles.emplace_back(handle);
+	lightCount--;
+	stats.lightCount = lightCount;
+}
+
+void LightManager::SetLight(UINT handle, const Light& light)
+{
+	UINT index = handleIndices[handle];
+	if (memcmp(&lights[index], &light, sizeof(Light)) == 0)
+		return;
+
+	lights[index] = light;
+	MarkDirty(index);
+}
+
+const Light& LightManager::GetLight(UINT handle)
+{
+	return lights[handleIndices[handle]];
+}
+
+void LightManager::MarkAllDirty()
+{
+	for (UINT i = 0; i < lightCount; i++)
+	{
+		MarkDirty(i);
+	}
+}
+
+UINT LightManager::FlushDirty(Light* dest, LightCullData* cullDest)
+{
+	//lights moved past the end by a removal aren't read by the shaders anymore
+	dirtyIndices.erase(std::remove_if(dirtyIndices.begin(), dirtyIndices.end(), [this](UINT index)
+	{
+		if (index < lightCount)
+			return false;
+		dirtyFlags[index] = 0;
+		return true;
+	}), dirtyIndices.end());
+
+	UINT dirtyCount = (UINT)dirtyIndices.size();
+	stats.dirtyLastFlush = dirtyCount;
+	stats.rangesLastFlush = 0;
+	stats.bytesLastFlush = 0;
+	flushedRanges.clear();
+
+	if (dirtyCount == 0)
+		return 0;
+
+	//the staging buffer is in the upload heap, write combined, and every run is a copy on the gpu, so fewer larger runs
+	//are cheaper. With many lights dirty a walk over the flags finds the runs quicker than sorting the indices
+	auto copyRun = [this, dest, cullDest](UINT first, UINT count)
+	{
+		UINT64 runBytes = (UINT64)count * sizeof(Light);
+		memcpy(dest + first, lights.data() + first, runBytes);
+		stats.bytesLastFlush += runBytes;
+		stats.rangesLastFlush++;
+		flushedRanges.push_back({ first, count });
+
+		if (cullDest == nullptr)
+			return;
+
+		for (UINT i = first; i < first + count; i++)
+		{
+			cullDest[i] = GetLightCullData(lights[i]);
+		}
+		stats.bytesLastFlush += (UINT64)count * sizeof(LightCullData);
+	};
+
+	if (dirtyCount * 16 > lightCount)
+	{
+		UINT runStart = UINT_MAX;
+		for (UINT i = 0; i <= lightCount; i++)
+		{
+			bool dirty = i < lightCount && dirtyFlags[i];
+			if (dirty && runStart == UINT_MAX)
+				runStart = i;
+			else if (!dirty && runStart != UINT_MAX)
+			{
+				copyRun(runStart, i - runStart);
+				runStart = UINT_MAX;
+			}
+
+			if (i < lightCount)
+				dirtyFlags[i] = 0;
+		}
+	}
+
+	else
+	{
+		std::sort(dirtyIndices.begin(), dirtyIndices.end());
+
+		size_t runStart = 0;
+		for (size_t i = 1; i <= dirtyIndices.size(); i++)
+		{
+			if (i < dirtyIndices.size() && dirtyIndices[i] == dirtyIndices[i - 1] + 1)
+				continue;
+
+			copyRun(dirtyIndices[runStart], (UINT)(i - runStart));
+			runStart = i;
+		}
+
+		for (size_t i = 0; i < dirtyIndices.size(); i++)
+		{
+			dirtyFlags[dirtyIndices[i]] = 0;
+		}
+	}
+
+	dirtyIndices.clear();
+	return dirtyCount;
+}
+
+const std::vector<LightRange>& LightManager::GetFlushedRanges()
+{
+	return flushedRanges;
+}
+
+const Light* LightManager::GetLights()
+{
+	return lights.data();
+}
+
+UINT LightManager::GetLightCount()
+{
+	return lightCount;
+}
+
+UINT LightManager::GetCapacity()
+{
+	return (UINT)lights.size();
+}
+
+const LightManagerStats& LightManager::GetStats()
+{
+	return stats;
+}
+
+void BenchmarkLightManager(int frameCount)
+{
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distribution(-50.0f, 50.0f);
+
+	//stands in for the mapped light buffer
+	std::vector<Light> destination(MAX_LIGHTS);
+	std::vector<Light> source(MAX_LIGHTS);
+	ZeroMemory(source.data(), source.size() * sizeof(Light));
+
+	const UINT lightCounts[] = { 100, 1000, 20000 };
+	for (UINT lightCount : lightCounts)
+	{
+		printf("Light buffer writes, %u lights, %d frames\n", lightCount, frameCount);
+
+		//the whole buffer every frame, whatever the light count
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			source[frame % lightCount].intensity += 0.01f;
+			memcpy(destination.data(), source.data(), sizeof(Light) * MAX_LIGHTS);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		printf("  full buffer:                    %.3f ms/frame, %8.1f KB/frame\n",
+			std::chrono::duration<double, std::milli>(end - start).count() / frameCount, sizeof(Light) * MAX_LIGHTS / 1024.0);
+
+		const float changingFractions[] = { 0.0f, 0.01f, 0.1f, 1.0f };
+		for (float changingFraction : changingFractions)
+		{
+			LightManager manager;
+			std::vector<UINT> handles(lightCount);
+			for (UINT i = 0; i < lightCount; i++)
+			{
+				Light light = {};
+				light.type = LIGHT_TYPE_POINT;
+				light.color = Vector3(1, 1, 1);
+				light.range = 50;
+				light.position = Vector3(distribution(generator), distribution(generator), distribution(generator));
+				light.intensity = 1;
+				handles[i] = manager.AddLight(light);
+			}
+			manager.FlushDirty(destination.data());
+
+			UINT changing = (UINT)(lightCount * changingFraction);
+			double flushTime = 0.0;
+			UINT64 bytes = 0;
+			UINT ranges = 0;
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				start = std::chrono::high_resolution_clock::now();
+				for (UINT i = 0; i < changing; i++)
+				{
+					UINT handle = handles[(i * 7919u + frame) % lightCount];
+					Light light = manager.GetLight(handle);
+					light.position.x += 0.01f;
+					manager.SetLight(handle, light);
+				}
+				manager.FlushDirty(destination.data());
+				end = std::chrono::high_resolution_clock::now();
+
+				flushTime += std::chrono::duration<double, std::milli>(end - start).count();
+				bytes += manager.GetStats().bytesLastFlush;
+				ranges += manager.GetStats().rangesLastFlush;
+			}
+
+			printf("  set + dirty flush, %5.1f%% changing: %.3f ms/frame, %8.1f KB/frame in %u ranges\n", changingFraction * 100.0f,
+				flushTime / frameCount, bytes / (double)frameCount / 1024.0, ranges / frameCount);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include"Lights.h"
+#include<vector>
+
+struct LightManagerStats
+{
+	UINT lightCount;
+
+	//written by the last flush
+	UINT dirtyLastFlush;
+	UINT rangesLastFlush;
+	UINT64 bytesLastFlush;
+};
+
+//a run of neighbouring lights written by a flush, the same run is copied from the staging buffer to the one the shaders read
+struct LightRange
+{
+	UINT first;
+	UINT count;
+};
+
+//the scene lights packed at the start of an array the size of the light buffer, so the shaders only loop over
+//lightCount of them. Lights are referred to by handles that stay valid while removals move other lights into the gap,
+//and only the lights that changed since the last flush are written to the gpu
+class LightManager
+{
+	std::vector<Light> lights;
+	UINT lightCount;
+
+	//handle -> index in the packed array and back
+	std::vector<UINT> handleIndices;
+	std::vector<UINT> indexHandles;
+	std::vector<UINT> freeHandles;
+
+	std::vector<UINT> dirtyIndices;
+	std::vector<UINT8> dirtyFlags;
+
+	LightManagerStats stats;
+	std::vector<LightRange> flushedRanges;
+
+	void MarkDirty(UINT index);
+
+public:
+	LightManager(UINT capacity = MAX_LIGHTS);
+	~LightManager();
+
+	//returns the handle of the light, throws when the buffer is full
+	UINT AddLight(const Light& light);
+	//the last light moves into the gap so the array stays packed
+	void RemoveLight(UINT handle);
+
+	//only marks the light dirty when it actually changed
+	void SetLight(UINT handle, const Light& light);
+	const Light& GetLight(UINT handle);
+	void MarkAllDirty();
+
+	//copies the dirty lights to dest, runs of neighbouring lights are copied together, and their culling entries to
+	//cullDest when there is one. Returns the number written
+	UINT FlushDirty(Light* dest, LightCullData* cullDest = nullptr);
+	//the runs the last flush wrote, in the order they were written
+	const std::vector<LightRange>& GetFlushedRanges();
+
+	//the packed lights, GetLightCount of them in the order the light buffer has them
+	const Light* GetLights();
+	UINT GetLightCount();
+	UINT GetCapacity();
+	const LightManagerStats& GetStats();
+};
+
+//per frame cost of writing the light buffer at 100, 1k and 20k lights, the whole buffer copied every frame
+//against the dirty flush with a fraction of the lights changing
+void BenchmarkLightManager(int frameCount = 60);
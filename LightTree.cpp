@@ -0,0 +1,831 @@
+#include "LightTree.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cfloat>
+#include<chrono>
+#include<random>
+
+static const float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
+
+static float Luminance(const Vector3& color)
+{
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+static float SafeSqrt(float value)
+{
+	return sqrtf(std::max(value, 0.0f));
+}
+
+static float SafeAcos(float value)
+{
+	return acosf(std::clamp(value, -1.0f, 1.0f));
+}
+
+//cos(max(a - b, 0)) and sin(max(a - b, 0)) from the sines and cosines of a and b
+static float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+	if (cosA > cosB)
+		return 1.0f;
+	return cosA * cosB + sinA * sinB;
+}
+
+static float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+	if (cosA > cosB)
+		return 0.0f;
+	return sinA * cosB - cosA * sinB;
+}
+
+//the same rotation LTCLighting.hlsli applies to the area light's axes, angles in turns
+static Vector3 RotateAreaAxis(Vector3 v, const AreaLight& area)
+{
+	float ax = area.rotX * 2.0f * PI;
+	float ay = area.rotY * 2.0f * PI;
+	float az = area.rotZ * 2.0f * PI;
+
+	v = Vector3(v.x * cosf(ay) + v.z * sinf(ay), v.y, -v.x * sinf(ay) + v.z * cosf(ay));
+	v = Vector3(v.x * cosf(az) - v.y * sinf(az), v.x * sinf(az) + v.y * cosf(az), v.z);
+	return Vector3(v.x, cosf(ax) * v.y - v.z * sinf(ax), sinf(ax) * v.y + cosf(ax) * v.z);
+}
+
+static bool IsInfinite(const Light& light)
+{
+	return light.type == LIGHT_TYPE_DIR;
+}
+
+static LightTreeNode GetLightBounds(const Light& light, UINT index)
+{
+	LightTreeNode bounds = {};
+	bounds.boundsMin = light.position;
+	bounds.boundsMax = light.position;
+	bounds.range = light.range;
+	bounds.axis = Vector3(0, 0, 1);
+	bounds.cosThetaO = -1.0f;
+	bounds.cosThetaE = 0.0f;
+	bounds.childOrLight = index;
+	bounds.isLeaf = 1;
+
+	float flux = std::max(light.intensity, 0.0f) * std::max(Luminance(light.color), 0.0f);
+
+	if (light.type == LIGHT_TYPE_SPOT)
+	{
+		//the penumbra is pow(dot(-L, direction), spotFalloff), nothing past 90 degrees
+		bounds.axis = light.direction;
+		bounds.axis.Normalize();
+		bounds.cosThetaO = 1.0f;
+		bounds.power = flux * 2.0f * PI;
+	}
+
+	else if (light.type == LIGHT_TYPE_AREA_RECT || light.type == LIGHT_TYPE_AREA_DISK)
+	{
+		Vector3 ex = RotateAreaAxis(Vector3(1, 0, 0), light.rectLight) * (0.5f * light.rectLight.width);
+		Vector3 ey = RotateAreaAxis(Vector3(0, 1, 0), light.rectLight) * (0.5f * light.rectLight.height);
+		Vector3 corners[4] = { light.position - ex - ey, light.position + ex - ey, light.position + ex + ey, light.position - ex + ey };
+		for (const Vector3& corner : corners)
+		{
+			bounds.boundsMin = Vector3::Min(bounds.boundsMin, corner);
+			bounds.boundsMax = Vector3::Max(bounds.boundsMax, corner);
+		}
+
+		//the ltc integration can be two sided and doesn't use the range
+		float area = light.rectLight.width * light.rectLight.height * (light.type == LIGHT_TYPE_AREA_DISK ? 0.25f * PI : 1.0f);
+		bounds.axis = ex.Cross(ey);
+		bounds.axis.Normalize();
+		bounds.range = FLT_MAX;
+		bounds.power = flux * area * PI;
+	}
+
+	else
+	{
+		bounds.power = flux * 4.0f * PI;
+	}
+
+	return bounds;
+}
+
+//the smallest cone holding both cones
+static void UnionCones(const LightTreeNode& a, const LightTreeNode& b, Vector3& axis, float& cosTheta)
+{
+	axis = Vector3(0, 0, 1);
+	cosTheta = -1.0f;
+	if (a.cosThetaO == -1.0f || b.cosThetaO == -1.0f)
+		return;
+
+	float thetaA = SafeAcos(a.cosThetaO);
+	float thetaB = SafeAcos(b.cosThetaO);
+	float thetaD = SafeAcos(a.axis.Dot(b.axis));
+
+	if (std::min(thetaD + thetaB, PI) <= thetaA)
+	{
+		axis = a.axis;
+		cosTheta = a.cosThetaO;
+		return;
+	}
+
+	if (std::min(thetaD + thetaA, PI) <= thetaB)
+	{
+		axis = b.axis;
+		cosTheta = b.cosThetaO;
+		return;
+	}
+
+	float thetaO = (thetaA + thetaD + thetaB) * 0.5f;
+	if (thetaO >= PI)
+		return;
+
+	//rotate a's axis towards b's until the cone's edge reaches past both
+	Vector3 rotationAxis = a.axis.Cross(b.axis);
+	if (rotationAxis.LengthSquared() < 1e-12f)
+		return;
+	rotationAxis.Normalize();
+
+	float thetaR = thetaO - thetaA;
+	Vector3 v = a.axis;
+	axis = v * cosf(thetaR) + rotationAxis.Cross(v) * sinf(thetaR) + rotationAxis * (rotationAxis.Dot(v) * (1.0f - cosf(thetaR)));
+	axis.Normalize();
+	cosTheta = cosf(thetaO);
+}
+
+//bounds holding nothing, the start of a union
+static LightTreeNode GetEmptyBounds()
+{
+	LightTreeNode bounds = {};
+	bounds.boundsMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	bounds.boundsMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	return bounds;
+}
+
+static bool IsEmpty(const LightTreeNode& bounds)
+{
+	return bounds.boundsMin.x > bounds.boundsMax.x;
+}
+
+static LightTreeNode UnionBounds(const LightTreeNode& a, const LightTreeNode& b)
+{
+	if (IsEmpty(a))
+		return b;
+	if (IsEmpty(b))
+		return a;
+
+	LightTreeNode bounds = {};
+	bounds.boundsMin = Vector3::Min(a.boundsMin, b.boundsMin);
+	bounds.boundsMax = Vector3::Max(a.boundsMax, b.boundsMax);
+	bounds.power = a.power + b.power;
+	bounds.range = std::max(a.range, b.range);
+	UnionCones(a, b, bounds.axis, bounds.cosThetaO);
+	bounds.cosThetaE = std::min(a.cosThetaE, b.cosThetaE);
+	return bounds;
+}
+
+//the surface area orientation heuristic, power times the solid angle the cones emit into times the box's area, with
+//boxes thin along the split axis made more expensive
+static float GetSplitCost(const LightTreeNode& bounds, const Vector3& parentExtent, int axis)
+{
+	Vector3 extent = bounds.boundsMax - bounds.boundsMin;
+	float area = 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	float axisExtent = (&parentExtent.x)[axis];
+	float aspect = std::max(std::max(parentExtent.x, parentExtent.y), parentExtent.z) / axisExtent;
+
+	//any point light below makes the cone the whole sphere, skips the trigonometry for most of the tree
+	if (bounds.cosThetaO == -1.0f)
+		return bounds.power * 4.0f * PI * aspect * area;
+
+	float thetaO = SafeAcos(bounds.cosThetaO);
+	float thetaE = SafeAcos(bounds.cosThetaE);
+	float thetaW = std::min(thetaO + thetaE, PI);
+	float sinThetaO = SafeSqrt(1.0f - bounds.cosThetaO * bounds.cosThetaO);
+	float orientation = 2.0f * PI * (1.0f - bounds.cosThetaO) + PI * 0.5f * (2.0f * thetaW * sinThetaO - cosf(thetaO - 2.0f * thetaW)
+		- 2.0f * thetaO * sinThetaO + bounds.cosThetaO);
+	return bounds.power * orientation * aspect * area;
+}
+
+LightTree::LightTree()
+{
+	ZeroMemory(&stats, sizeof(LightTreeStats));
+}
+
+LightTree::~LightTree()
+{
+}
+
+float LightTree::Importance(const LightTreeNode& node, const Vector3& point, const Vector3& normal)
+{
+	Vector3 outside = Vector3::Max(Vector3::Max(node.boundsMin - point, point - node.boundsMax), Vector3(0, 0, 0));
+	if (node.range != FLT_MAX && outside.LengthSquared() > node.range * node.range)
+		return 0.0f;
+
+	Vector3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+	float radius = (node.boundsMax - node.boundsMin).Length() * 0.5f;
+	float centerDistance2 = Vector3::DistanceSquared(point, center);
+	//keeps points inside large nodes from getting unbounded importance
+	float distance2 = std::max(centerDistance2, radius);
+
+	Vector3 wi = point - center;
+	if (centerDistance2 > 0.0f)
+		wi /= sqrtf(centerDistance2);
+
+	float cosThetaW = node.axis.Dot(wi);
+	float sinThetaW = SafeSqrt(1.0f - cosThetaW * cosThetaW);
+
+	//the half angle the bounds span seen from the point
+	float cosThetaB = -1.0f;
+	if (outside.LengthSquared() > 0.0f && radius * radius < centerDistance2)
+		cosThetaB = SafeSqrt(1.0f - radius * radius / centerDistance2);
+	float sinThetaB = SafeSqrt(1.0f - cosThetaB * cosThetaB);
+
+	float sinThetaO = SafeSqrt(1.0f - node.cosThetaO * node.cosThetaO);
+	float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+	float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, node.cosThetaO);
+	float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+	if (cosThetaP <= node.cosThetaE)
+		return 0.0f;
+
+	float importance = node.power * cosThetaP / distance2;
+
+	//the surfaces are one sided, the lights below the horizon give nothing
+	if (normal.LengthSquared() > 0.0f)
+	{
+		float cosThetaI = -wi.Dot(normal);
+		float sinThetaI = SafeSqrt(1.0f - cosThetaI * cosThetaI);
+		float cosThetaIP = CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+		if (cosThetaIP <= 0.0f)
+			return 0.0f;
+		importance *= cosThetaIP;
+	}
+
+	return std::max(importance, 0.0f);
+}
+
+UINT LightTree::BuildNodes(std::vector<BuildLight>& buildLights, size_t begin, size_t end, UINT parent, UINT depth)
+{
+	UINT nodeIndex = (UINT)nodes.size();
+	nodes.emplace_back();
+	parents.emplace_back(parent);
+	stats.depth = std::max(stats.depth, depth);
+
+	if (end - begin == 1)
+	{
+		nodes[nodeIndex] = buildLights[begin].bounds;
+		lightLeaves[buildLights[begin].light] = nodeIndex;
+		return nodeIndex;
+	}
+
+	LightTreeNode bounds = GetEmptyBounds();
+	Vector3 centroidMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 centroidMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = begin; i < end; i++)
+	{
+		bounds = UnionBounds(bounds, buildLights[i].bounds);
+		centroidMin = Vector3::Min(centroidMin, buildLights[i].centroid);
+		centroidMax = Vector3::Max(centroidMax, buildLights[i].centroid);
+	}
+
+	const int bucketCount = 12;
+	Vector3 extent = bounds.boundsMax - bounds.boundsMin;
+	Vector3 centroidExtent = centroidMax - centroidMin;
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBucket = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float axisMin = (&centroidMin.x)[axis];
+		float axisExtent = (&centroidExtent.x)[axis];
+		if (axisExtent <= 0.0f || (&extent.x)[axis] <= 0.0f)
+			continue;
+
+		LightTreeNode buckets[bucketCount];
+		std::fill(buckets, buckets + bucketCount, GetEmptyBounds());
+		for (size_t i = begin; i < end; i++)
+		{
+			int bucket = std::min((int)(bucketCount * ((&buildLights[i].centroid.x)[axis] - axisMin) / axisExtent), bucketCount - 1);
+			buckets[bucket] = UnionBounds(buckets[bucket], buildLights[i].bounds);
+		}
+
+		//a split after every bucket but the last
+		LightTreeNode below[bucketCount];
+		below[0] = buckets[0];
+		for (int b = 1; b < bucketCount; b++)
+			below[b] = UnionBounds(below[b - 1], buckets[b]);
+
+		LightTreeNode above = GetEmptyBounds();
+		for (int b = bucketCount - 1; b > 0; b--)
+		{
+			above = UnionBounds(above, buckets[b]);
+			if (IsEmpty(below[b - 1]) || IsEmpty(above))
+				continue;
+
+			float cost = GetSplitCost(below[b - 1], extent, axis) + GetSplitCost(above, extent, axis);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBucket = b;
+			}
+		}
+	}
+
+	size_t mid;
+	if (bestAxis == -1)
+	{
+		//every light in one spot
+		mid = (begin + end) / 2;
+	}
+
+	else
+	{
+		float axisMin = (&centroidMin.x)[bestAxis];
+		float axisExtent = (&centroidExtent.x)[bestAxis];
+		mid = std::partition(buildLights.begin() + begin, buildLights.begin() + end, [=](const BuildLight& light)
+		{
+			return std::min((int)(bucketCount * ((&light.centroid.x)[bestAxis] - axisMin) / axisExtent), bucketCount - 1) < bestBucket;
+		}) - buildLights.begin();
+
+		if (mid == begin || mid == end)
+			mid = (begin + end) / 2;
+	}
+
+	BuildNodes(buildLights, begin, mid, nodeIndex, depth + 1);
+	UINT second = BuildNodes(buildLights, mid, end, nodeIndex, depth + 1);
+
+	LightTreeNode& node = nodes[nodeIndex];
+	node = UnionBounds(nodes[nodeIndex + 1], nodes[second]);
+	node.childOrLight = second;
+	node.isLeaf = 0;
+	return nodeIndex;
+}
+
+void LightTree::Build(const Light* lights, UINT lightCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	nodes.clear();
+	parents.clear();
+	infiniteLights.clear();
+	lightLeaves.assign(lightCount, UINT_MAX);
+	stats.depth = 0;
+
+	std::vector<BuildLight> buildLights;
+	buildLights.reserve(lightCount);
+	for (UINT i = 0; i < lightCount; i++)
+	{
+		if (IsInfinite(lights[i]))
+		{
+			infiniteLights.emplace_back(i);
+			continue;
+		}
+
+		BuildLight buildLight;
+		buildLight.bounds = GetLightBounds(lights[i], i);
+		buildLight.centroid = (buildLight.bounds.boundsMin + buildLight.bounds.boundsMax) * 0.5f;
+		buildLight.light = i;
+		buildLights.emplace_back(buildLight);
+	}
+
+	if (!buildLights.empty())
+	{
+		nodes.reserve(buildLights.size() * 2 - 1);
+		BuildNodes(buildLights, 0, buildLights.size(), UINT_MAX, 0);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+	stats.nodeCount = (UINT)nodes.size();
+	stats.infiniteLights = (UINT)infiniteLights.size();
+}
+
+void LightTree::Refit(const Light* lights, UINT lightCount)
+{
+	if (lightCount != lightLeaves.size())
+		throw std::logic_error("Light tree refit with a different light count");
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (UINT i = 0; i < lightCount; i++)
+	{
+		if (lightLeaves[i] == UINT_MAX)
+			continue;
+		nodes[lightLeaves[i]] = GetLightBounds(lights[i], i);
+	}
+
+	//children always come after their parent
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		LightTreeNode& node = nodes[i];
+		if (node.isLeaf)
+			continue;
+
+		UINT second = node.childOrLight;
+		node = UnionBounds(nodes[i + 1], nodes[second]);
+		node.childOrLight = second;
+		node.isLeaf = 0;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.refitTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+float LightTree::GetInfiniteProbability()
+{
+	if (infiniteLights.empty())
+		return 0.0f;
+	return (float)infiniteLights.size() / (infiniteLights.size() + (nodes.empty() ? 0 : 1));
+}
+
+UINT LightTree::Sample(const Vector3& point, const Vector3& normal, float u, float& pdf)
+{
+	float infiniteProbability = GetInfiniteProbability();
+	if (u < infiniteProbability)
+	{
+		UINT index = std::min((UINT)(u / infiniteProbability * infiniteLights.size()), (UINT)infiniteLights.size() - 1);
+		pdf = infiniteProbability / infiniteLights.size();
+		return infiniteLights[index];
+	}
+
+	pdf = 0.0f;
+	if (nodes.empty())
+		return UINT_MAX;
+
+	u = std::min((u - infiniteProbability) / (1.0f - infiniteProbability), ONE_MINUS_EPSILON);
+	float probability = 1.0f - infiniteProbability;
+	UINT nodeIndex = 0;
+
+	while (!nodes[nodeIndex].isLeaf)
+	{
+		UINT children[2] = { nodeIndex + 1, nodes[nodeIndex].childOrLight };
+		float importance[2] = { Importance(nodes[children[0]], point, normal), Importance(nodes[children[1]], point, normal) };
+		if (importance[0] == 0.0f && importance[1] == 0.0f)
+			return UINT_MAX;
+
+		//u is reused for the next level after stretching the picked part back to [0, 1)
+		float first = importance[0] / (importance[0] + importance[1]);
+		if (u < first)
+		{
+			nodeIndex = children[0];
+			u = std::min(u / first, ONE_MINUS_EPSILON);
+			probability *= first;
+		}
+
+		else
+		{
+			nodeIndex = children[1];
+			u = std::min((u - first) / (1.0f - first), ONE_MINUS_EPSILON);
+			probability *= 1.0f - first;
+		}
+	}
+
+	//the parent's test already covers every leaf but a root on its own
+	if (nodeIndex == 0 && Importance(nodes[0], point, normal) == 0.0f)
+		return UINT_MAX;
+
+	pdf = probability;
+	return nodes[nodeIndex].childOrLight;
+}
+
+float LightTree::Pdf(const Vector3& point, const Vector3& normal, UINT light)
+{
+	float infiniteProbability = GetInfiniteProbability();
+	UINT leaf = lightLeaves[light];
+	if (leaf == UINT_MAX)
+		return infiniteProbability / infiniteLights.size();
+
+	if (leaf == 0)
+		return Importance(nodes[0], point, normal) > 0.0f ? 1.0f - infiniteProbability : 0.0f;
+
+	float probability = 1.0f - infiniteProbability;
+	for (UINT child = leaf, parent = parents[leaf]; parent != UINT_MAX; child = parent, parent = parents[parent])
+	{
+		float first = Importance(nodes[parent + 1], point, normal);
+		float second = Importance(nodes[nodes[parent].childOrLight], point, normal);
+		float picked = child == parent + 1 ? first : second;
+		if (picked == 0.0f)
+			return 0.0f;
+		probability *= picked / (first + second);
+	}
+	return probability;
+}
+
+const std::vector<LightTreeNode>& LightTree::GetNodes()
+{
+	return nodes;
+}
+
+const LightTreeStats& LightTree::GetStats()
+{
+	return stats;
+}
+
+//what the light gives an unshadowed point, the way the raytraced lighting shades it, area lights as a point at their
+//center
+static float GetLightContribution(const Light& light, const Vector3& point, const Vector3& normal)
+{
+	float flux = light.intensity * Luminance(light.color);
+	if (light.type == LIGHT_TYPE_DIR)
+		return flux * std::max(-normal.Dot(light.direction), 0.0f);
+
+	Vector3 toLight = light.position - point;
+	float distance2 = toLight.LengthSquared();
+	Vector3 L = toLight / sqrtf(distance2);
+	float nDotL = std::max(normal.Dot(L), 0.0f);
+
+	if (light.type == LIGHT_TYPE_AREA_RECT || light.type == LIGHT_TYPE_AREA_DISK)
+	{
+		Vector3 ex = RotateAreaAxis(Vector3(1, 0, 0), light.rectLight);
+		Vector3 ey = RotateAreaAxis(Vector3(0, 1, 0), light.rectLight);
+		float cosLight = fabsf(ex.Cross(ey).Dot(L));
+		return flux * light.rectLight.width * light.rectLight.height * cosLight * nDotL / distance2;
+	}
+
+	float attenuation = std::clamp(1.0f - distance2 / (light.range * light.range), 0.0f, 1.0f);
+	float contribution = flux * nDotL * attenuation * attenuation;
+	if (light.type == LIGHT_TYPE_SPOT)
+		contribution *= powf(std::max(-L.Dot(light.direction), 0.0f), light.spotFalloff);
+	return contribution;
+}
+
+static std::vector<Light> MakeLightTreeScene(UINT count, UINT directionalCount, UINT seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Light> lights(count);
+	for (UINT i = 0; i < count; i++)
+	{
+		Light light = {};
+		light.position = Vector3(position(generator), position(generator) * 0.2f, position(generator));
+		light.color = Vector3(unit(generator), unit(generator), unit(generator));
+		light.intensity = 0.5f + unit(generator) * 4.0f;
+		light.range = 5.0f + unit(generator) * 25.0f;
+
+		float type = unit(generator);
+		if (i < directionalCount)
+		{
+			light.type = LIGHT_TYPE_DIR;
+			light.direction = Vector3(unit(generator) - 0.5f, -1.0f, unit(generator) - 0.5f);
+			light.direction.Normalize();
+		}
+
+		else if (type < 0.7f)
+			light.type = LIGHT_TYPE_POINT;
+
+		else if (type < 0.9f)
+		{
+			light.type = LIGHT_TYPE_SPOT;
+			light.direction = Vector3(unit(generator) - 0.5f, -1.0f, unit(generator) - 0.5f);
+			light.direction.Normalize();
+			light.spotFalloff = 4.0f + unit(generator) * 28.0f;
+		}
+
+		else
+		{
+			light.type = type < 0.95f ? LIGHT_TYPE_AREA_RECT : LIGHT_TYPE_AREA_DISK;
+			light.rectLight.width = 1.0f + unit(generator) * 3.0f;
+			light.rectLight.height = 1.0f + unit(generator) * 3.0f;
+			light.rectLight.rotX = unit(generator);
+			light.rectLight.rotY = unit(generator);
+			light.rectLight.rotZ = unit(generator);
+		}
+
+		lights[i] = light;
+	}
+	return lights;
+}
+
+static void MakeShadingPoint(std::mt19937& generator, Vector3& point, Vector3& normal)
+{
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	point = Vector3(position(generator), position(generator) * 0.2f, position(generator));
+	do
+	{
+		normal = Vector3(unit(generator), unit(generator), unit(generator));
+	} while (normal.LengthSquared() > 1.0f || normal.LengthSquared() < 1e-4f);
+	normal.Normalize();
+}
+
+//the chance the traversal ends at a node whose children both have no importance and picks nothing. It and the pdfs of
+//all lights add up to one
+static double GetDeadEndProbability(const std::vector<LightTreeNode>& nodes, const Vector3& point, const Vector3& normal, double treeProbability)
+{
+	if (nodes.empty())
+		return 0.0;
+	if (nodes[0].isLeaf)
+		return LightTree::Importance(nodes[0], point, normal) > 0.0f ? 0.0 : treeProbability;
+
+	double deadEnd = 0.0;
+	std::vector<std::pair<UINT, double>> stack = { { 0, treeProbability } };
+	while (!stack.empty())
+	{
+		auto [nodeIndex, probability] = stack.back();
+		stack.pop_back();
+		if (nodes[nodeIndex].isLeaf)
+			continue;
+
+		UINT children[2] = { nodeIndex + 1, nodes[nodeIndex].childOrLight };
+		float first = LightTree::Importance(nodes[children[0]], point, normal);
+		float second = LightTree::Importance(nodes[children[1]], point, normal);
+		if (first == 0.0f && second == 0.0f)
+		{
+			deadEnd += probability;
+			continue;
+		}
+
+		if (first > 0.0f)
+			stack.push_back({ children[0], probability * first / (first + second) });
+		if (second > 0.0f)
+			stack.push_back({ children[1], probability * second / (first + second) });
+	}
+	return deadEnd;
+}
+
+void ValidateLightTree()
+{
+	printf("Light tree\n");
+	bool passed = true;
+
+	std::vector<Light> lights = MakeLightTreeScene(2000, 3, 11);
+	LightTree tree;
+	tree.Build(lights.data(), (UINT)lights.size());
+
+	const std::vector<LightTreeNode>& nodes = tree.GetNodes();
+	bool nested = true;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].isLeaf)
+			continue;
+		UINT children[2] = { (UINT)i + 1, nodes[i].childOrLight };
+		for (UINT child : children)
+		{
+			nested = nested && child > i && child < nodes.size() && nodes[child].power <= nodes[i].power * 1.0001f
+				&& nodes[child].boundsMin.x >= nodes[i].boundsMin.x && nodes[child].boundsMax.x <= nodes[i].boundsMax.x
+				&& nodes[child].boundsMin.y >= nodes[i].boundsMin.y && nodes[child].boundsMax.y <= nodes[i].boundsMax.y
+				&& nodes[child].boundsMin.z >= nodes[i].boundsMin.z && nodes[child].boundsMax.z <= nodes[i].boundsMax.z;
+		}
+	}
+	Check(passed, "children inside their parents", nested && nodes.size() == 2 * (lights.size() - 3) - 1);
+
+	//every light that gives the point anything must be pickable, and the pdfs of all lights sum to one
+	auto checkPdfs = [&](LightTree& tree, const std::vector<Light>& lights, UINT seed, bool& sumsToOne, bool& covered, bool& samplesMatch)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		sumsToOne = true;
+		covered = true;
+		samplesMatch = true;
+
+		for (int p = 0; p < 200; p++)
+		{
+			Vector3 point, normal;
+			MakeShadingPoint(generator, point, normal);
+
+			//the directional lights get 3/4 of the picks
+			double sum = GetDeadEndProbability(tree.GetNodes(), point, normal, 0.25);
+			for (UINT i = 0; i < lights.size(); i++)
+			{
+				float pdf = tree.Pdf(point, normal, i);
+				sum += pdf;
+				if (GetLightContribution(lights[i], point, normal) > 0.0f && pdf <= 0.0f)
+					covered = false;
+			}
+			sumsToOne = sumsToOne && fabs(sum - 1.0) < 1e-4;
+
+			for (int s = 0; s < 16; s++)
+			{
+				float pdf;
+				UINT light = tree.Sample(point, normal, unit(generator), pdf);
+				if (light == UINT_MAX)
+					samplesMatch = samplesMatch && pdf == 0.0f;
+				else
+					samplesMatch = samplesMatch && fabsf(pdf - tree.Pdf(point, normal, light)) <= 1e-5f * pdf;
+			}
+		}
+	};
+
+	bool sumsToOne, covered, samplesMatch;
+	checkPdfs(tree, lights, 3, sumsToOne, covered, samplesMatch);
+	Check(passed, "pdfs and dead ends sum to one", sumsToOne);
+	Check(passed, "every contributing light can be picked", covered);
+	Check(passed, "sampled pdfs match Pdf", samplesMatch);
+
+	//picked often enough to match the pdfs at one point
+	{
+		std::mt19937 generator(5);
+		Vector3 point(10, 0, 10), normal(0, 1, 0);
+		std::vector<UINT> histogram(lights.size());
+		const UINT sampleCount = 400000;
+		for (UINT s = 0; s < sampleCount; s++)
+		{
+			float pdf;
+			UINT light = tree.Sample(point, normal, (s + 0.5f) / sampleCount, pdf);
+			if (light != UINT_MAX)
+				histogram[light]++;
+		}
+
+		bool frequenciesMatch = true;
+		for (UINT i = 0; i < lights.size(); i++)
+		{
+			double expected = tree.Pdf(point, normal, i) * sampleCount;
+			if (expected > 100.0)
+				frequenciesMatch = frequenciesMatch && fabs(histogram[i] - expected) < 0.05 * expected + 2.0;
+			else if (expected == 0.0)
+				frequenciesMatch = frequenciesMatch && histogram[i] == 0;
+		}
+		Check(passed, "sampled frequencies follow the pdfs", frequenciesMatch);
+	}
+
+	//moving lights and refitting keeps the tree valid for the new positions
+	std::mt19937 generator(9);
+	std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+	for (Light& light : lights)
+	{
+		light.position += Vector3(offset(generator), offset(generator), offset(generator));
+	}
+	tree.Refit(lights.data(), (UINT)lights.size());
+
+	checkPdfs(tree, lights, 4, sumsToOne, covered, samplesMatch);
+	Check(passed, "refit pdfs and dead ends sum to one", sumsToOne);
+	Check(passed, "refit keeps moved lights pickable", covered && samplesMatch);
+
+	LightTree infiniteOnly;
+	std::vector<Light> directional(lights.begin(), lights.begin() + 3);
+	infiniteOnly.Build(directional.data(), (UINT)directional.size());
+	float pdf;
+	UINT light = infiniteOnly.Sample(Vector3(0, 0, 0), Vector3(0, 1, 0), 0.9f, pdf);
+	Check(passed, "directional lights only", light == 2 && fabsf(pdf - 1.0f / 3.0f) < 1e-6f && infiniteOnly.GetNodes().empty());
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkLightTree(int frameCount)
+{
+	std::vector<Light> lights = MakeLightTreeScene(20000, 4, 1);
+	LightTree tree;
+
+	double buildTime = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		tree.Build(lights.data(), (UINT)lights.size());
+		buildTime += tree.GetStats().buildTime;
+	}
+
+	double refitTime = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		for (size_t i = frame % 2; i < lights.size(); i += 2)
+		{
+			lights[i].position.x += 0.1f;
+		}
+		tree.Refit(lights.data(), (UINT)lights.size());
+		refitTime += tree.GetStats().refitTime;
+	}
+
+	const LightTreeStats& stats = tree.GetStats();
+	printf("Light tree, %zu lights, %u directional, %d frames\n", lights.size(), stats.infiniteLights, frameCount);
+	printf("  build: %.3f ms, refit: %.3f ms, %u nodes, %.1f KB, depth %u\n", buildTime / frameCount, refitTime / frameCount,
+		stats.nodeCount, stats.nodeCount * sizeof(LightTreeNode) / 1024.0, stats.depth);
+
+	//one light per point, weighted by its pdf, against the sum over every light
+	std::mt19937 generator(2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int pointCount = 500;
+	const int samplesPerPoint = 64;
+	double uniformError = 0.0;
+	double treeError = 0.0;
+	double sampleTime = 0.0;
+
+	for (int p = 0; p < pointCount; p++)
+	{
+		Vector3 point, normal;
+		MakeShadingPoint(generator, point, normal);
+
+		double reference = 0.0;
+		for (const Light& light : lights)
+		{
+			reference += GetLightContribution(light, point, normal);
+		}
+		if (reference <= 0.0)
+			continue;
+
+		for (int s = 0; s < samplesPerPoint; s++)
+		{
+			UINT uniformLight = std::min((UINT)(unit(generator) * lights.size()), (UINT)lights.size() - 1);
+			double uniformEstimate = GetLightContribution(lights[uniformLight], point, normal) * lights.size();
+			uniformError += (uniformEstimate - reference) * (uniformEstimate - reference) / (reference * reference);
+
+			float pdf;
+			auto start = std::chrono::high_resolution_clock::now();
+			UINT treeLight = tree.Sample(point, normal, unit(generator), pdf);
+			auto end = std::chrono::high_resolution_clock::now();
+			sampleTime += std::chrono::duration<double, std::micro>(end - start).count();
+
+			double treeEstimate = treeLight == UINT_MAX ? 0.0 : GetLightContribution(lights[treeLight], point, normal) / pdf;
+			treeError += (treeEstimate - reference) * (treeEstimate - reference) / (reference * reference);
+		}
+	}
+
+	double sampleCount = (double)pointCount * samplesPerPoint;
+	printf("  one light estimate, relative rms error: uniform %.3f, tree %.3f, %.0f ns per tree sample\n",
+		sqrt(uniformError / sampleCount), sqrt(treeError / sampleCount), sampleTime * 1000.0 / sampleCount);
+}
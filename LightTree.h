@@ -0,0 +1,83 @@
+#pragma once
+
+#include"Lights.h"
+#include<vector>
+
+//a node of the light tree laid out for a structured buffer. Inner nodes have their first child right after them and
+//the second at childOrLight, leaves hold the index of their light
+struct LightTreeNode
+{
+	Vector3 boundsMin;
+	float power;
+	Vector3 boundsMax;
+	//the largest range of the lights below, the node lights nothing further than this from its bounds
+	float range;
+	Vector3 axis;
+	//the lights' directions are within acos(cosThetaO) of axis and they emit up to acos(cosThetaE) past that
+	float cosThetaO;
+	float cosThetaE;
+	UINT childOrLight;
+	UINT isLeaf;
+	UINT padding;
+};
+
+struct LightTreeStats
+{
+	double buildTime;
+	double refitTime;
+	UINT nodeCount;
+	UINT depth;
+	UINT infiniteLights;
+};
+
+//a bvh over the local lights for picking a light with probability proportional to a conservative estimate of what it
+//gives a shading point, so the pick stays good when there are thousands of lights. Every level the traversal weighs
+//both children by power, distance and the orientation cones. Directional lights reach everything and are picked
+//uniformly outside the tree
+class LightTree
+{
+	struct BuildLight
+	{
+		LightTreeNode bounds;
+		Vector3 centroid;
+		UINT light;
+	};
+
+	std::vector<LightTreeNode> nodes;
+	std::vector<UINT> parents;
+	//the leaf of every light, UINT_MAX for the lights outside the tree
+	std::vector<UINT> lightLeaves;
+	std::vector<UINT> infiniteLights;
+
+	LightTreeStats stats;
+
+	UINT BuildNodes(std::vector<BuildLight>& buildLights, size_t begin, size_t end, UINT parent, UINT depth);
+	float GetInfiniteProbability();
+
+public:
+	LightTree();
+	~LightTree();
+
+	void Build(const Light* lights, UINT lightCount);
+	//moves the bounds to where the lights are now without changing the tree. The lights have to be the ones it was
+	//built over, adding or removing lights or changing their type needs a Build
+	void Refit(const Light* lights, UINT lightCount);
+
+	//importance of a node for a shading point, 0 when none of its lights can reach it. A zero normal skips the
+	//surface facing term
+	static float Importance(const LightTreeNode& node, const Vector3& point, const Vector3& normal);
+
+	//picks a light for a shading point with u uniform in [0, 1), UINT_MAX when no light reaches it
+	UINT Sample(const Vector3& point, const Vector3& normal, float u, float& pdf);
+	//the probability Sample picks the light
+	float Pdf(const Vector3& point, const Vector3& normal, UINT light);
+
+	const std::vector<LightTreeNode>& GetNodes();
+	const LightTreeStats& GetStats();
+};
+
+//pdfs summing to one, sampled frequencies against the pdfs and refit against the moved lights
+void ValidateLightTree();
+
+//build and refit times at 20k lights and the error of a one light estimate against uniform picking
+void BenchmarkLightTree(int frameCount = 10);
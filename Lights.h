@@ -15,30 +15,7 @@ static const float PI = 3.14159265f;
 #define LIGHT_TYPE_AREA_RECT 3
 #define LIGHT_TYPE_AREA_DISK 4
 
-
-struct AreaLight
-{
-	float width;
-	float height;
-	float rotY;
-	float rotZ;
-	float rotX;
-	Vector3 padding;
-};
-
-struct Light
-{
-	int type;
-	Vector3 direction;
-	float range;
-	Vector3 position;
-	float intensity;
-	Vector3 diffuse;
-	float spotFalloff;
-	Vector3 color;
-
-	AreaLight rectLight;
-};
+#include"LightLayout.h"
 
 struct Decal
 {
@@ -65,29 +42,7 @@ struct Area
 	float3 center;
 };
 
-struct AreaLight
-{
-	float width;
-	float height;
-	float rotY;
-	float rotZ;
-	float rotX;
-	float3 padding;
-};
-
-struct Light
-{
-	int type;
-	float3 direction;
-	float range;
-	float3 position;
-	float intensity;
-	float3 diffuse;
-	float spotFalloff;
-	float3 color;
-
-	AreaLight rectLight;
-};
+#include "LightLayout.h"
 
 struct Decal
 {
@@ -1,6 +1,11 @@
 #include "Mesh.h"
+#include<atomic>
+
+static std::atomic<UINT64> nextMeshID = 1;
+
 Mesh::Mesh(std::vector<Vertex> vertices, unsigned int numVertices, std::vector<UINT> indices, int numIndices)
 {
+	meshID = nextMeshID++;
 	ComPtr<ID3D12Resource> vertexBufferDeafult;
 	vertexBuffer = CreateVBView(&vertices[0], numVertices, defaultHeap,uploadHeap);
 	indexBuffer = CreateIBView(&indices[0], numIndices, defaultIndexHeap, uploadIndexHeap);
@@ -16,6 +21,7 @@ Mesh::Mesh(std::vector<Vertex> vertices, unsigned int numVertices, std::vector<U
 
 Mesh::Mesh(std::string fileName)
 {
+	meshID = nextMeshID++;
 	vertexBuffer = {};
 	indexBuffer = {};
 	numIndices = 0;
@@ -102,6 +108,11 @@ ComPtr<ID3D12Resource>& Mesh::GetVertexBufferResource()
 	return defaultHeap;
 }
 
+ComPtr<ID3D12Resource>& Mesh::GetIndexBufferResource()
+{
+	return defaultIndexHeap;
+}
+
 unsigned int& Mesh::GetIndexCount()
 {
 	return numIndices;
@@ -117,6 +128,11 @@ std::vector<Vertex>& Mesh::GetVerts()
 	return vertices;
 }
 
+std::vector<unsigned int>& Mesh::GetIndices()
+{
+	return indices;
+}
+
 bool Mesh::RayMeshTest(Vector4 origin, Vector4 direction)
 {
 	auto triCount = numIndices / 3.0f;
@@ -412,3 +428,8 @@ UINT Mesh::GetMaterialID()
 {
 	return materialID;
 }
+
+UINT64 Mesh::GetMeshID()
+{
+	return meshID;
+}
@@ -32,6 +32,9 @@ class Mesh
 
 	UINT materialID;
 
+	//unique for the lifetime of the program, unlike the address of the mesh
+	UINT64 meshID;
+
 public:
 	Mesh(std::vector<Vertex> vertices, unsigned int numVertices, std::vector<UINT> indices, int numIndices);
 	Mesh(std::string fileName);
@@ -44,10 +47,12 @@ public:
 	D3D12_VERTEX_BUFFER_VIEW& GetVertexBuffer();
 	D3D12_INDEX_BUFFER_VIEW& GetIndexBuffer();
 	ComPtr<ID3D12Resource>& GetVertexBufferResource();
+	ComPtr<ID3D12Resource>& GetIndexBufferResource();
 	unsigned int& GetIndexCount();
 	unsigned int& GetVertexCount();
 	std::vector<Vector3>& GetPoints();
 	std::vector<Vertex>& GetVerts();
+	std::vector<unsigned int>& GetIndices();
 
 	bool RayMeshTest(Vector4 origin, Vector4 direction);
 
@@ -62,6 +67,8 @@ public:
 
 	UINT GetMaterialID();
 
+	UINT64 GetMeshID();
+
 	//function to load draw the mesh
 	//void Draw(ID3D11DeviceContext* context);
 };
@@ -77,17 +77,44 @@ Ocean::Ocean(std::shared_ptr<Mesh> waterMesh,
 	srvcbvuavDescriptorHeap.CreateDescriptor(htzTexture, RESOURCE_TYPE_SRV, 0, texSize, texSize, 0, 1);
 	srvcbvuavDescriptorHeap.CreateDescriptor(htzTexture, RESOURCE_TYPE_UAV, 0, texSize, texSize, 0, 1);
 
-	//creating the twiddle indices texture
-	int bits = (int)(log(texSize), log(2));
+	//creating the twiddle indices texture, one column per butterfly stage
+	auto fftPlan = FFTPlan::Get(texSize);
+	int bits = fftPlan->GetLog2Size();
 	h0TexDesc.Width = bits;
 
 	ThrowIfFailed(device->CreateCommittedResource(&GetAppResources().defaultHeapType, D3D12_HEAP_FLAG_NONE, &h0TexDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(twiddleTexture.resource.GetAddressOf())));
-	twiddleTexture.currentState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(twiddleTexture.resource.GetAddressOf())));
+
+	//the plan already holds what TwiddleFactorsCS would write, stage major, so it is transposed into rows of stages
+	const std::vector<XMFLOAT4>& twiddleData = fftPlan->GetTwiddleTextureData();
+	std::vector<XMFLOAT4> twiddleTexels(twiddleData.size());
+	for (int y = 0; y < texSize; y++)
+	{
+		for (int stage = 0; stage < bits; stage++)
+		{
+			twiddleTexels[(size_t)y * bits + stage] = twiddleData[(size_t)stage * texSize + y];
+		}
+	}
+
+	const UINT64 twiddleUploadSize = GetRequiredIntermediateSize(twiddleTexture.resource.Get(), 0, 1);
+	auto twiddleUploadDesc = CD3DX12_RESOURCE_DESC::Buffer(twiddleUploadSize);
+	ThrowIfFailed(device->CreateCommittedResource(&GetAppResources().uploadHeapType, D3D12_HEAP_FLAG_NONE, &twiddleUploadDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(twiddleUploadHeap.GetAddressOf())));
+
+	D3D12_SUBRESOURCE_DATA twiddleTextureData = {};
+	twiddleTextureData.pData = twiddleTexels.data();
+	twiddleTextureData.RowPitch = sizeof(XMFLOAT4) * bits;
+	twiddleTextureData.SlicePitch = twiddleTextureData.RowPitch * texSize;
+	UpdateSubresources<1>(GetAppResources().commandList.Get(), twiddleTexture.resource.Get(), twiddleUploadHeap.Get(), 0, 0, 1, &twiddleTextureData);
+
+	auto twiddleTransition = CD3DX12_RESOURCE_BARRIER::Transition(twiddleTexture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	GetAppResources().commandList->ResourceBarrier(1, &twiddleTransition);
+	twiddleTexture.currentState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
 
 	//creating twiddle uav and srv
-	srvcbvuavDescriptorHeap.CreateDescriptor(twiddleTexture, RESOURCE_TYPE_SRV, 0, texSize, texSize, 0, 1);
-	srvcbvuavDescriptorHeap.CreateDescriptor(twiddleTexture, RESOURCE_TYPE_UAV, 0, texSize, texSize, 0, 1);
+	srvcbvuavDescriptorHeap.CreateDescriptor(twiddleTexture, RESOURCE_TYPE_SRV, 0, bits, texSize, 0, 1);
+	srvcbvuavDescriptorHeap.CreateDescriptor(twiddleTexture, RESOURCE_TYPE_UAV, 0, bits, texSize, 0, 1);
 
 	h0TexDesc.Width = texSize;
 
@@ -146,6 +173,14 @@ Ocean::Ocean(std::shared_ptr<Mesh> waterMesh,
 	srvcbvuavDescriptorHeap.CreateDescriptor(foldingMapTexture, RESOURCE_TYPE_SRV, 0, texSize, texSize, 0, 1);
 	srvcbvuavDescriptorHeap.CreateDescriptor(foldingMapTexture, RESOURCE_TYPE_UAV, 0, texSize, texSize, 0, 1);
 
+	OceanSpectrumParams spectrumParams = {};
+	spectrumParams.fftRes = texSize;
+	spectrumParams.patchSize = 1000.0f;
+	spectrumParams.amplitude = 4.0f;
+	spectrumParams.windDir = Vector2(1.0f, 1.0f);
+	spectrumParams.windSpeed = 40.0f;
+	spectrumParams.seed = 1;
+	cpuSimulation = std::make_shared<OceanSimulation>(spectrumParams);
 }
 
 Ocean::~Ocean()
@@ -162,36 +197,30 @@ void Ocean::Draw(std::shared_ptr<Camera> camera, ComPtr<ID3D12GraphicsCommandLis
 
 void Ocean::CreateH0Texture()
 {
+	cpuSimulation->CreateH0();
 }
 
 void Ocean::CreateHtTexture(float totalTime)
 {
+	cpuSimulation->CreateHt(totalTime);
 }
 
-int Ocean::CreateBitReversedIndices(int num, int d)
+int Ocean::CreateBitReversedIndices(int num)
 {
-	unsigned int count = sizeof(num) * 8 - 1;
-	unsigned int reverseNum = num;
-
-	num >>= 1;
-	while (num)
-	{
-		reverseNum <<= 1;
-		reverseNum |= num & 1;
-		num >>= 1;
-		count--;
-	}
-	//this is our bit reversed number
-	reverseNum <<= count;
-
-	//rotating this number left
-	return (reverseNum << d) | (reverseNum >> (CHAR_BIT * sizeof(reverseNum) - d));
+	return FFTPlan::Get(texSize)->GetBitReversedIndex(num);
 }
 
 void Ocean::CreateTwiddleIndices()
 {
+	cpuSimulation->CreateTwiddleIndices();
 }
 
 void Ocean::RenderFFT(float totalTime)
 {
+	cpuSimulation->Simulate(totalTime);
+}
+
+std::shared_ptr<OceanSimulation> Ocean::GetCPUSimulation()
+{
+	return cpuSimulation;
 }
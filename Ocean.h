@@ -5,6 +5,7 @@
 #include"Mesh.h"
 #include"Camera.h"
 #include"Mesh.h"
+#include"OceanSimulation.h"
 #include<memory>
 
 //class to generate ocean using either gerstner or IFFT waves
@@ -22,6 +23,8 @@ class Ocean
 	ManagedResource htzTexture;
 
 	ManagedResource twiddleTexture;
+	//kept until the upload recorded in the constructor has run
+	ComPtr<ID3D12Resource> twiddleUploadHeap;
 
 	ManagedResource pingpong0Texture;
 
@@ -42,6 +45,9 @@ class Ocean
 	XMFLOAT4X4 worldMatrix;
 	int texSize;
 
+	//cpu version of the fft passes, runs until the compute passes are dispatched
+	std::shared_ptr<OceanSimulation> cpuSimulation;
+
 public:
 public:
 
@@ -58,9 +64,11 @@ public:
 
 	void CreateH0Texture();
 	void CreateHtTexture(float totalTime);
-	int CreateBitReversedIndices(int num, int d);
+	int CreateBitReversedIndices(int num);
 	void CreateTwiddleIndices();
 	void RenderFFT(float totalTime);
 
+	std::shared_ptr<OceanSimulation> GetCPUSimulation();
+
 };
 
@@ -0,0 +1,449 @@
+#include "OceanHeightField.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cassert>
+#include<chrono>
+#include<execution>
+#include<mutex>
+#include<numeric>
+
+//points handed to one task of a batched query, a multiple of the four points sampled together
+static const size_t queryBatchSize = 256;
+
+//fixed point iterations used to find which surface point ends up above a query position
+static const int heightQueryIterations = 2;
+
+OceanHeightField::OceanHeightField()
+{
+	lastUpdateTime = 0.0;
+	previousSnapshot.time = 0.0f;
+	currentSnapshot.time = 0.0f;
+	backSnapshot.time = 0.0f;
+}
+
+OceanHeightField::~OceanHeightField()
+{
+}
+
+void OceanHeightField::AddCascade(const OceanSpectrumParams& params)
+{
+	//the snapshots are sized once the first update has run
+	assert(currentSnapshot.cascades.empty());
+
+	auto simulation = std::make_shared<OceanSimulation>(params);
+	simulation->CreateH0();
+	cascades.emplace_back(simulation);
+
+	backSnapshot.cascades.emplace_back((size_t)params.fftRes * params.fftRes, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void OceanHeightField::CreateDefaultCascades(int fftRes, Vector2 windDir, float windSpeed)
+{
+	float patchSizes[3] = { 1000.0f, 257.0f, 43.0f };
+	float amplitudes[3] = { 4.0f, 2.0f, 1.0f };
+
+	for (int i = 0; i < 3; i++)
+	{
+		OceanSpectrumParams params = {};
+		params.fftRes = fftRes;
+		params.patchSize = patchSizes[i];
+		params.amplitude = amplitudes[i];
+		params.windDir = windDir;
+		params.windSpeed = windSpeed;
+		params.seed = i + 1;
+		AddCascade(params);
+	}
+}
+
+void OceanHeightField::Update(float totalTime)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < cascades.size(); i++)
+	{
+		cascades[i]->Simulate(totalTime);
+
+		const std::vector<float>& dx = cascades[i]->GetDisplacementX();
+		const std::vector<float>& dy = cascades[i]->GetDisplacementY();
+		const std::vector<float>& dz = cascades[i]->GetDisplacementZ();
+		std::vector<XMFLOAT4>& packed = backSnapshot.cascades[i];
+
+		for (size_t texel = 0; texel < packed.size(); texel++)
+		{
+			packed[texel] = XMFLOAT4(dx[texel], dy[texel], dz[texel], 0.0f);
+		}
+	}
+
+	backSnapshot.time = totalTime;
+
+	{
+		std::unique_lock<std::shared_mutex> lock(snapshotMutex);
+
+		if (currentSnapshot.cascades.empty())
+		{
+			previousSnapshot = backSnapshot;
+			currentSnapshot = backSnapshot;
+		}
+
+		else
+		{
+			//the oldest snapshot becomes the back buffer of the next update
+			std::swap(previousSnapshot, currentSnapshot);
+			std::swap(currentSnapshot, backSnapshot);
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	lastUpdateTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+float OceanHeightField::GetSnapshotBlend(float t) const
+{
+	float duration = currentSnapshot.time - previousSnapshot.time;
+	if (duration <= 0.0f)
+		return 1.0f;
+
+	return std::clamp((t - previousSnapshot.time) / duration, 0.0f, 1.0f);
+}
+
+Vector3 OceanHeightField::SampleCascades(float x, float z, float snapshotBlend) const
+{
+	XMVECTOR displacement = XMVectorZero();
+
+	for (size_t i = 0; i < cascades.size(); i++)
+	{
+		int N = cascades[i]->GetResolution();
+		float texelsPerUnit = N / cascades[i]->GetPatchSize();
+
+		float u = x * texelsPerUnit;
+		float v = z * texelsPerUnit;
+		float floorU = floorf(u);
+		float floorV = floorf(v);
+		float fracU = u - floorU;
+		float fracV = v - floorV;
+
+		//the patch tiles, N is a power of two so the mask also wraps negative coordinates
+		int x0 = (int)floorU & (N - 1);
+		int y0 = (int)floorV & (N - 1);
+		int x1 = (x0 + 1) & (N - 1);
+		int y1 = (y0 + 1) & (N - 1);
+
+		const XMFLOAT4* previous = previousSnapshot.cascades[i].data();
+		const XMFLOAT4* current = currentSnapshot.cascades[i].data();
+
+		//bilinear in space on both snapshots, then linear in time
+		XMVECTOR previousTop = XMVectorLerp(XMLoadFloat4(&previous[y0 * N + x0]), XMLoadFloat4(&previous[y0 * N + x1]), fracU);
+		XMVECTOR previousBottom = XMVectorLerp(XMLoadFloat4(&previous[y1 * N + x0]), XMLoadFloat4(&previous[y1 * N + x1]), fracU);
+		XMVECTOR currentTop = XMVectorLerp(XMLoadFloat4(&current[y0 * N + x0]), XMLoadFloat4(&current[y0 * N + x1]), fracU);
+		XMVECTOR currentBottom = XMVectorLerp(XMLoadFloat4(&current[y1 * N + x0]), XMLoadFloat4(&current[y1 * N + x1]), fracU);
+
+		XMVECTOR previousValue = XMVectorLerp(previousTop, previousBottom, fracV);
+		XMVECTOR currentValue = XMVectorLerp(currentTop, currentBottom, fracV);
+
+		displacement = XMVectorAdd(displacement, XMVectorLerp(previousValue, currentValue, snapshotBlend));
+	}
+
+	Vector3 result;
+	XMStoreFloat3(&result, displacement);
+	return result;
+}
+
+void OceanHeightField::SampleCascades4(FXMVECTOR x, FXMVECTOR z, float snapshotBlend, XMVECTOR displacement[3]) const
+{
+	displacement[0] = XMVectorZero();
+	displacement[1] = XMVectorZero();
+	displacement[2] = XMVectorZero();
+
+	XMVECTOR one = XMVectorReplicate(1.0f);
+
+	for (size_t i = 0; i < cascades.size(); i++)
+	{
+		int N = cascades[i]->GetResolution();
+		float texelsPerUnit = N / cascades[i]->GetPatchSize();
+
+		XMVECTOR u = XMVectorScale(x, texelsPerUnit);
+		XMVECTOR v = XMVectorScale(z, texelsPerUnit);
+		XMVECTOR floorU = XMVectorFloor(u);
+		XMVECTOR floorV = XMVectorFloor(v);
+		XMVECTOR fracU = XMVectorSubtract(u, floorU);
+		XMVECTOR fracV = XMVectorSubtract(v, floorV);
+
+		//the patch tiles, N is a power of two so the mask also wraps negative coordinates
+		XMVECTOR mask = XMVectorReplicateInt(N - 1);
+		uint32_t x0[4], y0[4], x1[4], y1[4];
+		XMStoreInt4(x0, XMVectorAndInt(XMConvertVectorFloatToInt(floorU, 0), mask));
+		XMStoreInt4(y0, XMVectorAndInt(XMConvertVectorFloatToInt(floorV, 0), mask));
+		XMStoreInt4(x1, XMVectorAndInt(XMConvertVectorFloatToInt(XMVectorAdd(floorU, one), 0), mask));
+		XMStoreInt4(y1, XMVectorAndInt(XMConvertVectorFloatToInt(XMVectorAdd(floorV, one), 0), mask));
+
+		const XMFLOAT4* previous = previousSnapshot.cascades[i].data();
+		const XMFLOAT4* current = currentSnapshot.cascades[i].data();
+
+		//the texels are gathered per point and blended in time while they are still (dx, dy, dz, 0), one row per point
+		XMMATRIX corners[4];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			uint32_t texels[4] = { y0[lane] * N + x0[lane], y0[lane] * N + x1[lane], y1[lane] * N + x0[lane], y1[lane] * N + x1[lane] };
+			for (int corner = 0; corner < 4; corner++)
+			{
+				corners[corner].r[lane] = XMVectorLerp(XMLoadFloat4(&previous[texels[corner]]), XMLoadFloat4(&current[texels[corner]]), snapshotBlend);
+			}
+		}
+
+		//transposed, rows 0 to 2 of a corner are dx, dy and dz of the four points and the bilinear runs on all of them
+		for (int corner = 0; corner < 4; corner++)
+		{
+			corners[corner] = XMMatrixTranspose(corners[corner]);
+		}
+
+		for (int component = 0; component < 3; component++)
+		{
+			XMVECTOR top = XMVectorLerpV(corners[0].r[component], corners[1].r[component], fracU);
+			XMVECTOR bottom = XMVectorLerpV(corners[2].r[component], corners[3].r[component], fracU);
+			displacement[component] = XMVectorAdd(displacement[component], XMVectorLerpV(top, bottom, fracV));
+		}
+	}
+}
+
+//x and z of the four points from begin on, the lanes past end repeat the last point
+static void LoadPositions4(const Vector2* positions, size_t begin, size_t end, XMVECTOR& x, XMVECTOR& z)
+{
+	float xs[4], zs[4];
+	for (size_t lane = 0; lane < 4; lane++)
+	{
+		const Vector2& position = positions[std::min(begin + lane, end - 1)];
+		xs[lane] = position.x;
+		zs[lane] = position.y;
+	}
+
+	x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(xs));
+	z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(zs));
+}
+
+Vector3 OceanHeightField::SampleDisplacement(float x, float z, float t) const
+{
+	std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+
+	if (currentSnapshot.cascades.empty())
+		return Vector3(0.0f, 0.0f, 0.0f);
+
+	return SampleCascades(x, z, GetSnapshotBlend(t));
+}
+
+float OceanHeightField::SampleHeight(float x, float z, float t) const
+{
+	std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+
+	if (currentSnapshot.cascades.empty())
+		return 0.0f;
+
+	float blend = GetSnapshotBlend(t);
+
+	//the waves also move the surface sideways, so look for the point that gets pushed over (x, z)
+	float sampleX = x;
+	float sampleZ = z;
+	for (int i = 0; i < heightQueryIterations; i++)
+	{
+		Vector3 displacement = SampleCascades(sampleX, sampleZ, blend);
+		sampleX = x - displacement.x;
+		sampleZ = z - displacement.z;
+	}
+
+	return SampleCascades(sampleX, sampleZ, blend).y;
+}
+
+void OceanHeightField::SampleDisplacements(const Vector2* positions, Vector3* displacements, size_t count, float t) const
+{
+	std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+
+	if (currentSnapshot.cascades.empty())
+	{
+		std::fill(displacements, displacements + count, Vector3(0.0f, 0.0f, 0.0f));
+		return;
+	}
+
+	float blend = GetSnapshotBlend(t);
+
+	std::vector<size_t> batches((count + queryBatchSize - 1) / queryBatchSize);
+	std::iota(batches.begin(), batches.end(), 0);
+
+	std::for_each(std::execution::par, batches.begin(), batches.end(), [&](size_t batch)
+		{
+			size_t end = std::min(count, (batch + 1) * queryBatchSize);
+			for (size_t i = batch * queryBatchSize; i < end; i += 4)
+			{
+				XMVECTOR x, z;
+				LoadPositions4(positions, i, end, x, z);
+
+				XMVECTOR displacement[3];
+				SampleCascades4(x, z, blend, displacement);
+
+				XMFLOAT4 dx, dy, dz;
+				XMStoreFloat4(&dx, displacement[0]);
+				XMStoreFloat4(&dy, displacement[1]);
+				XMStoreFloat4(&dz, displacement[2]);
+
+				const float* lanesX = &dx.x;
+				const float* lanesY = &dy.x;
+				const float* lanesZ = &dz.x;
+				for (size_t lane = 0; lane < 4 && i + lane < end; lane++)
+				{
+					displacements[i + lane] = Vector3(lanesX[lane], lanesY[lane], lanesZ[lane]);
+				}
+			}
+		});
+}
+
+void OceanHeightField::SampleHeights(const Vector2* positions, float* heights, size_t count, float t) const
+{
+	std::shared_lock<std::shared_mutex> lock(snapshotMutex);
+
+	if (currentSnapshot.cascades.empty())
+	{
+		std::fill(heights, heights + count, 0.0f);
+		return;
+	}
+
+	float blend = GetSnapshotBlend(t);
+
+	std::vector<size_t> batches((count + queryBatchSize - 1) / queryBatchSize);
+	std::iota(batches.begin(), batches.end(), 0);
+
+	std::for_each(std::execution::par, batches.begin(), batches.end(), [&](size_t batch)
+		{
+			size_t end = std::min(count, (batch + 1) * queryBatchSize);
+			for (size_t i = batch * queryBatchSize; i < end; i += 4)
+			{
+				XMVECTOR x, z;
+				LoadPositions4(positions, i, end, x, z);
+
+				XMVECTOR displacement[3];
+				XMVECTOR sampleX = x;
+				XMVECTOR sampleZ = z;
+				for (int iteration = 0; iteration < heightQueryIterations; iteration++)
+				{
+					SampleCascades4(sampleX, sampleZ, blend, displacement);
+					sampleX = XMVectorSubtract(x, displacement[0]);
+					sampleZ = XMVectorSubtract(z, displacement[2]);
+				}
+
+				SampleCascades4(sampleX, sampleZ, blend, displacement);
+
+				XMFLOAT4 dy;
+				XMStoreFloat4(&dy, displacement[1]);
+
+				const float* lanesY = &dy.x;
+				for (size_t lane = 0; lane < 4 && i + lane < end; lane++)
+				{
+					heights[i + lane] = lanesY[lane];
+				}
+			}
+		});
+}
+
+UINT OceanHeightField::GetCascadeCount()
+{
+	return (UINT)cascades.size();
+}
+
+std::shared_ptr<OceanSimulation> OceanHeightField::GetCascade(UINT index)
+{
+	return cascades[index];
+}
+
+double OceanHeightField::GetLastUpdateTime()
+{
+	return lastUpdateTime;
+}
+
+void ValidateOceanHeightField()
+{
+	printf("Ocean height field\n");
+	bool passed = true;
+
+	OceanHeightField heightField;
+	heightField.CreateDefaultCascades(64, Vector2(1.0f, 1.0f), 40.0f);
+	heightField.Update(0.0f);
+	heightField.Update(1.0f / 60.0f);
+
+	//not a multiple of four or of the task size, so the last lanes of a batch repeat a point
+	const size_t pointCount = 1001;
+	std::mt19937 randomGenerator(3);
+	std::uniform_real_distribution<float> dist(-2000.0f, 2000.0f);
+
+	std::vector<Vector2> positions(pointCount);
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		positions[i] = Vector2(dist(randomGenerator), dist(randomGenerator));
+	}
+
+	float t = 1.0f / 120.0f;
+	std::vector<Vector3> displacements(pointCount);
+	std::vector<float> heights(pointCount);
+	heightField.SampleDisplacements(positions.data(), displacements.data(), pointCount, t);
+	heightField.SampleHeights(positions.data(), heights.data(), pointCount, t);
+
+	//the batch blends in time before space, the single queries after, so they only differ by rounding
+	float displacementError = 0.0f;
+	float heightError = 0.0f;
+	float largestHeight = 0.0f;
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		Vector3 displacement = heightField.SampleDisplacement(positions[i].x, positions[i].y, t);
+		float height = heightField.SampleHeight(positions[i].x, positions[i].y, t);
+		displacementError = std::max(displacementError, (displacement - displacements[i]).Length());
+		heightError = std::max(heightError, fabsf(height - heights[i]));
+		largestHeight = std::max(largestHeight, fabsf(height));
+	}
+
+	printf("    displacement error %e, height error %e, largest height %.3f\n", displacementError, heightError, largestHeight);
+	Check(passed, "batched displacements match single ones", displacementError < 1e-3f);
+	Check(passed, "batched heights match single ones", heightError < 1e-3f);
+	Check(passed, "heights aren't all zero", largestHeight > 0.0f);
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkOceanHeightQueries(size_t pointCount)
+{
+	OceanHeightField heightField;
+	heightField.CreateDefaultCascades(256, Vector2(1.0f, 1.0f), 40.0f);
+	heightField.Update(0.0f);
+	heightField.Update(1.0f / 60.0f);
+
+	std::mt19937 randomGenerator(1);
+	std::uniform_real_distribution<float> dist(-2000.0f, 2000.0f);
+
+	std::vector<Vector2> positions(pointCount);
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		positions[i] = Vector2(dist(randomGenerator), dist(randomGenerator));
+	}
+
+	std::vector<float> heights(pointCount);
+
+	int iterations = 20;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		heightField.SampleHeights(positions.data(), heights.data(), pointCount, 1.0f / 120.0f);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	printf("ocean height queries: %zu points in %.3f ms (%.1f million points/s), update %.3f ms\n",
+		pointCount, milliseconds, pointCount / (milliseconds * 1000.0), heightField.GetLastUpdateTime());
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (size_t point = 0; point < pointCount; point++)
+		{
+			heights[point] = heightField.SampleHeight(positions[point].x, positions[point].y, 1.0f / 120.0f);
+		}
+	}
+	end = std::chrono::high_resolution_clock::now();
+
+	double singleMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	printf("ocean height queries one by one: %.3f ms, the batch is %.2fx faster\n", singleMilliseconds, singleMilliseconds / milliseconds);
+}
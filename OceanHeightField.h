@@ -0,0 +1,65 @@
+#pragma once
+
+#include"OceanSimulation.h"
+#include<shared_mutex>
+
+//displacement of every cascade at one point in time, (dx, dy, dz, 0) per texel so one texel is one XMVECTOR load
+struct OceanHeightFieldSnapshot
+{
+	float time;
+	std::vector<std::vector<XMFLOAT4>> cascades;
+};
+
+//cpu side height queries for gameplay, several fft cascades of different patch sizes are added together
+//so the tiling of any one of them is hidden. Update runs the simulations, queries can come from any thread
+class OceanHeightField
+{
+	std::vector<std::shared_ptr<OceanSimulation>> cascades;
+
+	//queries interpolate between the last two updates, the back snapshot is written without holding the lock
+	OceanHeightFieldSnapshot previousSnapshot;
+	OceanHeightFieldSnapshot currentSnapshot;
+	OceanHeightFieldSnapshot backSnapshot;
+	mutable std::shared_mutex snapshotMutex;
+
+	double lastUpdateTime;
+
+	Vector3 SampleCascades(float x, float z, float snapshotBlend) const;
+	//the same sum for four points at once, one lane per point. displacement gets dx, dy and dz of the four points
+	void SampleCascades4(FXMVECTOR x, FXMVECTOR z, float snapshotBlend, XMVECTOR displacement[3]) const;
+	float GetSnapshotBlend(float t) const;
+
+public:
+	OceanHeightField();
+	~OceanHeightField();
+
+	//h0 of the cascade is generated here, cascades have to be added before the first update
+	void AddCascade(const OceanSpectrumParams& params);
+
+	//three cascades at patch sizes that don't divide each other
+	void CreateDefaultCascades(int fftRes, Vector2 windDir, float windSpeed);
+
+	void Update(float totalTime);
+
+	//displacement of the surface point that rests at (x, z)
+	Vector3 SampleDisplacement(float x, float z, float t) const;
+
+	//height of the displaced surface above (x, z)
+	float SampleHeight(float x, float z, float t) const;
+
+	//batched versions for lots of floating objects, positions are (x, z). Four points are sampled per XMVECTOR
+	void SampleDisplacements(const Vector2* positions, Vector3* displacements, size_t count, float t) const;
+	void SampleHeights(const Vector2* positions, float* heights, size_t count, float t) const;
+
+	UINT GetCascadeCount();
+	std::shared_ptr<OceanSimulation> GetCascade(UINT index);
+
+	//milliseconds spent in the last Update call
+	double GetLastUpdateTime();
+};
+
+//the batched queries against the single point ones, including counts that aren't a multiple of four
+void ValidateOceanHeightField();
+
+//prints the cost of a batched height query of pointCount random points, and of the same points queried one by one
+void BenchmarkOceanHeightQueries(size_t pointCount = 10000);
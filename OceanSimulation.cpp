@@ -0,0 +1,348 @@
+#include "OceanSimulation.h"
+#include<algorithm>
+#include<cassert>
+#include<chrono>
+#include<execution>
+#include<numeric>
+
+static const float oceanGravity = 9.81f;
+
+OceanSimulation::OceanSimulation(const OceanSpectrumParams& params)
+{
+	this->params = params;
+	lastSimulationTime = 0.0;
+
+	//the butterflies only work on powers of two and ht is done four texels at a time
+	assert(params.fftRes >= 4 && (params.fftRes & (params.fftRes - 1)) == 0);
+
+	fftPlan = FFTPlan::Get(params.fftRes);
+	log2Size = fftPlan->GetLog2Size();
+
+	size_t texelCount = (size_t)params.fftRes * params.fftRes;
+	h0.resize(texelCount);
+	h0Minus.resize(texelCount);
+	twiddleIndices.resize((size_t)log2Size * params.fftRes);
+
+	for (int i = 0; i < 3; i++)
+	{
+		pingpong0[i].resize(texelCount);
+		pingpong1[i].resize(texelCount);
+		displacement[i].resize(texelCount);
+	}
+
+	rowIndices.resize(params.fftRes);
+	std::iota(rowIndices.begin(), rowIndices.end(), 0);
+}
+
+OceanSimulation::~OceanSimulation()
+{
+}
+
+void OceanSimulation::CreateH0()
+{
+	int N = params.fftRes;
+	float L = params.patchSize;
+	float L_ = (params.windSpeed * params.windSpeed) / oceanGravity;
+	Vector2 windDir = params.windDir;
+	windDir.Normalize();
+
+	std::mt19937 randomGenerator(params.seed);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+	for (int y = 0; y < N; y++)
+	{
+		for (int x = 0; x < N; x++)
+		{
+			Vector2 k = Vector2(XM_2PI * (x - N / 2.0f) / L, XM_2PI * (y - N / 2.0f) / L);
+			float mag = std::max(k.Length(), 0.00001f);
+			float magSq = mag * mag;
+
+			//the noise textures are replaced by a seeded generator, the box muller step is the same
+			float noise1 = std::min(dist(randomGenerator) + 0.001f, 1.0f);
+			float noise2 = std::min(dist(randomGenerator) + 0.001f, 1.0f);
+			float noise3 = std::min(dist(randomGenerator) + 0.001f, 1.0f);
+			float noise4 = std::min(dist(randomGenerator) + 0.001f, 1.0f);
+
+			float u0 = XM_2PI * noise1;
+			float v0 = sqrtf(-2.0f * logf(noise2));
+			float u1 = XM_2PI * noise3;
+			float v1 = sqrtf(-2.0f * logf(noise4));
+
+			//the shader normalizes a zero vector at the center of the spectrum, that wave has no energy anyway
+			float kDotW = 0.0f;
+			if (k.Length() > 0.00001f)
+				kDotW = (k / k.Length()).Dot(windDir);
+
+			//kDotW is squared so h0(-k) has the same magnitude as h0(k)
+			float spectrum = (params.amplitude / (magSq * magSq)) * kDotW * kDotW
+				* expf(-(1.0f / (magSq * L_ * L_)))
+				* expf(-magSq * powf(L / 2000.0f, 2.0f));
+			float h0k = std::min(sqrtf(spectrum) / sqrtf(2.0f), 4000.0f);
+
+			h0[y * N + x] = OceanComplex(v0 * cosf(u0) * h0k, v0 * sinf(u0) * h0k);
+			h0Minus[y * N + x] = OceanComplex(v1 * cosf(u1) * h0k, v1 * sinf(u1) * h0k);
+		}
+	}
+}
+
+void OceanSimulation::CreateHt(float totalTime)
+{
+	int N = params.fftRes;
+	float L = params.patchSize;
+
+	std::for_each(std::execution::par, rowIndices.begin(), rowIndices.end(), [&](int y)
+		{
+			float kyScalar = XM_2PI * (y - N / 2.0f) / L;
+			XMVECTOR ky = XMVectorReplicate(kyScalar);
+			XMVECTOR minMag = XMVectorReplicate(0.00001f);
+			XMVECTOR time = XMVectorReplicate(totalTime);
+			XMVECTOR gravity = XMVectorReplicate(oceanGravity);
+
+			//four texels per iteration, the complex values are split into real and imaginary vectors
+			for (int x = 0; x < N; x += 4)
+			{
+				size_t index = (size_t)y * N + x;
+
+				XMVECTOR kx = XMVectorSet((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3));
+				kx = XMVectorScale(XMVectorSubtract(kx, XMVectorReplicate(N / 2.0f)), XM_2PI / L);
+
+				XMVECTOR mag = XMVectorSqrt(XMVectorMultiplyAdd(kx, kx, XMVectorMultiply(ky, ky)));
+				mag = XMVectorMax(mag, minMag);
+
+				XMVECTOR w = XMVectorSqrt(XMVectorMultiply(gravity, mag));
+				XMVECTOR sinWT, cosWT;
+				XMVectorSinCos(&sinWT, &cosWT, XMVectorMultiply(w, time));
+
+				XMVECTOR h0Low = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&h0[index]));
+				XMVECTOR h0High = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&h0[index + 2]));
+				XMVECTOR h0Real = XMVectorPermute<0, 2, 4, 6>(h0Low, h0High);
+				XMVECTOR h0Im = XMVectorPermute<1, 3, 5, 7>(h0Low, h0High);
+
+				XMVECTOR h0MinusLow = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&h0Minus[index]));
+				XMVECTOR h0MinusHigh = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&h0Minus[index + 2]));
+				XMVECTOR h0MinusReal = XMVectorPermute<0, 2, 4, 6>(h0MinusLow, h0MinusHigh);
+				XMVECTOR h0MinusIm = XMVectorPermute<1, 3, 5, 7>(h0MinusLow, h0MinusHigh);
+
+				//h0 * e^iwt + conj(h0minus) * e^-iwt
+				XMVECTOR hyReal = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(h0Real, h0MinusReal), cosWT),
+					XMVectorMultiply(XMVectorAdd(h0Im, h0MinusIm), sinWT));
+				XMVECTOR hyIm = XMVectorAdd(XMVectorMultiply(XMVectorSubtract(h0Real, h0MinusReal), sinWT),
+					XMVectorMultiply(XMVectorSubtract(h0Im, h0MinusIm), cosWT));
+
+				//(0, -k/|k|) * hy
+				XMVECTOR kxNorm = XMVectorDivide(kx, mag);
+				XMVECTOR kyNorm = XMVectorDivide(ky, mag);
+				XMVECTOR hxReal = XMVectorMultiply(kxNorm, hyIm);
+				XMVECTOR hxIm = XMVectorNegate(XMVectorMultiply(kxNorm, hyReal));
+				XMVECTOR hzReal = XMVectorMultiply(kyNorm, hyIm);
+				XMVECTOR hzIm = XMVectorNegate(XMVectorMultiply(kyNorm, hyReal));
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[0][index]), XMVectorPermute<0, 4, 1, 5>(hxReal, hxIm));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[0][index + 2]), XMVectorPermute<2, 6, 3, 7>(hxReal, hxIm));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[1][index]), XMVectorPermute<0, 4, 1, 5>(hyReal, hyIm));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[1][index + 2]), XMVectorPermute<2, 6, 3, 7>(hyReal, hyIm));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[2][index]), XMVectorPermute<0, 4, 1, 5>(hzReal, hzIm));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pingpong0[2][index + 2]), XMVectorPermute<2, 6, 3, 7>(hzReal, hzIm));
+			}
+		});
+}
+
+void OceanSimulation::CreateTwiddleIndices()
+{
+	twiddleIndices = fftPlan->GetTwiddleTextureData();
+}
+
+void OceanSimulation::HorizontalButterflies(int stage, const std::vector<OceanComplex>& src, std::vector<OceanComplex>& dst)
+{
+	int N = params.fftRes;
+	const XMFLOAT4* stageTwiddles = &twiddleIndices[(size_t)stage * N];
+
+	std::for_each(std::execution::par, rowIndices.begin(), rowIndices.end(), [&](int y)
+		{
+			const OceanComplex* srcRow = &src[(size_t)y * N];
+			OceanComplex* dstRow = &dst[(size_t)y * N];
+
+			//the reads along a row are scattered so the pairs are gathered before the multiply
+			for (int x = 0; x < N; x += 2)
+			{
+				const XMFLOAT4& data0 = stageTwiddles[x];
+				const XMFLOAT4& data1 = stageTwiddles[x + 1];
+
+				const OceanComplex& p0 = srcRow[(int)data0.z];
+				const OceanComplex& p1 = srcRow[(int)data1.z];
+				const OceanComplex& q0 = srcRow[(int)data0.w];
+				const OceanComplex& q1 = srcRow[(int)data1.w];
+
+				XMVECTOR p = XMVectorSet(p0.x, p0.y, p1.x, p1.y);
+				XMVECTOR q = XMVectorSet(q0.x, q0.y, q1.x, q1.y);
+				XMVECTOR w = XMVectorSet(data0.x, data0.y, data1.x, data1.y);
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&dstRow[x]), XMVectorAdd(p, ComplexMultiply2(w, q)));
+			}
+		});
+}
+
+void OceanSimulation::VerticalButterflies(int stage, const std::vector<OceanComplex>& src, std::vector<OceanComplex>& dst)
+{
+	int N = params.fftRes;
+	const XMFLOAT4* stageTwiddles = &twiddleIndices[(size_t)stage * N];
+
+	std::for_each(std::execution::par, rowIndices.begin(), rowIndices.end(), [&](int y)
+		{
+			//every texel of a row uses the same twiddle and reads whole rows, so it vectorizes directly
+			const XMFLOAT4& data = stageTwiddles[y];
+			const OceanComplex* pRow = &src[(size_t)data.z * N];
+			const OceanComplex* qRow = &src[(size_t)data.w * N];
+			OceanComplex* dstRow = &dst[(size_t)y * N];
+
+			XMVECTOR w = XMVectorSet(data.x, data.y, data.x, data.y);
+
+			for (int x = 0; x < N; x += 2)
+			{
+				XMVECTOR p = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&pRow[x]));
+				XMVECTOR q = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&qRow[x]));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&dstRow[x]), XMVectorAdd(p, ComplexMultiply2(w, q)));
+			}
+		});
+}
+
+void OceanSimulation::Inversion(const std::vector<OceanComplex>& src, std::vector<float>& dst)
+{
+	int N = params.fftRes;
+	float scale = 1.0f / ((float)N * N);
+
+	std::for_each(std::execution::par, rowIndices.begin(), rowIndices.end(), [&](int y)
+		{
+			for (int x = 0; x < N; x++)
+			{
+				size_t index = (size_t)y * N + x;
+				float perm = ((x + y) % 2 == 0) ? 1.0f : -1.0f;
+				dst[index] = perm * src[index].x * scale;
+			}
+		});
+}
+
+void OceanSimulation::RenderFFT()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		fftPlan->Inverse2D(pingpong0[i].data(), pingpong1[i].data());
+		Inversion(pingpong0[i], displacement[i]);
+	}
+}
+
+void OceanSimulation::RenderButterflies()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		int pingpong = 0;
+
+		//1D FFTs of all the rows first, then of all the columns
+		for (int stage = 0; stage < log2Size; stage++)
+		{
+			if (pingpong == 0)
+				HorizontalButterflies(stage, pingpong0[i], pingpong1[i]);
+			else
+				HorizontalButterflies(stage, pingpong1[i], pingpong0[i]);
+
+			pingpong = 1 - pingpong;
+		}
+
+		for (int stage = 0; stage < log2Size; stage++)
+		{
+			if (pingpong == 0)
+				VerticalButterflies(stage, pingpong0[i], pingpong1[i]);
+			else
+				VerticalButterflies(stage, pingpong1[i], pingpong0[i]);
+
+			pingpong = 1 - pingpong;
+		}
+
+		Inversion(pingpong == 0 ? pingpong0[i] : pingpong1[i], displacement[i]);
+	}
+}
+
+void OceanSimulation::Simulate(float totalTime)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	CreateHt(totalTime);
+	RenderFFT();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	lastSimulationTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int OceanSimulation::GetResolution()
+{
+	return params.fftRes;
+}
+
+float OceanSimulation::GetPatchSize()
+{
+	return params.patchSize;
+}
+
+const std::vector<OceanComplex>& OceanSimulation::GetH0()
+{
+	return h0;
+}
+
+const std::vector<OceanComplex>& OceanSimulation::GetH0Minus()
+{
+	return h0Minus;
+}
+
+const std::vector<XMFLOAT4>& OceanSimulation::GetTwiddleIndices()
+{
+	return twiddleIndices;
+}
+
+const std::vector<float>& OceanSimulation::GetDisplacementX()
+{
+	return displacement[0];
+}
+
+const std::vector<float>& OceanSimulation::GetDisplacementY()
+{
+	return displacement[1];
+}
+
+const std::vector<float>& OceanSimulation::GetDisplacementZ()
+{
+	return displacement[2];
+}
+
+double OceanSimulation::GetLastSimulationTime()
+{
+	return lastSimulationTime;
+}
+
+void BenchmarkOceanSimulation(int frameCount)
+{
+	int resolutions[3] = { 256, 512, 1024 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		OceanSpectrumParams params = {};
+		params.fftRes = resolutions[i];
+		params.patchSize = 1000.0f;
+		params.amplitude = 4.0f;
+		params.windDir = Vector2(1.0f, 1.0f);
+		params.windSpeed = 40.0f;
+		params.seed = 1;
+
+		OceanSimulation simulation(params);
+		simulation.CreateH0();
+		simulation.CreateTwiddleIndices();
+
+		double totalTime = 0.0;
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			simulation.Simulate(frame / 60.0f);
+			totalTime += simulation.GetLastSimulationTime();
+		}
+
+		printf("cpu ocean %dx%d: %.3f ms per frame\n", resolutions[i], resolutions[i], totalTime / frameCount);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include"FFTPlan.h"
+#include<vector>
+
+//same inputs as the philipsSpectrum cbuffer in H0OceanCS
+struct OceanSpectrumParams
+{
+	int fftRes;
+	float patchSize;
+	float amplitude;
+	Vector2 windDir;
+	float windSpeed;
+	unsigned int seed;
+};
+
+//cpu implementation of the tessendorf fft ocean, every step mirrors one of the ocean compute shaders
+//so it can be used when there is no gpu work to be done, to validate the shaders and to answer physics queries
+class OceanSimulation
+{
+	OceanSpectrumParams params;
+	int log2Size;
+	std::shared_ptr<FFTPlan> fftPlan;
+
+	//H0OceanCS
+	std::vector<OceanComplex> h0;
+	std::vector<OceanComplex> h0Minus;
+
+	//TwiddleFactorsCS, log2Size stages of fftRes (twiddle real, twiddle imaginary, top index, bottom index)
+	std::vector<XMFLOAT4> twiddleIndices;
+
+	//HtOceanCS writes into pingpong0, the butterflies bounce between both
+	std::vector<OceanComplex> pingpong0[3];
+	std::vector<OceanComplex> pingpong1[3];
+	std::vector<int> rowIndices;
+
+	//InversionCS
+	std::vector<float> displacement[3];
+
+	double lastSimulationTime;
+
+	void HorizontalButterflies(int stage, const std::vector<OceanComplex>& src, std::vector<OceanComplex>& dst);
+	void VerticalButterflies(int stage, const std::vector<OceanComplex>& src, std::vector<OceanComplex>& dst);
+	void Inversion(const std::vector<OceanComplex>& src, std::vector<float>& dst);
+
+public:
+	OceanSimulation(const OceanSpectrumParams& params);
+	~OceanSimulation();
+
+	void CreateH0();
+	void CreateHt(float totalTime);
+	void CreateTwiddleIndices();
+
+	//inverse transform of the three ht grids through the fft plan, followed by the inversion
+	void RenderFFT();
+
+	//same result as RenderFFT, but stage by stage through the twiddle table like ButterflyCS, to compare against the compute passes
+	void RenderButterflies();
+
+	//ht, fft and inversion for one frame, h0 has to exist already
+	void Simulate(float totalTime);
+
+	int GetResolution();
+	float GetPatchSize();
+	const std::vector<OceanComplex>& GetH0();
+	const std::vector<OceanComplex>& GetH0Minus();
+	const std::vector<XMFLOAT4>& GetTwiddleIndices();
+	const std::vector<float>& GetDisplacementX();
+	const std::vector<float>& GetDisplacementY();
+	const std::vector<float>& GetDisplacementZ();
+
+	//milliseconds spent in the last Simulate call
+	double GetLastSimulationTime();
+};
+
+//prints the average cost of a cpu ocean frame at 256, 512 and 1024
+void BenchmarkOceanSimulation(int frameCount = 60);
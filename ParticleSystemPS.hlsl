@@ -0,0 +1,19 @@
+#include "Common.hlsl"
+struct VertexToPixel
+{
+	float4 position: SV_POSITION;
+	float2 uv : TEXCOORD;
+	float4 color: COLOR;
+	nointerpolation uint textureIndex : TEXINDEX;
+};
+
+//must match MAX_PARTICLE_TEXTURES
+Texture2D particleTextures[8]: register(t0);
+SamplerState sampleOptions: register(s0);
+
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 color = particleTextures[NonUniformResourceIndex(input.textureIndex)].Sample(sampleOptions,input.uv) * input.color;
+
+	return color;
+}
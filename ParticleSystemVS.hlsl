@@ -0,0 +1,99 @@
+#include "Common.hlsl"
+cbuffer externalData: register(b0)
+{
+	matrix view;
+	matrix projection;
+	float currentTime;
+};
+
+struct Particle
+{
+	float spawnTime;
+	float3 startPosition;
+
+	float rotationStart;
+	float3 startVelocity;
+
+	float rotationEnd;
+	uint emitterIndex;
+	float2 padding;
+};
+
+struct EmitterData
+{
+	float3 acceleration;
+	float lifetime;
+
+	float4 startColor;
+	float4 endColor;
+
+	float startSize;
+	float endSize;
+	uint textureIndex;
+	float padding;
+};
+
+struct VertexToPixel
+{
+	float4 position: SV_POSITION;
+	float2 uv : TEXCOORD;
+	float4 color: COLOR;
+	nointerpolation uint textureIndex : TEXINDEX;
+};
+
+StructuredBuffer<Particle> ParticleData: register(t0);
+StructuredBuffer<EmitterData> Emitters: register(t1);
+
+VertexToPixel main(uint cornerID: SV_VertexID, uint particleID: SV_InstanceID)
+{
+	VertexToPixel output;
+
+	//every instance is a particle, the shared index buffer addresses its 4 corners
+	Particle p = ParticleData.Load(particleID);
+	EmitterData emitter = Emitters.Load(p.emitterIndex);
+
+	float t = currentTime - p.spawnTime;
+	float percent = t / emitter.lifetime; //percent to lerp with
+
+	float3 pos = 0.5 * t * t * emitter.acceleration + t * p.startVelocity + p.startPosition;
+	float4 color = lerp(emitter.startColor, emitter.endColor, percent);
+	float size = lerp(emitter.startSize, emitter.endSize, percent);
+	float rotation = lerp(p.rotationStart, p.rotationEnd, percent);
+
+	float2 offsets[4];
+	offsets[0] = float2(-1.0f, 1.0f); //top left
+	offsets[1] = float2(1.0f, 1.0f); //top right
+	offsets[2] = float2(1.0f, -1.0f); //back right
+	offsets[3] = float2(-1.0f, -1.0f); //back left
+
+	float c, s;
+	sincos(rotation, s, c);
+
+	float2x2 rot =
+	{
+		c,s
+		,-s,c
+	};
+
+	float2 rotatedOffset = mul(offsets[cornerID], rot);
+
+	pos += float3(view._11, view._21, view._31) * rotatedOffset.y * size;
+	pos += float3(view._12, view._22, view._32) * rotatedOffset.x * size;
+
+	matrix viewProj = mul(view, projection);
+
+	output.position = mul(float4(pos, 1.0f), viewProj);
+
+	float2 uvs[4];
+	uvs[0] = float2(0, 0);  // TL
+	uvs[1] = float2(1, 0);  // TR
+	uvs[2] = float2(1, 1);  // BR
+	uvs[3] = float2(0, 1);  // BL
+
+	// Pass uv through
+	output.uv = saturate(uvs[cornerID]);
+	output.color = color;
+	output.textureIndex = emitter.textureIndex;
+
+	return output;
+}
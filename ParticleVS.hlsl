@@ -27,7 +27,8 @@ struct Particle
 	float3 startVelocity;
 
 	float rotationEnd;
-	float3 padding;
+	uint emitterIndex;
+	float2 padding;
 };
 
 struct VertexToPixel
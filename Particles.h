@@ -13,5 +13,6 @@ struct Particle
 	Vector3 startVelocity;
 
 	float rotationEnd;
-	Vector3 padding;
+	UINT emitterIndex; //index into the emitter data buffer when drawn through the emitter system
+	Vector2 padding;
 };
\ No newline at end of file
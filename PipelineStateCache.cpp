@@ -0,0 +1,682 @@
+#include "PipelineStateCache.h"
+#include"Validation.h"
+#include "RootSignatureCache.h"
+#include<algorithm>
+#include<fstream>
+
+//bump when the canonical form or the file layout changes
+static const UINT StoreVersion = 1;
+static const UINT StoreMagic = 0x4C4F5350;
+
+static const UINT GraphicsPipeline = 0;
+static const UINT ComputePipeline = 1;
+
+static UINT FloatBits(float value)
+{
+	if (value == 0.0f)
+		value = 0.0f;
+	UINT bits;
+	memcpy(&bits, &value, sizeof(UINT));
+	return bits;
+}
+
+static void AppendHash(CanonicalPipelineState& canonical, UINT64 hash)
+{
+	canonical.push_back((UINT)hash);
+	canonical.push_back((UINT)(hash >> 32));
+}
+
+static void AppendShader(CanonicalPipelineState& canonical, const D3D12_SHADER_BYTECODE& bytecode)
+{
+	canonical.push_back((UINT)bytecode.BytecodeLength);
+	AppendHash(canonical, bytecode.BytecodeLength > 0 ? HashShaderBytecode(bytecode) : 0);
+}
+
+static void AppendString(CanonicalPipelineState& canonical, const char* string)
+{
+	size_t length = string ? strlen(string) : 0;
+	canonical.push_back((UINT)length);
+	for (size_t i = 0; i < length; i += sizeof(UINT))
+	{
+		UINT word = 0;
+		memcpy(&word, string + i, std::min(sizeof(UINT), length - i));
+		canonical.push_back(word);
+	}
+}
+
+CanonicalPipelineState CanonicalizeGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash)
+{
+	CanonicalPipelineState canonical;
+	canonical.push_back(GraphicsPipeline);
+	AppendHash(canonical, rootSignatureHash);
+
+	AppendShader(canonical, desc.VS);
+	AppendShader(canonical, desc.PS);
+	AppendShader(canonical, desc.DS);
+	AppendShader(canonical, desc.HS);
+	AppendShader(canonical, desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+	canonical.push_back(streamOutput.NumEntries);
+	for (UINT i = 0; i < streamOutput.NumEntries; i++)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+		canonical.push_back(entry.Stream);
+		AppendString(canonical, entry.SemanticName);
+		canonical.insert(canonical.end(), { entry.SemanticIndex, (UINT)entry.StartComponent, (UINT)entry.ComponentCount, (UINT)entry.OutputSlot });
+	}
+	canonical.push_back(streamOutput.NumStrides);
+	canonical.insert(canonical.end(), streamOutput.pBufferStrides, streamOutput.pBufferStrides + streamOutput.NumStrides);
+	canonical.push_back(streamOutput.NumEntries > 0 ? streamOutput.RasterizedStream : 0);
+
+	//without independent blending the first target's state applies to all of them, and blend factors or the logic op
+	//only matter when they're switched on
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	canonical.push_back(blend.AlphaToCoverageEnable);
+	canonical.push_back(blend.IndependentBlendEnable);
+	UINT blendTargets = blend.IndependentBlendEnable ? desc.NumRenderTargets : 1;
+	for (UINT i = 0; i < blendTargets; i++)
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC& target = blend.RenderTarget[i];
+		canonical.push_back(target.BlendEnable);
+		if (target.BlendEnable)
+			canonical.insert(canonical.end(), { (UINT)target.SrcBlend, (UINT)target.DestBlend, (UINT)target.BlendOp,
+				(UINT)target.SrcBlendAlpha, (UINT)target.DestBlendAlpha, (UINT)target.BlendOpAlpha });
+		canonical.push_back(target.LogicOpEnable);
+		if (target.LogicOpEnable)
+			canonical.push_back((UINT)target.LogicOp);
+		canonical.push_back(target.RenderTargetWriteMask);
+	}
+	canonical.push_back(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+	canonical.insert(canonical.end(), { (UINT)rasterizer.FillMode, (UINT)rasterizer.CullMode, (UINT)rasterizer.FrontCounterClockwise,
+		(UINT)rasterizer.DepthBias, FloatBits(rasterizer.DepthBiasClamp), FloatBits(rasterizer.SlopeScaledDepthBias),
+		(UINT)rasterizer.DepthClipEnable, (UINT)rasterizer.MultisampleEnable, (UINT)rasterizer.AntialiasedLineEnable,
+		rasterizer.ForcedSampleCount, (UINT)rasterizer.ConservativeRaster });
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	canonical.push_back(depthStencil.DepthEnable);
+	if (depthStencil.DepthEnable)
+		canonical.insert(canonical.end(), { (UINT)depthStencil.DepthWriteMask, (UINT)depthStencil.DepthFunc });
+	canonical.push_back(depthStencil.StencilEnable);
+	if (depthStencil.StencilEnable)
+	{
+		const D3D12_DEPTH_STENCILOP_DESC& front = depthStencil.FrontFace;
+		const D3D12_DEPTH_STENCILOP_DESC& back = depthStencil.BackFace;
+		canonical.insert(canonical.end(), { (UINT)depthStencil.StencilReadMask, (UINT)depthStencil.StencilWriteMask,
+			(UINT)front.StencilFailOp, (UINT)front.StencilDepthFailOp, (UINT)front.StencilPassOp, (UINT)front.StencilFunc,
+			(UINT)back.StencilFailOp, (UINT)back.StencilDepthFailOp, (UINT)back.StencilPassOp, (UINT)back.StencilFunc });
+	}
+
+	const D3D12_INPUT_LAYOUT_DESC& inputLayout = desc.InputLayout;
+	canonical.push_back(inputLayout.NumElements);
+	for (UINT i = 0; i < inputLayout.NumElements; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+		AppendString(canonical, element.SemanticName);
+		canonical.insert(canonical.end(), { element.SemanticIndex, (UINT)element.Format, element.InputSlot, element.AlignedByteOffset,
+			(UINT)element.InputSlotClass, element.InstanceDataStepRate });
+	}
+
+	canonical.push_back((UINT)desc.IBStripCutValue);
+	canonical.push_back((UINT)desc.PrimitiveTopologyType);
+	canonical.push_back(desc.NumRenderTargets);
+	for (UINT i = 0; i < desc.NumRenderTargets; i++)
+		canonical.push_back((UINT)desc.RTVFormats[i]);
+	canonical.push_back((UINT)desc.DSVFormat);
+	canonical.insert(canonical.end(), { desc.SampleDesc.Count, desc.SampleDesc.Quality, desc.NodeMask, (UINT)desc.Flags });
+	return canonical;
+}
+
+CanonicalPipelineState CanonicalizeComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash)
+{
+	CanonicalPipelineState canonical;
+	canonical.push_back(ComputePipeline);
+	AppendHash(canonical, rootSignatureHash);
+	AppendShader(canonical, desc.CS);
+	canonical.insert(canonical.end(), { desc.NodeMask, (UINT)desc.Flags });
+	return canonical;
+}
+
+UINT64 HashPipelineState(const CanonicalPipelineState& canonical)
+{
+	//fnv-1a over the words
+	UINT64 hash = 0xCBF29CE484222325ull;
+	for (size_t i = 0; i < canonical.size(); i++)
+	{
+		hash ^= canonical[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+UINT64 HashShaderBytecode(const D3D12_SHADER_BYTECODE& bytecode)
+{
+	//fnv-1a over the bytes, a recompiled shader gets a new hash and with it new pipelines
+	const BYTE* bytes = static_cast<const BYTE*>(bytecode.pShaderBytecode);
+	UINT64 hash = 0xCBF29CE484222325ull;
+	for (size_t i = 0; i < bytecode.BytecodeLength; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+PipelineDriverVersion GetPipelineDriverVersion(IDXGIAdapter* adapter)
+{
+	PipelineDriverVersion driver = {};
+	DXGI_ADAPTER_DESC desc = {};
+	if (FAILED(adapter->GetDesc(&desc)))
+		return driver;
+
+	//the user mode driver version, what the stored pipelines were compiled by
+	LARGE_INTEGER version = {};
+	adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &version);
+
+	driver.vendorId = desc.VendorId;
+	driver.deviceId = desc.DeviceId;
+	driver.driverVersion = (UINT64)version.QuadPart;
+	return driver;
+}
+
+PipelineStateStore::PipelineStateStore()
+{
+}
+
+PipelineStateStore::~PipelineStateStore()
+{
+}
+
+bool PipelineStateStore::Load(const std::filesystem::path& fileName, const PipelineDriverVersion& driver)
+{
+	Clear();
+
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::error_code error;
+	UINT64 remaining = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	UINT header[7] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != StoreMagic || header[1] != StoreVersion)
+		return false;
+	remaining -= sizeof(header);
+
+	UINT64 driverVersion = header[4] | ((UINT64)header[5] << 32);
+	if (header[2] != driver.vendorId || header[3] != driver.deviceId || driverVersion != driver.driverVersion)
+		return false;
+
+	//a truncated or corrupt store is a miss, nothing is sized from it before it is checked against what is left
+	for (UINT i = 0; i < header[6]; i++)
+	{
+		UINT64 hash = 0;
+		UINT size = 0;
+		if (remaining < sizeof(UINT64) + sizeof(UINT))
+		{
+			Clear();
+			return false;
+		}
+		file.read(reinterpret_cast<char*>(&hash), sizeof(UINT64));
+		file.read(reinterpret_cast<char*>(&size), sizeof(UINT));
+		remaining -= sizeof(UINT64) + sizeof(UINT);
+
+		if (!file.good() || (UINT64)size * sizeof(UINT) > remaining)
+		{
+			Clear();
+			return false;
+		}
+		remaining -= (UINT64)size * sizeof(UINT);
+
+		CanonicalPipelineState canonical(size);
+		file.read(reinterpret_cast<char*>(canonical.data()), size * sizeof(UINT));
+		if (!file.good() || HashPipelineState(canonical) != hash)
+		{
+			Clear();
+			return false;
+		}
+		entries[hash] = std::move(canonical);
+	}
+
+	UINT64 librarySize = 0;
+	if (remaining < sizeof(UINT64))
+	{
+		Clear();
+		return false;
+	}
+	file.read(reinterpret_cast<char*>(&librarySize), sizeof(UINT64));
+	remaining -= sizeof(UINT64);
+	if (!file.good() || librarySize > remaining)
+	{
+		Clear();
+		return false;
+	}
+	library.resize((size_t)librarySize);
+	file.read(reinterpret_cast<char*>(library.data()), library.size());
+	if (!file.good())
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool PipelineStateStore::Save(const std::filesystem::path& fileName, const PipelineDriverVersion& driver)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[7] = { StoreMagic, StoreVersion, driver.vendorId, driver.deviceId, (UINT)driver.driverVersion,
+		(UINT)(driver.driverVersion >> 32), (UINT)entries.size() };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		UINT size = (UINT)i->second.size();
+		file.write(reinterpret_cast<const char*>(&i->first), sizeof(UINT64));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(i->second.data()), size * sizeof(UINT));
+	}
+
+	UINT64 librarySize = library.size();
+	file.write(reinterpret_cast<const char*>(&librarySize), sizeof(UINT64));
+	file.write(reinterpret_cast<const char*>(library.data()), library.size());
+	return file.good();
+}
+
+bool PipelineStateStore::Contains(UINT64 hash, const CanonicalPipelineState& canonical)
+{
+	auto found = entries.find(hash);
+	return found != entries.end() && found->second == canonical;
+}
+
+void PipelineStateStore::Add(UINT64 hash, const CanonicalPipelineState& canonical)
+{
+	entries[hash] = canonical;
+}
+
+void PipelineStateStore::Clear()
+{
+	entries.clear();
+	library.clear();
+}
+
+std::vector<BYTE>& PipelineStateStore::GetLibrary()
+{
+	return library;
+}
+
+size_t PipelineStateStore::GetCount()
+{
+	return entries.size();
+}
+
+std::wstring PipelineStateStore::GetPipelineName(UINT64 hash)
+{
+	wchar_t name[17];
+	swprintf(name, _countof(name), L"%016llx", (unsigned long long)hash);
+	return name;
+}
+
+PipelineStateCache::PipelineStateCache(std::filesystem::path storeFileName)
+	: storeFileName(storeFileName), driver({}), driverSet(false), storeLoaded(false), storedCount(0), dirty(false), stats({})
+{
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+}
+
+void PipelineStateCache::SetDriverVersion(const PipelineDriverVersion& driver)
+{
+	this->driver = driver;
+	driverSet = true;
+}
+
+PipelineStateCache::Entry* PipelineStateCache::Find(UINT64 hash, const CanonicalPipelineState& canonical, const std::string& name)
+{
+	stats.requests++;
+
+	auto found = entries.find(hash);
+	if (found == entries.end())
+		return nullptr;
+
+	for (size_t i = 0; i < found->second.size(); i++)
+	{
+		if (found->second[i].canonical == canonical)
+		{
+			found->second[i].users.push_back(name);
+			return &found->second[i];
+		}
+	}
+	return nullptr;
+}
+
+void PipelineStateCache::LoadStore(ID3D12Device* device)
+{
+	if (storeLoaded || !driverSet)
+		return;
+	storeLoaded = true;
+
+	if (!store.Load(storeFileName, driver))
+		return;
+	storedCount = store.GetCount();
+
+	//pipeline libraries need a newer device interface, without it everything is created
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(device1.GetAddressOf()))))
+		return;
+
+	//the library reads from the blob for as long as it lives
+	libraryBlob = std::move(store.GetLibrary());
+	if (FAILED(device1->CreatePipelineLibrary(libraryBlob.data(), libraryBlob.size(), IID_PPV_ARGS(library.GetAddressOf()))))
+	{
+		//a driver update the version check didn't see, or a damaged file
+		library = nullptr;
+		store.Clear();
+	}
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::Get(ID3D12Device* device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::string& name)
+{
+	UINT64 rootSignatureHash = GetRootSignatureCache().GetHash(desc.pRootSignature);
+	if (rootSignatureHash == 0)
+		throw std::logic_error("Pipeline " + name + " uses a root signature not created through the root signature cache");
+
+	CanonicalPipelineState canonical = CanonicalizeGraphicsPipelineState(desc, rootSignatureHash);
+	UINT64 hash = HashPipelineState(canonical);
+	if (Entry* found = Find(hash, canonical, name))
+		return found->pipelineState;
+
+	LoadStore(device);
+
+	Entry entry = { canonical, nullptr, { name } };
+	//loading fails when the description differs from the stored one in state the canonical form leaves out
+	if (library && store.Contains(hash, canonical) && SUCCEEDED(library->LoadGraphicsPipeline(PipelineStateStore::GetPipelineName(hash).c_str(),
+		&desc, IID_PPV_ARGS(entry.pipelineState.GetAddressOf()))))
+	{
+		stats.loaded++;
+	}
+	else
+	{
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(entry.pipelineState.GetAddressOf())));
+		stats.created++;
+		dirty = true;
+	}
+
+	stats.unique++;
+	entries[hash].push_back(entry);
+	return entry.pipelineState;
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::Get(ID3D12Device* device, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::string& name)
+{
+	UINT64 rootSignatureHash = GetRootSignatureCache().GetHash(desc.pRootSignature);
+	if (rootSignatureHash == 0)
+		throw std::logic_error("Pipeline " + name + " uses a root signature not created through the root signature cache");
+
+	CanonicalPipelineState canonical = CanonicalizeComputePipelineState(desc, rootSignatureHash);
+	UINT64 hash = HashPipelineState(canonical);
+	if (Entry* found = Find(hash, canonical, name))
+		return found->pipelineState;
+
+	LoadStore(device);
+
+	Entry entry = { canonical, nullptr, { name } };
+	if (library && store.Contains(hash, canonical) && SUCCEEDED(library->LoadComputePipeline(PipelineStateStore::GetPipelineName(hash).c_str(),
+		&desc, IID_PPV_ARGS(entry.pipelineState.GetAddressOf()))))
+	{
+		stats.loaded++;
+	}
+	else
+	{
+		ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(entry.pipelineState.GetAddressOf())));
+		stats.created++;
+		dirty = true;
+	}
+
+	stats.unique++;
+	entries[hash].push_back(entry);
+	return entry.pipelineState;
+}
+
+void PipelineStateCache::Save(ID3D12Device* device)
+{
+	//nothing new and every stored pipeline was used
+	if (!driverSet || (!dirty && stats.loaded >= storedCount))
+		return;
+
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(device1.GetAddressOf()))))
+		return;
+
+	//a new library of this run's pipelines only, so the ones of edited shaders don't pile up. Graphics debuggers
+	//don't always support libraries
+	ComPtr<ID3D12PipelineLibrary> newLibrary;
+	if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(newLibrary.GetAddressOf()))))
+		return;
+
+	store.Clear();
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		for (size_t j = 0; j < i->second.size(); j++)
+		{
+			//two canonical forms under one hash can't share a name, the second is created every run
+			if (j == 0 && SUCCEEDED(newLibrary->StorePipeline(PipelineStateStore::GetPipelineName(i->first).c_str(), i->second[j].pipelineState.Get())))
+				store.Add(i->first, i->second[j].canonical);
+		}
+	}
+
+	std::vector<BYTE>& blob = store.GetLibrary();
+	blob.resize(newLibrary->GetSerializedSize());
+	if (FAILED(newLibrary->Serialize(blob.data(), blob.size())) || !store.Save(storeFileName, driver))
+		return;
+
+	library = newLibrary;
+	storedCount = 0;
+	dirty = false;
+}
+
+const PipelineStateCacheStats& PipelineStateCache::GetStats()
+{
+	return stats;
+}
+
+void PipelineStateCache::PrintReport()
+{
+	printf("Pipeline states: %u requested, %u unique, %u from the pipeline library, %u created\n",
+		stats.requests, stats.unique, stats.loaded, stats.created);
+
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		for (size_t j = 0; j < i->second.size(); j++)
+		{
+			const Entry& entry = i->second[j];
+			std::string users;
+			for (size_t k = 0; k < entry.users.size(); k++)
+				users += (k > 0 ? ", " : "") + entry.users[k];
+			printf("  %016llx %2zu users: %s\n", (unsigned long long)i->first, entry.users.size(), users.c_str());
+		}
+	}
+}
+
+PipelineStateCache& GetPipelineStateCache()
+{
+	static PipelineStateCache cache;
+	return cache;
+}
+
+void ValidatePipelineStateCache()
+{
+	printf("Pipeline state cache\n");
+	bool passed = true;
+
+	//the entity pipeline: the mesh input layout, a vertex and a pixel shader, default state
+	D3D12_INPUT_ELEMENT_DESC inputElementDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+	D3D12_INPUT_ELEMENT_DESC renamedElementDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	BYTE vertexShader[] = { 'D', 'X', 'B', 'C', 1, 2, 3, 4 };
+	BYTE pixelShader[] = { 'D', 'X', 'B', 'C', 5, 6, 7, 8, 9 };
+	BYTE pixelShaderCopy[] = { 'D', 'X', 'B', 'C', 5, 6, 7, 8, 9 };
+	BYTE editedPixelShader[] = { 'D', 'X', 'B', 'C', 5, 6, 7, 8, 10 };
+	UINT64 rootSignatureHash = 0x1234567890ABCDEFull;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.InputLayout = { inputElementDesc,_countof(inputElementDesc) };
+	psoDesc.VS = { vertexShader, sizeof(vertexShader) };
+	psoDesc.PS = { pixelShader, sizeof(pixelShader) };
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	psoDesc.SampleDesc.Count = 1;
+	CanonicalPipelineState base = CanonicalizeGraphicsPipelineState(psoDesc, rootSignatureHash);
+
+	auto canonicalize = [&psoDesc, rootSignatureHash](auto change)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = psoDesc;
+		change(desc);
+		return CanonicalizeGraphicsPipelineState(desc, rootSignatureHash);
+	};
+
+	Check(passed, "shaders taken by contents", canonicalize([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.PS = { pixelShaderCopy, sizeof(pixelShaderCopy) };
+	}) == base);
+	Check(passed, "disabled blend factors ignored", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		desc.BlendState.RenderTarget[1].RenderTargetWriteMask = 0;
+	}) == base);
+	Check(passed, "disabled stencil state ignored", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.DepthStencilState.StencilReadMask = 0;
+		desc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_NEVER;
+	}) == base);
+	Check(passed, "unused render target formats ignored", canonicalize([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.RTVFormats[3] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.CachedPSO = { vertexShader, sizeof(vertexShader) };
+	}) == base);
+
+	Check(passed, "edited shader differs", canonicalize([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.PS = { editedPixelShader, sizeof(editedPixelShader) };
+	}) != base);
+	Check(passed, "enabled blending differs", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.BlendState.RenderTarget[0].BlendEnable = TRUE;
+	}) != base);
+	Check(passed, "depth function differs", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+	}) != base);
+	Check(passed, "cull mode differs", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	}) != base);
+	Check(passed, "input layout differs", canonicalize([&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.InputLayout = { renamedElementDesc,_countof(renamedElementDesc) };
+	}) != base);
+	Check(passed, "render target format differs", canonicalize([](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		desc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	}) != base);
+	Check(passed, "root signature differs", CanonicalizeGraphicsPipelineState(psoDesc, rootSignatureHash + 1) != base);
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc = {};
+	computeDesc.CS = { pixelShader, sizeof(pixelShader) };
+	CanonicalPipelineState compute = CanonicalizeComputePipelineState(computeDesc, rootSignatureHash);
+	Check(passed, "compute differs from graphics", compute != base && HashPipelineState(compute) != HashPipelineState(base));
+
+	//the store written and read back, by the same driver and by others
+	std::filesystem::path fileName = std::filesystem::temp_directory_path() / "PipelineStateCacheValidation.bin";
+	PipelineDriverVersion driver = { 0x10DE, 0x2484, 0x001F000E000A1234ull };
+	BYTE library[] = { 1, 2, 3, 4, 5, 6, 7 };
+	UINT64 hash = HashPipelineState(base);
+	auto saveStore = [&]()
+	{
+		PipelineStateStore store;
+		store.Add(hash, base);
+		store.Add(HashPipelineState(compute), compute);
+		store.GetLibrary().assign(library, library + sizeof(library));
+		return store.Save(fileName, driver);
+	};
+	Check(passed, "store saved", saveStore());
+	{
+		PipelineStateStore store;
+		Check(passed, "store loaded", store.Load(fileName, driver) && store.GetCount() == 2);
+		Check(passed, "pipelines found", store.Contains(hash, base) && store.Contains(HashPipelineState(compute), compute));
+		Check(passed, "collision rejected", !store.Contains(hash, compute));
+		Check(passed, "library read back", store.GetLibrary() == std::vector<BYTE>(library, library + sizeof(library)));
+	}
+	{
+		PipelineStateStore store;
+		PipelineDriverVersion updated = driver;
+		updated.driverVersion++;
+		PipelineDriverVersion otherDevice = driver;
+		otherDevice.deviceId++;
+		Check(passed, "other driver version ignored", !store.Load(fileName, updated) && store.GetCount() == 0);
+		Check(passed, "other device ignored", !store.Load(fileName, otherDevice) && store.GetCount() == 0);
+	}
+
+	//an entry size past the end of the file and a library cut short are misses, not allocations
+	{
+		std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+		UINT corruptSize = 0xFFFFFFF0;
+		file.seekp(7 * sizeof(UINT) + sizeof(UINT64));
+		file.write(reinterpret_cast<const char*>(&corruptSize), sizeof(UINT));
+	}
+	{
+		PipelineStateStore store;
+		Check(passed, "corrupt entry size rejected", !store.Load(fileName, driver) && store.GetCount() == 0);
+	}
+	saveStore();
+	std::filesystem::resize_file(fileName, std::filesystem::file_size(fileName) - 2);
+	{
+		PipelineStateStore store;
+		Check(passed, "truncated library rejected", !store.Load(fileName, driver) && store.GetCount() == 0 && store.GetLibrary().empty());
+	}
+
+	saveStore();
+	{
+		std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+		UINT oldVersion = StoreVersion + 1;
+		file.seekp(sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(&oldVersion), sizeof(UINT));
+	}
+	{
+		PipelineStateStore store;
+		Check(passed, "other version ignored", !store.Load(fileName, driver) && store.GetCount() == 0);
+	}
+
+	Check(passed, "pipeline names unique", PipelineStateStore::GetPipelineName(hash) != PipelineStateStore::GetPipelineName(hash + 1)
+		&& PipelineStateStore::GetPipelineName(hash).size() == 16);
+
+	std::error_code error;
+	std::filesystem::remove(fileName, error);
+	PrintValidationResult(passed);
+}
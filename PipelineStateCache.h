@@ -0,0 +1,116 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<dxgi1_6.h>
+#include<filesystem>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+//a pipeline description as words, equal for descriptions that create the same pipeline. The root signature is taken by
+//the hash of its canonical form and shaders by the hash of their bytecode, so the words mean the same thing every run.
+//State a disabled switch ignores, like blend factors without blending, is left out
+typedef std::vector<UINT> CanonicalPipelineState;
+
+CanonicalPipelineState CanonicalizeGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash);
+CanonicalPipelineState CanonicalizeComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash);
+UINT64 HashPipelineState(const CanonicalPipelineState& canonical);
+UINT64 HashShaderBytecode(const D3D12_SHADER_BYTECODE& bytecode);
+
+//pipelines stored by one driver can't be loaded by another
+struct PipelineDriverVersion
+{
+	UINT vendorId;
+	UINT deviceId;
+	UINT64 driverVersion;
+};
+
+PipelineDriverVersion GetPipelineDriverVersion(IDXGIAdapter* adapter);
+
+//the serialized pipeline library from an earlier run and the canonical descriptions of the pipelines in it
+class PipelineStateStore
+{
+	std::unordered_map<UINT64, CanonicalPipelineState> entries;
+	std::vector<BYTE> library;
+
+public:
+	PipelineStateStore();
+	~PipelineStateStore();
+
+	//false when there's no file, or it was written by another version of the store or another driver
+	bool Load(const std::filesystem::path& fileName, const PipelineDriverVersion& driver);
+	bool Save(const std::filesystem::path& fileName, const PipelineDriverVersion& driver);
+
+	bool Contains(UINT64 hash, const CanonicalPipelineState& canonical);
+	void Add(UINT64 hash, const CanonicalPipelineState& canonical);
+	void Clear();
+
+	//has to outlive the library created from it
+	std::vector<BYTE>& GetLibrary();
+	size_t GetCount();
+
+	//the name the pipeline is stored under in the library
+	static std::wstring GetPipelineName(UINT64 hash);
+};
+
+struct PipelineStateCacheStats
+{
+	UINT requests;
+	UINT unique;
+	UINT loaded;
+	UINT created;
+};
+
+//one pipeline state object per distinct description, shared by every pass asking for it. Pipelines come from the
+//library stored by the last run when their description and shaders haven't changed, the rest are created and the
+//library written again on Save
+class PipelineStateCache
+{
+	struct Entry
+	{
+		CanonicalPipelineState canonical;
+		ComPtr<ID3D12PipelineState> pipelineState;
+		std::vector<std::string> users;
+	};
+
+	std::unordered_map<UINT64, std::vector<Entry>> entries;
+	PipelineStateStore store;
+	std::filesystem::path storeFileName;
+	PipelineDriverVersion driver;
+	bool driverSet;
+	bool storeLoaded;
+	//pipelines in the stored library when it was loaded, fewer loaded means some belong to edited shaders
+	size_t storedCount;
+	bool dirty;
+	std::vector<BYTE> libraryBlob;
+	ComPtr<ID3D12PipelineLibrary> library;
+
+	PipelineStateCacheStats stats;
+
+	Entry* Find(UINT64 hash, const CanonicalPipelineState& canonical, const std::string& name);
+	void LoadStore(ID3D12Device* device);
+
+public:
+	PipelineStateCache(std::filesystem::path storeFileName = "ShaderCache/Pipelines.bin");
+	~PipelineStateCache();
+
+	//the store is only used once the driver is known
+	void SetDriverVersion(const PipelineDriverVersion& driver);
+
+	//the root signature has to come from the root signature cache. name is only used in the report
+	ComPtr<ID3D12PipelineState> Get(ID3D12Device* device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::string& name);
+	ComPtr<ID3D12PipelineState> Get(ID3D12Device* device, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::string& name);
+
+	//writes a library of the pipelines used this run when any of them wasn't loaded or the stored ones went unused
+	void Save(ID3D12Device* device);
+
+	const PipelineStateCacheStats& GetStats();
+	//every unique pipeline and the passes using it
+	void PrintReport();
+};
+
+PipelineStateCache& GetPipelineStateCache();
+
+//canonical forms of equivalent and different descriptions, and the store written and read back under matching and
+//other drivers
+void ValidatePipelineStateCache();
@@ -1,5 +1,7 @@
 #include "Common.hlsl"
 #include "Lighting.hlsli"
+#include "SphericalHarmonics.hlsli"
+#include "ClusteredLighting.hlsli"
 
 cbuffer LightingData : register(b1)
 {
@@ -24,6 +26,7 @@ struct IndirectLighting
     bool inlineRaytrace;
 };
 ConstantBuffer<IndirectLighting> indLighting : register(b2);
+ConstantBuffer<IrradianceSHData> irradianceSH : register(b3);
 
 RaytracingAccelerationStructure SceneBVH : register(t0, space4);
 
@@ -38,17 +41,12 @@ struct VertexToPixel
 
 };
 
-#define TILE_SIZE 8
-
 Texture2D material[]: register(t0);
-TextureCube irradianceMap: register(t0, space1);
 TextureCube prefilteredMap: register(t1, space1);
 
 Texture2D vmfMap: register(t0, space3);
 Texture2D prefilteredRoughnessMap: register(t1, space3);
 
-StructuredBuffer<uint> LightIndices : register(t1, space2);
-
 Texture2D blueNoise : register(t0, space4);
 
 float IGN(int pixelX, int pixelY, int frame)
@@ -77,10 +75,8 @@ float4 main(VertexToPixel input) : SV_TARGET
     }
 	
 	
-    uint2 location = uint2(input.position.xy);
-    uint2 tileID = location / uint2(TILE_SIZE, TILE_SIZE);
-    uint numberOfTilesX = WIDTH / TILE_SIZE;
-    uint tileIndex = tileID.y * numberOfTilesX + tileID.x;
+    //the lights of the cluster the pixel falls in
+    uint2 clusterRange = GetClusterRange(input.position.xy, dot(input.worldPosition - cameraPosition, cameraForward));
 
 	uint index = entityIndex.index;
 
@@ -185,11 +181,10 @@ float4 main(VertexToPixel input) : SV_TARGET
         }
     }
 	
-    uint offset = tileIndex * 1024;
 	[loop]
-     for (uint i = 0; i < 1024 && LightIndices[offset + i] != -1; i++)
+     for (uint i = 0; i < clusterRange.y; i++)
      {
-         uint lightIndex = LightIndices[offset + i];
+         uint lightIndex = ClusterLightIndices[clusterRange.x + i];
 	
          switch (lights[lightIndex].type)
          {
@@ -227,7 +222,8 @@ float4 main(VertexToPixel input) : SV_TARGET
 
 	kdIndirect *= surfaceColor.rgb / PI;
 
-	float3 irradiance = irradianceMap.Sample(basicSampler, N).rgb;
+	//the same 2.2 curve the irradiance map was rendered with
+	float3 irradiance = pow(EvaluateIrradianceSH(irradianceSH, N), 2.2f);
 
 	float3 diffuseIndirect = surfaceColor.rgb * irradiance;
 
@@ -1,10 +1,13 @@
 #include "Common.hlsl"
 #include "Lighting.hlsli"
+#include "SphericalHarmonics.hlsli"
+#include "ClusteredLighting.hlsli"
 
 cbuffer LightingData : register(b1)
 {
     float3 cameraPosition;
     uint lightCount;
+    float3 cameraForward;
 };
 
 struct Index
@@ -20,6 +23,7 @@ struct IndirectLighting
     bool inlineRaytrace;
 };
 ConstantBuffer<IndirectLighting> indLighting : register(b2);
+ConstantBuffer<IrradianceSHData> irradianceSH : register(b3);
 
 RaytracingAccelerationStructure SceneBVH : register(t0, space4);
 
@@ -34,25 +38,18 @@ struct VertexToPixel
 
 };
 
-#define TILE_SIZE 8
-
 Texture2D material[] : register(t0);
-TextureCube irradianceMap : register(t0, space1);
 TextureCube prefilteredMap : register(t1, space1);
 
 Texture2D vmfMap : register(t0, space3);
 Texture2D prefilteredRoughnessMap : register(t1, space3);
 
-StructuredBuffer<uint> LightIndices : register(t1, space2);
-
 Texture2D blueNoise : register(t0, space4);
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
-    uint2 location = uint2(input.position.xy);
-    uint2 tileID = location / uint2(TILE_SIZE, TILE_SIZE);
-    uint numberOfTilesX = WIDTH / TILE_SIZE;
-    uint tileIndex = tileID.y * numberOfTilesX + tileID.x;
+    //the lights of the cluster the pixel falls in
+    uint2 clusterRange = GetClusterRange(input.position.xy, dot(input.worldPosition - cameraPosition, cameraForward));
 
     uint index = entityIndex.index;
 
@@ -157,11 +154,10 @@ float4 main(VertexToPixel input) : SV_TARGET
         }
     }
 	
-    uint offset = tileIndex * 1024;
 	[loop]
-    for (uint i = 0; i < 1024 && LightIndices[offset + i] != -1; i++)
+    for (uint i = 0; i < clusterRange.y; i++)
     {
-        uint lightIndex = LightIndices[offset + i];
+        uint lightIndex = ClusterLightIndices[clusterRange.x + i];
 	
         switch (lights[lightIndex].type)
         {
@@ -199,7 +195,8 @@ float4 main(VertexToPixel input) : SV_TARGET
 
     kdIndirect *= surfaceColor.rgb / PI;
 
-    float3 irradiance = irradianceMap.Sample(basicSampler, N).rgb;
+    //the same 2.2 curve the irradiance map was rendered with
+    float3 irradiance = pow(EvaluateIrradianceSH(irradianceSH, N), 2.2f);
 
     float3 diffuseIndirect = surfaceColor.rgb * irradiance;
 
@@ -5,8 +5,8 @@ RWStructuredBuffer<uint> newSequences : register(u0, space1);
 
 ConstantBuffer<RayTraceExternData> externData : register(b0);
 
-RWStructuredBuffer<GIReservoir> prevFrameRes : register(u0, space3);
-RWStructuredBuffer<GIReservoir> intermediateReservoir : register(u1, space3);
+RWStructuredBuffer<PackedGIReservoir> prevFrameRes : register(u0, space3);
+RWStructuredBuffer<PackedGIReservoir> intermediateReservoir : register(u1, space3);
 float IntersectAABB(float3 origin, float3 direction, float3 extents)
 {
     float3 reciprocal = rcp(direction);
@@ -51,17 +51,8 @@ float3 TemporalReprojection(uint2 launchDims, float4 history, float4 color)
 	
     if(factor == 1)
     {
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.color = float3(0, 0, 0);
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.sampleNormal = float3(0, 0, 0);
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.visibleNormal = float3(0, 0, 0);
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.RandomNums = float3(0, 0, 0);
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.samplePos = float3(0, 0, 0);
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].sample.visiblePos = float3(0, 0, 0);
-        
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].M = 0;
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].wsum = 0;
-        prevFrameRes[launchDims.y * WIDTH + launchDims.x].W = 0;
-
+        GIReservoir emptyReservoir = (GIReservoir) 0;
+        prevFrameRes[launchDims.y * WIDTH + launchDims.x] = PackGIReservoir(emptyReservoir);
     }
     return ((lerp(history, color, factor))).xyz;
 }
@@ -152,7 +143,12 @@ void IndirectDiffuseRayGen()
         
         //Generate the initial Samples Alg 2
         
-        float3 randomVars = float3(nextRand(rndseed), nextRand(rndseed), 0);
+        //the reservoir keeps the 16 bit seed instead of the random numbers
+        uint sampleSeed = rndseed & 0xFFFF;
+        uint sampleRndSeed = SampleSeedState(sampleSeed);
+        float3 randomVars = float3(nextRand(sampleRndSeed), nextRand(sampleRndSeed), 0);
+        //moves the payload's seed off the bits the sample seed took
+        nextRand(rndseed);
         float3 L = GetCosHemisphereSample(randomVars.x, randomVars.y, norm);
         L = normalize(L);
         HitInfo giPayload = { float4(0, 0, 0, 0), 0, rndseed, pos, norm, 0.01,albedo };
@@ -171,7 +167,7 @@ void IndirectDiffuseRayGen()
         newSample.sampleNormal = giPayload.normal;
         newSample.samplePos = giPayload.currentPosition;
         newSample.color = giPayload.color;
-        newSample.RandomNums = randomVars;
+        newSample.seed = sampleSeed;
         
         //Creating the temporal buffer Alg 3
         
@@ -198,7 +194,7 @@ void IndirectDiffuseRayGen()
 
             if (prevIndex.x >= 0 && prevIndex.x < dims.x && prevIndex.y >= 0 && prevIndex.y < dims.y)
             {
-                prevReservoir = prevFrameRes[prevIndex.y * WIDTH + prevIndex.x];
+                prevReservoir = UnpackGIReservoir(prevFrameRes[prevIndex.y * WIDTH + prevIndex.x]);
                 
                 history = gIndirectDiffuseOutputHistory[prevIndex];
                 
@@ -238,7 +234,7 @@ void IndirectDiffuseRayGen()
             else
                 prevReservoir.W = (prevReservoir.wsum) / (prevReservoir.M * p_hat);
         
-            prevFrameRes[launchIndex.y * WIDTH + launchIndex.x] = prevReservoir;
+            prevFrameRes[launchIndex.y * WIDTH + launchIndex.x] = PackGIReservoir(prevReservoir);
             float3 finalBrdfVal = albedo / M_PI * (prevReservoir.sample.color) * saturate(dot(newL, prevReservoir.sample.visibleNormal));
 
             gIndirectDiffuseOutput[launchIndex] = float4(finalBrdfVal * prevReservoir.W, 1.0);
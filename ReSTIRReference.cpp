@@ -0,0 +1,682 @@
+#include "ReSTIRReference.h"
+#include"Validation.h"
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<random>
+#include<thread>
+
+static const UINT GBufferMagic = 0x42475352;
+static const UINT GBufferVersion = 1;
+
+//a reservoir and the pixel whose target function produced it
+struct ReuseSource
+{
+	UINT pixel;
+	ReferenceReservoir reservoir;
+};
+
+static const ReferenceReservoir EmptyReservoir = { UINT_MAX, 0.0f, 0.0f, 0.0f };
+
+//initRand and nextRand from RTUtils.hlsli, so the cpu draws the same kind of numbers the shaders do
+static UINT InitRand(UINT val0, UINT val1)
+{
+	UINT v0 = val0;
+	UINT v1 = val1;
+	UINT s0 = 0;
+	for (UINT n = 0; n < 16; n++)
+	{
+		s0 += 0x9e3779b9;
+		v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+		v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+	}
+	return v0;
+}
+
+static float NextRand(UINT& s)
+{
+	s = 1664525u * s + 1013904223u;
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+static float Luminance(const Vector3& color)
+{
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+bool ReSTIRGBuffer::Load(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	UINT64 remaining = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != GBufferMagic || header[1] != GBufferVersion)
+		return false;
+	remaining -= sizeof(header);
+
+	//a corrupt dump fails to load, the planes are only sized once the dimensions match what is left of the file
+	if (header[2] == 0 || header[3] == 0 || (UINT64)header[2] * header[3] * sizeof(Vector4) * 3 != remaining)
+		return false;
+
+	width = header[2];
+	height = header[3];
+	std::vector<Vector4>* planes[] = { &positions, &normalDepths, &albedos };
+	for (std::vector<Vector4>* plane : planes)
+	{
+		plane->resize((size_t)width * height);
+		file.read(reinterpret_cast<char*>(plane->data()), plane->size() * sizeof(Vector4));
+	}
+	return file.good();
+}
+
+bool ReSTIRGBuffer::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[4] = { GBufferMagic, GBufferVersion, width, height };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	const std::vector<Vector4>* planes[] = { &positions, &normalDepths, &albedos };
+	for (const std::vector<Vector4>* plane : planes)
+	{
+		file.write(reinterpret_cast<const char*>(plane->data()), plane->size() * sizeof(Vector4));
+	}
+	return file.good();
+}
+
+ReSTIRReference::ReSTIRReference(const ReSTIRGBuffer& gBuffer, const Light* lights, UINT lightCount, UINT workerCount)
+	: gBuffer(gBuffer), lights(lights, lights + lightCount)
+{
+	if (lightCount == 0)
+		throw std::logic_error("ReSTIR reference needs lights");
+
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	this->workerCount = std::min(workerCount, gBuffer.height);
+	workerEvaluations.resize(this->workerCount);
+
+	size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+	reference.resize(pixelCount);
+	image.resize(pixelCount);
+	spatialReservoirs.resize(pixelCount);
+	Reset();
+}
+
+ReSTIRReference::~ReSTIRReference()
+{
+}
+
+void ReSTIRReference::ForEachRow(const std::function<void(UINT worker, UINT row)>& rowFunction)
+{
+	auto work = [this, &rowFunction](UINT worker)
+	{
+		for (UINT row = worker; row < gBuffer.height; row += workerCount)
+		{
+			rowFunction(worker, row);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (UINT w = 1; w < workerCount; w++)
+	{
+		workers.emplace_back(work, w);
+	}
+	work(0);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+Vector3 ReSTIRReference::Shade(UINT pixel, UINT lightIndex)
+{
+	const Vector4& position = gBuffer.positions[pixel];
+	const Vector4& normalDepth = gBuffer.normalDepths[pixel];
+	const Vector4& albedo = gBuffer.albedos[pixel];
+	const Light& light = lights[lightIndex];
+
+	Vector3 normal(normalDepth.x, normalDepth.y, normalDepth.z);
+	Vector3 radiance = light.color * light.intensity;
+	Vector3 diffuse = Vector3(albedo.x, albedo.y, albedo.z) / PI;
+
+	if (light.type == LIGHT_TYPE_DIR)
+		return diffuse * radiance * std::max(-normal.Dot(light.direction), 0.0f);
+
+	//area lights as a point at their center
+	Vector3 toLight = light.position - Vector3(position.x, position.y, position.z);
+	float distance2 = toLight.LengthSquared();
+	if (distance2 <= 0.0f)
+		return Vector3(0, 0, 0);
+
+	Vector3 L = toLight / sqrtf(distance2);
+	float nDotL = std::max(normal.Dot(L), 0.0f);
+	if (light.type == LIGHT_TYPE_AREA_RECT || light.type == LIGHT_TYPE_AREA_DISK)
+		return diffuse * radiance * (nDotL * light.rectLight.width * light.rectLight.height / distance2);
+
+	//Attenuate from Lighting.hlsli
+	float attenuation = std::clamp(1.0f - distance2 / (light.range * light.range), 0.0f, 1.0f);
+	float scale = nDotL * attenuation * attenuation;
+	if (light.type == LIGHT_TYPE_SPOT)
+		scale *= powf(std::max(-L.Dot(light.direction), 0.0f), light.spotFalloff);
+	return diffuse * radiance * scale;
+}
+
+float ReSTIRReference::TargetFunction(UINT pixel, UINT light)
+{
+	return Luminance(Shade(pixel, light));
+}
+
+void ReSTIRReference::ComputeReference()
+{
+	ForEachRow([this](UINT worker, UINT row)
+	{
+		for (UINT x = 0; x < gBuffer.width; x++)
+		{
+			UINT pixel = row * gBuffer.width + x;
+			Vector3 sum(0, 0, 0);
+			if (gBuffer.normalDepths[pixel].w > 0.0f)
+			{
+				for (UINT i = 0; i < lights.size(); i++)
+				{
+					sum += Shade(pixel, i);
+				}
+			}
+			reference[pixel] = sum;
+		}
+	});
+}
+
+void ReSTIRReference::Reset()
+{
+	size_t pixelCount = (size_t)gBuffer.width * gBuffer.height;
+	reservoirs.assign(pixelCount, EmptyReservoir);
+	previousReservoirs.assign(pixelCount, EmptyReservoir);
+}
+
+ReferenceReservoir ReSTIRReference::CombineReservoirs(const ReuseSource* sources, UINT sourceCount, UINT pixel, bool unbiased, UINT& seed, UINT64& evaluations)
+{
+	//Algorithm 4 of the paper, each reservoir resampled by its weight under this pixel's target function
+	ReferenceReservoir combined = EmptyReservoir;
+	for (UINT i = 0; i < sourceCount; i++)
+	{
+		const ReferenceReservoir& reservoir = sources[i].reservoir;
+		combined.M += reservoir.M;
+		if (reservoir.light == UINT_MAX)
+			continue;
+
+		float weight = TargetFunction(pixel, reservoir.light) * reservoir.W * reservoir.M;
+		evaluations++;
+		combined.wsum += weight;
+		if (weight > 0.0f && NextRand(seed) < weight / combined.wsum)
+			combined.light = reservoir.light;
+	}
+
+	if (combined.light == UINT_MAX)
+		return combined;
+
+	float target = TargetFunction(pixel, combined.light);
+	evaluations++;
+
+	float normalization = combined.M;
+	if (unbiased)
+	{
+		//only the pixels that could have picked the sample count towards M
+		normalization = 0.0f;
+		for (UINT i = 0; i < sourceCount; i++)
+		{
+			if (sources[i].reservoir.M == 0.0f)
+				continue;
+
+			if (sources[i].pixel == pixel ? target > 0.0f : TargetFunction(sources[i].pixel, combined.light) > 0.0f)
+				normalization += sources[i].reservoir.M;
+			evaluations += sources[i].pixel != pixel;
+		}
+	}
+
+	combined.W = target > 0.0f && normalization > 0.0f ? combined.wsum / (normalization * target) : 0.0f;
+	return combined;
+}
+
+void ReSTIRReference::RenderFrame(const ReSTIRSettings& settings, UINT frame, UINT seed)
+{
+	std::fill(workerEvaluations.begin(), workerEvaluations.end(), 0);
+	float lightCount = (float)lights.size();
+
+	//initial candidates and temporal reuse
+	ForEachRow([&](UINT worker, UINT row)
+	{
+		UINT64& evaluations = workerEvaluations[worker];
+		for (UINT x = 0; x < gBuffer.width; x++)
+		{
+			UINT pixel = row * gBuffer.width + x;
+			ReferenceReservoir& reservoir = reservoirs[pixel];
+			reservoir = EmptyReservoir;
+			if (gBuffer.normalDepths[pixel].w <= 0.0f)
+				continue;
+
+			UINT rndSeed = InitRand(pixel, frame * 0x9e3779b9u + seed);
+			float selectedTarget = 0.0f;
+			for (UINT i = 0; i < settings.candidateCount; i++)
+			{
+				UINT light = std::min((UINT)(NextRand(rndSeed) * lightCount), (UINT)lights.size() - 1);
+				float target = TargetFunction(pixel, light);
+				float weight = target * lightCount;
+				reservoir.wsum += weight;
+				reservoir.M += 1.0f;
+				if (weight > 0.0f && NextRand(rndSeed) < weight / reservoir.wsum)
+				{
+					reservoir.light = light;
+					selectedTarget = target;
+				}
+			}
+			evaluations += settings.candidateCount;
+			reservoir.W = selectedTarget > 0.0f ? reservoir.wsum / (reservoir.M * selectedTarget) : 0.0f;
+
+			const ReferenceReservoir& previous = previousReservoirs[pixel];
+			if (settings.temporalReuse && previous.M > 0.0f)
+			{
+				//the camera doesn't move in a dump, the history is at the same pixel
+				ReuseSource sources[2] = { { pixel, reservoir }, { pixel, previous } };
+				sources[1].reservoir.M = std::min(previous.M, settings.historyLimit * settings.candidateCount);
+				reservoir = CombineReservoirs(sources, 2, pixel, settings.unbiasedReuse, rndSeed, evaluations);
+			}
+		}
+	});
+
+	//spatial reuse and shading
+	ForEachRow([&](UINT worker, UINT row)
+	{
+		UINT64& evaluations = workerEvaluations[worker];
+		std::vector<ReuseSource> sources;
+		for (UINT x = 0; x < gBuffer.width; x++)
+		{
+			UINT pixel = row * gBuffer.width + x;
+			const Vector4& normalDepth = gBuffer.normalDepths[pixel];
+			image[pixel] = Vector3(0, 0, 0);
+			if (normalDepth.w <= 0.0f)
+			{
+				spatialReservoirs[pixel] = EmptyReservoir;
+				continue;
+			}
+
+			UINT rndSeed = InitRand(pixel, frame * 0x9e3779b9u + seed + 0x68e31da4u);
+			sources.clear();
+			sources.push_back({ pixel, reservoirs[pixel] });
+
+			//the neighbour tests of ReStirSpatialReuseAndFinalShade.hlsl
+			for (UINT i = 0; i < settings.neighborCount; i++)
+			{
+				float radius = settings.neighborRadius * NextRand(rndSeed);
+				float angle = 2.0f * PI * NextRand(rndSeed);
+				int neighborX = (int)(x + 0.5f + radius * cosf(angle));
+				int neighborY = (int)(row + 0.5f + radius * sinf(angle));
+				if (neighborX < 0 || neighborY < 0 || neighborX >= (int)gBuffer.width || neighborY >= (int)gBuffer.height)
+					continue;
+
+				UINT neighbor = neighborY * gBuffer.width + neighborX;
+				const Vector4& neighborNormalDepth = gBuffer.normalDepths[neighbor];
+				float normalDot = normalDepth.x * neighborNormalDepth.x + normalDepth.y * neighborNormalDepth.y + normalDepth.z * neighborNormalDepth.z;
+				if (normalDot < 0.906f || neighborNormalDepth.w > 1.1f * normalDepth.w || neighborNormalDepth.w < 0.9f * normalDepth.w)
+					continue;
+
+				sources.push_back({ neighbor, reservoirs[neighbor] });
+			}
+
+			ReferenceReservoir& reservoir = spatialReservoirs[pixel];
+			if (sources.size() > 1)
+				reservoir = CombineReservoirs(sources.data(), (UINT)sources.size(), pixel, settings.unbiasedReuse, rndSeed, evaluations);
+			else
+				reservoir = sources[0].reservoir;
+
+			if (reservoir.light != UINT_MAX)
+			{
+				image[pixel] = Shade(pixel, reservoir.light) * reservoir.W;
+				evaluations++;
+			}
+		}
+	});
+
+	//the reused reservoirs are next frame's history
+	std::swap(previousReservoirs, spatialReservoirs);
+}
+
+ReSTIRRunStats ReSTIRReference::Measure(const ReSTIRSettings& settings, UINT frameCount, UINT seed)
+{
+	Reset();
+
+	ReSTIRRunStats stats = {};
+	for (UINT frame = 0; frame < frameCount; frame++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		RenderFrame(settings, frame, seed);
+		auto end = std::chrono::high_resolution_clock::now();
+		stats.frameTime += std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+	}
+
+	double referenceSum = 0.0;
+	double imageSum = 0.0;
+	double squaredError = 0.0;
+	UINT64 evaluations = 0;
+	UINT pixelCount = 0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		if (gBuffer.normalDepths[i].w <= 0.0f)
+			continue;
+
+		double referenceLuminance = Luminance(reference[i]);
+		double imageLuminance = Luminance(image[i]);
+		referenceSum += referenceLuminance;
+		imageSum += imageLuminance;
+		squaredError += (imageLuminance - referenceLuminance) * (imageLuminance - referenceLuminance);
+		pixelCount++;
+	}
+	for (UINT64 workerCount : workerEvaluations)
+	{
+		evaluations += workerCount;
+	}
+
+	if (pixelCount == 0 || referenceSum <= 0.0)
+		return stats;
+
+	double referenceMean = referenceSum / pixelCount;
+	stats.relativeMSE = squaredError / pixelCount / (referenceMean * referenceMean);
+	stats.relativeBias = (imageSum - referenceSum) / referenceSum;
+	stats.evaluationsPerPixel = (double)evaluations / pixelCount;
+	return stats;
+}
+
+const std::vector<Vector3>& ReSTIRReference::GetImage()
+{
+	return image;
+}
+
+const std::vector<Vector3>& ReSTIRReference::GetReference()
+{
+	return reference;
+}
+
+ReSTIRGBuffer MakeReSTIRTestGBuffer(UINT width, UINT height)
+{
+	ReSTIRGBuffer gBuffer;
+	gBuffer.width = width;
+	gBuffer.height = height;
+	gBuffer.positions.resize((size_t)width * height);
+	gBuffer.normalDepths.resize((size_t)width * height);
+	gBuffer.albedos.resize((size_t)width * height);
+
+	Vector3 cameraPosition(0, 6, -18);
+	Vector3 forward = Vector3(0, 2, 10) - cameraPosition;
+	forward.Normalize();
+	Vector3 right = Vector3(0, 1, 0).Cross(forward);
+	right.Normalize();
+	Vector3 up = forward.Cross(right);
+	float tanHalfFov = tanf(PI / 6.0f);
+	float aspect = (float)width / height;
+
+	Vector3 sphereCenter(0, 3, 6);
+	float sphereRadius = 3.0f;
+
+	for (UINT y = 0; y < height; y++)
+	{
+		for (UINT x = 0; x < width; x++)
+		{
+			float u = ((x + 0.5f) / width * 2.0f - 1.0f) * tanHalfFov * aspect;
+			float v = (1.0f - (y + 0.5f) / height * 2.0f) * tanHalfFov;
+			Vector3 direction = forward + right * u + up * v;
+			direction.Normalize();
+
+			float nearest = FLT_MAX;
+			Vector3 normal(0, 0, 0);
+			Vector3 albedo(0, 0, 0);
+
+			//floor at y = 0, checkered
+			if (direction.y < 0.0f)
+			{
+				float t = -cameraPosition.y / direction.y;
+				Vector3 hit = cameraPosition + direction * t;
+				if (t < nearest && fabsf(hit.x) < 40.0f && hit.z < 30.0f)
+				{
+					nearest = t;
+					normal = Vector3(0, 1, 0);
+					bool checker = ((int)floorf(hit.x / 4.0f) + (int)floorf(hit.z / 4.0f)) & 1;
+					albedo = checker ? Vector3(0.8f, 0.8f, 0.8f) : Vector3(0.3f, 0.3f, 0.35f);
+				}
+			}
+
+			//wall at z = 30
+			if (direction.z > 0.0f)
+			{
+				float t = (30.0f - cameraPosition.z) / direction.z;
+				Vector3 hit = cameraPosition + direction * t;
+				if (t < nearest && fabsf(hit.x) < 40.0f && hit.y > 0.0f && hit.y < 20.0f)
+				{
+					nearest = t;
+					normal = Vector3(0, 0, -1);
+					albedo = Vector3(0.6f, 0.55f, 0.5f);
+				}
+			}
+
+			Vector3 toCenter = cameraPosition - sphereCenter;
+			float b = toCenter.Dot(direction);
+			float c = toCenter.LengthSquared() - sphereRadius * sphereRadius;
+			float discriminant = b * b - c;
+			if (discriminant > 0.0f)
+			{
+				float t = -b - sqrtf(discriminant);
+				if (t > 0.0f && t < nearest)
+				{
+					nearest = t;
+					normal = cameraPosition + direction * t - sphereCenter;
+					normal.Normalize();
+					albedo = Vector3(0.9f, 0.2f, 0.15f);
+				}
+			}
+
+			UINT pixel = y * width + x;
+			if (nearest == FLT_MAX)
+			{
+				gBuffer.positions[pixel] = Vector4(0, 0, 0, 0);
+				gBuffer.normalDepths[pixel] = Vector4(0, 0, 0, 0);
+				gBuffer.albedos[pixel] = Vector4(0, 0, 0, 0);
+				continue;
+			}
+
+			Vector3 hit = cameraPosition + direction * nearest;
+			gBuffer.positions[pixel] = Vector4(hit.x, hit.y, hit.z, 1);
+			gBuffer.normalDepths[pixel] = Vector4(normal.x, normal.y, normal.z, nearest * direction.Dot(forward));
+			gBuffer.albedos[pixel] = Vector4(albedo.x, albedo.y, albedo.z, 1);
+		}
+	}
+	return gBuffer;
+}
+
+static std::vector<Light> MakeReSTIRTestLights(UINT count, UINT seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Light> lights(count);
+	for (UINT i = 0; i < count; i++)
+	{
+		Light light = {};
+		light.type = unit(generator) < 0.85f ? LIGHT_TYPE_POINT : LIGHT_TYPE_SPOT;
+		light.position = Vector3(unit(generator) * 50.0f - 25.0f, 0.5f + unit(generator) * 8.0f, unit(generator) * 33.0f - 5.0f);
+		light.color = Vector3(unit(generator), unit(generator), unit(generator));
+		light.intensity = 1.0f + unit(generator) * 4.0f;
+		light.range = 4.0f + unit(generator) * 10.0f;
+		light.direction = Vector3(unit(generator) - 0.5f, -1.0f, unit(generator) - 0.5f);
+		light.direction.Normalize();
+		light.spotFalloff = 2.0f + unit(generator) * 14.0f;
+		lights[i] = light;
+	}
+	return lights;
+}
+
+void ValidateReSTIRReference()
+{
+	printf("ReSTIR reference\n");
+	bool passed = true;
+
+	ReSTIRGBuffer gBuffer = MakeReSTIRTestGBuffer(64, 36);
+
+	std::filesystem::path dumpFile = std::filesystem::temp_directory_path() / "restir_gbuffer_test.bin";
+	ReSTIRGBuffer loaded;
+	bool roundTrip = gBuffer.Save(dumpFile) && loaded.Load(dumpFile) && loaded.width == gBuffer.width && loaded.height == gBuffer.height
+		&& memcmp(loaded.normalDepths.data(), gBuffer.normalDepths.data(), gBuffer.normalDepths.size() * sizeof(Vector4)) == 0;
+	Check(passed, "g-buffer dump round trip", roundTrip);
+
+	UINT corruptHeight = 0x40000000;
+	gBuffer.Save(dumpFile);
+	{
+		std::fstream file(dumpFile, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(3 * sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(&corruptHeight), sizeof(corruptHeight));
+	}
+	bool rejected = !loaded.Load(dumpFile);
+	gBuffer.Save(dumpFile);
+	std::error_code error;
+	std::filesystem::resize_file(dumpFile, std::filesystem::file_size(dumpFile, error) - 1, error);
+	rejected = rejected && !loaded.Load(dumpFile);
+	std::filesystem::remove(dumpFile, error);
+	Check(passed, "corrupt g-buffer dumps rejected", rejected);
+
+	ReSTIRSettings noReuse = { 4, false, 20.0f, 0, 0.0f, false };
+	ReSTIRSettings biasedReuse = { 4, true, 20.0f, 5, 10.0f, false };
+	ReSTIRSettings unbiasedReuse = { 4, true, 20.0f, 5, 10.0f, true };
+
+	//with one light every estimate is the light's contribution. Not for the biased combine, it counts the M of
+	//neighbours the light doesn't reach and darkens the edges of their shadows
+	{
+		Light sun = {};
+		sun.type = LIGHT_TYPE_DIR;
+		sun.direction = Vector3(0.3f, -1.0f, 0.5f);
+		sun.direction.Normalize();
+		sun.color = Vector3(1, 0.9f, 0.8f);
+		sun.intensity = 2.0f;
+
+		ReSTIRReference restir(gBuffer, &sun, 1, 3);
+		restir.ComputeReference();
+		bool exact = true;
+		ReSTIRSettings temporalReuse = { 4, true, 20.0f, 0, 0.0f, false };
+		for (const ReSTIRSettings& settings : { noReuse, temporalReuse, unbiasedReuse })
+		{
+			ReSTIRRunStats stats = restir.Measure(settings, 3, 1);
+			exact = exact && stats.relativeMSE < 1e-10;
+		}
+		Check(passed, "one light is exact", exact);
+	}
+
+	std::vector<Light> lights = MakeReSTIRTestLights(200, 3);
+	ReSTIRReference restir(gBuffer, lights.data(), (UINT)lights.size(), 4);
+	restir.ComputeReference();
+
+	//the mean over independent frames converges to the brute force image
+	auto averageBias = [&](const ReSTIRSettings& settings, UINT runs)
+	{
+		double bias = 0.0;
+		for (UINT run = 0; run < runs; run++)
+		{
+			bias += restir.Measure(settings, settings.temporalReuse ? 4 : 1, run * 7919 + 1).relativeBias / runs;
+		}
+		return bias;
+	};
+
+	double noReuseBias = averageBias(noReuse, 64);
+	double unbiasedBias = averageBias(unbiasedReuse, 32);
+	double biasedBias = averageBias(biasedReuse, 32);
+	printf("    mean luminance error: no reuse %+.4f, unbiased reuse %+.4f, biased reuse %+.4f\n", noReuseBias, unbiasedBias, biasedBias);
+	Check(passed, "no reuse is unbiased", fabs(noReuseBias) < 0.01);
+	Check(passed, "unbiased combine is unbiased", fabs(unbiasedBias) < 0.015);
+
+	ReSTIRSettings oneCandidate = { 1, false, 20.0f, 0, 0.0f, false };
+	ReSTIRSettings manyCandidates = { 32, false, 20.0f, 0, 0.0f, false };
+	double oneCandidateError = restir.Measure(oneCandidate, 1, 5).relativeMSE;
+	double manyCandidatesError = restir.Measure(manyCandidates, 1, 5).relativeMSE;
+	double reuseError = restir.Measure(unbiasedReuse, 8, 5).relativeMSE;
+	Check(passed, "more candidates lower the error", manyCandidatesError < oneCandidateError * 0.5);
+	Check(passed, "reuse lowers the error", reuseError < restir.Measure(noReuse, 1, 5).relativeMSE);
+
+	PrintValidationResult(passed);
+}
+
+void BenchmarkReSTIRReference(const std::filesystem::path& gBufferFile, UINT lightCount, UINT frameCount)
+{
+	ReSTIRGBuffer gBuffer;
+	if (gBufferFile.empty() || !gBuffer.Load(gBufferFile))
+		gBuffer = MakeReSTIRTestGBuffer(320, 180);
+
+	std::vector<Light> lights = MakeReSTIRTestLights(lightCount, 1);
+	ReSTIRReference restir(gBuffer, lights.data(), (UINT)lights.size());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	restir.ComputeReference();
+	auto end = std::chrono::high_resolution_clock::now();
+	printf("ReSTIR DI, %ux%u, %u lights, %u frames, brute force %.1f ms\n", gBuffer.width, gBuffer.height, lightCount, frameCount,
+		std::chrono::duration<double, std::milli>(end - start).count());
+
+	const ReSTIRSettings configurations[] =
+	{
+		{ 1, false, 20.0f, 0, 0.0f, false },
+		{ 4, false, 20.0f, 0, 0.0f, false },
+		{ 16, false, 20.0f, 0, 0.0f, false },
+		{ 32, false, 20.0f, 0, 0.0f, false },
+		{ 4, true, 20.0f, 0, 0.0f, false },
+		{ 16, true, 20.0f, 0, 0.0f, false },
+		{ 4, false, 20.0f, 5, 10.0f, false },
+		{ 4, false, 20.0f, 5, 10.0f, true },
+		{ 4, true, 20.0f, 3, 10.0f, true },
+		{ 4, true, 20.0f, 5, 10.0f, false },
+		{ 4, true, 20.0f, 5, 10.0f, true },
+		{ 4, true, 20.0f, 5, 30.0f, false },
+		{ 4, true, 20.0f, 5, 30.0f, true },
+		{ 8, true, 20.0f, 5, 30.0f, true },
+		{ 16, true, 20.0f, 5, 10.0f, true },
+		{ 1, true, 20.0f, 3, 30.0f, true },
+	};
+
+	//averaged over a few seeds, the spatial reuse passes correlate neighbouring pixels
+	const UINT seedCount = 3;
+	std::vector<ReSTIRRunStats> results;
+	for (const ReSTIRSettings& settings : configurations)
+	{
+		ReSTIRRunStats average = {};
+		for (UINT seed = 0; seed < seedCount; seed++)
+		{
+			ReSTIRRunStats stats = restir.Measure(settings, frameCount, seed * 104729 + 17);
+			average.relativeMSE += stats.relativeMSE / seedCount;
+			average.relativeBias += stats.relativeBias / seedCount;
+			average.frameTime += stats.frameTime / seedCount;
+			average.evaluationsPerPixel += stats.evaluationsPerPixel / seedCount;
+		}
+		results.push_back(average);
+	}
+
+	//a configuration is worth it when nothing cheaper has a lower error
+	printf("  cand temporal neighbours radius combine    evals/px  ms/frame  rel mse   bias\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		bool dominated = false;
+		for (size_t j = 0; j < results.size(); j++)
+		{
+			dominated = dominated || (j != i && results[j].evaluationsPerPixel <= results[i].evaluationsPerPixel
+				&& results[j].relativeMSE < results[i].relativeMSE);
+		}
+
+		const ReSTIRSettings& settings = configurations[i];
+		printf("  %4u %8s %10u %6.0f %-9s %9.1f %9.2f %8.4f %+7.4f %s\n", settings.candidateCount, settings.temporalReuse ? "yes" : "no",
+			settings.neighborCount, settings.neighborRadius, settings.neighborCount > 0 || settings.temporalReuse ? (settings.unbiasedReuse ? "unbiased" : "biased") : "-",
+			results[i].evaluationsPerPixel, results[i].frameTime, results[i].relativeMSE, results[i].relativeBias, dominated ? "" : "*");
+	}
+	printf("  * nothing cheaper has a lower error\n");
+}
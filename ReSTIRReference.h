@@ -0,0 +1,106 @@
+#pragma once
+
+#include"Lights.h"
+#include<filesystem>
+#include<functional>
+#include<vector>
+
+//the g-buffer the restir passes read, as float4 planes read back from the gpu. normalDepth.w is the view depth the
+//spatial reuse compares, a zero normal is sky
+struct ReSTIRGBuffer
+{
+	UINT width;
+	UINT height;
+	std::vector<Vector4> positions;
+	std::vector<Vector4> normalDepths;
+	std::vector<Vector4> albedos;
+
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+};
+
+struct ReSTIRSettings
+{
+	//initial candidates per pixel, picked uniformly like RayGen.hlsl does
+	UINT candidateCount;
+	bool temporalReuse;
+	//the previous frame's M is capped at this many times candidateCount
+	float historyLimit;
+	UINT neighborCount;
+	float neighborRadius;
+	//divide by the M of the reservoirs whose pixels could have produced the sample instead of the M of all of them,
+	//an extra target evaluation per reservoir. Off is the biased combine ReStirSpatialReuseAndFinalShade.hlsl uses
+	bool unbiasedReuse;
+};
+
+//Reservoir from the shaders with the light as an index instead of a float, UINT_MAX for an empty one
+struct ReferenceReservoir
+{
+	UINT light;
+	float wsum;
+	float M;
+	float W;
+};
+
+struct ReSTIRRunStats
+{
+	//of the last frame's luminance against the brute force image, relative to the mean luminance squared
+	double relativeMSE;
+	//the last frame's mean luminance against the brute force mean, the sign shows darkening or brightening
+	double relativeBias;
+	double frameTime;
+	//target function evaluations per pixel per frame, the cost of the candidates and the reuse
+	double evaluationsPerPixel;
+};
+
+//restir di on the cpu over a g-buffer dump, for measuring what candidate counts and reuse settings buy before they
+//go into the shaders. Shading is diffuse and unshadowed, the target function is the luminance of a light's
+//contribution so the brute force sum over every light is the exact answer
+class ReSTIRReference
+{
+	const ReSTIRGBuffer& gBuffer;
+	std::vector<Light> lights;
+	UINT workerCount;
+
+	std::vector<Vector3> reference;
+	std::vector<ReferenceReservoir> reservoirs;
+	std::vector<ReferenceReservoir> previousReservoirs;
+	std::vector<ReferenceReservoir> spatialReservoirs;
+	std::vector<Vector3> image;
+	std::vector<UINT64> workerEvaluations;
+
+	//runs the rows of the image on the workers
+	void ForEachRow(const std::function<void(UINT worker, UINT row)>& rowFunction);
+	//resamples the reservoirs into one for pixel and gives it its W, counting target evaluations into evaluations
+	ReferenceReservoir CombineReservoirs(const struct ReuseSource* sources, UINT sourceCount, UINT pixel, bool unbiased, UINT& seed, UINT64& evaluations);
+
+public:
+	ReSTIRReference(const ReSTIRGBuffer& gBuffer, const Light* lights, UINT lightCount, UINT workerCount = 0);
+	~ReSTIRReference();
+
+	//what the light gives the pixel, unshadowed
+	Vector3 Shade(UINT pixel, UINT light);
+	float TargetFunction(UINT pixel, UINT light);
+
+	//the sum over every light for every pixel
+	void ComputeReference();
+	//forgets the temporal history
+	void Reset();
+	//candidates, temporal reuse, spatial reuse and shading, the image ends up in GetImage
+	void RenderFrame(const ReSTIRSettings& settings, UINT frame, UINT seed);
+	//renders frameCount frames from a reset and measures the last one
+	ReSTIRRunStats Measure(const ReSTIRSettings& settings, UINT frameCount, UINT seed);
+
+	const std::vector<Vector3>& GetImage();
+	const std::vector<Vector3>& GetReference();
+};
+
+//a floor, a wall and a sphere seen from a camera, for when there is no dump
+ReSTIRGBuffer MakeReSTIRTestGBuffer(UINT width, UINT height);
+
+//exact results with one light, unbiased averages without reuse and with the unbiased combine
+void ValidateReSTIRReference();
+
+//error and cost over candidate counts, neighbour counts and radii, with and without temporal reuse. Uses the g-buffer
+//dump when there is one and the test scene when not
+void BenchmarkReSTIRReference(const std::filesystem::path& gBufferFile = "", UINT lightCount = 2000, UINT frameCount = 8);
@@ -10,9 +10,9 @@ RWTexture2D<float4> gBufferDif : register(u2);
 RWTexture2D<float4> gBufferRoughnessMetal : register(u3);
 RWTexture2D<float4> outColor : register(u4);
 
-RWStructuredBuffer<GIReservoir> temporalRes : register(u5);
+RWStructuredBuffer<PackedGIReservoir> temporalRes : register(u5);
 RWStructuredBuffer<uint> newSequences : register(u6);
-RWStructuredBuffer<GIReservoir> spatialRes : register(u7);
+RWStructuredBuffer<PackedGIReservoir> spatialRes : register(u7);
 
 cbuffer RestirData : register(b0)
 {
@@ -80,7 +80,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
     
     uint2 pixelPos = DTid.xy;
     
-    GIReservoir r = spatialRes[pixelPos.y * uint(WIDTH) + pixelPos.x];
+    GIReservoir r = UnpackGIReservoir(spatialRes[pixelPos.y * uint(WIDTH) + pixelPos.x]);
   
     if (outColor[pixelPos].x != outColor[pixelPos].x)
     {
@@ -142,7 +142,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
             continue;
         }
         
-        GIReservoir neighborRes = temporalRes[u_neighbor.y * uint(WIDTH) + u_neighbor.x];
+        GIReservoir neighborRes = UnpackGIReservoir(temporalRes[u_neighbor.y * uint(WIDTH) + u_neighbor.x]);
         
         float3 newL = neighborRes.sample.samplePos - neighborRes.sample.visiblePos;
         newL = normalize(newL);
@@ -221,7 +221,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
     else
         r.W = (1.0 / max(p_hat, 0.00001)) * (r.wsum / max(r.M, 0.0001));
     
-    spatialRes[pixelPos.y * uint(WIDTH) + pixelPos.x] = r;
+    spatialRes[pixelPos.y * uint(WIDTH) + pixelPos.x] = PackGIReservoir(r);
     
     outColor[pixelPos] = float4(brdfVal * r.W, 1);
 
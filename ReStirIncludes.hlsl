@@ -7,23 +7,8 @@ struct Reservoir
     float W; //Probablistic weight
 };
 
-struct Sample
-{
-    float3 visiblePos;
-    float3 visibleNormal;
-    float3 samplePos;
-    float3 sampleNormal;
-    float3 color;
-    float3 RandomNums;
-};
-
-struct GIReservoir
-{
-    Sample sample;
-    float wsum; // the sum of weights
-    float M; //the number of samples seen so far
-    float W; //Probablistic weight
-};
+//Sample, GIReservoir and the packed reservoir the buffers hold
+#include "ReservoirPacking.h"
 
 void UpdateResrvoir(inout Reservoir r, float x, float w, float rndnum)
 {
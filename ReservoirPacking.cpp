@@ -0,0 +1,135 @@
+#include "ReservoirPacking.h"
+#include"Validation.h"
+#include<random>
+
+static_assert(sizeof(PackedGIReservoir) == 44, "The reservoir buffers are sized for the packed reservoir");
+
+//five float3s, the float3 of random numbers the seed replaced, wsum, M and W
+static const UINT UnpackedGIReservoirSize = 84;
+
+static float Distance(const Vector3& a, const Vector3& b)
+{
+	return (a - b).Length();
+}
+
+static Vector3 RandomDirection(std::mt19937& generator)
+{
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	Vector3 direction;
+	do
+	{
+		direction = Vector3(normal(generator), normal(generator), normal(generator));
+	} while (direction.LengthSquared() < 1e-6f);
+	direction.Normalize();
+	return direction;
+}
+
+void ValidateReservoirPacking()
+{
+	printf("Reservoir packing\n");
+	bool passed = true;
+
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const UINT count = 100000;
+
+	//16 bit octahedral steps are 2/65535, a bit under 1e-4 once they're spread over the sphere
+	float normalError = 0.0f;
+	for (UINT i = 0; i < count; i++)
+	{
+		Vector3 normal = RandomDirection(generator);
+		normalError = std::max(normalError, Distance(DecodeOctahedral(EncodeOctahedral(normal)), normal));
+	}
+	const Vector3 axes[] = { Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1) };
+	for (const Vector3& axis : axes)
+	{
+		normalError = std::max(normalError, Distance(DecodeOctahedral(EncodeOctahedral(axis)), axis));
+	}
+	printf("    largest normal error %.2e\n", normalError);
+	Check(passed, "octahedral normals within 1e-4", normalError < 1e-4f);
+	Check(passed, "zero normals stay zero", DecodeOctahedral(EncodeOctahedral(Vector3(0, 0, 0))).LengthSquared() == 0.0f);
+
+	//the corner of the folded -z half every component rounds towards, where 0 used to come out
+	bool nearNegativeZ = true;
+	const float offsets[] = { -1e-5f, -1e-7f, 0.0f, 1e-7f, 1e-5f };
+	for (float x : offsets)
+	{
+		for (float y : offsets)
+		{
+			Vector3 normal(x, y, -1.0f);
+			normal.Normalize();
+			UINT encoded = EncodeOctahedral(normal);
+			nearNegativeZ = nearNegativeZ && encoded != 0 && Distance(DecodeOctahedral(encoded), normal) < 1e-4f;
+		}
+	}
+	Check(passed, "normals near -z never pack to zero", nearNegativeZ);
+
+	//each channel within half a step of the shared exponent, at most the largest channel / 512 above the smallest step
+	bool colorInBounds = true;
+	float colorError = 0.0f;
+	for (UINT i = 0; i < count; i++)
+	{
+		float magnitude = exp2f(unit(generator) * 30.0f - 15.0f);
+		Vector3 color(unit(generator) * magnitude, unit(generator) * magnitude, unit(generator) * magnitude);
+		Vector3 decoded = DecodeRGB9E5(EncodeRGB9E5(color));
+		float largest = std::max(std::max(color.x, color.y), color.z);
+		float error = std::max(std::max(fabsf(decoded.x - color.x), fabsf(decoded.y - color.y)), fabsf(decoded.z - color.z));
+		colorInBounds = colorInBounds && error <= std::max(largest / 512.0f, exp2f(-25.0f));
+		colorError = std::max(colorError, largest > exp2f(-16.0f) ? error / largest : 0.0f);
+	}
+	printf("    largest radiance error %.2e of the brightest channel\n", colorError);
+	Check(passed, "rgb9e5 radiance within 1/512", colorInBounds);
+
+	Vector3 black = DecodeRGB9E5(EncodeRGB9E5(Vector3(0, 0, 0)));
+	Vector3 clamped = DecodeRGB9E5(EncodeRGB9E5(Vector3(-1.0f, 1e9f, 1000.0f)));
+	Check(passed, "rgb9e5 keeps black and clamps", black.LengthSquared() == 0.0f && clamped.x == 0.0f && clamped.y == MaxRGB9E5 && clamped.z == 1024.0f);
+
+	//the visible point comes back off by the direction's error times the distance
+	bool reservoirsInBounds = true;
+	float positionError = 0.0f;
+	for (UINT i = 0; i < count; i++)
+	{
+		GIReservoir reservoir;
+		reservoir.sample.samplePos = Vector3(unit(generator) - 0.5f, unit(generator) - 0.5f, unit(generator) - 0.5f) * 400.0f;
+		reservoir.sample.visiblePos = reservoir.sample.samplePos + RandomDirection(generator) * (unit(generator) * 200.0f);
+		reservoir.sample.visibleNormal = RandomDirection(generator);
+		reservoir.sample.sampleNormal = RandomDirection(generator);
+		reservoir.sample.color = Vector3(unit(generator), unit(generator), unit(generator)) * 20.0f;
+		reservoir.sample.seed = generator() & 0xFFFF;
+		reservoir.wsum = unit(generator) * 1000.0f;
+		reservoir.W = unit(generator) * 10.0f;
+		//the shaders cap M at 30 after temporal reuse and 500 after spatial, halves are exact up to MaxPackedM
+		reservoir.M = (float)(generator() % 501);
+
+		GIReservoir unpacked = UnpackGIReservoir(PackGIReservoir(reservoir));
+		float distance = Distance(reservoir.sample.visiblePos, reservoir.sample.samplePos);
+		float error = Distance(unpacked.sample.visiblePos, reservoir.sample.visiblePos);
+		positionError = std::max(positionError, distance > 0.0f ? error / distance : 0.0f);
+
+		reservoirsInBounds = reservoirsInBounds
+			&& error <= distance * 1e-4f + 1e-6f * (reservoir.sample.samplePos.Length() + distance)
+			&& Distance(unpacked.sample.samplePos, reservoir.sample.samplePos) == 0.0f
+			&& unpacked.sample.seed == reservoir.sample.seed
+			&& unpacked.wsum == reservoir.wsum && unpacked.W == reservoir.W && unpacked.M == reservoir.M;
+	}
+	printf("    largest visible point error %.2e of the ray length\n", positionError);
+	Check(passed, "reservoirs round trip within bounds", reservoirsInBounds);
+
+	GIReservoir large = {};
+	large.M = 5000.0f;
+	Check(passed, "M clamped to the largest exact half", UnpackGIReservoir(PackGIReservoir(large)).M == MaxPackedM);
+
+	//what TemporalReprojection writes to forget a pixel
+	GIReservoir empty = {};
+	GIReservoir unpackedEmpty = UnpackGIReservoir(PackGIReservoir(empty));
+	Check(passed, "empty reservoirs stay empty", unpackedEmpty.M == 0.0f && unpackedEmpty.wsum == 0.0f && unpackedEmpty.W == 0.0f
+		&& unpackedEmpty.sample.visiblePos.LengthSquared() == 0.0f && unpackedEmpty.sample.sampleNormal.LengthSquared() == 0.0f
+		&& unpackedEmpty.sample.color.LengthSquared() == 0.0f);
+
+	//the temporal and spatial reservoir buffers at 4k
+	double pixels = 3840.0 * 2160.0;
+	printf("    %u bytes a reservoir against %u, %.0f MB less for the two 4k buffers\n", (UINT)sizeof(PackedGIReservoir), UnpackedGIReservoirSize,
+		2.0 * pixels * (UnpackedGIReservoirSize - sizeof(PackedGIReservoir)) / (1024.0 * 1024.0));
+
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,196 @@
+#ifndef __RESERVOIR_PACKING_H__
+#define __RESERVOIR_PACKING_H__
+
+//the restir gi reservoir and its packed form, shared by the c++ and the hlsl like LightLayout.h. The functions only use
+//scalars, float3 constructors and the Packing helpers below so they compile as both
+
+#ifdef __cplusplus
+#include"DX12Helper.h"
+#include<DirectXPackedVector.h>
+
+#define RESERVOIR_UINT UINT
+#define RESERVOIR_FLOAT3 Vector3
+#define RESERVOIR_FUNCTION inline
+
+inline float PackingAbs(float x) { return fabsf(x); }
+inline float PackingSaturate(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+inline float PackingMax(float a, float b) { return a > b ? a : b; }
+inline float PackingMin(float a, float b) { return a < b ? a : b; }
+inline float PackingFloor(float x) { return floorf(x); }
+inline float PackingLog2(float x) { return log2f(x); }
+inline float PackingExp2(float x) { return exp2f(x); }
+inline float PackingSqrt(float x) { return sqrtf(x); }
+inline UINT PackingF32ToF16(float x) { return DirectX::PackedVector::XMConvertFloatToHalf(x); }
+inline float PackingF16ToF32(UINT x) { return DirectX::PackedVector::XMConvertHalfToFloat((DirectX::PackedVector::HALF)x); }
+#else
+#define RESERVOIR_UINT uint
+#define RESERVOIR_FLOAT3 float3
+#define RESERVOIR_FUNCTION
+
+#define PackingAbs abs
+#define PackingSaturate saturate
+#define PackingMax max
+#define PackingMin min
+#define PackingFloor floor
+#define PackingLog2 log2
+#define PackingExp2 exp2
+#define PackingSqrt sqrt
+#define PackingF32ToF16 f32tof16
+#define PackingF16ToF32 f16tof32
+#endif
+
+struct Sample
+{
+	RESERVOIR_FLOAT3 visiblePos;
+	RESERVOIR_FLOAT3 visibleNormal;
+	RESERVOIR_FLOAT3 samplePos;
+	RESERVOIR_FLOAT3 sampleNormal;
+	RESERVOIR_FLOAT3 color;
+	//16 bits the sample's random numbers were drawn from, see SampleSeedState
+	RESERVOIR_UINT seed;
+};
+
+struct GIReservoir
+{
+	Sample sample;
+	float wsum; // the sum of weights
+	float M; //the number of samples seen so far
+	float W; //Probablistic weight
+};
+
+//what the reservoir buffers hold, 44 bytes instead of 84. The visible point is the sample point moved back along the
+//ray by visibleDistance, normals and the ray are octahedral, the radiance is rgb9e5 and M is a half with the seed above it
+struct PackedGIReservoir
+{
+	RESERVOIR_FLOAT3 samplePos;
+	RESERVOIR_UINT sampleNormal;
+	RESERVOIR_UINT visibleNormal;
+	RESERVOIR_UINT visibleDirection;
+	float visibleDistance;
+	RESERVOIR_UINT color;
+	float wsum;
+	float W;
+	RESERVOIR_UINT mAndSeed;
+};
+
+//the largest radiance rgb9e5 holds, 511/512 * 2^16
+static const float MaxRGB9E5 = 65408.0f;
+//M is a half, whole numbers are exact up to 2^11. Packing clamps it there, above the 500 the spatial reuse caps it at
+static const float MaxPackedM = 2048.0f;
+
+//16 bits a component, each in [1, 65535] so a unit vector never packs to 0. 0 stands for a zero vector, sky and empty
+//reservoirs
+RESERVOIR_FUNCTION RESERVOIR_UINT EncodeOctahedral(RESERVOIR_FLOAT3 n)
+{
+	float l1 = PackingAbs(n.x) + PackingAbs(n.y) + PackingAbs(n.z);
+	if (l1 == 0.0f)
+		return 0;
+
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if (n.z < 0.0f)
+	{
+		float foldedX = (1.0f - PackingAbs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - PackingAbs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+	}
+
+	RESERVOIR_UINT encodedX = (RESERVOIR_UINT)(PackingSaturate(x * 0.5f + 0.5f) * 65534.0f + 1.5f);
+	RESERVOIR_UINT encodedY = (RESERVOIR_UINT)(PackingSaturate(y * 0.5f + 0.5f) * 65534.0f + 1.5f);
+	return encodedX | (encodedY << 16);
+}
+
+RESERVOIR_FUNCTION RESERVOIR_FLOAT3 DecodeOctahedral(RESERVOIR_UINT encoded)
+{
+	if (encoded == 0)
+		return RESERVOIR_FLOAT3(0.0f, 0.0f, 0.0f);
+
+	float x = ((encoded & 0xFFFF) - 1.0f) / 65534.0f * 2.0f - 1.0f;
+	float y = ((encoded >> 16) - 1.0f) / 65534.0f * 2.0f - 1.0f;
+	float z = 1.0f - PackingAbs(x) - PackingAbs(y);
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - PackingAbs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - PackingAbs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = unfoldedX;
+	}
+
+	float scale = 1.0f / PackingSqrt(x * x + y * y + z * z);
+	return RESERVOIR_FLOAT3(x * scale, y * scale, z * scale);
+}
+
+//shared exponent, 9 bits of mantissa a channel. Channels are off by at most the largest one / 512
+RESERVOIR_FUNCTION RESERVOIR_UINT EncodeRGB9E5(RESERVOIR_FLOAT3 color)
+{
+	float r = PackingMin(PackingMax(color.x, 0.0f), MaxRGB9E5);
+	float g = PackingMin(PackingMax(color.y, 0.0f), MaxRGB9E5);
+	float b = PackingMin(PackingMax(color.z, 0.0f), MaxRGB9E5);
+	float maxChannel = PackingMax(PackingMax(r, g), b);
+
+	float exponent = PackingMax(-16.0f, PackingFloor(PackingLog2(maxChannel))) + 16.0f;
+	float scale = PackingExp2(exponent - 24.0f);
+	if (PackingFloor(maxChannel / scale + 0.5f) >= 512.0f)
+	{
+		scale *= 2.0f;
+		exponent += 1.0f;
+	}
+
+	RESERVOIR_UINT encodedR = (RESERVOIR_UINT)PackingFloor(r / scale + 0.5f);
+	RESERVOIR_UINT encodedG = (RESERVOIR_UINT)PackingFloor(g / scale + 0.5f);
+	RESERVOIR_UINT encodedB = (RESERVOIR_UINT)PackingFloor(b / scale + 0.5f);
+	return encodedR | (encodedG << 9) | (encodedB << 18) | ((RESERVOIR_UINT)exponent << 27);
+}
+
+RESERVOIR_FUNCTION RESERVOIR_FLOAT3 DecodeRGB9E5(RESERVOIR_UINT encoded)
+{
+	float scale = PackingExp2((float)(encoded >> 27) - 24.0f);
+	return RESERVOIR_FLOAT3((encoded & 0x1FF) * scale, ((encoded >> 9) & 0x1FF) * scale, ((encoded >> 18) & 0x1FF) * scale);
+}
+
+//a full rng state from the 16 bit seed a sample keeps, for nextRand
+RESERVOIR_FUNCTION RESERVOIR_UINT SampleSeedState(RESERVOIR_UINT seed)
+{
+	RESERVOIR_UINT state = seed * 0x9e3779b9u + 0x7f4a7c15u;
+	state = (state ^ (state >> 16)) * 0x85ebca6bu;
+	return state ^ (state >> 13);
+}
+
+RESERVOIR_FUNCTION PackedGIReservoir PackGIReservoir(GIReservoir reservoir)
+{
+	PackedGIReservoir packed;
+	packed.samplePos = reservoir.sample.samplePos;
+	packed.sampleNormal = EncodeOctahedral(reservoir.sample.sampleNormal);
+	packed.visibleNormal = EncodeOctahedral(reservoir.sample.visibleNormal);
+
+	RESERVOIR_FLOAT3 toVisible = reservoir.sample.visiblePos - reservoir.sample.samplePos;
+	packed.visibleDistance = PackingSqrt(toVisible.x * toVisible.x + toVisible.y * toVisible.y + toVisible.z * toVisible.z);
+	packed.visibleDirection = EncodeOctahedral(toVisible);
+
+	packed.color = EncodeRGB9E5(reservoir.sample.color);
+	packed.wsum = reservoir.wsum;
+	packed.W = reservoir.W;
+	packed.mAndSeed = PackingF32ToF16(PackingMin(reservoir.M, MaxPackedM)) | ((reservoir.sample.seed & 0xFFFF) << 16);
+	return packed;
+}
+
+RESERVOIR_FUNCTION GIReservoir UnpackGIReservoir(PackedGIReservoir packed)
+{
+	GIReservoir reservoir;
+	reservoir.sample.samplePos = packed.samplePos;
+	reservoir.sample.sampleNormal = DecodeOctahedral(packed.sampleNormal);
+	reservoir.sample.visibleNormal = DecodeOctahedral(packed.visibleNormal);
+	reservoir.sample.visiblePos = packed.samplePos + DecodeOctahedral(packed.visibleDirection) * packed.visibleDistance;
+	reservoir.sample.color = DecodeRGB9E5(packed.color);
+	reservoir.sample.seed = packed.mAndSeed >> 16;
+	reservoir.wsum = packed.wsum;
+	reservoir.W = packed.W;
+	reservoir.M = PackingF16ToF32(packed.mAndSeed & 0xFFFF);
+	return reservoir;
+}
+
+#ifdef __cplusplus
+//round trips of random and edge case reservoirs against the error bounds of each encoding, and the packed size
+void ValidateReservoirPacking();
+#endif
+
+#endif
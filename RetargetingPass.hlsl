@@ -8,23 +8,12 @@ SamplerState pointSampler : register(s0);
 cbuffer ExternData : register(b0)
 {
     uint frameNum;
+    //the r2 scroll for this frame from the permutation table, movemask2 is both the noise and the retarget texture
+    uint2 noiseOffset;
+    uint noiseWidth;
+    uint noiseHeight;
 }
 
-//http://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
-float2 GenerateR2Sequence(uint n)
-{
-    float g = 1.32471795724474602596;
-
-    float a1 = 1.0 / g;
-
-    float a2 = 1.0 / (g * g);
-
-    float x = (a1 * n) % 1;
-
-    float y = (a2 * n) % 1;
-
-    return float2(x, y);
-}
 // Generates a seed for a random number generator from 2 inputs plus a backoff
 uint InitSeed2(uint3 thread, uint width)
 {
@@ -59,10 +48,8 @@ void main(uint3 groupID : SV_GroupID, // 3D index of the thread group in the dis
       
     retargetTex.GetDimensions(texWidth, texHeight);
     
-    float2 offset = GenerateR2Sequence(frameNum);
-    
-    uint samplePosX = (dispatchThreadID.x + offset.x * (texWidth - 1)) % texWidth;
-    uint samplePosY = (dispatchThreadID.y + offset.y * (texHeight - 1)) % texHeight;
+    uint samplePosX = (dispatchThreadID.x + noiseOffset.x) % texWidth;
+    uint samplePosY = (dispatchThreadID.y + noiseOffset.y) % texHeight;
     
     float2 pixelOffsets = retargetTex[uint2(samplePosX, samplePosY)].gb;
     
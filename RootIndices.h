@@ -12,6 +12,10 @@ enum EntityRootIndices
 	EntityEnvironmentSRV,
 	EntityLTCSRV,
 	AccelerationStructureSRV,
+	EntityIrradianceSHCBV,
+	EntityClusterRangesSRV,
+	EntityClusterLightIndicesSRV,
+	EntityClusterDataConstants,
 	EntityNumRootIndices,
 };
 
@@ -58,7 +62,7 @@ enum RaytracingHeapRangesIndices
 
 enum LightCullingRootIndices
 {
-	LightListSRV,
+	LightCullDataSRV,
 	DepthMapSRV,
 	VisibleLightIndicesUAV,
 	LightCullingExternalDataCBV,
@@ -129,7 +133,7 @@ enum BMFRPostProcessRootIndices
 
 enum BlueNoiseDithering
 {
-	BlueNoiseTex,
+	BlueNoiseOrders,
 	RetargetTex,
 	PrevFrameNoisy,
 	NewSequences,
@@ -170,4 +174,12 @@ enum RestrirSpatialReuseIndices
 	RestirSpatialReuse_AccelStruct,
 	RestirSpatialReuse_History,
 	RestirSpatialReuse_NumIndices
-};
\ No newline at end of file
+};
+enum ParticleSystemRootIndices
+{
+	ParticleSystemParticlesSRV,
+	ParticleSystemEmitterDataSRV,
+	ParticleSystemExternDataCBV,
+	ParticleSystemTexturesSRV,
+	ParticleSystemNumRootIndices
+};
@@ -0,0 +1,515 @@
+#include "RootSignatureCache.h"
+#include"Validation.h"
+#include<algorithm>
+#include<fstream>
+
+//bump when the canonical form or the file layout changes
+static const UINT StoreVersion = 1;
+static const UINT StoreMagic = 0x53544F52;
+
+static UINT FloatBits(float value)
+{
+	//-0 and 0 sample the same
+	if (value == 0.0f)
+		value = 0.0f;
+	UINT bits;
+	memcpy(&bits, &value, sizeof(UINT));
+	return bits;
+}
+
+static void AppendRanges(CanonicalRootSignature& canonical, const D3D12_DESCRIPTOR_RANGE1* ranges, UINT rangeCount)
+{
+	canonical.push_back(rangeCount);
+	UINT offset = 0;
+	for (UINT i = 0; i < rangeCount; i++)
+	{
+		const D3D12_DESCRIPTOR_RANGE1& range = ranges[i];
+		if (range.OffsetInDescriptorsFromTableStart != D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+			offset = range.OffsetInDescriptorsFromTableStart;
+
+		canonical.insert(canonical.end(), { (UINT)range.RangeType, range.NumDescriptors, range.BaseShaderRegister, range.RegisterSpace,
+			(UINT)range.Flags, offset });
+
+		//an unbounded range can only be last
+		if (range.NumDescriptors != UINT_MAX)
+			offset += range.NumDescriptors;
+	}
+}
+
+static void AppendSamplers(CanonicalRootSignature& canonical, const D3D12_STATIC_SAMPLER_DESC* samplers, UINT samplerCount)
+{
+	std::vector<D3D12_STATIC_SAMPLER_DESC> sorted(samplers, samplers + samplerCount);
+	std::sort(sorted.begin(), sorted.end(), [](const D3D12_STATIC_SAMPLER_DESC& a, const D3D12_STATIC_SAMPLER_DESC& b)
+	{
+		return a.RegisterSpace != b.RegisterSpace ? a.RegisterSpace < b.RegisterSpace : a.ShaderRegister < b.ShaderRegister;
+	});
+
+	canonical.push_back(samplerCount);
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const D3D12_STATIC_SAMPLER_DESC& sampler = sorted[i];
+		canonical.insert(canonical.end(), { (UINT)sampler.Filter, (UINT)sampler.AddressU, (UINT)sampler.AddressV, (UINT)sampler.AddressW,
+			FloatBits(sampler.MipLODBias), sampler.MaxAnisotropy, (UINT)sampler.ComparisonFunc, (UINT)sampler.BorderColor,
+			FloatBits(sampler.MinLOD), FloatBits(sampler.MaxLOD), sampler.ShaderRegister, sampler.RegisterSpace, (UINT)sampler.ShaderVisibility });
+	}
+}
+
+CanonicalRootSignature CanonicalizeRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc)
+{
+	CanonicalRootSignature canonical;
+
+	if (desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0)
+	{
+		//1.0 treats every descriptor and the data behind it as volatile
+		const D3D12_ROOT_SIGNATURE_DESC& rootDesc = desc.Desc_1_0;
+		canonical.push_back((UINT)rootDesc.Flags);
+		canonical.push_back(rootDesc.NumParameters);
+		for (UINT i = 0; i < rootDesc.NumParameters; i++)
+		{
+			const D3D12_ROOT_PARAMETER& parameter = rootDesc.pParameters[i];
+			canonical.push_back((UINT)parameter.ParameterType);
+			canonical.push_back((UINT)parameter.ShaderVisibility);
+
+			switch (parameter.ParameterType)
+			{
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			{
+				const D3D12_ROOT_DESCRIPTOR_TABLE& table = parameter.DescriptorTable;
+				std::vector<D3D12_DESCRIPTOR_RANGE1> ranges(table.NumDescriptorRanges);
+				for (UINT j = 0; j < table.NumDescriptorRanges; j++)
+				{
+					const D3D12_DESCRIPTOR_RANGE& range = table.pDescriptorRanges[j];
+					ranges[j] = { range.RangeType, range.NumDescriptors, range.BaseShaderRegister, range.RegisterSpace,
+						range.RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER ? D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE :
+						D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE,
+						range.OffsetInDescriptorsFromTableStart };
+				}
+				AppendRanges(canonical, ranges.data(), (UINT)ranges.size());
+				break;
+			}
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+				canonical.insert(canonical.end(), { parameter.Constants.ShaderRegister, parameter.Constants.RegisterSpace, parameter.Constants.Num32BitValues });
+				break;
+			default:
+				canonical.insert(canonical.end(), { parameter.Descriptor.ShaderRegister, parameter.Descriptor.RegisterSpace,
+					(UINT)D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE });
+				break;
+			}
+		}
+		AppendSamplers(canonical, rootDesc.pStaticSamplers, rootDesc.NumStaticSamplers);
+		return canonical;
+	}
+
+	const D3D12_ROOT_SIGNATURE_DESC1& rootDesc = desc.Desc_1_1;
+	canonical.push_back((UINT)rootDesc.Flags);
+	canonical.push_back(rootDesc.NumParameters);
+	for (UINT i = 0; i < rootDesc.NumParameters; i++)
+	{
+		const D3D12_ROOT_PARAMETER1& parameter = rootDesc.pParameters[i];
+		canonical.push_back((UINT)parameter.ParameterType);
+		canonical.push_back((UINT)parameter.ShaderVisibility);
+
+		switch (parameter.ParameterType)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			AppendRanges(canonical, parameter.DescriptorTable.pDescriptorRanges, parameter.DescriptorTable.NumDescriptorRanges);
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			canonical.insert(canonical.end(), { parameter.Constants.ShaderRegister, parameter.Constants.RegisterSpace, parameter.Constants.Num32BitValues });
+			break;
+		default:
+			canonical.insert(canonical.end(), { parameter.Descriptor.ShaderRegister, parameter.Descriptor.RegisterSpace, (UINT)parameter.Descriptor.Flags });
+			break;
+		}
+	}
+	AppendSamplers(canonical, rootDesc.pStaticSamplers, rootDesc.NumStaticSamplers);
+	return canonical;
+}
+
+UINT64 HashRootSignature(const CanonicalRootSignature& canonical)
+{
+	//fnv-1a over the words
+	UINT64 hash = 0xCBF29CE484222325ull;
+	for (size_t i = 0; i < canonical.size(); i++)
+	{
+		hash ^= canonical[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+RootSignatureBlobStore::RootSignatureBlobStore()
+	: dirty(false)
+{
+}
+
+RootSignatureBlobStore::~RootSignatureBlobStore()
+{
+}
+
+bool RootSignatureBlobStore::Load(const std::filesystem::path& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::error_code error;
+	UINT64 remaining = std::filesystem::file_size(fileName, error);
+	if (error)
+		return false;
+
+	UINT header[3] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != StoreMagic || header[1] != StoreVersion)
+		return false;
+	remaining -= sizeof(header);
+
+	//a truncated or corrupt store is a miss, nothing is sized from it before it is checked against what is left
+	std::unordered_map<UINT64, Entry> loaded;
+	for (UINT i = 0; i < header[2]; i++)
+	{
+		UINT64 hash = 0;
+		UINT sizes[2] = {};
+		if (remaining < sizeof(UINT64) + sizeof(sizes))
+			return false;
+		file.read(reinterpret_cast<char*>(&hash), sizeof(UINT64));
+		file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+		remaining -= sizeof(UINT64) + sizeof(sizes);
+
+		UINT64 entrySize = (UINT64)sizes[0] * sizeof(UINT) + sizes[1];
+		if (!file.good() || entrySize > remaining)
+			return false;
+		remaining -= entrySize;
+
+		Entry entry;
+		entry.canonical.resize(sizes[0]);
+		entry.blob.resize(sizes[1]);
+		file.read(reinterpret_cast<char*>(entry.canonical.data()), sizes[0] * sizeof(UINT));
+		file.read(reinterpret_cast<char*>(entry.blob.data()), sizes[1]);
+		if (!file.good() || HashRootSignature(entry.canonical) != hash)
+			return false;
+
+		loaded[hash] = std::move(entry);
+	}
+
+	entries.insert(loaded.begin(), loaded.end());
+	return true;
+}
+
+bool RootSignatureBlobStore::Save(const std::filesystem::path& fileName)
+{
+	std::error_code error;
+	std::filesystem::create_directories(fileName.parent_path(), error);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT header[3] = { StoreMagic, StoreVersion, (UINT)entries.size() };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		UINT sizes[2] = { (UINT)i->second.canonical.size(), (UINT)i->second.blob.size() };
+		file.write(reinterpret_cast<const char*>(&i->first), sizeof(UINT64));
+		file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+		file.write(reinterpret_cast<const char*>(i->second.canonical.data()), sizes[0] * sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(i->second.blob.data()), sizes[1]);
+	}
+
+	dirty = !file.good();
+	return !dirty;
+}
+
+const std::vector<BYTE>* RootSignatureBlobStore::Find(UINT64 hash, const CanonicalRootSignature& canonical)
+{
+	auto found = entries.find(hash);
+	if (found == entries.end() || found->second.canonical != canonical)
+		return nullptr;
+	return &found->second.blob;
+}
+
+void RootSignatureBlobStore::Add(UINT64 hash, const CanonicalRootSignature& canonical, const void* blob, size_t size)
+{
+	const BYTE* bytes = static_cast<const BYTE*>(blob);
+	entries[hash] = { canonical, std::vector<BYTE>(bytes, bytes + size) };
+	dirty = true;
+}
+
+size_t RootSignatureBlobStore::GetCount()
+{
+	return entries.size();
+}
+
+bool RootSignatureBlobStore::IsDirty()
+{
+	return dirty;
+}
+
+RootSignatureCache::RootSignatureCache(std::filesystem::path storeFileName)
+	: storeFileName(storeFileName), storeLoaded(false), stats({})
+{
+}
+
+RootSignatureCache::~RootSignatureCache()
+{
+}
+
+ComPtr<ID3D12RootSignature> RootSignatureCache::Get(ID3D12Device* device, const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, const std::string& name)
+{
+	stats.requests++;
+
+	CanonicalRootSignature canonical = CanonicalizeRootSignature(desc);
+	UINT64 hash = HashRootSignature(canonical);
+
+	std::vector<Entry>& bucket = entries[hash];
+	for (size_t i = 0; i < bucket.size(); i++)
+	{
+		if (bucket[i].canonical == canonical)
+		{
+			bucket[i].users.push_back(name);
+			return bucket[i].rootSignature;
+		}
+	}
+
+	if (!storeLoaded)
+	{
+		store.Load(storeFileName);
+		storeLoaded = true;
+	}
+
+	Entry entry = { canonical, nullptr, { name } };
+	const std::vector<BYTE>* blob = store.Find(hash, canonical);
+	if (blob && SUCCEEDED(device->CreateRootSignature(0, blob->data(), blob->size(), IID_PPV_ARGS(entry.rootSignature.GetAddressOf()))))
+	{
+		stats.loaded++;
+	}
+	else
+	{
+		ComPtr<ID3DBlob> signature;
+		ComPtr<ID3DBlob> error;
+		if (FAILED(D3DX12SerializeVersionedRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1_1, signature.GetAddressOf(), error.GetAddressOf())))
+		{
+			std::string message = "Cannot serialize root signature " + name;
+			if (error)
+				message += std::string(": ") + static_cast<const char*>(error->GetBufferPointer());
+			throw std::logic_error(message);
+		}
+
+		ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+			IID_PPV_ARGS(entry.rootSignature.GetAddressOf())));
+		store.Add(hash, canonical, signature->GetBufferPointer(), signature->GetBufferSize());
+		stats.serialized++;
+	}
+
+	stats.unique++;
+	bucket.push_back(entry);
+	return entry.rootSignature;
+}
+
+UINT64 RootSignatureCache::GetHash(ID3D12RootSignature* rootSignature)
+{
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		for (size_t j = 0; j < i->second.size(); j++)
+		{
+			if (i->second[j].rootSignature.Get() == rootSignature)
+				return i->first;
+		}
+	}
+	return 0;
+}
+
+void RootSignatureCache::Save()
+{
+	if (store.IsDirty())
+		store.Save(storeFileName);
+}
+
+const RootSignatureCacheStats& RootSignatureCache::GetStats()
+{
+	return stats;
+}
+
+void RootSignatureCache::PrintReport()
+{
+	printf("Root signatures: %u requested, %u unique, %u from the blob cache, %u serialized\n",
+		stats.requests, stats.unique, stats.loaded, stats.serialized);
+
+	for (auto i = entries.begin(); i != entries.end(); i++)
+	{
+		for (size_t j = 0; j < i->second.size(); j++)
+		{
+			const Entry& entry = i->second[j];
+			std::string users;
+			for (size_t k = 0; k < entry.users.size(); k++)
+				users += (k > 0 ? ", " : "") + entry.users[k];
+			printf("  %016llx %2zu users: %s\n", (unsigned long long)i->first, entry.users.size(), users.c_str());
+		}
+	}
+}
+
+RootSignatureCache& GetRootSignatureCache()
+{
+	static RootSignatureCache cache;
+	return cache;
+}
+
+static D3D12_VERSIONED_ROOT_SIGNATURE_DESC MakeVersionedDesc(const std::vector<D3D12_ROOT_PARAMETER1>& parameters,
+	const std::vector<D3D12_STATIC_SAMPLER_DESC>& samplers, D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = {};
+	desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	desc.Desc_1_1.NumParameters = (UINT)parameters.size();
+	desc.Desc_1_1.pParameters = parameters.data();
+	desc.Desc_1_1.NumStaticSamplers = (UINT)samplers.size();
+	desc.Desc_1_1.pStaticSamplers = samplers.data();
+	desc.Desc_1_1.Flags = flags;
+	return desc;
+}
+
+void ValidateRootSignatureCache()
+{
+	printf("Root signature cache\n");
+	bool passed = true;
+
+	//a full screen pass: a table of two srvs, a cbv and two samplers
+	D3D12_DESCRIPTOR_RANGE1 appended[2] = {
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND } };
+	D3D12_DESCRIPTOR_RANGE1 explicitOffsets[2] = {
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 0 },
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 1 } };
+
+	auto table = [](D3D12_DESCRIPTOR_RANGE1* ranges, UINT count)
+	{
+		D3D12_ROOT_PARAMETER1 parameter = {};
+		parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		parameter.DescriptorTable = { count, ranges };
+		parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		return parameter;
+	};
+	auto cbv = [](UINT shaderRegister, D3D12_ROOT_DESCRIPTOR_FLAGS flags)
+	{
+		D3D12_ROOT_PARAMETER1 parameter = {};
+		parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		parameter.Descriptor = { shaderRegister, 0, flags };
+		parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		return parameter;
+	};
+	auto sampler = [](UINT shaderRegister, float mipBias)
+	{
+		D3D12_STATIC_SAMPLER_DESC desc = {};
+		desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		desc.AddressU = desc.AddressV = desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		desc.MipLODBias = mipBias;
+		desc.MaxAnisotropy = 16;
+		desc.ComparisonFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+		desc.BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE;
+		desc.MaxLOD = D3D12_FLOAT32_MAX;
+		desc.ShaderRegister = shaderRegister;
+		desc.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		return desc;
+	};
+
+	D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+	std::vector<D3D12_ROOT_PARAMETER1> parameters = { table(appended, 2), cbv(0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE) };
+	std::vector<D3D12_STATIC_SAMPLER_DESC> samplers = { sampler(0, 0.0f), sampler(1, 0.0f) };
+	CanonicalRootSignature base = CanonicalizeRootSignature(MakeVersionedDesc(parameters, samplers, flags));
+
+	std::vector<D3D12_ROOT_PARAMETER1> explicitParameters = { table(explicitOffsets, 2), cbv(0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE) };
+	Check(passed, "appended offsets resolved", CanonicalizeRootSignature(MakeVersionedDesc(explicitParameters, samplers, flags)) == base);
+
+	std::vector<D3D12_STATIC_SAMPLER_DESC> reversed = { sampler(1, 0.0f), sampler(0, -0.0f) };
+	Check(passed, "sampler order and -0 ignored", CanonicalizeRootSignature(MakeVersionedDesc(parameters, reversed, flags)) == base);
+
+	std::vector<D3D12_ROOT_PARAMETER1> swapped = { cbv(0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE), table(appended, 2) };
+	Check(passed, "parameter order matters", CanonicalizeRootSignature(MakeVersionedDesc(swapped, samplers, flags)) != base);
+
+	std::vector<D3D12_ROOT_PARAMETER1> otherRegister = { table(appended, 2), cbv(1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE) };
+	Check(passed, "register matters", CanonicalizeRootSignature(MakeVersionedDesc(otherRegister, samplers, flags)) != base);
+
+	std::vector<D3D12_ROOT_PARAMETER1> otherFlags = { table(appended, 2), cbv(0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC) };
+	Check(passed, "descriptor flags matter", CanonicalizeRootSignature(MakeVersionedDesc(otherFlags, samplers, flags)) != base);
+
+	std::vector<D3D12_STATIC_SAMPLER_DESC> biased = { sampler(0, 0.5f), sampler(1, 0.0f) };
+	Check(passed, "sampler state matters", CanonicalizeRootSignature(MakeVersionedDesc(parameters, biased, flags)) != base);
+	Check(passed, "root flags matter", CanonicalizeRootSignature(MakeVersionedDesc(parameters, samplers, D3D12_ROOT_SIGNATURE_FLAG_NONE)) != base);
+
+	//a 1.0 description is the 1.1 one with everything volatile
+	D3D12_DESCRIPTOR_RANGE oldRanges[2] = {
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND } };
+	D3D12_ROOT_PARAMETER oldParameters[2] = {};
+	oldParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	oldParameters[0].DescriptorTable = { 2, oldRanges };
+	oldParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	oldParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	oldParameters[1].Descriptor = { 0, 0 };
+	oldParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC oldDesc = {};
+	oldDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	oldDesc.Desc_1_0 = { 2, oldParameters, (UINT)samplers.size(), samplers.data(), flags };
+
+	D3D12_DESCRIPTOR_RANGE1 volatileRanges[2] = {
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+		{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND } };
+	std::vector<D3D12_ROOT_PARAMETER1> volatileParameters = { table(volatileRanges, 2), cbv(0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE) };
+	CanonicalRootSignature volatileBase = CanonicalizeRootSignature(MakeVersionedDesc(volatileParameters, samplers, flags));
+	Check(passed, "1.0 matches volatile 1.1", CanonicalizeRootSignature(oldDesc) == volatileBase);
+	Check(passed, "1.0 differs from static 1.1", CanonicalizeRootSignature(oldDesc) != base);
+
+	//the store written and read back, a mismatching canonical form under the same hash isn't returned
+	std::filesystem::path fileName = std::filesystem::temp_directory_path() / "RootSignatureCacheValidation.bin";
+	BYTE blob[] = { 1, 2, 3, 4, 5 };
+	UINT64 hash = HashRootSignature(base);
+	auto saveStore = [&]()
+	{
+		RootSignatureBlobStore store;
+		store.Add(hash, base, blob, sizeof(blob));
+		store.Add(HashRootSignature(volatileBase), volatileBase, blob, 3);
+		return store.Save(fileName) && !store.IsDirty();
+	};
+	Check(passed, "store saved", saveStore());
+	{
+		RootSignatureBlobStore store;
+		Check(passed, "store loaded", store.Load(fileName) && store.GetCount() == 2);
+		const std::vector<BYTE>* found = store.Find(hash, base);
+		Check(passed, "blob read back", found && found->size() == sizeof(blob) && memcmp(found->data(), blob, sizeof(blob)) == 0);
+		Check(passed, "collision rejected", store.Find(hash, volatileBase) == nullptr);
+	}
+
+	//a blob size past the end of the file and a store cut short are misses, not allocations
+	{
+		std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+		UINT corruptSize = 0xFFFFFFF0;
+		file.seekp(3 * sizeof(UINT) + sizeof(UINT64) + sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(&corruptSize), sizeof(UINT));
+	}
+	{
+		RootSignatureBlobStore store;
+		Check(passed, "corrupt size ignored", !store.Load(fileName) && store.GetCount() == 0);
+	}
+	saveStore();
+	std::filesystem::resize_file(fileName, std::filesystem::file_size(fileName) - 2);
+	{
+		RootSignatureBlobStore store;
+		Check(passed, "truncated store ignored", !store.Load(fileName) && store.GetCount() == 0);
+	}
+
+	saveStore();
+	{
+		std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+		UINT oldVersion = StoreVersion + 1;
+		file.seekp(sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(&oldVersion), sizeof(UINT));
+	}
+	{
+		RootSignatureBlobStore store;
+		Check(passed, "other version ignored", !store.Load(fileName) && store.GetCount() == 0);
+	}
+
+	std::error_code error;
+	std::filesystem::remove(fileName, error);
+	PrintValidationResult(passed);
+}
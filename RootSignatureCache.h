@@ -0,0 +1,89 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+//a root signature description as bytes, equal for descriptions that create the same root signature: 1.0 descriptions
+//take the flags 1.0 implies, appended range offsets are resolved and static samplers are sorted by register
+typedef std::vector<UINT> CanonicalRootSignature;
+
+CanonicalRootSignature CanonicalizeRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc);
+UINT64 HashRootSignature(const CanonicalRootSignature& canonical);
+
+//serialized root signatures from earlier runs, a file of canonical descriptions and their blobs
+class RootSignatureBlobStore
+{
+	struct Entry
+	{
+		CanonicalRootSignature canonical;
+		std::vector<BYTE> blob;
+	};
+
+	std::unordered_map<UINT64, Entry> entries;
+	bool dirty;
+
+public:
+	RootSignatureBlobStore();
+	~RootSignatureBlobStore();
+
+	bool Load(const std::filesystem::path& fileName);
+	bool Save(const std::filesystem::path& fileName);
+
+	//nullptr when the store has no blob for the description
+	const std::vector<BYTE>* Find(UINT64 hash, const CanonicalRootSignature& canonical);
+	void Add(UINT64 hash, const CanonicalRootSignature& canonical, const void* blob, size_t size);
+
+	size_t GetCount();
+	bool IsDirty();
+};
+
+struct RootSignatureCacheStats
+{
+	UINT requests;
+	UINT unique;
+	UINT loaded;
+	UINT serialized;
+};
+
+//one root signature object per distinct description. The passes asking for identical ones share it
+class RootSignatureCache
+{
+	struct Entry
+	{
+		CanonicalRootSignature canonical;
+		ComPtr<ID3D12RootSignature> rootSignature;
+		std::vector<std::string> users;
+	};
+
+	std::unordered_map<UINT64, std::vector<Entry>> entries;
+	RootSignatureBlobStore store;
+	std::filesystem::path storeFileName;
+	bool storeLoaded;
+
+	RootSignatureCacheStats stats;
+
+public:
+	RootSignatureCache(std::filesystem::path storeFileName = "ShaderCache/RootSignatures.bin");
+	~RootSignatureCache();
+
+	//name is only used in the report
+	ComPtr<ID3D12RootSignature> Get(ID3D12Device* device, const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, const std::string& name);
+
+	//hash of the canonical form of a root signature this cache returned, 0 for any other
+	UINT64 GetHash(ID3D12RootSignature* rootSignature);
+
+	//writes the blobs serialized this run next to the ones loaded
+	void Save();
+
+	const RootSignatureCacheStats& GetStats();
+	//every unique root signature and the passes using it
+	void PrintReport();
+};
+
+RootSignatureCache& GetRootSignatureCache();
+
+//canonical forms of equivalent and different descriptions, and the store written and read back
+void ValidateRootSignatureCache();
@@ -36,6 +36,7 @@ pointers will be bound.
 */
 #include<stdexcept>
 #include "RootSignatureGenerator.h"
+#include "RootSignatureCache.h"
 
 namespace nv_helpers_dx12
 {
@@ -184,23 +185,12 @@ ComPtr<ID3D12RootSignature> RootSignatureGenerator::Generate(ID3D12Device* devic
   rootDesc.Flags =
       isLocal ? D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE : D3D12_ROOT_SIGNATURE_FLAG_NONE;
 
-  // Create the root signature from its descriptor
-  ID3DBlob* pSigBlob;
-  ID3DBlob* pErrorBlob;
-  HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &pSigBlob,
-                                           &pErrorBlob);
-  if (FAILED(hr))
-  {
-    throw std::logic_error("Cannot serialize root signature");
-  }
-  ComPtr<ID3D12RootSignature> pRootSig;
-  hr = device->CreateRootSignature(0, pSigBlob->GetBufferPointer(), pSigBlob->GetBufferSize(),
-                                   IID_PPV_ARGS(&pRootSig));
-  if (FAILED(hr))
-  {
-    throw std::logic_error("Cannot create root signature");
-  }
-  return pRootSig;
+  // Identical signatures, like the ones every raytracing pipeline asks for, share one object and the
+  // serialized blob is kept across runs
+  D3D12_VERSIONED_ROOT_SIGNATURE_DESC versionedDesc = {};
+  versionedDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_0;
+  versionedDesc.Desc_1_0 = rootDesc;
+  return GetRootSignatureCache().Get(device, versionedDesc, isLocal ? "raytracing local" : "raytracing global");
 }
 
 } // namespace nv_helpers_dx12
@@ -0,0 +1,525 @@
+#include "ShaderBindingTableManager.h"
+#include"Validation.h"
+#include "DXRHelper.h"
+#include<algorithm>
+
+static UINT GetEntrySize(size_t argumentCount)
+{
+	return ROUND_UP(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 * (UINT)argumentCount, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
+}
+
+ShaderBindingTableManager::ShaderBindingTableManager(ComPtr<ID3D12Device5> device, UINT rayTypeCount)
+{
+	this->device = device;
+	this->rayTypeCount = rayTypeCount;
+	recordCapacity = 0;
+	hitGroupArgumentCount = 0;
+	layoutDirty = true;
+	tableSize = 0;
+	mappedBuffer = nullptr;
+	bufferSize = 0;
+	ZeroMemory(&stats, sizeof(SBTUpdateStats));
+}
+
+ShaderBindingTableManager::~ShaderBindingTableManager()
+{
+	if (mappedBuffer != nullptr)
+		buffer->Unmap(0, nullptr);
+}
+
+UINT ShaderBindingTableManager::AddPipeline(std::string name, const SBTPipelineDesc& desc, ComPtr<ID3D12StateObjectProperties> properties)
+{
+	if (desc.rayTypes.size() != rayTypeCount)
+		throw std::logic_error("Every pipeline needs one hit group per ray type");
+
+	Pipeline pipeline = {};
+	pipeline.name = name;
+	pipeline.desc = desc;
+	pipeline.properties = properties;
+	pipelines.emplace_back(pipeline);
+
+	layoutDirty = true;
+	return (UINT)pipelines.size() - 1;
+}
+
+void ShaderBindingTableManager::SetPipelineProperties(UINT pipeline, ComPtr<ID3D12StateObjectProperties> properties)
+{
+	pipelines[pipeline].properties = properties;
+	layoutDirty = true;
+}
+
+void ShaderBindingTableManager::MarkDirty(UINT record)
+{
+	if (dirtyFlags[record])
+		return;
+
+	dirtyFlags[record] = 1;
+	dirtyRecords.emplace_back(record);
+}
+
+UINT ShaderBindingTableManager::AcquireGeometryRecord(SBTGeometryKey key, const SBTRootArguments& arguments)
+{
+	auto existing = keyToRecord.find(key);
+	if (existing != keyToRecord.end())
+	{
+		records[existing->second].refCount++;
+		return existing->second;
+	}
+
+	GeometryRecord geometry = {};
+	geometry.key = key;
+	geometry.arguments = arguments;
+	geometry.refCount = 1;
+
+	UINT record;
+	if (!freeRecords.empty())
+	{
+		record = freeRecords.back();
+		freeRecords.pop_back();
+		records[record] = geometry;
+	}
+
+	else
+	{
+		record = (UINT)records.size();
+		records.emplace_back(geometry);
+		dirtyFlags.emplace_back(0);
+	}
+
+	keyToRecord[key] = record;
+
+	//new slots past the capacity, or more arguments than the entries have room for, need a new layout
+	if (record >= recordCapacity || arguments.size() > hitGroupArgumentCount)
+		layoutDirty = true;
+
+	MarkDirty(record);
+	return record;
+}
+
+void ShaderBindingTableManager::ReleaseGeometryRecord(UINT record)
+{
+	GeometryRecord& geometry = records[record];
+	if (geometry.refCount == 0)
+		return;
+
+	geometry.refCount--;
+	if (geometry.refCount > 0)
+		return;
+
+	keyToRecord.erase(geometry.key);
+	geometry.arguments.clear();
+	freeRecords.emplace_back(record);
+
+	//cleared so nothing points at stale resources
+	MarkDirty(record);
+}
+
+void ShaderBindingTableManager::SetGeometryArguments(UINT record, const SBTRootArguments& arguments)
+{
+	GeometryRecord& geometry = records[record];
+	if (geometry.arguments == arguments)
+		return;
+
+	geometry.arguments = arguments;
+	if (arguments.size() > hitGroupArgumentCount)
+		layoutDirty = true;
+
+	MarkDirty(record);
+}
+
+UINT ShaderBindingTableManager::GetHitGroupIndex(UINT record)
+{
+	return record * rayTypeCount;
+}
+
+void ShaderBindingTableManager::ComputeLayout(const SBTIdentifierLookup& lookup)
+{
+	if (recordCapacity < records.size())
+	{
+		UINT capacity = std::max(recordCapacity, 16u);
+		while (capacity < records.size())
+			capacity *= 2;
+
+		recordCapacity = capacity;
+	}
+
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		hitGroupArgumentCount = std::max(hitGroupArgumentCount, (UINT)records[i].arguments.size());
+	}
+
+	sectionData.clear();
+	sectionOffsets.clear();
+	stats.sharedSections = 0;
+
+	UINT64 offset = 0;
+
+	//raygen and miss sections identical to one already placed point at it instead
+	auto placeSection = [&](std::vector<BYTE>& data) -> UINT64
+	{
+		if (data.empty())
+			return 0;
+
+		for (size_t i = 0; i < sectionData.size(); i++)
+		{
+			if (sectionData[i] == data)
+			{
+				stats.sharedSections++;
+				return sectionOffsets[i];
+			}
+		}
+
+		offset = ROUND_UP(offset, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		UINT64 sectionOffset = offset;
+		offset += data.size();
+
+		sectionData.emplace_back(std::move(data));
+		sectionOffsets.emplace_back(sectionOffset);
+		return sectionOffset;
+	};
+
+	for (UINT i = 0; i < pipelines.size(); i++)
+	{
+		SBTPipelineDesc& desc = pipelines[i].desc;
+		SBTPipelineLayout& layout = pipelines[i].layout;
+
+		UINT rayGenStride = GetEntrySize(desc.rayGenArguments.size());
+		std::vector<BYTE> rayGenData(rayGenStride);
+		WriteRecord(rayGenData.data(), lookup(i, desc.rayGen), desc.rayGenArguments, rayGenStride);
+		layout.rayGen.stride = rayGenStride;
+		layout.rayGen.size = rayGenStride;
+		layout.rayGen.offset = placeSection(rayGenData);
+
+		size_t missArgumentCount = 0;
+		for (size_t j = 0; j < desc.missPrograms.size(); j++)
+		{
+			missArgumentCount = std::max(missArgumentCount, desc.missPrograms[j].arguments.size());
+		}
+
+		UINT missStride = GetEntrySize(missArgumentCount);
+		std::vector<BYTE> missData(missStride * desc.missPrograms.size());
+		for (size_t j = 0; j < desc.missPrograms.size(); j++)
+		{
+			WriteRecord(missData.data() + j * missStride, lookup(i, desc.missPrograms[j].name), desc.missPrograms[j].arguments, missStride);
+		}
+		layout.miss.stride = missStride;
+		layout.miss.size = missData.size();
+		layout.miss.offset = placeSection(missData);
+
+		//hit groups are patched per record, so every pipeline keeps its own
+		bool usesGeometryArguments = false;
+		for (size_t j = 0; j < desc.rayTypes.size(); j++)
+		{
+			usesGeometryArguments |= desc.rayTypes[j].usesGeometryArguments;
+		}
+
+		UINT hitGroupStride = GetEntrySize(usesGeometryArguments ? hitGroupArgumentCount : 0);
+		UINT hitGroupCount = recordCapacity * rayTypeCount + (UINT)desc.trailingHitGroups.size();
+
+		offset = ROUND_UP(offset, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+		layout.hitGroup.stride = hitGroupStride;
+		layout.hitGroup.size = (UINT64)hitGroupStride * hitGroupCount;
+		layout.hitGroup.offset = offset;
+		offset += layout.hitGroup.size;
+	}
+
+	tableSize = ROUND_UP(offset, 256);
+}
+
+UINT64 ShaderBindingTableManager::WriteRecord(BYTE* dest, const void* identifier, const SBTRootArguments& arguments, UINT stride)
+{
+	if (identifier == nullptr)
+		throw std::logic_error("Unknown shader identifier used in the SBT");
+
+	memcpy(dest, identifier, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+
+	UINT64 argumentSize = arguments.size() * 8;
+	if (argumentSize > 0)
+		memcpy(dest + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, arguments.data(), argumentSize);
+
+	//unused arguments are zeroed so identical records stay byte identical
+	UINT64 written = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + argumentSize;
+	ZeroMemory(dest + written, stride - written);
+
+	return stride;
+}
+
+void ShaderBindingTableManager::WriteHitGroupRecords(BYTE* dest, UINT pipeline, UINT record, const SBTIdentifierLookup& lookup)
+{
+	Pipeline& target = pipelines[pipeline];
+	UINT stride = target.layout.hitGroup.stride;
+	BYTE* recordData = dest + target.layout.hitGroup.offset + (UINT64)record * rayTypeCount * stride;
+
+	GeometryRecord& geometry = records[record];
+	for (UINT i = 0; i < rayTypeCount; i++)
+	{
+		//released slots aren't referenced by any instance
+		if (geometry.refCount == 0)
+		{
+			ZeroMemory(recordData + i * stride, stride);
+		}
+
+		else
+		{
+			const SBTRayType& rayType = target.desc.rayTypes[i];
+			WriteRecord(recordData + i * stride, lookup(pipeline, rayType.hitGroup),
+				rayType.usesGeometryArguments ? geometry.arguments : SBTRootArguments(), stride);
+		}
+
+		stats.recordsWritten++;
+		stats.bytesWritten += stride;
+	}
+}
+
+void ShaderBindingTableManager::WriteAll(BYTE* dest, const SBTIdentifierLookup& lookup)
+{
+	for (size_t i = 0; i < sectionData.size(); i++)
+	{
+		memcpy(dest + sectionOffsets[i], sectionData[i].data(), sectionData[i].size());
+		stats.bytesWritten += sectionData[i].size();
+	}
+
+	for (UINT i = 0; i < pipelines.size(); i++)
+	{
+		SBTPipelineLayout& layout = pipelines[i].layout;
+		stats.recordsWritten += 1 + (UINT)pipelines[i].desc.missPrograms.size();
+
+		for (UINT j = 0; j < records.size(); j++)
+		{
+			WriteHitGroupRecords(dest, i, j, lookup);
+		}
+
+		//slots past the records in use stay empty until they are acquired
+		UINT64 usedSize = (UINT64)records.size() * rayTypeCount * layout.hitGroup.stride;
+		UINT64 emptySize = (UINT64)recordCapacity * rayTypeCount * layout.hitGroup.stride - usedSize;
+		ZeroMemory(dest + layout.hitGroup.offset + usedSize, emptySize);
+
+		auto& trailingHitGroups = pipelines[i].desc.trailingHitGroups;
+		BYTE* trailingData = dest + layout.hitGroup.offset + usedSize + emptySize;
+		for (size_t j = 0; j < trailingHitGroups.size(); j++)
+		{
+			stats.bytesWritten += WriteRecord(trailingData + j * layout.hitGroup.stride, lookup(i, trailingHitGroups[j]), {}, layout.hitGroup.stride);
+			stats.recordsWritten++;
+		}
+	}
+}
+
+SBTIdentifierLookup ShaderBindingTableManager::GetStateObjectLookup()
+{
+	return [this](UINT pipeline, const std::wstring& exportName) -> const void*
+	{
+		return pipelines[pipeline].properties->GetShaderIdentifier(exportName.c_str());
+	};
+}
+
+SBTUpdateStats ShaderBindingTableManager::Update()
+{
+	//the frames that used the previous buffer are done
+	retiredBuffer = nullptr;
+
+	SBTIdentifierLookup lookup = GetStateObjectLookup();
+	bool fullRewrite = layoutDirty;
+	if (fullRewrite)
+	{
+		ComputeLayout(lookup);
+
+		if (tableSize > bufferSize)
+		{
+			if (mappedBuffer != nullptr)
+				buffer->Unmap(0, nullptr);
+
+			retiredBuffer = buffer;
+			bufferSize = tableSize;
+			buffer = nv_helpers_dx12::CreateBuffer(device.Get(), bufferSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ,
+				nv_helpers_dx12::kUploadHeapProps);
+			buffer->SetName(L"SBT Resource");
+
+			ThrowIfFailed(buffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedBuffer)));
+		}
+	}
+
+	stats.fullRewrite = fullRewrite;
+	stats.recordsWritten = 0;
+	stats.bytesWritten = 0;
+	stats.tableSize = tableSize;
+
+	if (fullRewrite)
+	{
+		WriteAll(mappedBuffer, lookup);
+	}
+
+	else
+	{
+		for (size_t i = 0; i < dirtyRecords.size(); i++)
+		{
+			for (UINT j = 0; j < pipelines.size(); j++)
+			{
+				WriteHitGroupRecords(mappedBuffer, j, dirtyRecords[i], lookup);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < dirtyRecords.size(); i++)
+	{
+		dirtyFlags[dirtyRecords[i]] = 0;
+	}
+	dirtyRecords.clear();
+	layoutDirty = false;
+
+	return stats;
+}
+
+SBTUpdateStats ShaderBindingTableManager::Update(std::vector<BYTE>& table, const SBTIdentifierLookup& lookup)
+{
+	bool fullRewrite = layoutDirty;
+	if (fullRewrite)
+	{
+		ComputeLayout(lookup);
+		table.resize(std::max((UINT64)table.size(), tableSize));
+	}
+
+	stats.fullRewrite = fullRewrite;
+	stats.recordsWritten = 0;
+	stats.bytesWritten = 0;
+	stats.tableSize = tableSize;
+
+	if (fullRewrite)
+	{
+		WriteAll(table.data(), lookup);
+	}
+
+	else
+	{
+		for (size_t i = 0; i < dirtyRecords.size(); i++)
+		{
+			for (UINT j = 0; j < pipelines.size(); j++)
+			{
+				WriteHitGroupRecords(table.data(), j, dirtyRecords[i], lookup);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < dirtyRecords.size(); i++)
+	{
+		dirtyFlags[dirtyRecords[i]] = 0;
+	}
+	dirtyRecords.clear();
+	layoutDirty = false;
+
+	return stats;
+}
+
+void ShaderBindingTableManager::FillDispatchDesc(UINT pipeline, D3D12_DISPATCH_RAYS_DESC& desc)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS address = buffer->GetGPUVirtualAddress();
+	SBTPipelineLayout& layout = pipelines[pipeline].layout;
+
+	desc.RayGenerationShaderRecord.StartAddress = address + layout.rayGen.offset;
+	desc.RayGenerationShaderRecord.SizeInBytes = layout.rayGen.size;
+
+	desc.MissShaderTable.StartAddress = address + layout.miss.offset;
+	desc.MissShaderTable.SizeInBytes = layout.miss.size;
+	desc.MissShaderTable.StrideInBytes = layout.miss.stride;
+
+	desc.HitGroupTable.StartAddress = address + layout.hitGroup.offset;
+	desc.HitGroupTable.SizeInBytes = layout.hitGroup.size;
+	desc.HitGroupTable.StrideInBytes = layout.hitGroup.stride;
+}
+
+const SBTPipelineLayout& ShaderBindingTableManager::GetLayout(UINT pipeline)
+{
+	return pipelines[pipeline].layout;
+}
+
+UINT ShaderBindingTableManager::GetRecordCount()
+{
+	return (UINT)(records.size() - freeRecords.size());
+}
+
+const SBTUpdateStats& ShaderBindingTableManager::GetStats()
+{
+	return stats;
+}
+
+void ValidateShaderBindingTableManager()
+{
+	printf("Shader binding table manager\n");
+
+	//identifiers made from the export name only, so the same export is the same in every pipeline
+	std::unordered_map<std::wstring, std::vector<BYTE>> identifiers;
+	SBTIdentifierLookup lookup = [&](UINT, const std::wstring& exportName) -> const void*
+	{
+		auto& identifier = identifiers[exportName];
+		if (identifier.empty())
+		{
+			identifier.resize(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			for (size_t i = 0; i < identifier.size(); i++)
+				identifier[i] = (BYTE)(std::hash<std::wstring>()(exportName) >> (i % 8 * 8));
+		}
+		return identifier.data();
+	};
+
+	ShaderBindingTableManager manager(nullptr);
+
+	SBTPipelineDesc lighting = {};
+	lighting.rayGen = L"RayGen";
+	lighting.rayGenArguments = { (void*)0x100 };
+	lighting.missPrograms = { { L"Miss", { (void*)0x200 } }, { L"ShadowMiss", {} } };
+	lighting.rayTypes = { { L"HitGroup", true }, { L"ShadowHitGroup", false } };
+	lighting.trailingHitGroups = { L"ShadowHitGroup" };
+
+	//same raygen and miss, these sections are shared
+	SBTPipelineDesc transparent = lighting;
+
+	SBTPipelineDesc gbuffer = {};
+	gbuffer.rayGen = L"GBufferRayGen";
+	gbuffer.missPrograms = { { L"GBufferMiss", {} } };
+	gbuffer.rayTypes = { { L"GBufferHitGroup", true }, { L"ShadowHitGroup", false } };
+
+	manager.AddPipeline("lighting", lighting);
+	manager.AddPipeline("transparent", transparent);
+	manager.AddPipeline("gbuffer", gbuffer);
+
+	//100 meshes of which every tenth repeats the one before it
+	std::vector<UINT> handles;
+	for (UINT i = 0; i < 100; i++)
+	{
+		UINT geometry = i % 10 == 9 ? i - 1 : i;
+		handles.emplace_back(manager.AcquireGeometryRecord({ 0x10000ull * (geometry + 1), geometry % 4 },
+			{ (void*)(0x10000ull * (geometry + 1)), (void*)(UINT64)(geometry % 4) }));
+	}
+
+	bool passed = true;
+	std::vector<BYTE> table;
+
+	SBTUpdateStats full = manager.Update(table, lookup);
+	passed &= manager.GetRecordCount() == 90 && handles[9] == handles[8] && full.fullRewrite && full.sharedSections == 2;
+	printf("  initial: %u records for 100 meshes, %u shared sections, %llu bytes written of %llu\n", manager.GetRecordCount(),
+		full.sharedSections, full.bytesWritten, full.tableSize);
+
+	SBTUpdateStats none = manager.Update(table, lookup);
+	passed &= !none.fullRewrite && none.bytesWritten == 0;
+	printf("  unchanged: %llu bytes written\n", none.bytesWritten);
+
+	//a material change only touches the ray types of that record in every pipeline
+	manager.SetGeometryArguments(handles[5], { (void*)0x60000ull, (void*)7ull });
+	SBTUpdateStats patch = manager.Update(table, lookup);
+	UINT64 expected = 2 * manager.GetLayout(0).hitGroup.stride * 2 + manager.GetLayout(2).hitGroup.stride * 2;
+	passed &= !patch.fullRewrite && patch.recordsWritten == 6 && patch.bytesWritten == expected;
+	printf("  one material changed: %u records, %llu bytes written\n", patch.recordsWritten, patch.bytesWritten);
+
+	//the record sits at its hit group index in every pipeline
+	const SBTPipelineLayout& layout = manager.GetLayout(1);
+	const BYTE* record = table.data() + layout.hitGroup.offset + (UINT64)manager.GetHitGroupIndex(handles[5]) * layout.hitGroup.stride;
+	passed &= memcmp(record, lookup(1, L"HitGroup"), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) == 0
+		&& *reinterpret_cast<const UINT64*>(record + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) == 7;
+
+	//a slot freed and taken again keeps the layout
+	manager.ReleaseGeometryRecord(handles[0]);
+	UINT reused = manager.AcquireGeometryRecord({ 0xABC0000ull, 1 }, { (void*)0xABC0000ull, (void*)1ull });
+	SBTUpdateStats reuse = manager.Update(table, lookup);
+	passed &= reused == handles[0] && !reuse.fullRewrite;
+	printf("  slot reused: %s, %llu bytes written\n", reused == handles[0] ? "same slot" : "new slot", reuse.bytesWritten);
+
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<functional>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+//root arguments of a shader record, 8 bytes each like in ShaderBindingTableGenerator
+typedef std::vector<void*> SBTRootArguments;
+
+//returns the shader identifier of the export in the pipeline, the state object properties outside of tests
+typedef std::function<const void* (UINT pipeline, const std::wstring& exportName)> SBTIdentifierLookup;
+
+//geometry with the same key shares one hit group record in every pipeline
+struct SBTGeometryKey
+{
+	D3D12_GPU_VIRTUAL_ADDRESS vertexBuffer;
+	UINT materialID;
+
+	bool operator==(const SBTGeometryKey& other) const
+	{
+		return vertexBuffer == other.vertexBuffer && materialID == other.materialID;
+	}
+};
+
+struct SBTGeometryKeyHasher
+{
+	size_t operator()(const SBTGeometryKey& key) const
+	{
+		return (size_t)(key.vertexBuffer ^ ((UINT64)key.materialID << 48) ^ key.materialID);
+	}
+};
+
+struct SBTRayType
+{
+	std::wstring hitGroup;
+	//false for hit groups without root arguments, like shadows
+	bool usesGeometryArguments;
+};
+
+struct SBTMissProgram
+{
+	std::wstring name;
+	SBTRootArguments arguments;
+};
+
+struct SBTPipelineDesc
+{
+	std::wstring rayGen;
+	SBTRootArguments rayGenArguments;
+	std::vector<SBTMissProgram> missPrograms;
+
+	//one hit group per ray type for every geometry record, the same count in every pipeline
+	std::vector<SBTRayType> rayTypes;
+	//records after the geometry records, without root arguments
+	std::vector<std::wstring> trailingHitGroups;
+};
+
+struct SBTSection
+{
+	UINT64 offset;
+	UINT64 size;
+	UINT stride;
+};
+
+struct SBTPipelineLayout
+{
+	SBTSection rayGen;
+	SBTSection miss;
+	SBTSection hitGroup;
+};
+
+struct SBTUpdateStats
+{
+	bool fullRewrite;
+	UINT recordsWritten;
+	UINT64 bytesWritten;
+
+	//raygen and miss sections that point at an identical section of another pipeline
+	UINT sharedSections;
+	UINT64 tableSize;
+};
+
+//all the shader binding tables in one buffer. Geometry records get a stable slot that the instances of the tlas point
+//at, so materials or entities changing only rewrite their own records instead of the whole table
+class ShaderBindingTableManager
+{
+	struct Pipeline
+	{
+		std::string name;
+		SBTPipelineDesc desc;
+		ComPtr<ID3D12StateObjectProperties> properties;
+		SBTPipelineLayout layout;
+	};
+
+	struct GeometryRecord
+	{
+		SBTGeometryKey key;
+		SBTRootArguments arguments;
+		UINT refCount;
+	};
+
+	UINT rayTypeCount;
+
+	std::vector<Pipeline> pipelines;
+	std::vector<GeometryRecord> records;
+	std::vector<UINT> freeRecords;
+	std::unordered_map<SBTGeometryKey, UINT, SBTGeometryKeyHasher> keyToRecord;
+	std::vector<UINT> dirtyRecords;
+	std::vector<UINT8> dirtyFlags;
+
+	//slots the hit group sections have room for, grows to twice its size when full
+	UINT recordCapacity;
+	UINT hitGroupArgumentCount;
+	bool layoutDirty;
+	UINT64 tableSize;
+
+	//raygen and miss sections, ready to copy
+	std::vector<std::vector<BYTE>> sectionData;
+	std::vector<UINT64> sectionOffsets;
+
+	ComPtr<ID3D12Device5> device;
+	ComPtr<ID3D12Resource> buffer;
+	BYTE* mappedBuffer;
+	UINT64 bufferSize;
+	//the frame using the replaced buffer has to be finished before the next update
+	ComPtr<ID3D12Resource> retiredBuffer;
+
+	SBTUpdateStats stats;
+
+	void MarkDirty(UINT record);
+	void ComputeLayout(const SBTIdentifierLookup& lookup);
+	UINT64 WriteRecord(BYTE* dest, const void* identifier, const SBTRootArguments& arguments, UINT stride);
+	void WriteHitGroupRecords(BYTE* dest, UINT pipeline, UINT record, const SBTIdentifierLookup& lookup);
+	void WriteAll(BYTE* dest, const SBTIdentifierLookup& lookup);
+	SBTIdentifierLookup GetStateObjectLookup();
+
+public:
+	ShaderBindingTableManager(ComPtr<ID3D12Device5> device, UINT rayTypeCount = 2);
+	~ShaderBindingTableManager();
+
+	//returns the index of the pipeline, used to fill its dispatch description
+	UINT AddPipeline(std::string name, const SBTPipelineDesc& desc, ComPtr<ID3D12StateObjectProperties> properties = nullptr);
+	//after the state object was created again, its shader identifiers can differ so the next update rewrites everything
+	void SetPipelineProperties(UINT pipeline, ComPtr<ID3D12StateObjectProperties> properties);
+
+	//returns the slot of the record, the same slot for the same key
+	UINT AcquireGeometryRecord(SBTGeometryKey key, const SBTRootArguments& arguments = {});
+	void ReleaseGeometryRecord(UINT record);
+	void SetGeometryArguments(UINT record, const SBTRootArguments& arguments);
+
+	//value for InstanceContributionToHitGroupIndex
+	UINT GetHitGroupIndex(UINT record);
+
+	//writes what changed since the last update into the upload buffer
+	SBTUpdateStats Update();
+	//same, into cpu memory and with the identifiers from lookup
+	SBTUpdateStats Update(std::vector<BYTE>& table, const SBTIdentifierLookup& lookup);
+
+	void FillDispatchDesc(UINT pipeline, D3D12_DISPATCH_RAYS_DESC& desc);
+	const SBTPipelineLayout& GetLayout(UINT pipeline);
+	UINT GetRecordCount();
+	const SBTUpdateStats& GetStats();
+};
+
+//layout, deduplication and partial writes against made up shader identifiers
+void ValidateShaderBindingTableManager();
@@ -0,0 +1,298 @@
+#include "ShaderBuildGraph.h"
+#include"Validation.h"
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<deque>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+
+void ShaderBuildReport::Print()
+{
+	printf("Shader build: %zu nodes on %u threads in %.1fms, %.1fms serial, %.1fms critical path\n",
+		nodes.size(), threadCount, totalTime, serialTime, criticalPath);
+
+	//slowest first
+	std::vector<const ShaderBuildTiming*> sorted(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++)
+		sorted[i] = &nodes[i];
+	std::sort(sorted.begin(), sorted.end(), [](const ShaderBuildTiming* a, const ShaderBuildTiming* b) { return a->duration > b->duration; });
+
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const ShaderBuildTiming& node = *sorted[i];
+		const char* status = node.skipped ? " skipped" : (node.failed ? " FAILED" : "");
+		printf("  %-40s %-8s %8.1fms at %8.1fms thread %u%s\n", node.name.c_str(),
+			node.type == SHADER_BUILD_SHADER ? "shader" : "pipeline", node.duration, node.start, node.thread, status);
+	}
+
+	if (failedCount > 0)
+		printf("  %u failed, %u skipped: %s\n", failedCount, skippedCount, error.c_str());
+}
+
+ShaderBuildGraph::ShaderBuildGraph()
+{
+}
+
+ShaderBuildGraph::~ShaderBuildGraph()
+{
+}
+
+UINT ShaderBuildGraph::AddNode(std::string name, ShaderBuildNodeType type, std::function<void()> work, const std::vector<UINT>& dependencies, bool mainThread)
+{
+	UINT index = (UINT)nodes.size();
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		if (dependencies[i] >= index)
+			throw std::logic_error("Shader build node " + name + " depends on a node added after it");
+		nodes[dependencies[i]].dependents.push_back(index);
+	}
+
+	nodes.push_back({ name, type, work, dependencies, {}, mainThread });
+	return index;
+}
+
+UINT ShaderBuildGraph::GetNodeCount()
+{
+	return (UINT)nodes.size();
+}
+
+ShaderBuildReport ShaderBuildGraph::Run(UINT workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	ShaderBuildReport report = {};
+	report.threadCount = workerCount + 1;
+	report.nodes.resize(nodes.size());
+
+	std::vector<UINT> remainingInputs(nodes.size());
+	std::vector<UINT8> ready(nodes.size(), 0);
+	std::deque<UINT> workerQueue;
+	std::vector<UINT> mainQueue;
+	size_t nextMainNode = 0;
+	size_t finishedCount = 0;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		report.nodes[i].name = nodes[i].name;
+		report.nodes[i].type = nodes[i].type;
+		remainingInputs[i] = (UINT)nodes[i].dependencies.size();
+		if (nodes[i].mainThread)
+			mainQueue.push_back((UINT)i);
+	}
+
+	auto runStart = std::chrono::high_resolution_clock::now();
+	auto elapsed = [&runStart]()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - runStart).count();
+	};
+
+	//called with the lock held. A failed node skips everything that depends on it, directly or not
+	std::function<void(UINT, bool)> finish = [&](UINT index, bool succeeded)
+	{
+		finishedCount++;
+		for (size_t i = 0; i < nodes[index].dependents.size(); i++)
+		{
+			UINT dependent = nodes[index].dependents[i];
+			if (!succeeded)
+			{
+				if (report.nodes[dependent].skipped)
+					continue;
+				report.nodes[dependent].skipped = true;
+				report.skippedCount++;
+				finish(dependent, false);
+				continue;
+			}
+
+			if (report.nodes[dependent].skipped || --remainingInputs[dependent] > 0)
+				continue;
+
+			ready[dependent] = 1;
+			if (!nodes[dependent].mainThread)
+				workerQueue.push_back(dependent);
+		}
+	};
+
+	auto execute = [&](UINT index, UINT thread)
+	{
+		ShaderBuildTiming& timing = report.nodes[index];
+		timing.thread = thread;
+		timing.start = elapsed();
+
+		bool succeeded = true;
+		std::string error;
+		try
+		{
+			nodes[index].work();
+		}
+		catch (const std::exception& e)
+		{
+			succeeded = false;
+			error = e.what();
+		}
+		catch (...)
+		{
+			succeeded = false;
+			error = "unknown error";
+		}
+		timing.duration = elapsed() - timing.start;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!succeeded)
+		{
+			timing.failed = true;
+			if (report.failedCount++ == 0)
+				report.error = nodes[index].name + ": " + error;
+		}
+		finish(index, succeeded);
+		workAvailable.notify_all();
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (remainingInputs[i] == 0)
+			{
+				ready[i] = 1;
+				if (!nodes[i].mainThread)
+					workerQueue.push_back((UINT)i);
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	for (UINT t = 0; t < workerCount; t++)
+	{
+		workers.push_back(std::thread([&, t]()
+		{
+			while (true)
+			{
+				UINT index;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					workAvailable.wait(lock, [&]() { return !workerQueue.empty() || finishedCount == nodes.size(); });
+					if (workerQueue.empty())
+						return;
+					index = workerQueue.front();
+					workerQueue.pop_front();
+				}
+				execute(index, t + 1);
+			}
+		}));
+	}
+
+	//the calling thread takes the main thread nodes in order, waiting on the inputs of each
+	while (nextMainNode < mainQueue.size())
+	{
+		UINT index = mainQueue[nextMainNode++];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&]() { return ready[index] || report.nodes[index].skipped; });
+			if (report.nodes[index].skipped)
+				continue;
+		}
+		execute(index, 0);
+	}
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	report.totalTime = elapsed();
+
+	//nodes are in dependency order, so one pass finds the longest chain
+	std::vector<double> chain(nodes.size(), 0.0);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		double longestInput = 0.0;
+		for (size_t j = 0; j < nodes[i].dependencies.size(); j++)
+			longestInput = std::max(longestInput, chain[nodes[i].dependencies[j]]);
+		chain[i] = longestInput + report.nodes[i].duration;
+
+		report.serialTime += report.nodes[i].duration;
+		report.criticalPath = std::max(report.criticalPath, chain[i]);
+	}
+
+	return report;
+}
+
+void ValidateShaderBuildGraph()
+{
+	printf("Shader build graph\n");
+	bool passed = true;
+
+	auto sleep = [](UINT milliseconds)
+	{
+		return [milliseconds]() { std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds)); };
+	};
+
+	//ten libraries, five pipelines sharing some of them like the raytracing pipelines share miss, hit and shadow
+	ShaderBuildGraph graph;
+	std::vector<UINT> libraries;
+	for (UINT i = 0; i < 10; i++)
+		libraries.push_back(graph.AddNode("library " + std::to_string(i), SHADER_BUILD_SHADER, sleep(40)));
+
+	std::vector<std::vector<UINT>> pipelineInputs = {
+		{ libraries[0], libraries[1], libraries[2], libraries[3] },
+		{ libraries[4], libraries[5], libraries[6], libraries[3] },
+		{ libraries[7], libraries[5], libraries[6], libraries[3] },
+		{ libraries[8], libraries[5], libraries[6], libraries[3] },
+		{ libraries[9], libraries[5], libraries[6], libraries[3] } };
+
+	std::vector<UINT> order;
+	std::vector<UINT> pipelines;
+	for (UINT i = 0; i < pipelineInputs.size(); i++)
+	{
+		pipelines.push_back(graph.AddNode("pipeline " + std::to_string(i), SHADER_BUILD_PIPELINE, [&order, i]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			order.push_back(i);
+		}, pipelineInputs[i], true));
+	}
+
+	ShaderBuildReport report = graph.Run(4);
+	report.Print();
+
+	bool gated = true;
+	for (size_t i = 0; i < pipelines.size(); i++)
+	{
+		const ShaderBuildTiming& pipeline = report.nodes[pipelines[i]];
+		for (size_t j = 0; j < pipelineInputs[i].size(); j++)
+		{
+			const ShaderBuildTiming& input = report.nodes[pipelineInputs[i][j]];
+			gated = gated && pipeline.start >= input.start + input.duration;
+		}
+		gated = gated && pipeline.thread == 0;
+	}
+	Check(passed, "pipelines wait for their inputs", gated);
+	Check(passed, "main thread nodes keep their order", order == std::vector<UINT>({ 0, 1, 2, 3, 4 }));
+	Check(passed, "compiles overlap", report.totalTime < report.serialTime * 0.6);
+	Check(passed, "critical path within the total", report.criticalPath <= report.totalTime + 1.0);
+
+	//a failed library skips the pipelines using it, the rest still build
+	ShaderBuildGraph failing;
+	UINT good = failing.AddNode("good", SHADER_BUILD_SHADER, sleep(5));
+	UINT bad = failing.AddNode("bad", SHADER_BUILD_SHADER, []() { throw std::logic_error("Failed compile shader"); });
+	UINT goodPipeline = failing.AddNode("good pipeline", SHADER_BUILD_PIPELINE, sleep(1), { good }, true);
+	UINT badPipeline = failing.AddNode("bad pipeline", SHADER_BUILD_PIPELINE, sleep(1), { good, bad }, true);
+	UINT dependent = failing.AddNode("after bad pipeline", SHADER_BUILD_SHADER, sleep(1), { badPipeline });
+
+	ShaderBuildReport failed = failing.Run(2);
+	Check(passed, "failure reported", failed.failedCount == 1 && failed.error.find("bad") == 0);
+	Check(passed, "dependents skipped", failed.skippedCount == 2 && failed.nodes[badPipeline].skipped && failed.nodes[dependent].skipped);
+	Check(passed, "independent nodes built", !failed.nodes[goodPipeline].skipped && !failed.nodes[goodPipeline].failed);
+
+	//the smallest pool, one worker next to the calling thread
+	ShaderBuildGraph single;
+	UINT first = single.AddNode("first", SHADER_BUILD_SHADER, sleep(1));
+	single.AddNode("second", SHADER_BUILD_PIPELINE, sleep(1), { first }, true);
+	ShaderBuildReport singleReport = single.Run(1);
+	Check(passed, "one worker finishes", singleReport.failedCount == 0 && singleReport.threadCount == 2);
+
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include<Windows.h>
+#include<functional>
+#include<string>
+#include<vector>
+
+enum ShaderBuildNodeType
+{
+	SHADER_BUILD_SHADER,
+	SHADER_BUILD_PIPELINE
+};
+
+struct ShaderBuildTiming
+{
+	std::string name;
+	ShaderBuildNodeType type;
+
+	//milliseconds since the start of the run
+	double start;
+	double duration;
+	//0 is the thread that called Run
+	UINT thread;
+
+	bool failed;
+	//not run because an input failed
+	bool skipped;
+};
+
+struct ShaderBuildReport
+{
+	std::vector<ShaderBuildTiming> nodes;
+	UINT threadCount;
+
+	double totalTime;
+	//sum of every node, what running them one after another would have taken
+	double serialTime;
+	//longest chain of dependent nodes, the least the run could take
+	double criticalPath;
+
+	UINT failedCount;
+	UINT skippedCount;
+	//message of the first failure
+	std::string error;
+
+	void Print();
+};
+
+//every shader and pipeline the engine needs, with the inputs of each. Independent nodes run on worker threads, a node
+//starts once all of its inputs are done
+class ShaderBuildGraph
+{
+	struct Node
+	{
+		std::string name;
+		ShaderBuildNodeType type;
+		std::function<void()> work;
+		std::vector<UINT> dependencies;
+		std::vector<UINT> dependents;
+		bool mainThread;
+	};
+
+	std::vector<Node> nodes;
+
+public:
+	ShaderBuildGraph();
+	~ShaderBuildGraph();
+
+	//dependencies have to be added first. Main thread nodes run in the order they were added, so nodes writing the
+	//same state keep the order of the code they replaced
+	UINT AddNode(std::string name, ShaderBuildNodeType type, std::function<void()> work, const std::vector<UINT>& dependencies = {}, bool mainThread = false);
+	UINT GetNodeCount();
+
+	//0 workers uses one per core but one. A node that throws fails its dependents, the others still run
+	ShaderBuildReport Run(UINT workerCount = 0);
+};
+
+//graph shaped like the raytracing startup, with compiles that sleep instead of calling dxc
+void ValidateShaderBuildGraph();
@@ -0,0 +1,524 @@
+#include "ShaderLibraryCache.h"
+#include"Validation.h"
+#include "DXRHelper.h"
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<set>
+#include<sstream>
+#include<thread>
+
+//bump when the entry layout or the key changes, old entries then stop matching
+static const UINT CacheVersion = 1;
+static const UINT CacheMagic = 0x43424C53;
+
+struct ShaderCacheEntryHeader
+{
+	UINT magic;
+	UINT version;
+	UINT64 key;
+	double compileTime;
+	UINT64 size;
+};
+
+//fnv-1a
+static UINT64 HashBytes(UINT64 hash, const void* data, size_t size)
+{
+	const BYTE* bytes = static_cast<const BYTE*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+static UINT64 HashString(UINT64 hash, const std::string& value)
+{
+	UINT64 size = value.size();
+	hash = HashBytes(hash, &size, sizeof(UINT64));
+	return HashBytes(hash, value.data(), value.size());
+}
+
+static UINT64 HashString(UINT64 hash, const std::wstring& value)
+{
+	UINT64 size = value.size();
+	hash = HashBytes(hash, &size, sizeof(UINT64));
+	return HashBytes(hash, value.data(), value.size() * sizeof(wchar_t));
+}
+
+static const UINT64 HashSeed = 0xCBF29CE484222325ull;
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+ShaderLibraryCache::ShaderLibraryCache(std::filesystem::path cacheDirectory, ShaderLibraryCompiler compiler, ShaderSourceReader reader)
+	: cacheDirectory(cacheDirectory), compiler(compiler), reader(reader), stats({})
+{
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+}
+
+ShaderLibraryCache::~ShaderLibraryCache()
+{
+}
+
+void ShaderLibraryCache::AddIncludeDirectory(std::filesystem::path directory)
+{
+	includeDirectories.push_back(directory);
+}
+
+bool ShaderLibraryCache::ReadShaderSource(const std::filesystem::path& fileName, std::string& contents)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.good())
+		return false;
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	contents = stream.str();
+	return true;
+}
+
+std::vector<std::string> ShaderLibraryCache::ParseIncludes(const std::string& source)
+{
+	std::vector<std::string> includes;
+	size_t lineStart = 0;
+	while (lineStart < source.size())
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = source.size();
+
+		size_t i = source.find_first_not_of(" \t", lineStart);
+		if (i < lineEnd && source[i] == '#')
+		{
+			i = source.find_first_not_of(" \t", i + 1);
+			if (i < lineEnd && source.compare(i, 7, "include") == 0)
+			{
+				size_t open = source.find_first_of("\"<", i + 7);
+				if (open < lineEnd)
+				{
+					size_t close = source.find(source[open] == '"' ? '"' : '>', open + 1);
+					if (close < lineEnd)
+						includes.push_back(source.substr(open + 1, close - open - 1));
+				}
+			}
+		}
+
+		lineStart = lineEnd + 1;
+	}
+	return includes;
+}
+
+bool ShaderLibraryCache::ResolveInclude(const std::filesystem::path& includingFile, const std::string& include, std::filesystem::path& resolved, std::string& contents)
+{
+	resolved = (includingFile.parent_path() / include).lexically_normal();
+	if (reader(resolved, contents))
+		return true;
+
+	for (size_t i = 0; i < includeDirectories.size(); i++)
+	{
+		resolved = (includeDirectories[i] / include).lexically_normal();
+		if (reader(resolved, contents))
+			return true;
+	}
+	return false;
+}
+
+ShaderSourceHash ShaderLibraryCache::HashSource(const std::filesystem::path& fileName)
+{
+	ShaderSourceHash result = { HashSeed };
+
+	std::filesystem::path root = fileName.lexically_normal();
+	std::string contents;
+	if (!reader(root, contents))
+		throw std::logic_error("Cannot find shader file " + root.string());
+
+	//depth first over the includes, every file hashed once so include guards and cycles don't matter
+	std::set<std::filesystem::path> visited = { root };
+	std::vector<std::pair<std::filesystem::path, std::string>> stack = { { root, contents } };
+	while (!stack.empty())
+	{
+		std::filesystem::path file = stack.back().first;
+		std::string source = std::move(stack.back().second);
+		stack.pop_back();
+
+		result.files.push_back(file);
+		result.hash = HashString(result.hash, file.generic_wstring());
+		result.hash = HashString(result.hash, source);
+
+		std::vector<std::string> includes = ParseIncludes(source);
+		for (size_t i = includes.size(); i-- > 0;)
+		{
+			std::filesystem::path resolved;
+			std::string includeSource;
+			if (!ResolveInclude(file, includes[i], resolved, includeSource))
+			{
+				//left to the compiler to report, the name still goes in the hash
+				result.hash = HashString(result.hash, includes[i]);
+				continue;
+			}
+
+			if (visited.insert(resolved).second)
+				stack.push_back({ resolved, std::move(includeSource) });
+		}
+	}
+
+	return result;
+}
+
+UINT64 ShaderLibraryCache::ComputeKey(const ShaderLibraryDesc& desc, ShaderSourceHash* sourceHash)
+{
+	ShaderSourceHash source = HashSource(desc.fileName);
+
+	UINT64 key = HashBytes(HashSeed, &CacheVersion, sizeof(UINT));
+	key = HashBytes(key, &source.hash, sizeof(UINT64));
+	key = HashString(key, desc.profile);
+	key = HashString(key, desc.entryPoint);
+
+	//the order defines are given in doesn't change the result
+	std::vector<ShaderDefine> defines = desc.defines;
+	std::sort(defines.begin(), defines.end(), [](const ShaderDefine& a, const ShaderDefine& b) { return a.name < b.name; });
+	for (size_t i = 0; i < defines.size(); i++)
+	{
+		key = HashString(key, defines[i].name);
+		key = HashString(key, defines[i].value);
+	}
+
+	if (sourceHash)
+		*sourceHash = std::move(source);
+	return key;
+}
+
+std::wstring ShaderLibraryCache::GetDescName(const ShaderLibraryDesc& desc)
+{
+	std::wstring name = desc.fileName.lexically_normal().generic_wstring() + L"|" + desc.profile + L"|" + desc.entryPoint;
+	for (size_t i = 0; i < desc.defines.size(); i++)
+		name += L"|" + desc.defines[i].name + L"=" + desc.defines[i].value;
+	return name;
+}
+
+std::filesystem::path ShaderLibraryCache::GetEntryPath(UINT64 key)
+{
+	char name[32];
+	sprintf_s(name, "%016llx.dxil", (unsigned long long)key);
+	return cacheDirectory / name;
+}
+
+bool ShaderLibraryCache::ReadEntry(UINT64 key, ShaderBytecode& bytecode, double& compileTime)
+{
+	std::ifstream file(GetEntryPath(key), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	ShaderCacheEntryHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(ShaderCacheEntryHeader));
+	if (!file.good() || header.magic != CacheMagic || header.version != CacheVersion || header.key != key)
+		return false;
+
+	bytecode.resize(header.size);
+	file.read(reinterpret_cast<char*>(bytecode.data()), header.size);
+	if (!file.good())
+		return false;
+
+	compileTime = header.compileTime;
+	return true;
+}
+
+void ShaderLibraryCache::WriteEntry(UINT64 key, const ShaderBytecode& bytecode, double compileTime)
+{
+	//written next to the entry and renamed, a run stopped halfway doesn't leave a broken entry
+	std::filesystem::path path = GetEntryPath(key);
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += L".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary);
+		if (!file.is_open())
+			return;
+
+		ShaderCacheEntryHeader header = { CacheMagic, CacheVersion, key, compileTime, bytecode.size() };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ShaderCacheEntryHeader));
+		file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+		if (!file.good())
+			return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+		std::filesystem::remove(temporaryPath, error);
+}
+
+std::shared_ptr<const ShaderBytecode> ShaderLibraryCache::Get(const ShaderLibraryDesc& desc)
+{
+	std::wstring name = GetDescName(desc);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.requests++;
+
+		auto found = entries.find(name);
+		if (found != entries.end())
+		{
+			stats.memoryHits++;
+			stats.timeSaved += found->second.compileTime;
+			return found->second.bytecode;
+		}
+	}
+
+	//hashing, loading and compiling happen outside the lock so libraries can be compiled on several threads
+	ShaderSourceHash source;
+	UINT64 key = ComputeKey(desc, &source);
+
+	Entry entry = { key, nullptr, source.files, 0.0 };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = entriesByKey.find(key);
+		if (found != entriesByKey.end())
+		{
+			entry.bytecode = found->second.bytecode;
+			entry.compileTime = found->second.compileTime;
+			entries[name] = entry;
+
+			stats.memoryHits++;
+			stats.timeSaved += entry.compileTime;
+			return entry.bytecode;
+		}
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto bytecode = std::make_shared<ShaderBytecode>();
+	bool loaded = ReadEntry(key, *bytecode, entry.compileTime);
+	double elapsed = MillisecondsSince(start);
+
+	if (!loaded)
+	{
+		std::string contents;
+		if (!reader(desc.fileName.lexically_normal(), contents))
+			throw std::logic_error("Cannot find shader file " + desc.fileName.string());
+
+		std::string errors;
+		start = std::chrono::high_resolution_clock::now();
+		if (!compiler(desc, contents, *bytecode, errors))
+			throw std::logic_error("Failed compile shader " + desc.fileName.string() + "\n" + errors);
+		entry.compileTime = MillisecondsSince(start);
+
+		WriteEntry(key, *bytecode, entry.compileTime);
+	}
+	entry.bytecode = bytecode;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (loaded)
+	{
+		stats.diskHits++;
+		stats.loadTime += elapsed;
+		stats.timeSaved += std::max(entry.compileTime - elapsed, 0.0);
+	}
+	else
+	{
+		stats.compiles++;
+		stats.compileTime += entry.compileTime;
+	}
+
+	entries[name] = entry;
+	entriesByKey[key] = entry;
+	return entry.bytecode;
+}
+
+UINT ShaderLibraryCache::Invalidate(const std::filesystem::path& fileName)
+{
+	std::filesystem::path path = fileName.lexically_normal();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto usesFile = [&path](const Entry& entry)
+	{
+		return std::find(entry.files.begin(), entry.files.end(), path) != entry.files.end();
+	};
+
+	UINT count = 0;
+	for (auto i = entries.begin(); i != entries.end();)
+	{
+		if (usesFile(i->second))
+		{
+			i = entries.erase(i);
+			count++;
+		}
+		else
+			i++;
+	}
+
+	for (auto i = entriesByKey.begin(); i != entriesByKey.end();)
+	{
+		if (usesFile(i->second))
+			i = entriesByKey.erase(i);
+		else
+			i++;
+	}
+
+	return count;
+}
+
+const ShaderCacheStats& ShaderLibraryCache::GetStats()
+{
+	return stats;
+}
+
+bool CompileShaderLibraryDXC(const ShaderLibraryDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors)
+{
+	//one compiler per thread, dxc instances aren't meant to be shared between threads
+	thread_local ComPtr<IDxcCompiler> compiler;
+	thread_local ComPtr<IDxcLibrary> library;
+	thread_local ComPtr<IDxcIncludeHandler> includeHandler;
+
+	if (!compiler)
+	{
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler), (void**)&compiler));
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, __uuidof(IDxcLibrary), (void**)&library));
+		ThrowIfFailed(library->CreateIncludeHandler(&includeHandler));
+	}
+
+	ComPtr<IDxcBlobEncoding> textBlob;
+	ThrowIfFailed(library->CreateBlobWithEncodingFromPinned((LPBYTE)source.c_str(), (UINT32)source.size(), 0, &textBlob));
+
+	std::vector<DxcDefine> defines(desc.defines.size());
+	for (size_t i = 0; i < desc.defines.size(); i++)
+		defines[i] = { desc.defines[i].name.c_str(), desc.defines[i].value.c_str() };
+
+	std::wstring fileName = desc.fileName.wstring();
+	ComPtr<IDxcOperationResult> result;
+	ThrowIfFailed(compiler->Compile(textBlob.Get(), fileName.c_str(), desc.entryPoint.c_str(), desc.profile.c_str(), nullptr, 0,
+		defines.data(), (UINT32)defines.size(), includeHandler.Get(), &result));
+
+	HRESULT status;
+	ThrowIfFailed(result->GetStatus(&status));
+	if (FAILED(status))
+	{
+		ComPtr<IDxcBlobEncoding> errorBlob;
+		if (SUCCEEDED(result->GetErrorBuffer(&errorBlob)) && errorBlob)
+			errors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+
+		std::string message = "Shader Compiler Error:\n" + errors;
+		MessageBoxA(nullptr, message.c_str(), "Error!", MB_OK);
+		return false;
+	}
+
+	ComPtr<IDxcBlob> blob;
+	ThrowIfFailed(result->GetResult(&blob));
+	const BYTE* data = static_cast<const BYTE*>(blob->GetBufferPointer());
+	bytecode.assign(data, data + blob->GetBufferSize());
+	return true;
+}
+
+ComPtr<IDxcBlob> CreateShaderLibraryBlob(const ShaderBytecode& bytecode)
+{
+	static ComPtr<IDxcLibrary> library;
+	if (!library)
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, __uuidof(IDxcLibrary), (void**)&library));
+
+	ComPtr<IDxcBlobEncoding> blob;
+	ThrowIfFailed(library->CreateBlobWithEncodingOnHeapCopy(bytecode.data(), (UINT32)bytecode.size(), 0, &blob));
+	return blob;
+}
+
+void ValidateShaderLibraryCache()
+{
+	std::unordered_map<std::wstring, std::string> files;
+	files[L"Shaders/RayGen.hlsl"] = "#include \"Common.hlsl\"\n[shader(\"raygeneration\")] void RayGen() {}\n";
+	files[L"Shaders/Common.hlsl"] = "#pragma once\n#include \"Lighting/BRDF.hlsl\"\n#include <Random.hlsl>\n";
+	files[L"Shaders/Lighting/BRDF.hlsl"] = "#include \"../Common.hlsl\"\nfloat D() { return 1; }\n";
+	files[L"Includes/Random.hlsl"] = "float Random() { return 0.5; }\n";
+	files[L"Shaders/Miss.hlsl"] = "  #  include \"Common.hlsl\"\n//#include \"Missing.hlsl\"\n[shader(\"miss\")] void Miss() {}\n";
+
+	ShaderSourceReader reader = [&files](const std::filesystem::path& fileName, std::string& contents)
+	{
+		auto found = files.find(fileName.generic_wstring());
+		if (found == files.end())
+			return false;
+		contents = found->second;
+		return true;
+	};
+
+	//the output is the hash of the source, each compile takes 20ms
+	UINT compileCount = 0;
+	ShaderLibraryCompiler compiler = [&compileCount](const ShaderLibraryDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors)
+	{
+		compileCount++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		UINT64 hash = HashString(HashSeed, source);
+		bytecode.assign(reinterpret_cast<const BYTE*>(&hash), reinterpret_cast<const BYTE*>(&hash) + sizeof(UINT64));
+		return true;
+	};
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderLibraryCacheValidation";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	printf("Shader library cache\n");
+	bool passed = true;
+
+	ShaderLibraryDesc rayGen = {};
+	rayGen.fileName = L"Shaders/RayGen.hlsl";
+	ShaderLibraryDesc miss = {};
+	miss.fileName = L"Shaders/Miss.hlsl";
+
+	{
+		ShaderLibraryCache cache(directory, compiler, reader);
+		cache.AddIncludeDirectory(L"Includes");
+
+		ShaderSourceHash source = cache.HashSource(rayGen.fileName);
+		Check(passed, "transitive includes found once", source.files.size() == 4);
+		Check(passed, "commented include ignored", cache.HashSource(miss.fileName).files.size() == 4);
+
+		auto first = cache.Get(rayGen);
+		auto second = cache.Get(rayGen);
+		Check(passed, "second request from memory", compileCount == 1 && first == second && cache.GetStats().memoryHits == 1);
+
+		ShaderLibraryDesc defined = rayGen;
+		defined.defines = { { L"A", L"1" }, { L"B", L"2" } };
+		ShaderLibraryDesc reordered = rayGen;
+		reordered.defines = { { L"B", L"2" }, { L"A", L"1" } };
+		UINT64 definedKey = cache.ComputeKey(defined);
+		Check(passed, "defines change the key", definedKey != cache.ComputeKey(rayGen));
+		Check(passed, "define order doesn't", definedKey == cache.ComputeKey(reordered));
+
+		ShaderLibraryDesc profile = rayGen;
+		profile.profile = L"lib_6_5";
+		Check(passed, "profile changes the key", cache.ComputeKey(profile) != cache.ComputeKey(rayGen));
+
+		cache.Get(miss);
+		Check(passed, "first run compiles", compileCount == 2 && cache.GetStats().compiles == 2);
+	}
+
+	{
+		ShaderLibraryCache cache(directory, compiler, reader);
+		cache.AddIncludeDirectory(L"Includes");
+
+		cache.Get(rayGen);
+		cache.Get(miss);
+		const ShaderCacheStats& stats = cache.GetStats();
+		Check(passed, "second run loads from disk", compileCount == 2 && stats.diskHits == 2);
+		Check(passed, "saved time reported", stats.timeSaved > 30.0);
+		printf("    %.1fms saved, %.2fms loading\n", stats.timeSaved, stats.loadTime);
+
+		UINT64 oldKey = cache.ComputeKey(rayGen);
+		files[L"Includes/Random.hlsl"] = "float Random() { return 0.25; }\n";
+		Check(passed, "nested include changes the key", cache.ComputeKey(rayGen) != oldKey);
+
+		UINT dropped = cache.Invalidate(L"Includes/Random.hlsl");
+		Check(passed, "invalidation drops both users", dropped == 2);
+
+		//the library source itself is unchanged, so the bytes don't change, only that it was compiled again
+		cache.Get(rayGen);
+		Check(passed, "recompiled after invalidation", compileCount == 3);
+
+		files[L"Shaders/RayGen.hlsl"] = "#include \"Missing.hlsl\"\n";
+		UINT64 missingKey = cache.ComputeKey(rayGen);
+		files[L"Shaders/RayGen.hlsl"] = "#include \"Absent.hlsl\"\n";
+		Check(passed, "unresolved include names hashed", cache.ComputeKey(rayGen) != missingKey);
+	}
+
+	std::filesystem::remove_all(directory, error);
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<filesystem>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+struct IDxcBlob;
+
+struct ShaderDefine
+{
+	std::wstring name;
+	std::wstring value;
+};
+
+struct ShaderLibraryDesc
+{
+	std::filesystem::path fileName;
+	std::wstring profile = L"lib_6_3";
+	//empty for libraries
+	std::wstring entryPoint;
+	std::vector<ShaderDefine> defines;
+};
+
+typedef std::vector<BYTE> ShaderBytecode;
+
+typedef std::function<bool(const std::filesystem::path& fileName, std::string& contents)> ShaderSourceReader;
+
+//returns false and fills errors when the source doesn't compile
+typedef std::function<bool(const ShaderLibraryDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors)> ShaderLibraryCompiler;
+
+//a source file and everything it includes, directly or not
+struct ShaderSourceHash
+{
+	UINT64 hash;
+	std::vector<std::filesystem::path> files;
+};
+
+struct ShaderCacheStats
+{
+	UINT requests;
+	UINT memoryHits;
+	UINT diskHits;
+	UINT compiles;
+
+	//milliseconds
+	double compileTime;
+	double loadTime;
+	//what the hits would have cost to compile, less what loading them cost
+	double timeSaved;
+};
+
+//compiled shaders on disk, addressed by a hash of the source, every file it includes, the defines and the profile.
+//A library asked for again in the same run comes from memory, so pipelines sharing one only compile it once
+class ShaderLibraryCache
+{
+	struct Entry
+	{
+		UINT64 key;
+		std::shared_ptr<const ShaderBytecode> bytecode;
+		std::vector<std::filesystem::path> files;
+		double compileTime;
+	};
+
+	std::filesystem::path cacheDirectory;
+	std::vector<std::filesystem::path> includeDirectories;
+	ShaderLibraryCompiler compiler;
+	ShaderSourceReader reader;
+
+	//by the desc the library was asked for with, and by key so different descs with the same result share it
+	std::unordered_map<std::wstring, Entry> entries;
+	std::unordered_map<UINT64, Entry> entriesByKey;
+	std::mutex mutex;
+
+	ShaderCacheStats stats;
+
+	static std::wstring GetDescName(const ShaderLibraryDesc& desc);
+	std::filesystem::path GetEntryPath(UINT64 key);
+	bool ReadEntry(UINT64 key, ShaderBytecode& bytecode, double& compileTime);
+	void WriteEntry(UINT64 key, const ShaderBytecode& bytecode, double compileTime);
+	bool ResolveInclude(const std::filesystem::path& includingFile, const std::string& include, std::filesystem::path& resolved, std::string& contents);
+
+public:
+	ShaderLibraryCache(std::filesystem::path cacheDirectory, ShaderLibraryCompiler compiler, ShaderSourceReader reader = ReadShaderSource);
+	~ShaderLibraryCache();
+
+	//searched after the directory of the including file
+	void AddIncludeDirectory(std::filesystem::path directory);
+
+	ShaderSourceHash HashSource(const std::filesystem::path& fileName);
+	UINT64 ComputeKey(const ShaderLibraryDesc& desc, ShaderSourceHash* sourceHash = nullptr);
+
+	//throws with the compiler errors if the library doesn't compile
+	std::shared_ptr<const ShaderBytecode> Get(const ShaderLibraryDesc& desc);
+
+	//forgets every library that uses the file, the next Get hashes their sources again. Returns how many were dropped
+	UINT Invalidate(const std::filesystem::path& fileName);
+
+	const ShaderCacheStats& GetStats();
+
+	static bool ReadShaderSource(const std::filesystem::path& fileName, std::string& contents);
+	static std::vector<std::string> ParseIncludes(const std::string& source);
+};
+
+//compiles with dxc, shows the errors in a message box like CompileShaderLibrary
+bool CompileShaderLibraryDXC(const ShaderLibraryDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors);
+ComPtr<IDxcBlob> CreateShaderLibraryBlob(const ShaderBytecode& bytecode);
+
+//hashing, invalidation and the disk round trip against sources in memory and a compiler that counts its calls
+void ValidateShaderLibraryCache();
@@ -0,0 +1,303 @@
+#include "ShaderWatcher.h"
+#include"Validation.h"
+#include "ShaderLibraryCache.h"
+#include<algorithm>
+#include<chrono>
+#include<cwctype>
+#include<thread>
+
+struct ShaderDirectoryWatch
+{
+	std::filesystem::path directory;
+	HANDLE handle;
+	HANDLE stopEvent;
+	std::thread thread;
+};
+
+ShaderWatcher::ShaderWatcher(double debounceTime)
+	: debounceTime(debounceTime), lastChangeTime(0.0)
+{
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	for (size_t i = 0; i < watches.size(); i++)
+	{
+		SetEvent(watches[i]->stopEvent);
+		watches[i]->thread.join();
+		CloseHandle(watches[i]->stopEvent);
+		CloseHandle(watches[i]->handle);
+	}
+}
+
+double ShaderWatcher::Now()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::wstring ShaderWatcher::GetFileKey(const std::filesystem::path& fileName)
+{
+	//the file system is case insensitive and the code doesn't always match the case of the file names
+	std::wstring key = fileName.lexically_normal().generic_wstring();
+	std::transform(key.begin(), key.end(), key.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+	return key;
+}
+
+bool ShaderWatcher::WatchDirectory(const std::filesystem::path& directory)
+{
+	HANDLE handle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	auto watch = std::make_unique<ShaderDirectoryWatch>();
+	watch->directory = directory;
+	watch->handle = handle;
+	watch->stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	watch->thread = std::thread(&ShaderWatcher::Watch, this, watch.get());
+	watches.emplace_back(std::move(watch));
+	return true;
+}
+
+void ShaderWatcher::Watch(ShaderDirectoryWatch* watch)
+{
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	alignas(DWORD) BYTE buffer[16384];
+
+	while (true)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (!ReadDirectoryChangesW(watch->handle, buffer, sizeof(buffer), TRUE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+			nullptr, &overlapped, nullptr))
+			break;
+
+		HANDLE events[] = { overlapped.hEvent, watch->stopEvent };
+		DWORD bytes = 0;
+		if (WaitForMultipleObjects(_countof(events), events, FALSE, INFINITE) != WAIT_OBJECT_0)
+		{
+			CancelIoEx(watch->handle, &overlapped);
+			GetOverlappedResult(watch->handle, &overlapped, &bytes, TRUE);
+			break;
+		}
+
+		if (!GetOverlappedResult(watch->handle, &overlapped, &bytes, FALSE))
+			break;
+
+		double time = Now();
+
+		//the buffer overflowed, anything could have changed
+		if (bytes == 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto i = fileTargets.begin(); i != fileTargets.end(); i++)
+				pendingFiles.insert(i->first);
+			lastChangeTime = time;
+			continue;
+		}
+
+		BYTE* entry = buffer;
+		while (true)
+		{
+			FILE_NOTIFY_INFORMATION* info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(entry);
+			std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+			OnFileChanged(watch->directory / name, time);
+
+			if (info->NextEntryOffset == 0)
+				break;
+			entry += info->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+
+void ShaderWatcher::SetDependencies(const std::filesystem::path& target, const std::vector<std::filesystem::path>& files)
+{
+	RemoveTarget(target);
+
+	std::wstring key = GetFileKey(target);
+	std::lock_guard<std::mutex> lock(mutex);
+	targets[key] = target;
+
+	std::set<std::wstring>& dependencies = targetFiles[key];
+	dependencies.insert(key);
+	for (size_t i = 0; i < files.size(); i++)
+		dependencies.insert(GetFileKey(files[i]));
+
+	for (auto i = dependencies.begin(); i != dependencies.end(); i++)
+		fileTargets[*i].insert(key);
+}
+
+void ShaderWatcher::RemoveTarget(const std::filesystem::path& target)
+{
+	std::wstring key = GetFileKey(target);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = targetFiles.find(key);
+	if (found == targetFiles.end())
+		return;
+
+	for (auto i = found->second.begin(); i != found->second.end(); i++)
+	{
+		auto users = fileTargets.find(*i);
+		users->second.erase(key);
+		if (users->second.empty())
+			fileTargets.erase(users);
+	}
+
+	targetFiles.erase(found);
+	targets.erase(key);
+}
+
+void ShaderWatcher::OnFileChanged(const std::filesystem::path& fileName, double time)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pendingFiles.insert(GetFileKey(fileName));
+	lastChangeTime = std::max(lastChangeTime, time);
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::Poll(double time)
+{
+	std::set<std::wstring> changed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pendingFiles.empty() || time - lastChangeTime < debounceTime)
+			return {};
+
+		changed.swap(pendingFiles);
+	}
+
+	std::vector<std::filesystem::path> files(changed.begin(), changed.end());
+	return GetAffectedTargets(files);
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::Poll()
+{
+	return Poll(Now());
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::GetAffectedTargets(const std::vector<std::filesystem::path>& files)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::set<std::wstring> affected;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		auto found = fileTargets.find(GetFileKey(files[i]));
+		if (found != fileTargets.end())
+			affected.insert(found->second.begin(), found->second.end());
+	}
+
+	std::vector<std::filesystem::path> result;
+	for (auto i = affected.begin(); i != affected.end(); i++)
+		result.push_back(targets[*i]);
+	return result;
+}
+
+void ValidateShaderWatcher()
+{
+	printf("Shader watcher\n");
+	bool passed = true;
+
+	typedef std::vector<std::filesystem::path> Paths;
+	auto same = [](Paths a, Paths b)
+	{
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		return a == b;
+	};
+
+	{
+		ShaderWatcher watcher(250.0);
+		watcher.SetDependencies(L"../../RayGen.hlsl", { L"../../RayGen.hlsl", L"../../Common.hlsl", L"../../RayGenIncludes.hlsli" });
+		watcher.SetDependencies(L"../../Hit.hlsl", { L"../../Hit.hlsl", L"../../Common.hlsl", L"../../HitGroupIncludes.hlsli" });
+		watcher.SetDependencies(L"../../Miss.hlsl", { L"../../Miss.hlsl" });
+
+		watcher.OnFileChanged(L"../../Common.hlsl", 0.0);
+		Check(passed, "nothing before the debounce time", watcher.Poll(100.0).empty());
+		Check(passed, "shared include rebuilds its users", same(watcher.Poll(260.0), { L"../../RayGen.hlsl", L"../../Hit.hlsl" }));
+		Check(passed, "changes taken once", watcher.Poll(300.0).empty());
+
+		//one save written in several steps
+		watcher.OnFileChanged(L"../../Hit.hlsl", 1000.0);
+		watcher.OnFileChanged(L"../../Hit.hlsl", 1200.0);
+		watcher.OnFileChanged(L"../../Hit.hlsl", 1400.0);
+		Check(passed, "burst waits for the last write", watcher.Poll(1500.0).empty());
+		Check(passed, "burst rebuilds once", same(watcher.Poll(1660.0), { L"../../Hit.hlsl" }));
+
+		watcher.OnFileChanged(L"../../Shaders/../MISS.hlsl", 2000.0);
+		Check(passed, "paths and case normalized", same(watcher.Poll(2300.0), { L"../../Miss.hlsl" }));
+
+		watcher.OnFileChanged(L"../../PixelShader.hlsl", 3000.0);
+		watcher.OnFileChanged(L"../../Assets/notes.txt", 3000.0);
+		Check(passed, "unrelated files ignored", watcher.Poll(3300.0).empty());
+
+		//raygen stopped including common
+		watcher.SetDependencies(L"../../RayGen.hlsl", { L"../../RayGen.hlsl", L"../../RayGenIncludes.hlsli" });
+		Check(passed, "dependencies replaced", same(watcher.GetAffectedTargets({ L"../../Common.hlsl" }), { L"../../Hit.hlsl" }));
+	}
+
+	//the same through the library cache, only what the change affects compiles again
+	std::unordered_map<std::wstring, std::string> files;
+	files[L"Shaders/RayGen.hlsl"] = "#include \"RayGenIncludes.hlsli\"\n";
+	files[L"Shaders/RayGenIncludes.hlsli"] = "#include \"Common.hlsl\"\n";
+	files[L"Shaders/Hit.hlsl"] = "#include \"Common.hlsl\"\n";
+	files[L"Shaders/Miss.hlsl"] = "float4 Miss() { return 0; }\n";
+	files[L"Shaders/Common.hlsl"] = "float Pi() { return 3.14; }\n";
+
+	ShaderSourceReader reader = [&files](const std::filesystem::path& fileName, std::string& contents)
+	{
+		auto found = files.find(fileName.generic_wstring());
+		if (found == files.end())
+			return false;
+		contents = found->second;
+		return true;
+	};
+
+	std::vector<std::wstring> compiled;
+	ShaderLibraryCompiler compiler = [&compiled](const ShaderLibraryDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors)
+	{
+		compiled.push_back(desc.fileName.generic_wstring());
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		bytecode.assign(source.begin(), source.end());
+		return true;
+	};
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderWatcherValidation";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	{
+		ShaderLibraryCache cache(directory, compiler, reader);
+		ShaderWatcher watcher(250.0);
+
+		Paths libraries = { L"Shaders/RayGen.hlsl", L"Shaders/Hit.hlsl", L"Shaders/Miss.hlsl" };
+		for (size_t i = 0; i < libraries.size(); i++)
+		{
+			ShaderLibraryDesc desc = {};
+			desc.fileName = libraries[i];
+			cache.Get(desc);
+			watcher.SetDependencies(libraries[i], cache.HashSource(libraries[i]).files);
+		}
+		compiled.clear();
+
+		files[L"Shaders/Common.hlsl"] = "float Pi() { return 3.14159; }\n";
+		watcher.OnFileChanged(L"Shaders/Common.hlsl", 0.0);
+
+		Paths reload = watcher.Poll(300.0);
+		for (size_t i = 0; i < reload.size(); i++)
+		{
+			cache.Invalidate(reload[i]);
+			ShaderLibraryDesc desc = {};
+			desc.fileName = reload[i];
+			cache.Get(desc);
+		}
+
+		std::sort(compiled.begin(), compiled.end());
+		Check(passed, "nested include recompiles its users only", compiled == std::vector<std::wstring>({ L"Shaders/Hit.hlsl", L"Shaders/RayGen.hlsl" }));
+	}
+
+	std::filesystem::remove_all(directory, error);
+	PrintValidationResult(passed);
+}
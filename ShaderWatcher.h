@@ -0,0 +1,61 @@
+#pragma once
+
+#include<Windows.h>
+#include<filesystem>
+#include<memory>
+#include<mutex>
+#include<set>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+struct ShaderDirectoryWatch;
+
+//watches the shader directories and tells which targets to rebuild once the files stop changing. Targets are whatever
+//the caller builds from the files, shader libraries here, and depend on every file they include
+class ShaderWatcher
+{
+	//milliseconds without a change before the pending files are taken, editors write a file more than once per save
+	double debounceTime;
+
+	//keys are normalized paths, see GetFileKey
+	std::unordered_map<std::wstring, std::filesystem::path> targets;
+	std::unordered_map<std::wstring, std::set<std::wstring>> targetFiles;
+	std::unordered_map<std::wstring, std::set<std::wstring>> fileTargets;
+
+	//filled by the directory threads
+	std::mutex mutex;
+	std::set<std::wstring> pendingFiles;
+	double lastChangeTime;
+
+	std::vector<std::unique_ptr<ShaderDirectoryWatch>> watches;
+
+	void Watch(ShaderDirectoryWatch* watch);
+
+public:
+	ShaderWatcher(double debounceTime = 250.0);
+	~ShaderWatcher();
+
+	//starts a thread reporting every write under the directory, false if it can't be opened
+	bool WatchDirectory(const std::filesystem::path& directory);
+
+	//replaces the files the target was built from
+	void SetDependencies(const std::filesystem::path& target, const std::vector<std::filesystem::path>& files);
+	void RemoveTarget(const std::filesystem::path& target);
+
+	void OnFileChanged(const std::filesystem::path& fileName, double time);
+
+	//the targets using the files that changed, once nothing changed for the debounce time. Empty until then
+	std::vector<std::filesystem::path> Poll(double time);
+	std::vector<std::filesystem::path> Poll();
+
+	std::vector<std::filesystem::path> GetAffectedTargets(const std::vector<std::filesystem::path>& files);
+
+	//milliseconds on the clock events are stamped with
+	static double Now();
+	static std::wstring GetFileKey(const std::filesystem::path& fileName);
+};
+
+//dependency tracking and debounce against made up events, then a reload of what they affect through a library cache
+//with sources in memory and a compiler that counts its calls
+void ValidateShaderWatcher();
@@ -0,0 +1,196 @@
+#include "SimulationClock.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cmath>
+
+SimulationClock::SimulationClock(float maxFrameTime)
+{
+	this->maxFrameTime = maxFrameTime;
+}
+
+SimulationClock::~SimulationClock()
+{
+}
+
+UINT SimulationClock::AddSystem(std::string name, float tickRate, SimulationTick tick, UINT maxStepsPerFrame)
+{
+	SimulationSystem system = {};
+	system.name = name;
+	system.stepTime = 1.0f / tickRate;
+	system.maxStepsPerFrame = maxStepsPerFrame;
+	system.tick = tick;
+
+	systems.emplace_back(system);
+	return (UINT)systems.size() - 1;
+}
+
+void SimulationClock::SetTickRate(UINT index, float tickRate)
+{
+	systems[index].stepTime = 1.0f / tickRate;
+}
+
+void SimulationClock::SetMaxStepsPerFrame(UINT index, UINT maxStepsPerFrame)
+{
+	systems[index].maxStepsPerFrame = maxStepsPerFrame;
+}
+
+void SimulationClock::Advance(float frameTime)
+{
+	frameTime = std::clamp(frameTime, 0.0f, maxFrameTime);
+
+	for (size_t i = 0; i < systems.size(); i++)
+	{
+		SimulationSystem& system = systems[i];
+		system.accumulator += frameTime;
+		system.stepsLastFrame = 0;
+
+		while (system.accumulator >= system.stepTime && system.stepsLastFrame < system.maxStepsPerFrame)
+		{
+			if (system.tick)
+				system.tick(system.stepTime, system.simulationTime);
+
+			system.simulationTime += system.stepTime;
+			system.accumulator -= system.stepTime;
+			system.stepsLastFrame++;
+			system.totalSteps++;
+		}
+
+		//out of budget, the whole steps that are left are dropped so the system doesn't fall further behind every frame
+		if (system.accumulator >= system.stepTime)
+		{
+			double dropped = std::floor(system.accumulator / system.stepTime) * system.stepTime;
+			system.accumulator -= dropped;
+			system.droppedTime += dropped;
+		}
+	}
+}
+
+float SimulationClock::GetInterpolationAlpha(UINT index)
+{
+	return (float)(systems[index].accumulator / systems[index].stepTime);
+}
+
+double SimulationClock::GetSimulationTime(UINT index)
+{
+	return systems[index].simulationTime;
+}
+
+double SimulationClock::GetInterpolatedTime(UINT index)
+{
+	return systems[index].simulationTime + systems[index].accumulator;
+}
+
+const SimulationSystem& SimulationClock::GetSystem(UINT index)
+{
+	return systems[index];
+}
+
+UINT SimulationClock::GetSystemCount()
+{
+	return (UINT)systems.size();
+}
+
+//advances a clock with one system through the frame times, returns the steps it took
+static UINT64 RunFrames(SimulationClock& clock, const std::vector<float>& frameTimes)
+{
+	for (size_t i = 0; i < frameTimes.size(); i++)
+	{
+		clock.Advance(frameTimes[i]);
+	}
+
+	return clock.GetSystem(0).totalSteps;
+}
+
+void ValidateSimulationClock()
+{
+	printf("Simulation clock\n");
+	bool passed = true;
+
+	//frames at the tick rate step once each and leave nothing over
+	{
+		SimulationClock clock;
+		clock.AddSystem("60hz", 60.0f, nullptr);
+		UINT64 steps = RunFrames(clock, std::vector<float>(120, 1.0f / 60.0f));
+		Check(passed, "60 fps at 60 hz steps once a frame", steps == 120 && clock.GetSystem(0).accumulator < 1e-6);
+	}
+
+	//faster frames than steps, the time not stepped yet is what's left in the accumulator
+	{
+		SimulationClock clock;
+		clock.AddSystem("60hz", 60.0f, nullptr);
+		std::vector<float> frameTimes(144, 1.0f / 144.0f);
+		UINT64 steps = RunFrames(clock, frameTimes);
+
+		const SimulationSystem& system = clock.GetSystem(0);
+		double frameTimeSum = 0.0;
+		for (size_t i = 0; i < frameTimes.size(); i++)
+		{
+			frameTimeSum += frameTimes[i];
+		}
+
+		double leftover = frameTimeSum - steps * (double)system.stepTime;
+		printf("    144 frames at 60 hz: %llu steps, %.6f s left over\n", steps, system.accumulator);
+		Check(passed, "144 fps at 60 hz steps 59 or 60 times", steps == 59 || steps == 60);
+		Check(passed, "leftover is the time not stepped", fabs(system.accumulator - leftover) < 1e-5 && system.accumulator < system.stepTime);
+		Check(passed, "interpolation alpha within [0, 1)", clock.GetInterpolationAlpha(0) >= 0.0f && clock.GetInterpolationAlpha(0) < 1.0f);
+	}
+
+	//slower frames than steps take several steps a frame, every system at its own rate
+	{
+		SimulationClock clock;
+		clock.AddSystem("120hz", 120.0f, nullptr);
+		clock.AddSystem("20hz", 20.0f, nullptr);
+		bool fourSteps = true;
+		for (int frame = 0; frame < 30; frame++)
+		{
+			//a little over 1/30 so rounding can't leave the last step of the frame behind
+			clock.Advance(1.0f / 30.0f + 1e-6f);
+			fourSteps = fourSteps && clock.GetSystem(0).stepsLastFrame == 4;
+		}
+
+		Check(passed, "30 fps at 120 hz steps four times a frame", fourSteps && clock.GetSystem(0).totalSteps == 120);
+		Check(passed, "a second system keeps its own rate", clock.GetSystem(1).totalSteps == 20);
+	}
+
+	//ticks see evenly spaced simulation times from 0
+	{
+		SimulationClock clock;
+		std::vector<double> tickTimes;
+		clock.AddSystem("ticks", 50.0f, [&tickTimes](float stepTime, double simulationTime)
+			{
+				tickTimes.push_back(simulationTime);
+			});
+
+		RunFrames(clock, { 0.013f, 0.029f, 0.002f, 0.041f, 0.017f });
+
+		bool evenlySpaced = !tickTimes.empty() && tickTimes[0] == 0.0;
+		for (size_t i = 1; i < tickTimes.size(); i++)
+		{
+			evenlySpaced = evenlySpaced && fabs(tickTimes[i] - tickTimes[i - 1] - 1.0 / 50.0) < 1e-6;
+		}
+
+		Check(passed, "ticks are one step apart", evenlySpaced && tickTimes.size() == clock.GetSystem(0).totalSteps);
+	}
+
+	//a very slow frame is clamped, the step budget runs and the rest is dropped instead of carried
+	{
+		SimulationClock clock(0.25f);
+		clock.AddSystem("60hz", 60.0f, nullptr, 4);
+		clock.Advance(2.0f);
+
+		const SimulationSystem& system = clock.GetSystem(0);
+		double accounted = system.totalSteps * (double)system.stepTime + system.droppedTime + system.accumulator;
+		printf("    2 s frame: %u steps, %.4f s dropped, %.4f s left over\n", system.stepsLastFrame, system.droppedTime, system.accumulator);
+		Check(passed, "slow frame clamped to 0.25 s", fabs(accounted - 0.25) < 1e-5);
+		Check(passed, "slow frame steps the budget of 4", system.stepsLastFrame == 4);
+		Check(passed, "slow frame leaves less than a step", system.accumulator < system.stepTime);
+
+		clock.Advance(1.0f / 60.0f);
+		Check(passed, "the next frame steps normally", system.stepsLastFrame == 1);
+
+		clock.Advance(-1.0f);
+		Check(passed, "negative frame times don't step", system.stepsLastFrame == 0);
+	}
+
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include<Windows.h>
+#include<functional>
+#include<string>
+#include<vector>
+
+//called once per fixed step with the step length and the simulation time at the start of the step
+typedef std::function<void(float stepTime, double simulationTime)> SimulationTick;
+
+struct SimulationSystem
+{
+	std::string name;
+	float stepTime;
+	UINT maxStepsPerFrame;
+	SimulationTick tick;
+
+	double accumulator;
+	double simulationTime;
+
+	//stats
+	UINT stepsLastFrame;
+	UINT64 totalSteps;
+	double droppedTime;
+};
+
+//fixed timestep scheduler, every system keeps its own accumulator so they can tick at different rates
+//independent of the render frame rate. Advance only needs frame times, so it can be driven without a window
+class SimulationClock
+{
+	std::vector<SimulationSystem> systems;
+
+	//longer frames are clamped, e.g. after a breakpoint or a window drag
+	float maxFrameTime;
+
+public:
+	SimulationClock(float maxFrameTime = 0.25f);
+	~SimulationClock();
+
+	//returns the index of the system, tickRate is in steps per second
+	UINT AddSystem(std::string name, float tickRate, SimulationTick tick, UINT maxStepsPerFrame = 4);
+	void SetTickRate(UINT index, float tickRate);
+	void SetMaxStepsPerFrame(UINT index, UINT maxStepsPerFrame);
+
+	void Advance(float frameTime);
+
+	//how far the render frame is between the last two simulated states of the system
+	float GetInterpolationAlpha(UINT index);
+
+	//time of the last simulated state, and the time the render frame is at
+	double GetSimulationTime(UINT index);
+	double GetInterpolatedTime(UINT index);
+
+	const SimulationSystem& GetSystem(UINT index);
+	UINT GetSystemCount();
+};
+
+//step counts, leftover time and the slow frame clamp for sequences of synthetic frame times
+void ValidateSimulationClock();
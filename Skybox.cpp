@@ -12,6 +12,7 @@ Skybox::Skybox(std::wstring skyboxTex, std::shared_ptr<Mesh> mesh,ComPtr<ID3D12P
 	descriptorHeap.CreateDescriptor(skyboxTex, skyboxTexResource, RESOURCE_TYPE_SRV,
 		TEXTURE_TYPE_HDR, false, textureUpload);
 
+	skyboxTextureFile = skyboxTex;
 	this->skyBoxPSO = skyboxPSO;
 	this->skyboxRootSignature = skyboxRoot;
 	skyboxMesh = mesh;
@@ -56,7 +57,7 @@ DescriptorHeapWrapper& Skybox::GetDescriptorHeap()
 
 void Skybox::CreateEnvironment(ComPtr<ID3D12RootSignature>& prefilterRootSignature,
 	ComPtr<ID3D12RootSignature>& brdfRootSignature,
-	ComPtr<ID3D12PipelineState>& irradiencePSO, ComPtr<ID3D12PipelineState>& prefilteredMapPSO, 
+	ComPtr<ID3D12PipelineState>& prefilteredMapPSO, 
 	ComPtr<ID3D12PipelineState>& brdfLUTPSO, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle)
 {
 
@@ -75,7 +76,7 @@ void Skybox::CreateEnvironment(ComPtr<ID3D12RootSignature>& prefilterRootSignatu
 	ID3D12DescriptorHeap* ppHeaps[] = { dummyHeap.GetHeap().Get() };
 	GetAppResources().commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 	auto skyboxHandle = descriptorHeap.GetGPUHandle(0);
-	environment = std::make_unique<Environment>(skyboxRootSignature, skyboxRootSignature, skyboxRootSignature,irradiencePSO,prefilteredMapPSO,
+	environment = std::make_unique<Environment>(skyboxTextureFile, skyboxRootSignature, skyboxRootSignature,prefilteredMapPSO,
 		brdfLUTPSO,dummyHeap.GetGPUHandle(0),depthStencilHandle,skyboxMesh->GetVertexBuffer(),skyboxMesh->GetIndexBuffer(),skyboxMesh->GetIndexCount());
 	
 }
@@ -110,4 +111,7 @@ DescriptorHeapWrapper Skybox::GetEnvironmentHeap()
 	return DescriptorHeapWrapper();
 }
 
-
+ComPtr<ID3D12Resource>& Skybox::GetIrradianceSHBuffer()
+{
+	return environment->GetIrradianceSHBuffer();
+}
@@ -31,6 +31,8 @@ class Skybox
 	SkyboxData skyboxData;
 
 	ComPtr<ID3D12Resource> textureUpload;
+	//the hdr the environment's irradiance is projected from
+	std::wstring skyboxTextureFile;
 
 	//skybox environment for image based lighting
 	bool hasEnvironmentMaps;
@@ -49,7 +51,7 @@ public:
 	DescriptorHeapWrapper& GetDescriptorHeap();
 
 	void CreateEnvironment(ComPtr<ID3D12RootSignature>& prefilterRootSignature, ComPtr<ID3D12RootSignature>& brdfRootSignature,
-		ComPtr<ID3D12PipelineState>& irradiencePSO, ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
+		ComPtr<ID3D12PipelineState>& prefilteredMapPSO,
 		ComPtr<ID3D12PipelineState>& brdfLUTPSO, D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle);
 
 	ManagedResource& GetSkyboxTexture();
@@ -58,6 +60,7 @@ public:
 	void PrepareForDraw(Matrix& view, Matrix& proj, Vector3& camPosition);
 
 	DescriptorHeapWrapper GetEnvironmentHeap();
+	ComPtr<ID3D12Resource>& GetIrradianceSHBuffer();
 
 	UINT skyboxTextureIndex;
 	UINT environmentTexturesIndex;
@@ -0,0 +1,24 @@
+
+//bands 0 to 2 of the environment's irradiance, projected on the cpu by IrradianceSH. Already convolved with the
+//clamped cosine, divided by pi and multiplied by the basis constants
+struct IrradianceSHData
+{
+	float4 coefficients[9];
+};
+
+//irradiance over pi at a unit normal, what the irradiance cube map used to hold
+float3 EvaluateIrradianceSH(IrradianceSHData sh, float3 n)
+{
+	float3 irradiance = sh.coefficients[0].rgb
+		+ sh.coefficients[1].rgb * n.y
+		+ sh.coefficients[2].rgb * n.z
+		+ sh.coefficients[3].rgb * n.x
+		+ sh.coefficients[4].rgb * (n.x * n.y)
+		+ sh.coefficients[5].rgb * (n.y * n.z)
+		+ sh.coefficients[6].rgb * (3.0f * n.z * n.z - 1.0f)
+		+ sh.coefficients[7].rgb * (n.x * n.z)
+		+ sh.coefficients[8].rgb * (n.x * n.x - n.y * n.y);
+
+	//ringing can take the sum below zero opposite a bright sun
+	return max(irradiance, 0.0f);
+}
@@ -0,0 +1,414 @@
+#include "TLASInstanceTable.h"
+#include "DXRHelper.h"
+#include<algorithm>
+#include<chrono>
+#include<random>
+
+using namespace DirectX;
+
+//the descriptor stores the first three rows of the transposed matrix
+static bool StoreTransform(D3D12_RAYTRACING_INSTANCE_DESC& desc, const XMMATRIX& transform)
+{
+	XMMATRIX transposed = XMMatrixTranspose(transform);
+
+	XMFLOAT4* rows = reinterpret_cast<XMFLOAT4*>(desc.Transform);
+	XMVECTOR equal = XMVectorAndInt(XMVectorEqualInt(transposed.r[0], XMLoadFloat4(&rows[0])),
+		XMVectorAndInt(XMVectorEqualInt(transposed.r[1], XMLoadFloat4(&rows[1])),
+			XMVectorEqualInt(transposed.r[2], XMLoadFloat4(&rows[2]))));
+
+	if (XMVector4EqualInt(equal, XMVectorTrueInt()))
+		return false;
+
+	XMStoreFloat4(&rows[0], transposed.r[0]);
+	XMStoreFloat4(&rows[1], transposed.r[1]);
+	XMStoreFloat4(&rows[2], transposed.r[2]);
+	return true;
+}
+
+TLASInstanceTable::TLASInstanceTable(UINT initialCapacity)
+{
+	descs.resize(std::max(initialCapacity, 1u));
+	dirtyFlags.resize(descs.size());
+	ZeroMemory(descs.data(), descs.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+
+	highWaterMark = 0;
+	structureChanged = false;
+	ZeroMemory(&stats, sizeof(TLASInstanceTableStats));
+	stats.capacity = (UINT)descs.size();
+}
+
+TLASInstanceTable::~TLASInstanceTable()
+{
+}
+
+void TLASInstanceTable::MarkDirty(UINT handle)
+{
+	if (dirtyFlags[handle])
+		return;
+
+	dirtyFlags[handle] = 1;
+	dirtySlots.emplace_back(handle);
+}
+
+UINT TLASInstanceTable::AddInstance(ID3D12Resource* bottomLevelAS, const XMMATRIX& transform, UINT instanceID, UINT hitGroupIndex,
+	UINT instanceMask, D3D12_RAYTRACING_INSTANCE_FLAGS flags)
+{
+	return AddInstance(bottomLevelAS->GetGPUVirtualAddress(), transform, instanceID, hitGroupIndex, instanceMask, flags);
+}
+
+UINT TLASInstanceTable::AddInstance(D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, const XMMATRIX& transform, UINT instanceID, UINT hitGroupIndex,
+	UINT instanceMask, D3D12_RAYTRACING_INSTANCE_FLAGS flags)
+{
+	UINT handle;
+	if (!freeSlots.empty())
+	{
+		handle = freeSlots.back();
+		freeSlots.pop_back();
+	}
+
+	else
+	{
+		if (highWaterMark == descs.size())
+		{
+			descs.resize(descs.size() * 2);
+			dirtyFlags.resize(descs.size());
+			ZeroMemory(descs.data() + highWaterMark, (descs.size() - highWaterMark) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+			stats.capacity = (UINT)descs.size();
+			stats.growCount++;
+		}
+
+		handle = highWaterMark;
+		highWaterMark++;
+	}
+
+	D3D12_RAYTRACING_INSTANCE_DESC& desc = descs[handle];
+	ZeroMemory(&desc, sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+	desc.InstanceID = instanceID;
+	desc.InstanceContributionToHitGroupIndex = hitGroupIndex;
+	desc.InstanceMask = instanceMask;
+	desc.Flags = flags;
+	desc.AccelerationStructure = bottomLevelAS;
+	StoreTransform(desc, transform);
+
+	MarkDirty(handle);
+	structureChanged = true;
+	stats.instanceCount++;
+
+	return handle;
+}
+
+void TLASInstanceTable::RemoveInstance(UINT handle)
+{
+	//a null bottom level structure makes the instance inactive
+	ZeroMemory(&descs[handle], sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+	MarkDirty(handle);
+
+	freeSlots.emplace_back(handle);
+	structureChanged = true;
+	stats.instanceCount--;
+}
+
+void TLASInstanceTable::SetTransform(UINT handle, const XMMATRIX& transform)
+{
+	if (StoreTransform(descs[handle], transform))
+		MarkDirty(handle);
+}
+
+void TLASInstanceTable::SetTransforms(const UINT* handles, const XMMATRIX* transforms, UINT count)
+{
+	for (UINT i = 0; i < count; i++)
+	{
+		if (StoreTransform(descs[handles[i]], transforms[i]))
+			MarkDirty(handles[i]);
+	}
+}
+
+void TLASInstanceTable::SetBottomLevelAS(UINT handle, ID3D12Resource* bottomLevelAS)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS address = bottomLevelAS->GetGPUVirtualAddress();
+	if (descs[handle].AccelerationStructure == address)
+		return;
+
+	descs[handle].AccelerationStructure = address;
+	MarkDirty(handle);
+}
+
+void TLASInstanceTable::SetInstanceMask(UINT handle, UINT instanceMask)
+{
+	if (descs[handle].InstanceMask == instanceMask)
+		return;
+
+	descs[handle].InstanceMask = instanceMask;
+	MarkDirty(handle);
+}
+
+void TLASInstanceTable::MarkAllDirty()
+{
+	for (UINT i = 0; i < highWaterMark; i++)
+	{
+		MarkDirty(i);
+	}
+}
+
+UINT TLASInstanceTable::FlushDirty(D3D12_RAYTRACING_INSTANCE_DESC* dest)
+{
+	UINT dirtyCount = (UINT)dirtySlots.size();
+	stats.dirtyLastFlush = dirtyCount;
+	stats.bytesLastFlush = 0;
+
+	if (dirtyCount == 0)
+		return 0;
+
+	//sorted so neighbouring slots go out as one copy, the upload heap is write combined so fewer larger writes are cheaper
+	std::sort(dirtySlots.begin(), dirtySlots.end());
+
+	size_t runStart = 0;
+	for (size_t i = 1; i <= dirtySlots.size(); i++)
+	{
+		if (i < dirtySlots.size() && dirtySlots[i] == dirtySlots[i - 1] + 1)
+			continue;
+
+		UINT first = dirtySlots[runStart];
+		UINT64 runBytes = (UINT64)(i - runStart) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+		memcpy(dest + first, descs.data() + first, runBytes);
+		stats.bytesLastFlush += runBytes;
+
+		runStart = i;
+	}
+
+	for (size_t i = 0; i < dirtySlots.size(); i++)
+	{
+		dirtyFlags[dirtySlots[i]] = 0;
+	}
+
+	dirtySlots.clear();
+	return dirtyCount;
+}
+
+bool TLASInstanceTable::ConsumeStructureChanged()
+{
+	bool changed = structureChanged;
+	structureChanged = false;
+	return changed;
+}
+
+UINT TLASInstanceTable::GetHighWaterMark()
+{
+	return highWaterMark;
+}
+
+UINT TLASInstanceTable::GetCapacity()
+{
+	return (UINT)descs.size();
+}
+
+UINT TLASInstanceTable::GetInstanceCount()
+{
+	return stats.instanceCount;
+}
+
+const D3D12_RAYTRACING_INSTANCE_DESC& TLASInstanceTable::GetDesc(UINT handle)
+{
+	return descs[handle];
+}
+
+const TLASInstanceTableStats& TLASInstanceTable::GetStats()
+{
+	return stats;
+}
+
+DynamicTLAS::DynamicTLAS(ComPtr<ID3D12Device5> device, UINT initialCapacity) : instances(initialCapacity)
+{
+	this->device = device;
+	mappedDescs = nullptr;
+	bufferCapacity = 0;
+	built = false;
+	lastBuildWasRefit = false;
+}
+
+DynamicTLAS::~DynamicTLAS()
+{
+	if (mappedDescs != nullptr)
+		buffers.pInstanceDesc->Unmap(0, nullptr);
+}
+
+void DynamicTLAS::CreateBuffers(UINT capacity)
+{
+	if (mappedDescs != nullptr)
+	{
+		buffers.pInstanceDesc->Unmap(0, nullptr);
+		mappedDescs = nullptr;
+	}
+
+	retiredBuffers.emplace_back(buffers.pScratch);
+	retiredBuffers.emplace_back(buffers.pResult);
+	retiredBuffers.emplace_back(buffers.pInstanceDesc);
+
+	//sized for every slot of the table, so instances can come and go without asking for the sizes again
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS prebuildDesc = {};
+	prebuildDesc.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+	prebuildDesc.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+	prebuildDesc.NumDescs = capacity;
+	prebuildDesc.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+	device->GetRaytracingAccelerationStructurePrebuildInfo(&prebuildDesc, &info);
+
+	UINT64 scratchSize = ROUND_UP(std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes),
+		D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	UINT64 resultSize = ROUND_UP(info.ResultDataMaxSizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	UINT64 instanceDescsSize = ROUND_UP(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * (UINT64)capacity,
+		D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	buffers.pScratch = nv_helpers_dx12::CreateBuffer(device.Get(), scratchSize,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		nv_helpers_dx12::kDefaultHeapProps);
+
+	buffers.pResult = nv_helpers_dx12::CreateBuffer(device.Get(), resultSize,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+		nv_helpers_dx12::kDefaultHeapProps);
+
+	buffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(device.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+
+	ThrowIfFailed(buffers.pInstanceDesc->Map(0, nullptr, reinterpret_cast<void**>(&mappedDescs)));
+
+	//the new descriptor buffer starts out empty
+	ZeroMemory(mappedDescs, instanceDescsSize);
+	instances.MarkAllDirty();
+
+	bufferCapacity = capacity;
+}
+
+TLASInstanceTable& DynamicTLAS::GetInstances()
+{
+	return instances;
+}
+
+bool DynamicTLAS::Build(ID3D12GraphicsCommandList4* commandList, bool allowRefit)
+{
+	//the previous build has finished, so whatever it used can go
+	retiredBuffers.clear();
+
+	bool recreated = false;
+	if (instances.GetCapacity() > bufferCapacity)
+	{
+		CreateBuffers(instances.GetCapacity());
+		recreated = true;
+	}
+
+	instances.FlushDirty(mappedDescs);
+
+	//an instance turning active or inactive needs a full build, as does a new result buffer
+	bool structureChanged = instances.ConsumeStructureChanged();
+	bool refit = allowRefit && built && !recreated && !structureChanged;
+
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+	buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+	buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+	buildDesc.Inputs.InstanceDescs = buffers.pInstanceDesc->GetGPUVirtualAddress();
+	buildDesc.Inputs.NumDescs = instances.GetHighWaterMark();
+	buildDesc.Inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+	if (refit)
+	{
+		buildDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+		buildDesc.SourceAccelerationStructureData = buffers.pResult->GetGPUVirtualAddress();
+	}
+
+	buildDesc.DestAccelerationStructureData = buffers.pResult->GetGPUVirtualAddress();
+	buildDesc.ScratchAccelerationStructureData = buffers.pScratch->GetGPUVirtualAddress();
+
+	commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+
+	auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(buffers.pResult.Get());
+	commandList->ResourceBarrier(1, &barrier);
+
+	built = true;
+	lastBuildWasRefit = refit;
+	return recreated;
+}
+
+bool DynamicTLAS::WasRefit()
+{
+	return lastBuildWasRefit;
+}
+
+AccelerationStructureBuffers& DynamicTLAS::GetBuffers()
+{
+	return buffers;
+}
+
+void BenchmarkTLASInstanceTable(UINT instanceCount, int frameCount)
+{
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+	std::vector<XMMATRIX> transforms(instanceCount);
+	for (UINT i = 0; i < instanceCount; i++)
+	{
+		transforms[i] = XMMatrixTranslation(distribution(generator), distribution(generator), distribution(generator));
+	}
+
+	//stands in for the mapped upload buffer
+	std::vector<D3D12_RAYTRACING_INSTANCE_DESC> destination(instanceCount);
+
+	//every descriptor rebuilt and written each frame, the way TopLevelASGenerator::Generate does it
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		for (UINT i = 0; i < instanceCount; i++)
+		{
+			destination[i].InstanceID = i;
+			destination[i].InstanceContributionToHitGroupIndex = i * 2;
+			destination[i].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+			XMMATRIX m = XMMatrixTranspose(transforms[i]);
+			memcpy(destination[i].Transform, &m, sizeof(destination[i].Transform));
+			destination[i].AccelerationStructure = 0x1000;
+			destination[i].InstanceMask = 0xFF;
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double fullRewrite = std::chrono::duration<double, std::milli>(end - start).count() / frameCount;
+
+	printf("TLAS instance writes, %u instances, %d frames\n", instanceCount, frameCount);
+	printf("  full rewrite: %.3f ms/frame, %.2f MB/frame\n", fullRewrite,
+		instanceCount * sizeof(D3D12_RAYTRACING_INSTANCE_DESC) / (1024.0 * 1024.0));
+
+	const float movingFractions[] = { 0.0f, 0.01f, 0.1f, 1.0f };
+	for (float movingFraction : movingFractions)
+	{
+		//the bottom level address is only copied, it doesn't have to point anywhere
+		TLASInstanceTable table;
+		std::vector<UINT> handles(instanceCount);
+		for (UINT i = 0; i < instanceCount; i++)
+		{
+			handles[i] = table.AddInstance(0x1000, transforms[i], i, i * 2);
+		}
+		table.FlushDirty(destination.data());
+
+		std::vector<XMMATRIX> frameTransforms = transforms;
+		UINT moving = (UINT)(instanceCount * movingFraction);
+
+		double flushTime = 0.0;
+		UINT64 bytes = 0;
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			for (UINT i = 0; i < moving; i++)
+			{
+				UINT index = (i * 7919u + frame) % instanceCount;
+				frameTransforms[index] = XMMatrixMultiply(frameTransforms[index], XMMatrixTranslation(0.01f, 0.0f, 0.0f));
+			}
+
+			start = std::chrono::high_resolution_clock::now();
+			table.SetTransforms(handles.data(), frameTransforms.data(), instanceCount);
+			table.FlushDirty(destination.data());
+			end = std::chrono::high_resolution_clock::now();
+
+			flushTime += std::chrono::duration<double, std::milli>(end - start).count();
+			bytes += table.GetStats().bytesLastFlush;
+		}
+
+		printf("  dirty flush, %5.1f%% moving: %.3f ms/frame, %.2f MB/frame\n", movingFraction * 100.0f,
+			flushTime / frameCount, bytes / (double)frameCount / (1024.0 * 1024.0));
+	}
+}
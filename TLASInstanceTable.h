@@ -0,0 +1,105 @@
+#pragma once
+
+#include"DX12Helper.h"
+#include<vector>
+#include<memory>
+
+struct TLASInstanceTableStats
+{
+	UINT instanceCount;
+	UINT capacity;
+	UINT growCount;
+
+	//written by the last flush
+	UINT dirtyLastFlush;
+	UINT64 bytesLastFlush;
+};
+
+//persistent copy of the instance descriptors of a top level structure, only the instances that changed since the
+//last flush are written to the gpu. Removed instances stay in the array as inactive descriptors until the slot is reused
+class TLASInstanceTable
+{
+	std::vector<D3D12_RAYTRACING_INSTANCE_DESC> descs;
+	std::vector<UINT> freeSlots;
+	std::vector<UINT> dirtySlots;
+	std::vector<UINT8> dirtyFlags;
+
+	//slots below this have been used, the structure is built over this many descriptors
+	UINT highWaterMark;
+
+	//an instance became active or inactive, which a refit can't do
+	bool structureChanged;
+
+	TLASInstanceTableStats stats;
+
+	void MarkDirty(UINT handle);
+
+public:
+	TLASInstanceTable(UINT initialCapacity = 16);
+	~TLASInstanceTable();
+
+	//returns the handle of the instance, the array grows to twice its size when it is full
+	UINT AddInstance(ID3D12Resource* bottomLevelAS, const DirectX::XMMATRIX& transform, UINT instanceID, UINT hitGroupIndex,
+		UINT instanceMask = 0xFF, D3D12_RAYTRACING_INSTANCE_FLAGS flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE);
+	UINT AddInstance(D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, const DirectX::XMMATRIX& transform, UINT instanceID, UINT hitGroupIndex,
+		UINT instanceMask = 0xFF, D3D12_RAYTRACING_INSTANCE_FLAGS flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE);
+	void RemoveInstance(UINT handle);
+
+	//only marks the instance dirty when the transform actually changed
+	void SetTransform(UINT handle, const DirectX::XMMATRIX& transform);
+	void SetTransforms(const UINT* handles, const DirectX::XMMATRIX* transforms, UINT count);
+	void SetBottomLevelAS(UINT handle, ID3D12Resource* bottomLevelAS);
+	void SetInstanceMask(UINT handle, UINT instanceMask);
+	void MarkAllDirty();
+
+	//copies the dirty descriptors to dest, runs of neighbouring slots are copied together. Returns the number written
+	UINT FlushDirty(D3D12_RAYTRACING_INSTANCE_DESC* dest);
+
+	//true once per structural change
+	bool ConsumeStructureChanged();
+
+	UINT GetHighWaterMark();
+	UINT GetCapacity();
+	UINT GetInstanceCount();
+	const D3D12_RAYTRACING_INSTANCE_DESC& GetDesc(UINT handle);
+	const TLASInstanceTableStats& GetStats();
+};
+
+//top level structure built from an instance table, the buffers are sized for the capacity of the table so adding
+//instances only needs new buffers when the table grows
+class DynamicTLAS
+{
+	ComPtr<ID3D12Device5> device;
+	TLASInstanceTable instances;
+
+	AccelerationStructureBuffers buffers;
+	//persistently mapped, the upload heap stays mapped for the lifetime of the buffer
+	D3D12_RAYTRACING_INSTANCE_DESC* mappedDescs;
+	UINT bufferCapacity;
+	bool built;
+	bool lastBuildWasRefit;
+
+	//replaced buffers, the last build recorded with them has to finish before they can go
+	std::vector<ComPtr<ID3D12Resource>> retiredBuffers;
+
+	void CreateBuffers(UINT capacity);
+
+public:
+	DynamicTLAS(ComPtr<ID3D12Device5> device, UINT initialCapacity = 16);
+	~DynamicTLAS();
+
+	TLASInstanceTable& GetInstances();
+
+	//refits when allowed and nothing structural changed, otherwise rebuilds. The previous build has to be finished
+	//on the gpu. Returns true if the result buffer was recreated, so views of it have to be recreated too
+	bool Build(ID3D12GraphicsCommandList4* commandList, bool allowRefit = true);
+
+	//whether the last Build was a refit
+	bool WasRefit();
+
+	AccelerationStructureBuffers& GetBuffers();
+};
+
+//per frame cost of writing the instance descriptors, all instances rewritten the way the generator does it
+//against the dirty flush with a fraction of the instances moving
+void BenchmarkTLASInstanceTable(UINT instanceCount = 100000, int frameCount = 60);
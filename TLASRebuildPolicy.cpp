@@ -0,0 +1,411 @@
+#include "TLASRebuildPolicy.h"
+#include"Validation.h"
+#include<algorithm>
+#include<cmath>
+#include<fstream>
+#include<random>
+
+using namespace DirectX;
+
+static float BoundsArea(const TLASInstanceBounds& bounds)
+{
+	float x = std::max(bounds.max.x - bounds.min.x, 0.0f);
+	float y = std::max(bounds.max.y - bounds.min.y, 0.0f);
+	float z = std::max(bounds.max.z - bounds.min.z, 0.0f);
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+static TLASInstanceBounds BoundsUnion(const TLASInstanceBounds& a, const TLASInstanceBounds& b)
+{
+	TLASInstanceBounds result;
+	XMStoreFloat3(&result.min, XMVectorMin(XMLoadFloat3(&a.min), XMLoadFloat3(&b.min)));
+	XMStoreFloat3(&result.max, XMVectorMax(XMLoadFloat3(&a.max), XMLoadFloat3(&b.max)));
+	return result;
+}
+
+static XMFLOAT3 BoundsCentroid(const TLASInstanceBounds& bounds)
+{
+	XMFLOAT3 centroid;
+	XMStoreFloat3(&centroid, XMVectorScale(XMVectorAdd(XMLoadFloat3(&bounds.min), XMLoadFloat3(&bounds.max)), 0.5f));
+	return centroid;
+}
+
+static TLASInstanceBounds SceneBounds(const std::vector<TLASInstanceBounds>& bounds)
+{
+	TLASInstanceBounds scene = bounds[0];
+	for (size_t i = 1; i < bounds.size(); i++)
+	{
+		scene = BoundsUnion(scene, bounds[i]);
+	}
+	return scene;
+}
+
+//spreads the lower 10 bits so there are two zero bits between each
+static UINT ExpandBits(UINT v)
+{
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+//area of every node of the tree over order[first, last), the bounds of the range are returned in nodeBounds
+static float TreeCost(const std::vector<TLASInstanceBounds>& bounds, const std::vector<UINT>& order, size_t first, size_t last,
+	TLASInstanceBounds& nodeBounds)
+{
+	if (last - first == 1)
+	{
+		nodeBounds = bounds[order[first]];
+		return BoundsArea(nodeBounds);
+	}
+
+	size_t middle = (first + last) / 2;
+	TLASInstanceBounds left, right;
+	float cost = TreeCost(bounds, order, first, middle, left) + TreeCost(bounds, order, middle, last, right);
+
+	nodeBounds = BoundsUnion(left, right);
+	return cost + BoundsArea(nodeBounds);
+}
+
+TLASRebuildPolicy::TLASRebuildPolicy(TLASRebuildPolicySettings settings)
+{
+	this->settings = settings;
+	buildRootArea = 0.0f;
+	buildDiagonal = 0.0f;
+	built = false;
+	ZeroMemory(&stats, sizeof(TLASRebuildPolicyStats));
+}
+
+TLASRebuildPolicy::~TLASRebuildPolicy()
+{
+}
+
+void TLASRebuildPolicy::OnBuild(const std::vector<TLASInstanceBounds>& bounds)
+{
+	built = true;
+	stats.framesSinceBuild = 0;
+
+	buildCentroids.resize(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		buildCentroids[i] = BoundsCentroid(bounds[i]);
+	}
+
+	buildOrder = ComputeMortonOrder(bounds);
+
+	if (bounds.empty())
+	{
+		buildRootArea = 0.0f;
+		buildDiagonal = 0.0f;
+		return;
+	}
+
+	TLASInstanceBounds scene = SceneBounds(bounds);
+	buildRootArea = BoundsArea(scene);
+	buildDiagonal = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&scene.max), XMLoadFloat3(&scene.min))));
+}
+
+TLASRebuildDecision TLASRebuildPolicy::Evaluate(const std::vector<TLASInstanceBounds>& bounds, bool structureChanged)
+{
+	TLASRebuildDecision decision = {};
+	decision.reason = TLAS_REFIT;
+	decision.sahRatio = 1.0f;
+	decision.boundsGrowth = 1.0f;
+
+	stats.framesSinceBuild++;
+
+	if (!built)
+	{
+		decision.reason = TLAS_REBUILD_FIRST_BUILD;
+	}
+
+	else if (structureChanged || bounds.size() != buildCentroids.size())
+	{
+		decision.reason = TLAS_REBUILD_STRUCTURE_CHANGED;
+	}
+
+	else if (!bounds.empty())
+	{
+		//how far the instances moved from where the tree was built for
+		float maxDistanceSq = 0.0f;
+		for (size_t i = 0; i < bounds.size(); i++)
+		{
+			XMFLOAT3 centroid = BoundsCentroid(bounds[i]);
+			float distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&centroid), XMLoadFloat3(&buildCentroids[i]))));
+			maxDistanceSq = std::max(maxDistanceSq, distanceSq);
+		}
+
+		decision.maxDisplacement = buildDiagonal > 0.0f ? sqrtf(maxDistanceSq) / buildDiagonal : 0.0f;
+		decision.boundsGrowth = buildRootArea > 0.0f ? BoundsArea(SceneBounds(bounds)) / buildRootArea : 1.0f;
+
+		if (stats.framesSinceBuild >= settings.maxRefitFrames)
+		{
+			decision.reason = TLAS_REBUILD_MAX_REFIT_FRAMES;
+		}
+
+		//sorting the instances again is the expensive part, so only when something moved far enough to matter
+		else if (decision.maxDisplacement >= settings.displacementThreshold)
+		{
+			float refitCost = ComputeTreeCost(bounds, buildOrder);
+			float rebuildCost = ComputeTreeCost(bounds, ComputeMortonOrder(bounds));
+			decision.sahRatio = rebuildCost > 0.0f ? refitCost / rebuildCost : 1.0f;
+			stats.sahEvaluations++;
+
+			if (decision.sahRatio > settings.sahDegradationThreshold)
+				decision.reason = TLAS_REBUILD_SAH_DEGRADED;
+		}
+	}
+
+	decision.rebuild = decision.reason != TLAS_REFIT;
+	decision.async = decision.rebuild && settings.useAsyncCompute;
+
+	if (decision.rebuild)
+		stats.rebuildCount++;
+	else
+		stats.refitCount++;
+
+	stats.lastDecision = decision;
+	return decision;
+}
+
+TLASRebuildDecision TLASRebuildPolicy::Update(const std::vector<TLASInstanceBounds>& bounds, bool structureChanged)
+{
+	TLASRebuildDecision decision = Evaluate(bounds, structureChanged);
+	if (decision.rebuild)
+		OnBuild(bounds);
+
+	return decision;
+}
+
+void TLASRebuildPolicy::SetSettings(TLASRebuildPolicySettings settings)
+{
+	this->settings = settings;
+}
+
+TLASRebuildPolicySettings& TLASRebuildPolicy::GetSettings()
+{
+	return settings;
+}
+
+const TLASRebuildPolicyStats& TLASRebuildPolicy::GetStats()
+{
+	return stats;
+}
+
+float TLASRebuildPolicy::ComputeTreeCost(const std::vector<TLASInstanceBounds>& bounds, const std::vector<UINT>& order)
+{
+	if (order.empty())
+		return 0.0f;
+
+	TLASInstanceBounds root;
+	float cost = TreeCost(bounds, order, 0, order.size(), root);
+
+	float rootArea = BoundsArea(root);
+	return rootArea > 0.0f ? cost / rootArea : 0.0f;
+}
+
+std::vector<UINT> TLASRebuildPolicy::ComputeMortonOrder(const std::vector<TLASInstanceBounds>& bounds)
+{
+	std::vector<UINT> order(bounds.size());
+	if (bounds.empty())
+		return order;
+
+	//codes are relative to the bounds of the centroids, not of the instances
+	XMVECTOR centroidMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR centroidMax = XMVectorReplicate(-FLT_MAX);
+	std::vector<XMFLOAT3> centroids(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		centroids[i] = BoundsCentroid(bounds[i]);
+		centroidMin = XMVectorMin(centroidMin, XMLoadFloat3(&centroids[i]));
+		centroidMax = XMVectorMax(centroidMax, XMLoadFloat3(&centroids[i]));
+	}
+
+	XMVECTOR extent = XMVectorMax(XMVectorSubtract(centroidMax, centroidMin), XMVectorReplicate(1e-6f));
+	XMVECTOR scale = XMVectorDivide(XMVectorReplicate(1023.0f), extent);
+
+	std::vector<std::pair<UINT, UINT>> codes(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		XMFLOAT3 cell;
+		XMStoreFloat3(&cell, XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&centroids[i]), centroidMin), scale));
+		UINT code = (ExpandBits((UINT)cell.x) << 2) | (ExpandBits((UINT)cell.y) << 1) | ExpandBits((UINT)cell.z);
+		codes[i] = std::make_pair(code, (UINT)i);
+	}
+
+	std::sort(codes.begin(), codes.end());
+	for (size_t i = 0; i < codes.size(); i++)
+	{
+		order[i] = codes[i].second;
+	}
+
+	return order;
+}
+
+TLASInstanceBounds TLASRebuildPolicy::TransformBounds(const TLASInstanceBounds& local, FXMMATRIX transform)
+{
+	XMVECTOR localMin = XMLoadFloat3(&local.min);
+	XMVECTOR localMax = XMLoadFloat3(&local.max);
+	XMVECTOR center = XMVectorScale(XMVectorAdd(localMin, localMax), 0.5f);
+	XMVECTOR extent = XMVectorScale(XMVectorSubtract(localMax, localMin), 0.5f);
+
+	//the extent along each world axis is the extent projected on the absolute rows
+	XMVECTOR worldCenter = XMVector3Transform(center, transform);
+	XMVECTOR worldExtent = XMVectorMultiply(XMVectorSplatX(extent), XMVectorAbs(transform.r[0]));
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatY(extent), XMVectorAbs(transform.r[1]), worldExtent);
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatZ(extent), XMVectorAbs(transform.r[2]), worldExtent);
+
+	TLASInstanceBounds world;
+	XMStoreFloat3(&world.min, XMVectorSubtract(worldCenter, worldExtent));
+	XMStoreFloat3(&world.max, XMVectorAdd(worldCenter, worldExtent));
+	return world;
+}
+
+TLASInstanceBounds TLASRebuildPolicy::ComputeBounds(const XMFLOAT3* positions, size_t count, size_t stride)
+{
+	TLASInstanceBounds bounds = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
+	if (count == 0)
+		return bounds;
+
+	const BYTE* bytes = reinterpret_cast<const BYTE*>(positions);
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bytes + i * stride));
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
+	}
+
+	XMStoreFloat3(&bounds.min, boundsMin);
+	XMStoreFloat3(&bounds.max, boundsMax);
+	return bounds;
+}
+
+std::vector<UINT> RunTLASRebuildPolicy(const TLASMotionTrace& trace, TLASRebuildPolicySettings settings)
+{
+	TLASRebuildPolicy policy(settings);
+	std::vector<UINT> rebuildFrames;
+
+	for (size_t i = 0; i < trace.size(); i++)
+	{
+		if (policy.Update(trace[i]).rebuild)
+			rebuildFrames.emplace_back((UINT)i);
+	}
+
+	return rebuildFrames;
+}
+
+bool SaveTLASMotionTrace(const std::string& fileName, const TLASMotionTrace& trace)
+{
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT frameCount = (UINT)trace.size();
+	file.write(reinterpret_cast<const char*>(&frameCount), sizeof(UINT));
+	for (size_t i = 0; i < trace.size(); i++)
+	{
+		UINT instanceCount = (UINT)trace[i].size();
+		file.write(reinterpret_cast<const char*>(&instanceCount), sizeof(UINT));
+		file.write(reinterpret_cast<const char*>(trace[i].data()), instanceCount * sizeof(TLASInstanceBounds));
+	}
+
+	return file.good();
+}
+
+bool LoadTLASMotionTrace(const std::string& fileName, TLASMotionTrace& trace)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	UINT frameCount = 0;
+	file.read(reinterpret_cast<char*>(&frameCount), sizeof(UINT));
+
+	trace.clear();
+	trace.resize(frameCount);
+	for (UINT i = 0; i < frameCount && file.good(); i++)
+	{
+		UINT instanceCount = 0;
+		file.read(reinterpret_cast<char*>(&instanceCount), sizeof(UINT));
+		trace[i].resize(instanceCount);
+		file.read(reinterpret_cast<char*>(trace[i].data()), instanceCount * sizeof(TLASInstanceBounds));
+	}
+
+	return file.good();
+}
+
+//unit boxes on an 8x8 grid, each frame positioned by move(instance, frame, x, z)
+template<typename Move>
+static TLASMotionTrace CreateGridTrace(UINT frameCount, Move move)
+{
+	TLASMotionTrace trace(frameCount);
+	for (UINT frame = 0; frame < frameCount; frame++)
+	{
+		trace[frame].resize(64);
+		for (UINT i = 0; i < 64; i++)
+		{
+			float x = (i % 8) * 4.0f;
+			float z = (i / 8) * 4.0f;
+			move(i, frame, x, z);
+
+			trace[frame][i].min = XMFLOAT3(x - 0.5f, -0.5f, z - 0.5f);
+			trace[frame][i].max = XMFLOAT3(x + 0.5f, 0.5f, z + 0.5f);
+		}
+	}
+
+	return trace;
+}
+
+static bool CheckRebuildFrames(const char* name, const TLASMotionTrace& trace, TLASRebuildPolicySettings settings,
+	const std::vector<UINT>& expected, bool expectAtLeast)
+{
+	std::vector<UINT> rebuildFrames = RunTLASRebuildPolicy(trace, settings);
+
+	bool passed = expectAtLeast ? rebuildFrames.size() >= expected.size() : rebuildFrames == expected;
+	printf("  %-28s %s, %zu rebuilds over %zu frames\n", name, passed ? "passed" : "FAILED", rebuildFrames.size(), trace.size());
+	return passed;
+}
+
+void ValidateTLASRebuildPolicy()
+{
+	printf("TLAS rebuild policy\n");
+	TLASRebuildPolicySettings settings;
+	bool passed = true;
+
+	//nothing moves, only the first build
+	TLASMotionTrace staticTrace = CreateGridTrace(300, [](UINT, UINT, float&, float&) {});
+	passed &= CheckRebuildFrames("static", staticTrace, settings, { 0 }, false);
+
+	//small movement around the build positions never gets as far as the tree estimate
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+	TLASMotionTrace jitterTrace = CreateGridTrace(300, [&](UINT, UINT, float& x, float& z)
+		{
+			x += jitter(generator);
+			z += jitter(generator);
+		});
+	passed &= CheckRebuildFrames("jitter", jitterTrace, settings, { 0 }, false);
+
+	//every instance moves to a scrambled cell of the grid, the build time tree ends up overlapping everywhere.
+	//a mirrored target wouldn't do, the tree keeps its shape under a reflection
+	TLASMotionTrace swapTrace = CreateGridTrace(120, [](UINT i, UINT frame, float& x, float& z)
+		{
+			float t = frame / 119.0f;
+			UINT target = (i * 37 + 11) % 64;
+			float targetX = (target % 8) * 4.0f;
+			float targetZ = (target / 8) * 4.0f;
+			x += (targetX - x) * t;
+			z += (targetZ - z) * t;
+		});
+	passed &= CheckRebuildFrames("swap", swapTrace, settings, { 0, 1 }, true);
+
+	//the static scene with a refit limit
+	TLASRebuildPolicySettings limitSettings = settings;
+	limitSettings.maxRefitFrames = 100;
+	passed &= CheckRebuildFrames("static, 100 frame limit", staticTrace, limitSettings, { 0, 100, 200 }, false);
+
+	PrintValidationResult(passed);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include<Windows.h>
+#include<DirectXMath.h>
+#include<string>
+#include<vector>
+
+struct TLASInstanceBounds
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+};
+
+//world bounds of every instance, one entry per frame
+typedef std::vector<std::vector<TLASInstanceBounds>> TLASMotionTrace;
+
+struct TLASRebuildPolicySettings
+{
+	//refitted tree cost over the cost of a fresh build, above this the structure is rebuilt
+	float sahDegradationThreshold = 1.25f;
+
+	//largest instance movement since the build as a fraction of the scene diagonal, below this the tree isn't evaluated
+	float displacementThreshold = 0.05f;
+
+	//rebuild at least this often even if the estimate says the tree is fine
+	UINT maxRefitFrames = 900;
+
+	//rebuilds are scheduled on the async compute queue when the caller supports it
+	bool useAsyncCompute = false;
+};
+
+enum TLASRebuildReason
+{
+	TLAS_REFIT,
+	TLAS_REBUILD_FIRST_BUILD,
+	TLAS_REBUILD_STRUCTURE_CHANGED,
+	TLAS_REBUILD_SAH_DEGRADED,
+	TLAS_REBUILD_MAX_REFIT_FRAMES
+};
+
+struct TLASRebuildDecision
+{
+	bool rebuild;
+	bool async;
+	TLASRebuildReason reason;
+
+	float maxDisplacement;
+	//root area now over the root area at the build
+	float boundsGrowth;
+	//only evaluated when the displacement was over the threshold, 1 otherwise
+	float sahRatio;
+};
+
+struct TLASRebuildPolicyStats
+{
+	UINT refitCount;
+	UINT rebuildCount;
+	UINT sahEvaluations;
+	UINT framesSinceBuild;
+	TLASRebuildDecision lastDecision;
+};
+
+//decides between refitting and rebuilding the top level structure. The topology the driver builds is unknown, so a
+//morton ordered tree over the instances at build time stands in for it: refitting keeps that tree and grows its bounds,
+//a rebuild would sort the instances again. The ratio of the two costs estimates how far the refitted tree has degraded
+class TLASRebuildPolicy
+{
+	TLASRebuildPolicySettings settings;
+
+	std::vector<DirectX::XMFLOAT3> buildCentroids;
+	std::vector<UINT> buildOrder;
+	float buildRootArea;
+	float buildDiagonal;
+	bool built;
+
+	TLASRebuildPolicyStats stats;
+
+public:
+	TLASRebuildPolicy(TLASRebuildPolicySettings settings = TLASRebuildPolicySettings());
+	~TLASRebuildPolicy();
+
+	//call with the bounds the structure was built with, after every full build
+	void OnBuild(const std::vector<TLASInstanceBounds>& bounds);
+
+	//called once per frame before the build, structureChanged forces a rebuild
+	TLASRebuildDecision Evaluate(const std::vector<TLASInstanceBounds>& bounds, bool structureChanged = false);
+
+	//evaluate and, on a rebuild, take the bounds as the new build state
+	TLASRebuildDecision Update(const std::vector<TLASInstanceBounds>& bounds, bool structureChanged = false);
+
+	void SetSettings(TLASRebuildPolicySettings settings);
+	TLASRebuildPolicySettings& GetSettings();
+	const TLASRebuildPolicyStats& GetStats();
+
+	//surface area heuristic cost of the tree over the instances in this order, relative to the root area
+	static float ComputeTreeCost(const std::vector<TLASInstanceBounds>& bounds, const std::vector<UINT>& order);
+	static std::vector<UINT> ComputeMortonOrder(const std::vector<TLASInstanceBounds>& bounds);
+	static TLASInstanceBounds TransformBounds(const TLASInstanceBounds& local, DirectX::FXMMATRIX transform);
+	static TLASInstanceBounds ComputeBounds(const DirectX::XMFLOAT3* positions, size_t count, size_t stride);
+};
+
+//runs a fresh policy over every frame of the trace, returns the frames that rebuilt
+std::vector<UINT> RunTLASRebuildPolicy(const TLASMotionTrace& trace, TLASRebuildPolicySettings settings = TLASRebuildPolicySettings());
+
+bool SaveTLASMotionTrace(const std::string& fileName, const TLASMotionTrace& trace);
+bool LoadTLASMotionTrace(const std::string& fileName, TLASMotionTrace& trace);
+
+//runs the policy over generated traces with a known answer: a static scene, jitter, and instances swapping places
+void ValidateTLASRebuildPolicy();
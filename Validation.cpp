@@ -0,0 +1,75 @@
+#include "Validation.h"
+#include"BLASCache.h"
+#include"BlueNoisePermutations.h"
+#include"ClusteredLightGrid.h"
+#include"FFTPlan.h"
+#include"IrradianceSH.h"
+#include"LTCTable.h"
+#include"LTCTexturePrefilter.h"
+#include"LightLayout.h"
+#include"LightManager.h"
+#include"LightTree.h"
+#include"OceanHeightField.h"
+#include"OceanSimulation.h"
+#include"PipelineStateCache.h"
+#include"ReSTIRReference.h"
+#include"ReservoirPacking.h"
+#include"RootSignatureCache.h"
+#include"ShaderBindingTableManager.h"
+#include"ShaderBuildGraph.h"
+#include"ShaderLibraryCache.h"
+#include"ShaderWatcher.h"
+#include"SimulationClock.h"
+#include"TLASInstanceTable.h"
+#include"TLASRebuildPolicy.h"
+
+void Check(bool& passed, const char* name, bool condition)
+{
+	printf("  %-44s %s\n", name, condition ? "passed" : "FAILED");
+	passed = passed && condition;
+}
+
+void PrintValidationResult(bool passed)
+{
+	printf("  %s\n", passed ? "all passed" : "some FAILED");
+}
+
+void RunValidations()
+{
+	printf("Validations\n");
+	ValidateSimulationClock();
+	ValidateFFTPlan();
+	ValidateOceanHeightField();
+	ValidateReservoirPacking();
+	ValidateLightLayout();
+	ValidateLightTree();
+	ValidateClusteredLightGrid();
+	ValidateReSTIRReference();
+	ValidateBlueNoisePermutations();
+	ValidateLTCTable();
+	ValidateLTCPrefilter();
+	ValidateIrradianceSH();
+	ValidateBLASCache();
+	ValidateBLASMemoryAccounting();
+	ValidateShaderBindingTableManager();
+	ValidateTLASRebuildPolicy();
+	ValidatePipelineStateCache();
+	ValidateRootSignatureCache();
+	ValidateShaderLibraryCache();
+	ValidateShaderBuildGraph();
+	ValidateShaderWatcher();
+
+	printf("Benchmarks\n");
+	BenchmarkFFTPlan();
+	BenchmarkOceanSimulation();
+	BenchmarkOceanHeightQueries();
+	BenchmarkTLASInstanceTable();
+	BenchmarkLightManager();
+	BenchmarkLightTree();
+	BenchmarkClusteredLightGrid();
+	BenchmarkReSTIRReference();
+	BenchmarkBlueNoisePermutations();
+	BenchmarkLTCTable();
+	BenchmarkLTCPrefilter();
+	BenchmarkIrradianceSH();
+}
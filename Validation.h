@@ -0,0 +1,13 @@
+#pragma once
+
+#include<stdio.h>
+
+//one line of a Validate function's report, folded into whether the whole validation passed
+void Check(bool& passed, const char* name, bool condition);
+
+//the line closing a Validate function's report
+void PrintValidationResult(bool passed);
+
+//runs every cpu Validate and Benchmark function against the default assets. What the -validate command line flag
+//does in Game::Init, before the scene loads
+void RunValidations();